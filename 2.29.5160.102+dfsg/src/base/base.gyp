@@ -101,6 +101,7 @@
         'file_util.cc',
         'init_mozc.cc',
         'logging.cc',
+        'memory_stats.cc',
         'mmap.cc',
         'random.cc',
         'strings/unicode.cc',
@@ -109,6 +110,8 @@
         'text_normalizer.cc',
         'thread.cc',
         'thread2.cc',
+        'thread_pool.cc',
+        'trace.cc',
         'util.cc',
       ],
       'dependencies': [
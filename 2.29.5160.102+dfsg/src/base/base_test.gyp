@@ -57,6 +57,7 @@
       'sources': [
         'codegen_bytearray_stream_test.cc',
         'cpu_stats_test.cc',
+        'memory_stats_test.cc',
         'process_mutex_test.cc',
         'stopwatch_test.cc',
       ],
@@ -110,6 +111,8 @@
         'text_normalizer_test.cc',
         'thread_test.cc',
         'thread2_test.cc',
+        'thread_pool_test.cc',
+        'trace_test.cc',
         'version_test.cc',
       ],
       'conditions': [
@@ -343,6 +346,7 @@
       'target_name': 'trie_test',
       'type': 'executable',
       'sources': [
+        'container/flat_trie_test.cc',
         'container/trie_test.cc',
       ],
       'dependencies': [
@@ -0,0 +1,260 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Read-only trie stored in flat arrays. It has the same lookup semantics as
+// Trie<T> in base/container/trie.h, including the keys being matched per UTF-8
+// character, but the states and the transitions are kept in contiguous
+// vectors and found by binary search instead of a tree of hash maps.
+//
+//   std::vector<std::pair<std::string, int>> entries = {{"a", 1}, {"ab", 2}};
+//   FlatTrie<int> trie(entries);
+//   int value;
+//   trie.LookUp("ab", &value);  // value == 2
+
+#ifndef MOZC_BASE_CONTAINER_FLAT_TRIE_H_
+#define MOZC_BASE_CONTAINER_FLAT_TRIE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/util.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+
+template <typename T>
+class FlatTrie final {
+ public:
+  // Builds an empty trie.
+  FlatTrie() : states_(1) { root_ascii_.fill(kNoState); }
+
+  // Builds a trie from the pairs of a key and a value. If a key appears more
+  // than once, the last value is used. `Container` is a range of pairs whose
+  // first element is convertible to absl::string_view.
+  template <typename Container>
+  explicit FlatTrie(const Container &entries);
+
+  FlatTrie(const FlatTrie &) = default;
+  FlatTrie &operator=(const FlatTrie &) = default;
+  FlatTrie(FlatTrie &&) = default;
+  FlatTrie &operator=(FlatTrie &&) = default;
+
+  // The methods below are equivalent to the ones of Trie<T>.
+  bool LookUp(absl::string_view key, T *data) const {
+    const auto [state, rest] = Walk(key);
+    if (!rest.empty() || !states_[state].has_data()) {
+      return false;
+    }
+    *data = data_[states_[state].data_index];
+    return true;
+  }
+
+  bool LookUpPrefix(absl::string_view key, T *data, size_t *key_length,
+                    bool *fixed) const {
+    const auto [state, rest] = Walk(key);
+    *key_length = key.size() - rest.size();
+    const State &s = states_[state];
+    if (!s.has_data()) {
+      *fixed = true;
+      return false;
+    }
+    *data = data_[s.data_index];
+    *fixed = s.edge_begin == s.edge_end;
+    return true;
+  }
+
+  void LookUpPredictiveAll(absl::string_view key,
+                           std::vector<T> *data_list) const {
+    DCHECK(data_list);
+    const auto [state, rest] = Walk(key);
+    if (rest.empty()) {
+      CollectData(state, data_list);
+    }
+  }
+
+  bool HasSubTrie(absl::string_view key) const {
+    return !key.empty() && Walk(key).second.empty();
+  }
+
+  size_t states_size() const { return states_.size(); }
+
+ private:
+  static constexpr uint32_t kNoData = UINT32_MAX;
+  static constexpr uint32_t kNoState = UINT32_MAX;
+  static constexpr size_t kNumAsciiChars = 0x80;
+
+  struct Edge {
+    char32_t label;
+    uint32_t target;
+  };
+
+  struct State {
+    bool has_data() const { return data_index != kNoData; }
+
+    // The outgoing edges are edges_[edge_begin, edge_end), sorted by label.
+    uint32_t edge_begin = 0;
+    uint32_t edge_end = 0;
+    uint32_t data_index = kNoData;
+  };
+
+  using KeyAndIndex = std::pair<std::u32string, uint32_t>;
+
+  // Returns the state reached by `key` from the root and the unmatched rest
+  // of `key`. The rest is empty if the whole key is matched.
+  std::pair<uint32_t, absl::string_view> Walk(absl::string_view key) const {
+    uint32_t state = 0;
+    while (!key.empty()) {
+      char32_t c = static_cast<unsigned char>(key.front());
+      absl::string_view rest = key.substr(1);
+      if (c >= 0x80) {
+        // Decodes the same way as Trie<T> for compatibility with invalid
+        // UTF-8.
+        Util::SplitFirstChar32(key, &c, &rest);
+      }
+      const uint32_t next = Next(state, c);
+      if (next == kNoState) {
+        break;
+      }
+      state = next;
+      key = rest;
+    }
+    return {state, key};
+  }
+
+  uint32_t Next(uint32_t state, char32_t c) const {
+    if (state == 0 && c < kNumAsciiChars) {
+      return root_ascii_[c];
+    }
+    const State &s = states_[state];
+    const auto begin = edges_.begin() + s.edge_begin;
+    const auto end = edges_.begin() + s.edge_end;
+    const auto it = std::lower_bound(
+        begin, end, c, [](const Edge &e, char32_t c) { return e.label < c; });
+    return it != end && it->label == c ? it->target : kNoState;
+  }
+
+  void CollectData(uint32_t state, std::vector<T> *data_list) const {
+    const State &s = states_[state];
+    if (s.has_data()) {
+      data_list->push_back(data_[s.data_index]);
+    }
+    for (uint32_t i = s.edge_begin; i < s.edge_end; ++i) {
+      CollectData(edges_[i].target, data_list);
+    }
+  }
+
+  // Builds the states for keys[begin, end), which share the first `depth`
+  // characters, and returns the index of the state for the shared prefix.
+  uint32_t Build(const std::vector<KeyAndIndex> &keys, size_t begin,
+                 size_t end, size_t depth);
+
+  std::vector<State> states_;
+  std::vector<Edge> edges_;
+  std::vector<T> data_;
+  // Transitions from the root by ASCII characters, which most of the keys
+  // start with, indexed by the character.
+  std::array<uint32_t, kNumAsciiChars> root_ascii_;
+};
+
+template <typename T>
+template <typename Container>
+FlatTrie<T>::FlatTrie(const Container &entries) {
+  std::vector<KeyAndIndex> keys;
+  for (const auto &[key, value] : entries) {
+    keys.emplace_back(Util::Utf8ToUtf32(key), data_.size());
+    data_.push_back(value);
+  }
+  // The later one comes first among the same keys.
+  std::sort(keys.begin(), keys.end(),
+            [](const KeyAndIndex &lhs, const KeyAndIndex &rhs) {
+              return lhs.first != rhs.first ? lhs.first < rhs.first
+                                            : lhs.second > rhs.second;
+            });
+  keys.erase(std::unique(keys.begin(), keys.end(),
+                         [](const KeyAndIndex &lhs, const KeyAndIndex &rhs) {
+                           return lhs.first == rhs.first;
+                         }),
+             keys.end());
+  Build(keys, 0, keys.size(), 0);
+
+  root_ascii_.fill(kNoState);
+  const State &root = states_[0];
+  for (uint32_t i = root.edge_begin; i < root.edge_end; ++i) {
+    if (edges_[i].label < kNumAsciiChars) {
+      root_ascii_[edges_[i].label] = edges_[i].target;
+    }
+  }
+}
+
+template <typename T>
+uint32_t FlatTrie<T>::Build(const std::vector<KeyAndIndex> &keys,
+                            size_t begin, size_t end, size_t depth) {
+  const uint32_t state = states_.size();
+  states_.emplace_back();
+  if (begin < end && keys[begin].first.size() == depth) {
+    // The sorted keys have the shared prefix itself first.
+    states_[state].data_index = keys[begin].second;
+    ++begin;
+  }
+
+  // Allocates the edges of this state first so that they are contiguous.
+  std::vector<std::pair<size_t, size_t>> groups;
+  for (size_t i = begin; i < end;) {
+    const char32_t c = keys[i].first[depth];
+    size_t j = i + 1;
+    while (j < end && keys[j].first[depth] == c) {
+      ++j;
+    }
+    groups.emplace_back(i, j);
+    i = j;
+  }
+  const uint32_t edge_begin = edges_.size();
+  states_[state].edge_begin = edge_begin;
+  states_[state].edge_end = edge_begin + groups.size();
+  edges_.resize(edges_.size() + groups.size());
+
+  for (size_t i = 0; i < groups.size(); ++i) {
+    const auto [group_begin, group_end] = groups[i];
+    const char32_t label = keys[group_begin].first[depth];
+    const uint32_t target = Build(keys, group_begin, group_end, depth + 1);
+    edges_[edge_begin + i] = {label, target};
+  }
+  return state;
+}
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_CONTAINER_FLAT_TRIE_H_
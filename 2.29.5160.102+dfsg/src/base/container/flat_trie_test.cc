@@ -0,0 +1,129 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/container/flat_trie.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/container/trie.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace {
+
+using ::testing::UnorderedElementsAreArray;
+
+const std::vector<std::pair<std::string, std::string>> &GetEntries() {
+  static const auto *entries =
+      new std::vector<std::pair<std::string, std::string>>{
+          {"a", "あ"},    {"ka", "か"},   {"kk", "っ"},   {"kya", "きゃ"},
+          {"n", "ん"},    {"nn", "ん"},   {"na", "な"},   {"あ゛", "あ゛"},
+          {"か゛", "が"}, {"xtsu", "っ"}, {"ka", "カ"},   {"ttt", "ttt"},
+      };
+  return *entries;
+}
+
+Trie<std::string> BuildTrie() {
+  Trie<std::string> trie;
+  for (const auto &[key, value] : GetEntries()) {
+    trie.AddEntry(key, value);
+  }
+  return trie;
+}
+
+TEST(FlatTrieTest, Empty) {
+  const FlatTrie<int> trie;
+  int value = 0;
+  EXPECT_FALSE(trie.LookUp("", &value));
+  EXPECT_FALSE(trie.LookUp("a", &value));
+  EXPECT_FALSE(trie.HasSubTrie("a"));
+  std::vector<int> values;
+  trie.LookUpPredictiveAll("", &values);
+  EXPECT_TRUE(values.empty());
+}
+
+TEST(FlatTrieTest, LastValueWins) {
+  const FlatTrie<std::string> trie(GetEntries());
+  std::string value;
+  EXPECT_TRUE(trie.LookUp("ka", &value));
+  EXPECT_EQ(value, "カ");
+}
+
+// Checks that FlatTrie behaves the same as Trie for various keys.
+TEST(FlatTrieTest, SameAsTrie) {
+  const Trie<std::string> trie = BuildTrie();
+  const FlatTrie<std::string> flat_trie(GetEntries());
+
+  constexpr absl::string_view kKeys[] = {
+      "",   "a",    "ab",  "k",   "ka",  "kak", "kk",   "kky",  "ky", "kya",
+      "n",  "nn",   "nnn", "na",  "nx",  "x",   "xt",   "xtsu", "z",  "あ",
+      "あ゛", "あい", "か", "か゛", "か゛a", "t",  "tt",   "ttt",  "tttt",
+  };
+  for (const absl::string_view key : kKeys) {
+    SCOPED_TRACE(key);
+    std::string expected, actual;
+    EXPECT_EQ(flat_trie.LookUp(key, &actual), trie.LookUp(key, &expected));
+    EXPECT_EQ(actual, expected);
+
+    expected.clear();
+    actual.clear();
+    size_t expected_length = 0, actual_length = 0;
+    bool expected_fixed = false, actual_fixed = false;
+    EXPECT_EQ(
+        flat_trie.LookUpPrefix(key, &actual, &actual_length, &actual_fixed),
+        trie.LookUpPrefix(key, &expected, &expected_length, &expected_fixed));
+    EXPECT_EQ(actual, expected);
+    EXPECT_EQ(actual_length, expected_length);
+    EXPECT_EQ(actual_fixed, expected_fixed);
+
+    std::vector<std::string> expected_list, actual_list;
+    trie.LookUpPredictiveAll(key, &expected_list);
+    flat_trie.LookUpPredictiveAll(key, &actual_list);
+    EXPECT_THAT(actual_list, UnorderedElementsAreArray(expected_list));
+
+    EXPECT_EQ(flat_trie.HasSubTrie(key), trie.HasSubTrie(key));
+  }
+}
+
+TEST(FlatTrieTest, PredictiveOrder) {
+  const FlatTrie<std::string> trie(GetEntries());
+  std::vector<std::string> values;
+  trie.LookUpPredictiveAll("k", &values);
+  // The values are returned in the order of the keys.
+  EXPECT_EQ(values, (std::vector<std::string>{"カ", "っ", "きゃ"}));
+}
+
+}  // namespace
+}  // namespace mozc
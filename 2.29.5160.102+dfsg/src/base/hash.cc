@@ -29,9 +29,13 @@
 
 #include "base/hash.h"
 
+
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 
 #include "base/port.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 namespace {
@@ -73,29 +77,25 @@ constexpr uint32_t kFingerPrintSeed1 = 0x7a63;
     c ^= (b >> 15);  \
   }
 
-uint32_t Hash::Fingerprint32(absl::string_view str) {
-  return Fingerprint32WithSeed(str, kFingerPrint32Seed);
-}
-
-uint32_t Hash::Fingerprint32WithSeed(absl::string_view str, uint32_t seed) {
 #define U32(x) static_cast<uint32_t>(x)
 #define ToUint32(a, b, c, d) \
   (U32(a) + (U32(b) << 8) + (U32(c) << 16) + (U32(d) << 24))
 
-  const uint32_t str_len = U32(str.size());
-  uint32_t a = 0x9e3779b9;
-  uint32_t b = a;
-  uint32_t c = seed;
+namespace {
 
-  while (str.size() >= 12) {
-    a += ToUint32(str[0], str[1], str[2], str[3]);
-    b += ToUint32(str[4], str[5], str[6], str[7]);
-    c += ToUint32(str[8], str[9], str[10], str[11]);
-    Mix(a, b, c);
-    str.remove_prefix(12);
-  }
+// Mixes one 12-byte block into the state (a, b, c).
+inline void MixBlock(const char* str, uint32_t& a, uint32_t& b, uint32_t& c) {
+  a += ToUint32(str[0], str[1], str[2], str[3]);
+  b += ToUint32(str[4], str[5], str[6], str[7]);
+  c += ToUint32(str[8], str[9], str[10], str[11]);
+  Mix(a, b, c);
+}
 
-  c += U32(str_len);
+// Mixes the last (less than 12 bytes) |str| and the total length |str_len|
+// into the state, and returns the 32-bit fingerprint.
+inline uint32_t MixTail(absl::string_view str, uint32_t str_len, uint32_t a,
+                        uint32_t b, uint32_t c) {
+  c += str_len;
   switch (str.size()) {
     case 11:
       c += U32(str[10]) << 24;
@@ -132,10 +132,34 @@ uint32_t Hash::Fingerprint32WithSeed(absl::string_view str, uint32_t seed) {
       break;
   }
   Mix(a, b, c);
-
   return c;
-#undef ToUint32
-#undef U32
+}
+
+uint64_t CombineFingerprint(uint32_t hi, uint32_t lo) {
+  uint64_t result = static_cast<uint64_t>(hi) << 32 | static_cast<uint64_t>(lo);
+  if ((hi == 0) && (lo < 2)) {
+    result ^= 0x130f9bef94a0a928uLL;
+  }
+  return result;
+}
+
+}  // namespace
+
+uint32_t Hash::Fingerprint32(absl::string_view str) {
+  return Fingerprint32WithSeed(str, kFingerPrint32Seed);
+}
+
+uint32_t Hash::Fingerprint32WithSeed(absl::string_view str, uint32_t seed) {
+  const uint32_t str_len = U32(str.size());
+  uint32_t a = 0x9e3779b9;
+  uint32_t b = a;
+  uint32_t c = seed;
+
+  while (str.size() >= 12) {
+    MixBlock(str.data(), a, b, c);
+    str.remove_prefix(12);
+  }
+  return MixTail(str, str_len, a, b, c);
 }
 
 uint64_t Hash::Fingerprint(absl::string_view str) {
@@ -145,11 +169,52 @@ uint64_t Hash::Fingerprint(absl::string_view str) {
 uint64_t Hash::FingerprintWithSeed(absl::string_view str, uint32_t seed) {
   const uint32_t hi = Fingerprint32WithSeed(str, seed);
   const uint32_t lo = Fingerprint32WithSeed(str, kFingerPrintSeed1);
-  uint64_t result = static_cast<uint64_t>(hi) << 32 | static_cast<uint64_t>(lo);
-  if ((hi == 0) && (lo < 2)) {
-    result ^= 0x130f9bef94a0a928uLL;
+  return CombineFingerprint(hi, lo);
+}
+
+FingerprintBuilder::FingerprintBuilder()
+    : FingerprintBuilder(kFingerPrintSeed0) {}
+
+FingerprintBuilder::FingerprintBuilder(uint32_t seed)
+    : hi_{0x9e3779b9, 0x9e3779b9, seed},
+      lo_{0x9e3779b9, 0x9e3779b9, kFingerPrintSeed1} {}
+
+void FingerprintBuilder::MixBlocks(const char* str, size_t blocks,
+                                   State* state) {
+  // Works on local copies so that the state stays in registers.
+  uint32_t a = state->a, b = state->b, c = state->c;
+  for (size_t i = 0; i < blocks; ++i, str += 12) {
+    MixBlock(str, a, b, c);
   }
-  return result;
+  *state = {a, b, c};
+}
+
+FingerprintBuilder& FingerprintBuilder::AppendAndMix(absl::string_view str) {
+  length_ += U32(str.size());
+  while (buffered_ + str.size() >= sizeof(buffer_)) {
+    const size_t n = sizeof(buffer_) - buffered_;
+    std::copy_n(str.data(), n, buffer_ + buffered_);
+    str.remove_prefix(n);
+    MixBlocks(buffer_, kBufferBlocks, &hi_);
+    MixBlocks(buffer_, kBufferBlocks, &lo_);
+    buffered_ = 0;
+  }
+  std::copy(str.begin(), str.end(), buffer_ + buffered_);
+  buffered_ += str.size();
+  return *this;
+}
+
+uint64_t FingerprintBuilder::Finish() const {
+  const size_t blocks = buffered_ / 12;
+  State hi = hi_, lo = lo_;
+  MixBlocks(buffer_, blocks, &hi);
+  MixBlocks(buffer_, blocks, &lo);
+  const absl::string_view tail(buffer_ + blocks * 12, buffered_ - blocks * 12);
+  return CombineFingerprint(MixTail(tail, length_, hi.a, hi.b, hi.c),
+                            MixTail(tail, length_, lo.a, lo.b, lo.c));
 }
 
+#undef ToUint32
+#undef U32
+
 }  // namespace mozc
@@ -30,6 +30,8 @@
 #ifndef MOZC_BASE_HASH_H_
 #define MOZC_BASE_HASH_H_
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
 
@@ -86,6 +88,54 @@ class Hash {
   }
 };
 
+// Computes Hash::FingerprintWithSeed() of the concatenation of the appended
+// pieces without materializing the concatenated string, e.g.,
+//
+//   FingerprintBuilder builder(seed);
+//   builder.Append("foo").Append("\t").Append("bar");
+//   builder.Finish() == Hash::FingerprintWithSeed("foo\tbar", seed);
+//
+// The result is bit-identical to the one-shot functions, so it can be used to
+// look up fingerprints that were stored from joined strings.
+class FingerprintBuilder {
+ public:
+  // Uses the same seed as Hash::Fingerprint().
+  FingerprintBuilder();
+  explicit FingerprintBuilder(uint32_t seed);
+
+  FingerprintBuilder& Append(absl::string_view str) {
+    if (buffered_ + str.size() < sizeof(buffer_)) {
+      std::copy(str.begin(), str.end(), buffer_ + buffered_);
+      buffered_ += str.size();
+      length_ += static_cast<uint32_t>(str.size());
+      return *this;
+    }
+    return AppendAndMix(str);
+  }
+
+  // Returns the fingerprint of the pieces appended so far. The builder can
+  // still be appended to after this call.
+  uint64_t Finish() const;
+
+ private:
+  struct State {
+    uint32_t a, b, c;
+  };
+
+  FingerprintBuilder& AppendAndMix(absl::string_view str);
+  static void MixBlocks(const char* str, size_t blocks, State* state);
+
+  // Pieces are buffered and mixed in batches of blocks, as mixing every
+  // 12-byte block as soon as it is complete is slower for short pieces.
+  static constexpr size_t kBufferBlocks = 8;
+
+  State hi_;
+  State lo_;
+  uint32_t length_ = 0;
+  size_t buffered_ = 0;
+  char buffer_[12 * kBufferBlocks];
+};
+
 }  // namespace mozc
 
 #endif  // MOZC_BASE_HASH_H_
@@ -29,11 +29,14 @@
 
 #include "base/hash.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
 #include "base/port.h"
 #include "testing/gunit.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 
 namespace mozc {
 namespace {
@@ -98,5 +101,38 @@ TEST(HashTest, Fingerprint32WithSeed_IntegralTypes) {
   }
 }
 
+TEST(HashTest, FingerprintBuilder) {
+  EXPECT_EQ(FingerprintBuilder().Finish(), Hash::Fingerprint(""));
+  EXPECT_EQ(FingerprintBuilder().Append("google").Finish(),
+            Hash::Fingerprint("google"));
+
+  // Every split of the string must give the same result as the one-shot
+  // function, including splits inside and across the 12-byte blocks and the
+  // internal buffer.
+  const std::string s = absl::StrCat(
+      "Hello, world!  Hello, Tokyo!  Good afternoon!  Ladies and gentlemen.",
+      "こんにちは、世界。こんにちは、東京。こんにちは、皆さん。",
+      "Hello, world!  Hello, Tokyo!  Good afternoon!  Ladies and gentlemen.");
+  const uint32_t seed = 0xdeadbeef;
+  const uint64_t expected = Hash::FingerprintWithSeed(s, seed);
+  const absl::string_view sv = s;
+  for (size_t i = 0; i <= s.size(); ++i) {
+    for (size_t j = i; j <= s.size(); ++j) {
+      FingerprintBuilder builder(seed);
+      builder.Append(sv.substr(0, i))
+          .Append(sv.substr(i, j - i))
+          .Append(sv.substr(j));
+      EXPECT_EQ(builder.Finish(), expected) << i << ", " << j;
+    }
+  }
+
+  // Finish() does not end the stream.
+  FingerprintBuilder builder(seed);
+  builder.Append("Hello");
+  EXPECT_EQ(builder.Finish(), Hash::FingerprintWithSeed("Hello", seed));
+  builder.Append(", world!");
+  EXPECT_EQ(builder.Finish(), Hash::FingerprintWithSeed("Hello, world!", seed));
+}
+
 }  // namespace
 }  // namespace mozc
@@ -0,0 +1,78 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/memory_stats.h"
+
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+
+MemoryStats::Scope::Scope(MemoryStats *stats, absl::string_view name)
+    : stats_(stats), prefix_size_(stats->prefix_.size()) {
+  absl::StrAppend(&stats_->prefix_, name, "/");
+}
+
+MemoryStats::Scope::~Scope() { stats_->prefix_.resize(prefix_size_); }
+
+void MemoryStats::Add(absl::string_view name, size_t bytes) {
+  entries_[absl::StrCat(prefix_, name)] += bytes;
+  total_bytes_ += bytes;
+}
+
+size_t MemoryStats::Get(absl::string_view name) const {
+  const auto it = entries_.find(name);
+  return it == entries_.end() ? 0 : it->second;
+}
+
+size_t MemoryStats::GetTotal(absl::string_view prefix) const {
+  size_t total = 0;
+  for (auto it = entries_.lower_bound(prefix);
+       it != entries_.end() && absl::StartsWith(it->first, prefix); ++it) {
+    const absl::string_view rest =
+        absl::string_view(it->first).substr(prefix.size());
+    if (rest.empty() || rest.front() == '/') {
+      total += it->second;
+    }
+  }
+  return total;
+}
+
+size_t MemoryStats::StringBytes(const std::string &str) {
+  // The capacity of an empty string is the size of the inline buffer.
+  static const size_t kInlineCapacity = std::string().capacity();
+  return str.capacity() > kInlineCapacity ? str.capacity() + 1 : 0;
+}
+
+}  // namespace mozc
@@ -0,0 +1,102 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_BASE_MEMORY_STATS_H_
+#define MOZC_BASE_MEMORY_STATS_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/container/btree_map.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+
+// Collects the approximate number of bytes held by the components of the
+// engine and the sessions.  Entries are keyed by slash separated names, e.g.
+// "engine/connector/cache", so that the callers can aggregate them by prefix.
+// The values are estimates of the heap and the mapped memory; they are meant
+// for sizing the hosts and finding leaks, not for exact accounting.
+//
+// Usage:
+//   MemoryStats stats;
+//   {
+//     MemoryStats::Scope scope(&stats, "engine");
+//     engine->GetMemoryStats(&stats);  // Adds "engine/..." entries.
+//   }
+//   LOG(INFO) << stats.total_bytes();
+class MemoryStats {
+ public:
+  // Prepends |name| to the names added to |stats| while this object is alive.
+  class Scope {
+   public:
+    Scope(MemoryStats *stats, absl::string_view name);
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope();
+
+   private:
+    MemoryStats *stats_;
+    size_t prefix_size_;
+  };
+
+  MemoryStats() = default;
+  MemoryStats(const MemoryStats &) = delete;
+  MemoryStats &operator=(const MemoryStats &) = delete;
+
+  // Adds |bytes| to the entry |name| under the current scope.  Adding to the
+  // same name accumulates, which is used to sum up the sessions.
+  void Add(absl::string_view name, size_t bytes);
+
+  // Returns the bytes of the entry |name| (full name), or 0 if not added.
+  size_t Get(absl::string_view name) const;
+
+  // Returns the sum of the entries whose names start with |prefix|/ or equal
+  // to |prefix|.
+  size_t GetTotal(absl::string_view prefix) const;
+
+  size_t total_bytes() const { return total_bytes_; }
+  const absl::btree_map<std::string, size_t> &entries() const {
+    return entries_;
+  }
+
+  // Returns the heap bytes owned by |str|, i.e. 0 if the string is small
+  // enough to be stored inline.
+  static size_t StringBytes(const std::string &str);
+
+ private:
+  std::string prefix_;
+  absl::btree_map<std::string, size_t> entries_;
+  size_t total_bytes_ = 0;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_MEMORY_STATS_H_
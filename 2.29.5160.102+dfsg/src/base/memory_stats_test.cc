@@ -0,0 +1,78 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/memory_stats.h"
+
+#include <string>
+
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(MemoryStatsTest, AddAndScope) {
+  MemoryStats stats;
+  stats.Add("a", 1);
+  {
+    MemoryStats::Scope scope(&stats, "b");
+    stats.Add("c", 10);
+    {
+      MemoryStats::Scope inner(&stats, "d");
+      stats.Add("e", 100);
+      stats.Add("e", 100);
+    }
+    stats.Add("f", 1000);
+  }
+  stats.Add("bb", 10000);
+
+  EXPECT_EQ(stats.Get("a"), 1);
+  EXPECT_EQ(stats.Get("b/c"), 10);
+  EXPECT_EQ(stats.Get("b/d/e"), 200);
+  EXPECT_EQ(stats.Get("b/f"), 1000);
+  EXPECT_EQ(stats.Get("bb"), 10000);
+  EXPECT_EQ(stats.Get("e"), 0);
+  EXPECT_EQ(stats.entries().size(), 5);
+  EXPECT_EQ(stats.total_bytes(), 11211);
+
+  EXPECT_EQ(stats.GetTotal("b"), 1210);
+  EXPECT_EQ(stats.GetTotal("b/d"), 200);
+  EXPECT_EQ(stats.GetTotal("bb"), 10000);
+  EXPECT_EQ(stats.GetTotal("x"), 0);
+}
+
+TEST(MemoryStatsTest, StringBytes) {
+  EXPECT_EQ(MemoryStats::StringBytes(""), 0);
+  EXPECT_EQ(MemoryStats::StringBytes("a"), 0);
+  const std::string large(1000, 'a');
+  EXPECT_GT(MemoryStats::StringBytes(large), large.size());
+}
+
+}  // namespace
+}  // namespace mozc
@@ -0,0 +1,176 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "base/singleton.h"
+#include "base/thread2.h"
+#include "absl/flags/flag.h"
+#include "absl/synchronization/mutex.h"
+
+ABSL_FLAG(int32_t, thread_pool_size, 0,
+          "Number of threads of the shared thread pool. 0 means the number "
+          "decided from the hardware concurrency.");
+
+namespace mozc {
+namespace {
+
+// The pool and the index of the worker running on the current thread.
+// current_pool is nullptr if the current thread is not a worker.
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+size_t GetDefaultNumThreads() {
+  const int32_t flag = absl::GetFlag(FLAGS_thread_pool_size);
+  if (flag > 0) {
+    return flag;
+  }
+  // Background jobs should not compete with the foreground conversion, so the
+  // pool uses only a few cores even on large machines.
+  constexpr size_t kMinThreads = 2;
+  constexpr size_t kMaxThreads = 4;
+  return std::clamp<size_t>(std::thread::hardware_concurrency(), kMinThreads,
+                            kMaxThreads);
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool() : ThreadPool(GetDefaultNumThreads()) {}
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  num_threads = std::max<size_t>(num_threads, 1);
+  workers_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  threads_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+    cond_.SignalAll();
+  }
+  for (Thread2 &thread : threads_) {
+    thread.Join();
+  }
+}
+
+ThreadPool *ThreadPool::GetDefaultThreadPool() {
+  return Singleton<ThreadPool>::get();
+}
+
+void ThreadPool::Enqueue(Priority priority, Task task) {
+  // Tasks scheduled from a worker go to its own queue, so that they are likely
+  // run by the same thread.
+  const size_t index = current_pool == this
+                           ? current_worker
+                           : next_worker_.fetch_add(1) % workers_.size();
+  {
+    Worker &worker = *workers_[index];
+    absl::MutexLock lock(&worker.mutex);
+    worker.queues[priority].push_back(std::move(task));
+  }
+  absl::MutexLock lock(&mutex_);
+  ++num_pending_;
+  cond_.Signal();
+}
+
+std::optional<ThreadPool::Task> ThreadPool::TakeTask(size_t index) {
+  {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](ThreadPool *pool) ABSL_EXCLUSIVE_LOCKS_REQUIRED(pool->mutex_) {
+          return pool->num_pending_ > 0 || pool->stopping_;
+        },
+        this));
+    if (num_pending_ == 0) {
+      // Stopping and no tasks remain.
+      return std::nullopt;
+    }
+    // Reserves one task. It is taken below, though maybe from another queue
+    // than the one where the reserved task was pushed.
+    --num_pending_;
+  }
+
+  for (;;) {
+    for (int priority = 0; priority < NUM_PRIORITIES; ++priority) {
+      {
+        // Takes the oldest task of its own queue.
+        Worker &worker = *workers_[index];
+        absl::MutexLock lock(&worker.mutex);
+        std::deque<Task> &queue = worker.queues[priority];
+        if (!queue.empty()) {
+          Task task = std::move(queue.front());
+          queue.pop_front();
+          return task;
+        }
+      }
+      // Steals the newest task of the other workers.
+      for (size_t i = 1; i < workers_.size(); ++i) {
+        Worker &victim = *workers_[(index + i) % workers_.size()];
+        absl::MutexLock lock(&victim.mutex);
+        std::deque<Task> &queue = victim.queues[priority];
+        if (!queue.empty()) {
+          Task task = std::move(queue.back());
+          queue.pop_back();
+          return task;
+        }
+      }
+    }
+    // Enqueue() counts a task after pushing it, so there are always as many
+    // tasks in the queues as reservations. The scan can still miss them when
+    // other workers move tasks concurrently, so scans again.
+    std::this_thread::yield();
+  }
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+  current_pool = this;
+  current_worker = index;
+  while (std::optional<Task> task = TakeTask(index)) {
+    std::move (*task)();
+  }
+  current_pool = nullptr;
+}
+
+}  // namespace mozc
@@ -0,0 +1,319 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_BASE_THREAD_POOL_H_
+#define MOZC_BASE_THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "base/thread2.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+
+namespace mozc {
+namespace internal {
+
+template <class T>
+struct TaskResult {
+  using type = absl::StatusOr<T>;
+};
+
+template <>
+struct TaskResult<void> {
+  using type = absl::Status;
+};
+
+// State shared by a task in the pool and its TaskFuture.
+template <class T>
+struct TaskState {
+  using Result = typename TaskResult<T>::type;
+
+  // Runs |f| unless the task has been cancelled.
+  template <class F>
+  void Run(F &&f) ABSL_LOCKS_EXCLUDED(mutex);
+
+  mutable absl::Mutex mutex;
+  bool started ABSL_GUARDED_BY(mutex) = false;
+  std::optional<Result> result ABSL_GUARDED_BY(mutex);
+};
+
+}  // namespace internal
+
+// Represents the result of a task scheduled on ThreadPool. The API is the
+// same as BackgroundFuture, except that the result is wrapped in
+// absl::StatusOr<T> (absl::Status for void) so that a cancelled task can be
+// told apart.
+template <class T>
+class TaskFuture {
+ public:
+  using Result = typename internal::TaskResult<T>::type;
+
+  explicit TaskFuture(std::shared_ptr<internal::TaskState<T>> state)
+      : state_(std::move(state)) {}
+
+  TaskFuture(const TaskFuture &) = delete;
+  TaskFuture &operator=(const TaskFuture &) = delete;
+
+  TaskFuture(TaskFuture &&) = default;
+  TaskFuture &operator=(TaskFuture &&) = default;
+
+  // Blocks until the task finishes, like ~BackgroundFuture.
+  ~TaskFuture();
+
+  // Blocks until the future becomes ready, and returns the result by
+  // reference.
+  const Result &Get() const &ABSL_LOCKS_EXCLUDED(state_->mutex);
+
+  // Blocks until the future becomes ready, and returns the result by move.
+  Result Get() && ABSL_LOCKS_EXCLUDED(state_->mutex);
+
+  // Returns whether the future is ready.
+  bool Ready() const ABSL_LOCKS_EXCLUDED(state_->mutex);
+
+  // Blocks until the future becomes ready.
+  void Wait() const ABSL_LOCKS_EXCLUDED(state_->mutex);
+
+  // Cancels the task if it has not started yet. The result becomes
+  // absl::CancelledError. Returns false if the task has already started or
+  // finished. A running task is not interrupted.
+  bool Cancel() ABSL_LOCKS_EXCLUDED(state_->mutex);
+
+ private:
+  std::shared_ptr<internal::TaskState<T>> state_;
+};
+
+// A fixed number of worker threads shared by the background jobs of the
+// process, e.g. saving the user history or loading a new data set. It caps
+// the threads used by such jobs and saves a thread creation per job.
+//
+// Each worker has its own queue per priority. A worker takes the oldest task
+// of its own queue, and steals the newest one from the other workers when its
+// own queue is empty. Higher priority tasks are taken first.
+//
+// A task may schedule other tasks, but waiting for them from the task blocks
+// its worker. Don't do it on a pool with a single thread.
+class ThreadPool {
+ public:
+  enum Priority {
+    HIGH,
+    NORMAL,
+    LOW,
+    NUM_PRIORITIES,
+  };
+
+  // Uses the number of threads given by --thread_pool_size.
+  ThreadPool();
+  explicit ThreadPool(size_t num_threads);
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Runs the remaining tasks and joins the workers.
+  ~ThreadPool();
+
+  // Returns the pool shared in the process.
+  static ThreadPool *GetDefaultThreadPool();
+
+  // Schedules `f()`. The task holds a decayed copy of `f`.
+  template <class F>
+  auto Schedule(Priority priority, F &&f)
+      -> TaskFuture<std::invoke_result_t<std::decay_t<F>>>;
+
+  template <class F>
+  auto Schedule(F &&f) -> TaskFuture<std::invoke_result_t<std::decay_t<F>>> {
+    return Schedule(NORMAL, std::forward<F>(f));
+  }
+
+  size_t num_threads() const { return workers_.size(); }
+
+ private:
+  using Task = absl::AnyInvocable<void() &&>;
+
+  struct Worker {
+    absl::Mutex mutex;
+    std::deque<Task> queues[NUM_PRIORITIES] ABSL_GUARDED_BY(mutex);
+  };
+
+  void Enqueue(Priority priority, Task task) ABSL_LOCKS_EXCLUDED(mutex_);
+  std::optional<Task> TakeTask(size_t index) ABSL_LOCKS_EXCLUDED(mutex_);
+  void WorkerLoop(size_t index) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<Thread2> threads_;
+  // Worker to put the next task from outside of the pool.
+  std::atomic<size_t> next_worker_ = 0;
+
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  size_t num_pending_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// Splits [0, size) into contiguous ranges of at least `min_range_size`
+// elements, calls `f(begin, end)` for each of them on `pool` and waits for
+// all of them. The calling thread runs one of the ranges itself. Calls
+// `f(0, size)` inline if `pool` is nullptr. Like other blocking waits, this
+// must not be called from a task of a pool with a single thread.
+template <class F>
+void ParallelFor(ThreadPool *pool, size_t size, size_t min_range_size, F &&f);
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementations
+////////////////////////////////////////////////////////////////////////////////
+
+namespace internal {
+
+template <class T>
+template <class F>
+void TaskState<T>::Run(F &&f) {
+  {
+    absl::MutexLock lock(&mutex);
+    if (result.has_value()) {
+      // Cancelled.
+      return;
+    }
+    started = true;
+  }
+  if constexpr (std::is_void_v<T>) {
+    std::invoke(std::forward<F>(f));
+    absl::MutexLock lock(&mutex);
+    result = absl::OkStatus();
+  } else {
+    T value = std::invoke(std::forward<F>(f));
+    absl::MutexLock lock(&mutex);
+    result = std::move(value);
+  }
+}
+
+}  // namespace internal
+
+template <class T>
+TaskFuture<T>::~TaskFuture() {
+  if (state_ != nullptr) {
+    Wait();
+  }
+}
+
+template <class T>
+const typename TaskFuture<T>::Result &TaskFuture<T>::Get() const & {
+  Wait();
+  absl::MutexLock lock(&state_->mutex);
+  return *state_->result;
+}
+
+template <class T>
+typename TaskFuture<T>::Result TaskFuture<T>::Get() && {
+  Wait();
+  absl::MutexLock lock(&state_->mutex);
+  return *std::move(state_->result);
+}
+
+template <class T>
+bool TaskFuture<T>::Ready() const {
+  absl::MutexLock lock(&state_->mutex);
+  return state_->result.has_value();
+}
+
+template <class T>
+void TaskFuture<T>::Wait() const {
+  absl::MutexLock lock(
+      &state_->mutex,
+      absl::Condition(
+          +[](std::optional<Result> *r) { return r->has_value(); },
+          &state_->result));
+}
+
+template <class T>
+bool TaskFuture<T>::Cancel() {
+  absl::MutexLock lock(&state_->mutex);
+  if (state_->started || state_->result.has_value()) {
+    return false;
+  }
+  state_->result = absl::CancelledError("The task is cancelled");
+  return true;
+}
+
+template <class F>
+auto ThreadPool::Schedule(Priority priority, F &&f)
+    -> TaskFuture<std::invoke_result_t<std::decay_t<F>>> {
+  using T = std::invoke_result_t<std::decay_t<F>>;
+  auto state = std::make_shared<internal::TaskState<T>>();
+  Enqueue(priority, [state, f = std::forward<F>(f)]() mutable {
+    state->Run(std::move(f));
+  });
+  return TaskFuture<T>(std::move(state));
+}
+
+template <class F>
+void ParallelFor(ThreadPool *pool, const size_t size,
+                 const size_t min_range_size, F &&f) {
+  if (size == 0) {
+    return;
+  }
+  size_t num_ranges = 1;
+  if (pool != nullptr) {
+    // A few ranges per thread so that uneven ranges are balanced by stealing.
+    num_ranges = std::min(pool->num_threads() * 4,
+                          size / std::max<size_t>(min_range_size, 1));
+    num_ranges = std::max<size_t>(num_ranges, 1);
+  }
+  if (num_ranges == 1) {
+    std::invoke(f, size_t{0}, size);
+    return;
+  }
+  std::vector<TaskFuture<void>> futures;
+  futures.reserve(num_ranges - 1);
+  for (size_t i = 1; i < num_ranges; ++i) {
+    const size_t begin = size * i / num_ranges;
+    const size_t end = size * (i + 1) / num_ranges;
+    futures.push_back(
+        pool->Schedule([&f, begin, end] { std::invoke(f, begin, end); }));
+  }
+  std::invoke(f, size_t{0}, size / num_ranges);
+  for (const TaskFuture<void> &future : futures) {
+    future.Wait();
+  }
+}
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_THREAD_POOL_H_
@@ -0,0 +1,200 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/thread_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "testing/gunit.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/notification.h"
+
+namespace mozc {
+namespace {
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+  ThreadPool pool(3);
+  EXPECT_EQ(pool.num_threads(), 3);
+
+  std::vector<TaskFuture<int>> futures;
+  for (int i = 0; i < 100; ++i) {
+    futures.push_back(pool.Schedule([i] { return i * i; }));
+  }
+  for (int i = 0; i < 100; ++i) {
+    const absl::StatusOr<int> &result = futures[i].Get();
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(*result, i * i);
+  }
+}
+
+TEST(ThreadPoolTest, Void) {
+  ThreadPool pool(2);
+  std::atomic<int> counter = 0;
+  {
+    std::vector<TaskFuture<void>> futures;
+    for (int i = 0; i < 10; ++i) {
+      futures.push_back(pool.Schedule([&counter] { counter.fetch_add(1); }));
+    }
+    for (const TaskFuture<void> &future : futures) {
+      EXPECT_TRUE(future.Get().ok());
+      EXPECT_TRUE(future.Ready());
+    }
+  }
+  EXPECT_EQ(counter.load(), 10);
+}
+
+TEST(ThreadPoolTest, MoveOnlyResult) {
+  ThreadPool pool(1);
+  TaskFuture<std::unique_ptr<std::string>> future =
+      pool.Schedule([] { return std::make_unique<std::string>("mozc"); });
+  absl::StatusOr<std::unique_ptr<std::string>> result =
+      std::move(future).Get();
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(**result, "mozc");
+}
+
+TEST(ThreadPoolTest, Priority) {
+  ThreadPool pool(1);
+  absl::Notification blocked, release;
+  TaskFuture<void> blocker = pool.Schedule([&] {
+    blocked.Notify();
+    release.WaitForNotification();
+  });
+  blocked.WaitForNotification();
+
+  // The only worker is busy, so the tasks below are queued and then run in
+  // the order of the priorities.
+  std::vector<int> order;
+  TaskFuture<void> low =
+      pool.Schedule(ThreadPool::LOW, [&order] { order.push_back(3); });
+  TaskFuture<void> normal =
+      pool.Schedule(ThreadPool::NORMAL, [&order] { order.push_back(2); });
+  TaskFuture<void> high =
+      pool.Schedule(ThreadPool::HIGH, [&order] { order.push_back(1); });
+  release.Notify();
+  low.Wait();
+  normal.Wait();
+  high.Wait();
+  EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+}
+
+TEST(ThreadPoolTest, Cancel) {
+  ThreadPool pool(1);
+  absl::Notification blocked, release;
+  TaskFuture<void> blocker = pool.Schedule([&] {
+    blocked.Notify();
+    release.WaitForNotification();
+  });
+  blocked.WaitForNotification();
+
+  // A running task can't be cancelled.
+  EXPECT_FALSE(blocker.Cancel());
+
+  bool run = false;
+  TaskFuture<int> queued = pool.Schedule([&run] {
+    run = true;
+    return 1;
+  });
+  EXPECT_TRUE(queued.Cancel());
+  EXPECT_TRUE(queued.Ready());
+  EXPECT_FALSE(queued.Cancel());
+  release.Notify();
+
+  EXPECT_TRUE(blocker.Get().ok());
+  EXPECT_TRUE(absl::IsCancelled(queued.Get().status()));
+  // The cancelled task is dropped by the worker without running it.
+  pool.Schedule([] {}).Wait();
+  EXPECT_FALSE(run);
+}
+
+TEST(ThreadPoolTest, ScheduleFromTask) {
+  ThreadPool pool(2);
+  TaskFuture<int> outer = pool.Schedule([&pool] {
+    int sum = 0;
+    std::vector<TaskFuture<int>> inner;
+    for (int i = 1; i <= 10; ++i) {
+      inner.push_back(pool.Schedule([i] { return i; }));
+    }
+    for (TaskFuture<int> &future : inner) {
+      sum += *future.Get();
+    }
+    return sum;
+  });
+  EXPECT_EQ(*outer.Get(), 55);
+}
+
+TEST(ThreadPoolTest, DestructorRunsPendingTasks) {
+  std::atomic<int> counter = 0;
+  {
+    ThreadPool pool(2);
+    for (int i = 0; i < 50; ++i) {
+      // Drops the futures, which waits for each task.
+      pool.Schedule([&counter] { counter.fetch_add(1); });
+    }
+  }
+  EXPECT_EQ(counter.load(), 50);
+}
+
+TEST(ThreadPoolTest, DefaultThreadPool) {
+  ThreadPool *pool = ThreadPool::GetDefaultThreadPool();
+  ASSERT_NE(pool, nullptr);
+  EXPECT_EQ(pool, ThreadPool::GetDefaultThreadPool());
+  EXPECT_GE(pool->num_threads(), 1);
+  EXPECT_EQ(*pool->Schedule([] { return 42; }).Get(), 42);
+}
+
+TEST(ThreadPoolTest, ParallelFor) {
+  ThreadPool pool(3);
+  for (const size_t size : {0, 1, 7, 1000}) {
+    std::vector<int> visited(size, 0);
+    ParallelFor(&pool, size, 2, [&visited](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        ++visited[i];
+      }
+    });
+    EXPECT_EQ(visited, std::vector<int>(size, 1)) << size;
+  }
+
+  // Runs inline without a pool.
+  size_t calls = 0;
+  ParallelFor(nullptr, 100, 1, [&calls](size_t begin, size_t end) {
+    EXPECT_EQ(begin, 0);
+    EXPECT_EQ(end, 100);
+    ++calls;
+  });
+  EXPECT_EQ(calls, 1);
+}
+
+}  // namespace
+}  // namespace mozc
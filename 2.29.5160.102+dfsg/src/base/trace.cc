@@ -0,0 +1,276 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/trace.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+
+#ifdef __GNUC__
+#include <cxxabi.h>
+
+#include <cstdlib>
+#endif  // __GNUC__
+
+namespace mozc {
+namespace {
+
+struct Event {
+  // One of name and type is set.
+  const char *name;
+  const std::type_info *type;
+  int64_t begin_ns;
+  int64_t duration_ns;
+};
+
+// The events of a thread. The mutex is taken by the owner thread on every
+// event and by the exporter, so it's almost never contended.
+class ThreadBuffer {
+ public:
+  explicit ThreadBuffer(int tid) : tid_(tid) {}
+
+  void Add(const Event &event) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    if (events_.size() < Trace::kBufferSize) {
+      events_.push_back(event);
+    } else {
+      events_[next_] = event;
+    }
+    next_ = (next_ + 1) % Trace::kBufferSize;
+  }
+
+  // Returns the events from the oldest one.
+  std::vector<Event> GetEvents() const ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    if (events_.size() < Trace::kBufferSize) {
+      return events_;
+    }
+    std::vector<Event> events(events_.begin() + next_, events_.end());
+    events.insert(events.end(), events_.begin(), events_.begin() + next_);
+    return events;
+  }
+
+  void Clear() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    events_.clear();
+    next_ = 0;
+  }
+
+  bool empty() const ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    return events_.empty();
+  }
+
+  int tid() const { return tid_; }
+
+ private:
+  const int tid_;
+  mutable absl::Mutex mutex_;
+  std::vector<Event> events_ ABSL_GUARDED_BY(mutex_);
+  size_t next_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// Keeps the buffers of the live threads and of the latest exited ones, so
+// that the events of a thread which has just finished can still be exported.
+class Registry {
+ public:
+  std::shared_ptr<ThreadBuffer> NewBuffer() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    buffers_.push_back(std::make_shared<ThreadBuffer>(++last_tid_));
+    return buffers_.back();
+  }
+
+  // Moves `buffer` to the exited ones, dropping the oldest one beyond
+  // Trace::kMaxExitedThreads. An empty buffer is dropped right away.
+  void RemoveBuffer(const ThreadBuffer *buffer) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+      if (it->get() != buffer) {
+        continue;
+      }
+      if (!buffer->empty()) {
+        exited_buffers_.push_back(std::move(*it));
+        if (exited_buffers_.size() > Trace::kMaxExitedThreads) {
+          exited_buffers_.pop_front();
+        }
+      }
+      buffers_.erase(it);
+      return;
+    }
+  }
+
+  std::vector<std::shared_ptr<ThreadBuffer>> GetBuffers() const
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers(exited_buffers_.begin(),
+                                                       exited_buffers_.end());
+    buffers.insert(buffers.end(), buffers_.begin(), buffers_.end());
+    return buffers;
+  }
+
+  void ClearExitedBuffers() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    exited_buffers_.clear();
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  int last_tid_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_ ABSL_GUARDED_BY(mutex_);
+  std::deque<std::shared_ptr<ThreadBuffer>> exited_buffers_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+Registry &GetRegistry() {
+  // Never destroyed, as events can be recorded during the process shutdown.
+  static Registry *registry = new Registry();
+  return *registry;
+}
+
+// Registers the buffer of a thread on its first event and removes it when the
+// thread exits.
+class ThreadBufferHolder {
+ public:
+  ThreadBufferHolder() : buffer_(GetRegistry().NewBuffer()) {}
+  ThreadBufferHolder(const ThreadBufferHolder &) = delete;
+  ThreadBufferHolder &operator=(const ThreadBufferHolder &) = delete;
+  ~ThreadBufferHolder() { GetRegistry().RemoveBuffer(buffer_.get()); }
+
+  ThreadBuffer &buffer() { return *buffer_; }
+
+ private:
+  std::shared_ptr<ThreadBuffer> buffer_;
+};
+
+ThreadBuffer &GetThreadBuffer() {
+  thread_local ThreadBufferHolder holder;
+  return holder.buffer();
+}
+
+std::string GetTypeName(const std::type_info &type) {
+#ifdef __GNUC__
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+  if (status == 0 && demangled != nullptr) {
+    std::string name = demangled;
+    std::free(demangled);
+    return name;
+  }
+#endif  // __GNUC__
+  return type.name();
+}
+
+// Escapes `str` as a JSON string literal.
+void AppendJsonString(absl::string_view str, std::string *output) {
+  output->push_back('"');
+  for (const char c : str) {
+    switch (c) {
+      case '"':
+        output->append("\\\"");
+        break;
+      case '\\':
+        output->append("\\\\");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(output, "\\u%04x", c);
+        } else {
+          output->push_back(c);
+        }
+        break;
+    }
+  }
+  output->push_back('"');
+}
+
+}  // namespace
+
+std::atomic<bool> Trace::enabled_ = false;
+
+void Trace::Record(const char *name, int64_t begin_ns, int64_t duration_ns) {
+  GetThreadBuffer().Add({name, nullptr, begin_ns, duration_ns});
+}
+
+void Trace::Record(const std::type_info &type, int64_t begin_ns,
+                   int64_t duration_ns) {
+  GetThreadBuffer().Add({nullptr, &type, begin_ns, duration_ns});
+}
+
+std::string Trace::ExportChromeTraceJson() {
+  std::string output = "{\"traceEvents\":[";
+  bool first = true;
+  for (const std::shared_ptr<ThreadBuffer> &buffer :
+       GetRegistry().GetBuffers()) {
+    for (const Event &event : buffer->GetEvents()) {
+      if (!first) {
+        output.push_back(',');
+      }
+      first = false;
+      // A complete event. The timestamps are in microseconds.
+      output.append("\n{\"name\":");
+      AppendJsonString(event.name != nullptr ? event.name
+                                             : GetTypeName(*event.type),
+                       &output);
+      absl::StrAppendFormat(&output,
+                            ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                            "\"pid\":1,\"tid\":%d}",
+                            event.begin_ns / 1e3, event.duration_ns / 1e3,
+                            buffer->tid());
+    }
+  }
+  output.append("\n]}\n");
+  return output;
+}
+
+void Trace::Clear() {
+  GetRegistry().ClearExitedBuffers();
+  for (const std::shared_ptr<ThreadBuffer> &buffer :
+       GetRegistry().GetBuffers()) {
+    buffer->Clear();
+  }
+}
+
+int64_t ScopedTrace::NowNanos() { return absl::GetCurrentTimeNanos(); }
+
+}  // namespace mozc
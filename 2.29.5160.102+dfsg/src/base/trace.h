@@ -0,0 +1,124 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Lightweight tracing of the stages of the conversion pipeline.
+//
+//   void ConverterImpl::StartConversion(...) {
+//     ScopedTrace trace("ConverterImpl::StartConversion");
+//     ...
+//   }
+//
+// The events are recorded only after Trace::Enable(true). While tracing is
+// disabled, ScopedTrace costs a relaxed atomic load. The events are kept in a
+// ring buffer per thread, so only the latest events of each thread are kept.
+// The buffer of a thread is released when the thread exits, except for those
+// of the latest few exited threads. The events can be exported in the Chrome
+// trace event format, which is loaded by chrome://tracing or
+// https://ui.perfetto.dev.
+
+#ifndef MOZC_BASE_TRACE_H_
+#define MOZC_BASE_TRACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+
+namespace mozc {
+
+class Trace {
+ public:
+  // Number of events kept per thread.
+  static constexpr size_t kBufferSize = 4096;
+  // Number of exited threads whose events are kept.
+  static constexpr size_t kMaxExitedThreads = 4;
+
+  Trace() = delete;
+
+  static void Enable(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Records an event of `name` which began at `begin_ns` and took
+  // `duration_ns` nanoseconds. `name` must outlive the traces, e.g. a string
+  // literal.
+  static void Record(const char *name, int64_t begin_ns, int64_t duration_ns);
+  // Same as above but the event is named after `type`, e.g. the class of a
+  // rewriter.
+  static void Record(const std::type_info &type, int64_t begin_ns,
+                     int64_t duration_ns);
+
+  // Returns the recorded events of all the threads as a JSON object in the
+  // Chrome trace event format.
+  static std::string ExportChromeTraceJson();
+
+  // Discards the recorded events.
+  static void Clear();
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+// Records the time from the construction to the destruction as an event of
+// `name`. `name` must outlive the traces, e.g. a string literal.
+class ScopedTrace {
+ public:
+  explicit ScopedTrace(const char *name)
+      : name_(Trace::IsEnabled() ? name : nullptr),
+        begin_ns_(name_ != nullptr ? NowNanos() : 0) {}
+  // Names the event after `type`, e.g. typeid(*rewriter).
+  explicit ScopedTrace(const std::type_info &type)
+      : type_(Trace::IsEnabled() ? &type : nullptr),
+        begin_ns_(type_ != nullptr ? NowNanos() : 0) {}
+
+  ScopedTrace(const ScopedTrace &) = delete;
+  ScopedTrace &operator=(const ScopedTrace &) = delete;
+
+  ~ScopedTrace() {
+    if (name_ != nullptr) {
+      Trace::Record(name_, begin_ns_, NowNanos() - begin_ns_);
+    } else if (type_ != nullptr) {
+      Trace::Record(*type_, begin_ns_, NowNanos() - begin_ns_);
+    }
+  }
+
+ private:
+  static int64_t NowNanos();
+
+  const char *name_ = nullptr;
+  const std::type_info *type_ = nullptr;
+  int64_t begin_ns_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_BASE_TRACE_H_
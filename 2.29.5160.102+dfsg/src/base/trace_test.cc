@@ -0,0 +1,114 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/trace.h"
+
+#include <cstddef>
+#include <string>
+
+#include "base/thread2.h"
+#include "testing/gunit.h"
+#include "absl/strings/match.h"
+
+namespace mozc {
+namespace {
+
+class TestRewriter {};
+
+class TraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override { Trace::Clear(); }
+  void TearDown() override {
+    Trace::Enable(false);
+    Trace::Clear();
+  }
+};
+
+TEST_F(TraceTest, Disabled) {
+  ASSERT_FALSE(Trace::IsEnabled());
+  { ScopedTrace trace("Disabled"); }
+  EXPECT_EQ(Trace::ExportChromeTraceJson(), "{\"traceEvents\":[\n]}\n");
+}
+
+TEST_F(TraceTest, Export) {
+  Trace::Enable(true);
+  {
+    ScopedTrace outer("Outer");
+    { ScopedTrace inner("Inner \"quoted\""); }
+    { ScopedTrace rewriter(typeid(TestRewriter)); }
+  }
+  Thread2([] { ScopedTrace trace("OtherThread"); }).Join();
+
+  const std::string json = Trace::ExportChromeTraceJson();
+  EXPECT_TRUE(absl::StartsWith(json, "{\"traceEvents\":["));
+  EXPECT_TRUE(absl::StrContains(json, "{\"name\":\"Outer\",\"ph\":\"X\","));
+  EXPECT_TRUE(absl::StrContains(json, "\"Inner \\\"quoted\\\"\""));
+  EXPECT_TRUE(absl::StrContains(json, "\"OtherThread\""));
+#ifdef __GNUC__
+  EXPECT_TRUE(
+      absl::StrContains(json, "\"mozc::(anonymous namespace)::TestRewriter\""));
+#endif  // __GNUC__
+
+  Trace::Clear();
+  EXPECT_FALSE(absl::StrContains(Trace::ExportChromeTraceJson(), "Outer"));
+}
+
+TEST_F(TraceTest, ExitedThreads) {
+  Trace::Enable(true);
+  for (size_t i = 0; i < Trace::kMaxExitedThreads + 3; ++i) {
+    Thread2([] { ScopedTrace trace("ExitedThread"); }).Join();
+  }
+  // Only the events of the latest exited threads are kept.
+  const std::string json = Trace::ExportChromeTraceJson();
+  size_t count = 0;
+  for (size_t pos = json.find("ExitedThread"); pos != std::string::npos;
+       pos = json.find("ExitedThread", pos + 1)) {
+    ++count;
+  }
+  EXPECT_EQ(count, Trace::kMaxExitedThreads);
+
+  Trace::Clear();
+  EXPECT_FALSE(
+      absl::StrContains(Trace::ExportChromeTraceJson(), "ExitedThread"));
+}
+
+TEST_F(TraceTest, RingBuffer) {
+  Trace::Enable(true);
+  { ScopedTrace trace("First"); }
+  for (size_t i = 0; i < Trace::kBufferSize; ++i) {
+    ScopedTrace trace("Repeated");
+  }
+  const std::string json = Trace::ExportChromeTraceJson();
+  EXPECT_FALSE(absl::StrContains(json, "First"));
+  EXPECT_TRUE(absl::StrContains(json, "Repeated"));
+}
+
+}  // namespace
+}  // namespace mozc
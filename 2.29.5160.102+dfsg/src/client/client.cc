@@ -31,6 +31,7 @@
 
 #include "client/client.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <ios>
@@ -249,18 +250,48 @@ void Client::PlaybackHistory() {
 
   commands::Output output;
   VLOG(1) << "Playback history: size=" << history_inputs_.size();
-  for (size_t i = 0; i < history_inputs_.size(); ++i) {
-    history_inputs_[i].set_id(id_);
-    if (!Call(history_inputs_[i], &output)) {
-      LOG(ERROR) << "playback history failed: "
-                 << history_inputs_[i].DebugString();
+  for (size_t i = 0; i < history_inputs_.size();) {
+    // Consecutive keys typed in the same context are sent in a batch.
+    size_t end = i + 1;
+    if (history_inputs_[i].type() == commands::Input::SEND_KEY) {
+      const std::string context =
+          history_inputs_[i].context().SerializeAsString();
+      while (end < history_inputs_.size() &&
+             history_inputs_[end].type() == commands::Input::SEND_KEY &&
+             history_inputs_[end].context().SerializeAsString() == context) {
+        ++end;
+      }
+    }
+    commands::Input input = history_inputs_[i];
+    if (end - i > 1) {
+      input.set_type(commands::Input::SEND_KEYS);
+      input.clear_key();
+      for (size_t j = i; j < end; ++j) {
+        *input.add_keys() = history_inputs_[j].key();
+      }
+    }
+    InitInput(&input);
+    if (!Call(input, &output)) {
+      LOG(ERROR) << "playback history failed: " << input.DebugString();
       break;
     }
+    if (input.type() == commands::Input::SEND_KEYS && output.key_count() > 0) {
+      // The server may stop the batch early, e.g. at a key it no longer
+      // consumes. Resend the keys after it.
+      i += std::min<size_t>(output.key_count(), end - i);
+    } else {
+      i = end;
+    }
   }
 }
 
 void Client::PushHistory(const commands::Input &input,
                          const commands::Output &output) {
+  if (input.type() == commands::Input::SEND_KEYS) {
+    PushKeysHistory(input, output);
+    return;
+  }
+
   if (!output.has_consumed() || !output.consumed()) {
     // Do not remember unconsumed input.
     return;
@@ -285,6 +316,36 @@ void Client::PushHistory(const commands::Input &input,
   }
 }
 
+void Client::PushKeysHistory(const commands::Input &input,
+                             const commands::Output &output) {
+  if (output.has_mode()) {
+    last_mode_ = output.mode();
+  }
+
+  // Something was committed in the middle of the keys. The keys after it are
+  // dropped from the history, as the position of the boundary is unknown.
+  if (output.has_result()) {
+    ResetHistory();
+    return;
+  }
+
+  // Remember the keys one by one, so that they look the same as the keys sent
+  // with SendKey(). Only the last evaluated key may be unconsumed.
+  const int consumed_size = std::min<int>(
+      input.keys_size(), output.consumed() ? output.key_count()
+                                           : output.key_count() - 1);
+  commands::Input key_input = input;
+  key_input.set_type(commands::Input::SEND_KEY);
+  key_input.clear_keys();
+  for (int i = 0; i < consumed_size; ++i) {
+    if (history_inputs_.size() >= kMaxPlayBackSize) {
+      break;
+    }
+    *key_input.mutable_key() = input.keys(i);
+    history_inputs_.push_back(key_input);
+  }
+}
+
 // Clear the history and push IMEOn command for initialize session.
 void Client::ResetHistory() {
   history_inputs_.clear();
@@ -341,6 +402,19 @@ bool Client::TestSendKeyWithContext(const commands::KeyEvent &key,
   return EnsureCallCommand(&input, output);
 }
 
+bool Client::SendKeysWithContext(absl::Span<const commands::KeyEvent> keys,
+                                 const commands::Context &context,
+                                 commands::Output *output) {
+  commands::Input input;
+  input.set_type(commands::Input::SEND_KEYS);
+  input.mutable_keys()->Add(keys.begin(), keys.end());
+  // If the pointer of |context| is not the default_instance, update the data.
+  if (&context != &commands::Context::default_instance()) {
+    *input.mutable_context() = context;
+  }
+  return EnsureCallCommand(&input, output);
+}
+
 bool Client::SendCommandWithContext(const commands::SessionCommand &command,
                                     const commands::Context &context,
                                     commands::Output *output) {
@@ -452,6 +526,7 @@ void Client::set_client_capability(const commands::Capability &capability) {
 
 bool Client::CreateSession() {
   id_ = 0;
+  output_delta_decoder_.Reset();
   commands::Input input;
   input.set_type(commands::Input::CREATE_SESSION);
 
@@ -713,6 +788,12 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
     return false;
   }
 
+  if (!output_delta_decoder_.Decode(output) &&
+      input.type() != commands::Input::GET_PREVIOUS_OUTPUT) {
+    LOG(ERROR) << "Cannot restore the output from the delta";
+    RestorePreviousOutput(output);
+  }
+
   DCHECK(server_status_ == SERVER_OK ||
          server_status_ == SERVER_INVALID_SESSION ||
          server_status_ == SERVER_SHUTDOWN ||
@@ -724,6 +805,34 @@ bool Client::Call(const commands::Input &input, commands::Output *output) {
   return true;
 }
 
+void Client::RestorePreviousOutput(commands::Output *output) {
+  // The decoder has forgotten the base, so the server sends the parts of the
+  // output in full without evaluating the command again.
+  commands::Input input;
+  InitInput(&input);
+  DCHECK_EQ(input.output_sequence(), 0);
+  input.set_type(commands::Input::GET_PREVIOUS_OUTPUT);
+  commands::Output previous;
+  if (!Call(input, &previous) ||
+      previous.error_code() != commands::Output::SESSION_SUCCESS) {
+    LOG(ERROR) << "Cannot get the previous output";
+    return;
+  }
+  output->clear_candidates();
+  if (previous.has_candidates()) {
+    output->mutable_candidates()->Swap(previous.mutable_candidates());
+  }
+  output->clear_all_candidate_words();
+  if (previous.has_all_candidate_words()) {
+    output->mutable_all_candidate_words()->Swap(
+        previous.mutable_all_candidate_words());
+  }
+  output->clear_preedit();
+  if (previous.has_preedit()) {
+    output->mutable_preedit()->Swap(previous.mutable_preedit());
+  }
+}
+
 bool Client::StartServer() {
   if (server_launcher_ != nullptr) {
     return server_launcher_->StartServer(this);
@@ -742,6 +851,9 @@ void Client::InitInput(commands::Input *input) const {
   if (preferences_ != nullptr) {
     *input->mutable_config() = *preferences_;
   }
+  if (client_capability_.output_delta()) {
+    input->set_output_sequence(output_delta_decoder_.sequence());
+  }
 }
 
 bool Client::CheckVersionOrRestartServerInternal(const commands::Input &input,
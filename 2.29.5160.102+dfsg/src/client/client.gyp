@@ -48,6 +48,7 @@
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
         '../session/session_base.gyp:key_info_util',
+        '../session/session_base.gyp:output_delta',
       ],
       'export_dependent_settings': [
         '../protocol/protocol.gyp:commands_proto',
@@ -45,9 +45,11 @@
 #include "ipc/ipc.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "session/output_delta.h"
 #include "testing/gunit_prod.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 // for FRIEND_TEST()
 
 namespace mozc {
@@ -128,6 +130,9 @@ class Client : public ClientInterface {
   bool TestSendKeyWithContext(const commands::KeyEvent &key,
                               const commands::Context &context,
                               commands::Output *output) override;
+  bool SendKeysWithContext(absl::Span<const commands::KeyEvent> keys,
+                           const commands::Context &context,
+                           commands::Output *output) override;
   bool SendCommandWithContext(const commands::SessionCommand &command,
                               const commands::Context &context,
                               commands::Output *output) override;
@@ -175,6 +180,9 @@ class Client : public ClientInterface {
   FRIEND_TEST(SessionPlaybackTest, PlaybackHistoryTest);
   FRIEND_TEST(SessionPlaybackTest, SetModeInitializerTest);
   FRIEND_TEST(SessionPlaybackTest, ConsumedTest);
+  FRIEND_TEST(SessionPlaybackTest, SendKeysHistoryTest);
+  FRIEND_TEST(SessionPlaybackTest, PlaybackBatchesKeysTest);
+  FRIEND_TEST(SessionPlaybackTest, PlaybackResendsRemainingKeysTest);
 
   enum ServerStatus {
     SERVER_UNKNOWN,           // initial status
@@ -222,6 +230,10 @@ class Client : public ClientInterface {
   // just return false.
   bool Call(const commands::Input &input, commands::Output *output);
 
+  // Replaces the parts of |output| which couldn't be restored from the delta
+  // with those sent by the server in full.
+  void RestorePreviousOutput(commands::Output *output);
+
   // first invoke Call() command and check the
   // protocol_version. When protocol version mismatch,
   // client goes to FATAL state
@@ -233,6 +245,9 @@ class Client : public ClientInterface {
   void PlaybackHistory();
   void PushHistory(const commands::Input &input,
                    const commands::Output &output);
+  // PushHistory() for SEND_KEYS. Records the consumed keys as SEND_KEY.
+  void PushKeysHistory(const commands::Input &input,
+                       const commands::Output &output);
   void ResetHistory();
 
   // The alias of
@@ -269,6 +284,8 @@ class Client : public ClientInterface {
   // Remember the composition mode of input session for playback.
   commands::CompositionMode last_mode_;
   commands::Capability client_capability_;
+  // Restores the outputs of the session when the server sends them as deltas.
+  OutputDeltaDecoder output_delta_decoder_;
 };
 
 class ClientFactory {
@@ -41,6 +41,7 @@
 #include "protocol/config.pb.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 
@@ -137,12 +138,26 @@ class ClientInterface {
         command, commands::Context::default_instance(), output);
   }
 
+  // Sends |keys| in a single round trip. The server stops after the first key
+  // it does not consume or whose output asks the client for an action (a
+  // callback, a deletion range or a tool to launch); |output| is the output
+  // of that key, or of the last one, with the results committed on the way
+  // merged in. The number of the evaluated keys is set to Output::key_count.
+  bool SendKeys(absl::Span<const commands::KeyEvent> keys,
+                commands::Output *output) {
+    return SendKeysWithContext(keys, commands::Context::default_instance(),
+                               output);
+  }
+
   virtual bool SendKeyWithContext(const commands::KeyEvent &key,
                                   const commands::Context &context,
                                   commands::Output *output) = 0;
   virtual bool TestSendKeyWithContext(const commands::KeyEvent &key,
                                       const commands::Context &context,
                                       commands::Output *output) = 0;
+  virtual bool SendKeysWithContext(absl::Span<const commands::KeyEvent> keys,
+                                   const commands::Context &context,
+                                   commands::Output *output) = 0;
   virtual bool SendCommandWithContext(const commands::SessionCommand &command,
                                       const commands::Context &context,
                                       commands::Output *output) = 0;
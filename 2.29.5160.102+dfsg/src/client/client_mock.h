@@ -39,6 +39,7 @@
 #include "testing/gmock.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace client {
@@ -62,6 +63,10 @@ class ClientMock : public client::ClientInterface {
               (const commands::KeyEvent &argument,
                const commands::Context &context, commands::Output *output),
               (override));
+  MOCK_METHOD(bool, SendKeysWithContext,
+              (absl::Span<const commands::KeyEvent> keys,
+               const commands::Context &context, commands::Output *output),
+              (override));
   MOCK_METHOD(bool, SendCommandWithContext,
               (const commands::SessionCommand &argument,
                const commands::Context &context, commands::Output *output),
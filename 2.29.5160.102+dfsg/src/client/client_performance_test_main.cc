@@ -52,6 +52,8 @@
 #include "base/util.h"
 #include "client/client.h"
 #include "config/config_handler.h"
+#include "ipc/ipc.h"
+#include "ipc/shm_ipc.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "session/random_keyevents_generator.h"
@@ -64,6 +66,8 @@
 
 ABSL_FLAG(std::string, server_path, "", "specify server path");
 ABSL_FLAG(std::string, log_path, "", "specify log output file path");
+ABSL_FLAG(std::string, transport, "both",
+          "IPC transport to measure: socket, shared_memory or both");
 
 namespace mozc {
 namespace {
@@ -111,7 +115,13 @@ class TestScenarioInterface {
  public:
   virtual Result Run() = 0;
 
-  TestScenarioInterface() {
+  explicit TestScenarioInterface(IPCClientFactoryInterface *ipc_factory)
+      : TestScenarioInterface(ipc_factory, commands::Capability()) {}
+
+  TestScenarioInterface(IPCClientFactoryInterface *ipc_factory,
+                        const commands::Capability &capability) {
+    client_.SetIPCClientFactory(ipc_factory);
+    client_.set_client_capability(capability);
     if (!absl::GetFlag(FLAGS_server_path).empty()) {
       client_.set_server_program(absl::GetFlag(FLAGS_server_path));
     }
@@ -171,11 +181,13 @@ std::string GetBasicStats(const std::vector<absl::Duration> &times) {
   uint64_t max = 0;
   uint64_t min = std::numeric_limits<uint64_t>::max();
   uint64_t median = 0;
+  uint64_t p99 = 0;
   if (!temp.empty()) {
     min = temp.front();
     max = temp.back();
     mean = total / times.size();
     median = temp[temp.size() / 2];
+    p99 = temp[temp.size() * 99 / 100];
   }
 
   uint64_t stddev = 0;
@@ -186,11 +198,35 @@ std::string GetBasicStats(const std::vector<absl::Duration> &times) {
     stddev = static_cast<uint64_t>(sqrt(dsd / (temp.size() - 1)));
   }
 
-  return absl::StrFormat("size=%d total=%d avg=%d max=%d min=%d st=%d med=%d",
-                         times.size(), total, mean, max, min, stddev, median);
+  return absl::StrFormat(
+      "size=%d total=%d avg=%d max=%d min=%d st=%d med=%d p99=%d", times.size(),
+      total, mean, max, min, stddev, median, p99);
 }
 
+// Measures the bare IPC round trip with NO_OPERATION, which the server
+// answers without touching the converter.
+class RoundTrip : public TestScenarioInterface {
+ public:
+  using TestScenarioInterface::TestScenarioInterface;
+
+  Result Run() override {
+    Result result;
+    result.test_name = "round_trip";
+    for (int i = 0; i < 1000; ++i) {
+      Stopwatch stopwatch;
+      stopwatch.Start();
+      client_.NoOperation();
+      stopwatch.Stop();
+      result.operations_times.push_back(stopwatch.GetElapsed());
+    }
+    return result;
+  }
+};
+
 class PreeditCommon : public TestScenarioInterface {
+ public:
+  using TestScenarioInterface::TestScenarioInterface;
+
  protected:
   virtual void RunTest(Result *result) {
     const std::vector<std::vector<commands::KeyEvent>> &keys =
@@ -212,6 +248,8 @@ class PreeditCommon : public TestScenarioInterface {
 
 class PreeditWithoutSuggestion : public PreeditCommon {
  public:
+  using PreeditCommon::PreeditCommon;
+
   Result Run() override {
     Result result;
     result.test_name = "preedit_without_suggestion";
@@ -227,6 +265,8 @@ class PreeditWithoutSuggestion : public PreeditCommon {
 
 class PreeditWithSuggestion : public PreeditCommon {
  public:
+  using PreeditCommon::PreeditCommon;
+
   Result Run() override {
     Result result;
     result.test_name = "preedit_with_suggestion";
@@ -240,6 +280,36 @@ class PreeditWithSuggestion : public PreeditCommon {
   }
 };
 
+// Same as PreeditWithSuggestion, but the client declares
+// Capability::suggestion_debounce_msec. As the keys are sent back to back,
+// only the first key of each sentence gets the suggestion, and the others are
+// answered with the composition only.
+class PreeditWithDebouncedSuggestion : public PreeditCommon {
+ public:
+  explicit PreeditWithDebouncedSuggestion(
+      IPCClientFactoryInterface *ipc_factory)
+      : PreeditCommon(ipc_factory, GetCapability()) {}
+
+  Result Run() override {
+    Result result;
+    result.test_name = "preedit_with_debounced_suggestion";
+    ResetConfig();
+    IMEOn();
+    EnableSuggestion();
+    RunTest(&result);
+    IMEOff();
+    ResetConfig();
+    return result;
+  }
+
+ private:
+  static commands::Capability GetCapability() {
+    commands::Capability capability;
+    capability.set_suggestion_debounce_msec(100);
+    return capability;
+  }
+};
+
 enum PredictionRequestType { ONE_CHAR, TWO_CHARS };
 
 void CreatePredictionKeys(PredictionRequestType type,
@@ -283,6 +353,9 @@ void CreatePredictionKeys(PredictionRequestType type,
 }
 
 class PredictionCommon : public TestScenarioInterface {
+ public:
+  using TestScenarioInterface::TestScenarioInterface;
+
  protected:
   void RunTest(PredictionRequestType type, Result *result) {
     IMEOn();
@@ -315,6 +388,8 @@ class PredictionCommon : public TestScenarioInterface {
 
 class PredictionWithOneChar : public PredictionCommon {
  public:
+  using PredictionCommon::PredictionCommon;
+
   Result Run() override {
     Result result;
     result.test_name = "prediction_one_char";
@@ -325,6 +400,8 @@ class PredictionWithOneChar : public PredictionCommon {
 
 class PredictionWithTwoChars : public PredictionCommon {
  public:
+  using PredictionCommon::PredictionCommon;
+
   Result Run() override {
     Result result;
     result.test_name = "prediction_two_chars";
@@ -335,6 +412,8 @@ class PredictionWithTwoChars : public PredictionCommon {
 
 class Conversion : public TestScenarioInterface {
  public:
+  using TestScenarioInterface::TestScenarioInterface;
+
   Result Run() override {
     Result result;
     result.test_name = "conversion";
@@ -367,13 +446,17 @@ class Conversion : public TestScenarioInterface {
   }
 };
 
-void Run(std::ostream &os) {
+void Run(absl::string_view transport, IPCClientFactoryInterface *ipc_factory,
+         std::ostream &os) {
   std::vector<std::unique_ptr<TestScenarioInterface>> tests;
-  tests.push_back(std::make_unique<PreeditWithoutSuggestion>());
-  tests.push_back(std::make_unique<PreeditWithSuggestion>());
-  tests.push_back(std::make_unique<Conversion>());
-  tests.push_back(std::make_unique<PredictionWithOneChar>());
-  tests.push_back(std::make_unique<PredictionWithTwoChars>());
+  tests.push_back(std::make_unique<RoundTrip>(ipc_factory));
+  tests.push_back(std::make_unique<PreeditWithoutSuggestion>(ipc_factory));
+  tests.push_back(std::make_unique<PreeditWithSuggestion>(ipc_factory));
+  tests.push_back(
+      std::make_unique<PreeditWithDebouncedSuggestion>(ipc_factory));
+  tests.push_back(std::make_unique<Conversion>(ipc_factory));
+  tests.push_back(std::make_unique<PredictionWithOneChar>(ipc_factory));
+  tests.push_back(std::make_unique<PredictionWithTwoChars>(ipc_factory));
 
   std::vector<Result> results;
   results.reserve(tests.size());
@@ -385,11 +468,22 @@ void Run(std::ostream &os) {
 
   // TODO(taku): generate histogram with ChartAPI
   for (const Result &result : results) {
-    os << result.test_name << ": "
+    os << transport << "/" << result.test_name << ": "
        << mozc::GetBasicStats(result.operations_times) << std::endl;
   }
 }
 
+void Run(std::ostream &os) {
+  const std::string transport = absl::GetFlag(FLAGS_transport);
+  if (transport == "socket" || transport == "both") {
+    Run("socket", IPCClientFactory::GetIPCClientFactory(), os);
+  }
+  if (transport == "shared_memory" || transport == "both") {
+    Run("shared_memory",
+        SharedMemoryIPCClientFactory::GetSharedMemoryIPCClientFactory(), os);
+  }
+}
+
 }  // namespace
 }  // namespace mozc
 
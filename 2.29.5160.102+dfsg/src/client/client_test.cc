@@ -1266,5 +1266,113 @@ TEST_F(SessionPlaybackTest, ConsumedTest) {
   client_->GetHistoryInputs(&history);
   EXPECT_EQ(history.size(), 2);
 }
+
+TEST_F(SessionPlaybackTest, SendKeysHistoryTest) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  std::vector<commands::KeyEvent> keys(3);
+  keys[0].set_key_code('a');
+  keys[1].set_key_code('b');
+  keys[2].set_key_code('c');
+
+  commands::Output mock_output;
+  mock_output.set_id(mock_id);
+  mock_output.set_consumed(true);
+  mock_output.set_key_count(3);
+  SetMockOutput(mock_output);
+
+  commands::Output output;
+  EXPECT_TRUE(client_->SendKeys(keys, &output));
+  EXPECT_EQ(output.key_count(), 3);
+
+  commands::Input input;
+  ASSERT_TRUE(
+      input.ParseFromString(ipc_client_factory_->GetGeneratedRequest()));
+  EXPECT_EQ(input.type(), commands::Input::SEND_KEYS);
+  EXPECT_EQ(input.keys_size(), 3);
+
+  // The keys are remembered one by one.
+  std::vector<commands::Input> history;
+  client_->GetHistoryInputs(&history);
+  ASSERT_EQ(history.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(history[i].type(), commands::Input::SEND_KEY);
+    EXPECT_EQ(history[i].key().key_code(), keys[i].key_code());
+  }
+
+  // The server stopped at the unconsumed second key.
+  mock_output.set_consumed(false);
+  mock_output.set_key_count(2);
+  SetMockOutput(mock_output);
+  EXPECT_TRUE(client_->SendKeys(keys, &output));
+  client_->GetHistoryInputs(&history);
+  EXPECT_EQ(history.size(), 4);
+
+  // Something was committed.
+  mock_output.set_consumed(true);
+  mock_output.set_key_count(3);
+  mock_output.mutable_result()->set_type(commands::Result::STRING);
+  mock_output.mutable_result()->set_value("output");
+  SetMockOutput(mock_output);
+  EXPECT_TRUE(client_->SendKeys(keys, &output));
+  client_->GetHistoryInputs(&history);
+  EXPECT_EQ(history.size(), 0);
+}
+
+TEST_F(SessionPlaybackTest, PlaybackBatchesKeysTest) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  commands::Output mock_output;
+  mock_output.set_id(mock_id);
+  mock_output.set_consumed(true);
+  SetMockOutput(mock_output);
+
+  commands::KeyEvent key_event;
+  key_event.set_key_code('a');
+  commands::Output output;
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+  key_event.set_key_code('b');
+  EXPECT_TRUE(client_->SendKey(key_event, &output));
+
+  client_->PlaybackHistory();
+  commands::Input input;
+  ASSERT_TRUE(
+      input.ParseFromString(ipc_client_factory_->GetGeneratedRequest()));
+  EXPECT_EQ(input.type(), commands::Input::SEND_KEYS);
+  ASSERT_EQ(input.keys_size(), 2);
+  EXPECT_EQ(input.keys(0).key_code(), 'a');
+  EXPECT_EQ(input.keys(1).key_code(), 'b');
+}
+
+TEST_F(SessionPlaybackTest, PlaybackResendsRemainingKeysTest) {
+  const int mock_id = 123;
+  EXPECT_TRUE(SetupConnection(mock_id));
+
+  commands::Output mock_output;
+  mock_output.set_id(mock_id);
+  mock_output.set_consumed(true);
+  SetMockOutput(mock_output);
+
+  commands::KeyEvent key_event;
+  commands::Output output;
+  for (const char key_code : {'a', 'b', 'c'}) {
+    key_event.set_key_code(key_code);
+    EXPECT_TRUE(client_->SendKey(key_event, &output));
+  }
+
+  // The server stops every batch after the first key.
+  mock_output.set_key_count(1);
+  SetMockOutput(mock_output);
+  client_->PlaybackHistory();
+
+  // 'a', 'b' and 'c' are sent, then 'b' and 'c', then 'c' alone.
+  commands::Input input;
+  ASSERT_TRUE(
+      input.ParseFromString(ipc_client_factory_->GetGeneratedRequest()));
+  EXPECT_EQ(input.type(), commands::Input::SEND_KEY);
+  EXPECT_EQ(input.key().key_code(), 'c');
+}
 }  // namespace client
 }  // namespace mozc
@@ -43,9 +43,11 @@
 #include "base/clock.h"
 #include "base/japanese_util.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/strings/assign.h"
 #include "base/strings/unicode.h"
 #include "base/util.h"
+#include "composer/internal/char_chunk.h"
 #include "composer/internal/composition.h"
 #include "composer/internal/composition_input.h"
 #include "composer/internal/mode_switching_handler.h"
@@ -763,10 +765,22 @@ void Composer::GetStringForSubmission(std::string *output) const {
 }
 
 void Composer::GetQueryForConversion(std::string *output) const {
+  *output = GetQueryForConversion();
+}
+
+const std::string &Composer::GetQueryForConversion() const {
+  QueryMemo &memo = GetQueryMemo();
+  if (!memo.conversion.has_value()) {
+    memo.conversion = ComputeQueryForConversion();
+  }
+  return *memo.conversion;
+}
+
+std::string Composer::ComputeQueryForConversion() const {
   std::string base_output;
   composition_.GetStringWithTrimMode(FIX, &base_output);
   TransformCharactersForNumbers(&base_output);
-  japanese_util::FullWidthAsciiToHalfWidthAscii(base_output, output);
+  return japanese_util::FullWidthAsciiToHalfWidthAscii(base_output);
 }
 
 namespace {
@@ -828,17 +842,27 @@ std::string *GetBaseQueryForPrediction(std::string *asis_query,
 }  // namespace
 
 void Composer::GetQueryForPrediction(std::string *output) const {
+  *output = GetQueryForPrediction();
+}
+
+const std::string &Composer::GetQueryForPrediction() const {
+  QueryMemo &memo = GetQueryMemo();
+  if (!memo.prediction.has_value()) {
+    memo.prediction = ComputeQueryForPrediction();
+  }
+  return *memo.prediction;
+}
+
+std::string Composer::ComputeQueryForPrediction() const {
   std::string asis_query;
   composition_.GetStringWithTrimMode(ASIS, &asis_query);
 
   switch (input_mode_) {
     case transliteration::HALF_ASCII: {
-      output->assign(asis_query);
-      return;
+      return asis_query;
     }
     case transliteration::FULL_ASCII: {
-      japanese_util::FullWidthAsciiToHalfWidthAscii(asis_query, output);
-      return;
+      return japanese_util::FullWidthAsciiToHalfWidthAscii(asis_query);
     }
     default: {
     }
@@ -857,24 +881,39 @@ void Composer::GetQueryForPrediction(std::string *output) const {
   std::string *base_query =
       GetBaseQueryForPrediction(&asis_query, &trimed_query);
   TransformCharactersForNumbers(base_query);
-  japanese_util::FullWidthAsciiToHalfWidthAscii(*base_query, output);
+  return japanese_util::FullWidthAsciiToHalfWidthAscii(*base_query);
 }
 
 void Composer::GetQueriesForPrediction(std::string *base,
                                        std::set<std::string> *expanded) const {
   DCHECK(base);
   DCHECK(expanded);
+  const PredictionQueries &queries = GetQueriesForPrediction();
+  *base = queries.base;
+  *expanded = queries.expanded;
+}
+
+const Composer::PredictionQueries &Composer::GetQueriesForPrediction() const {
+  QueryMemo &memo = GetQueryMemo();
+  if (!memo.expanded_prediction.has_value()) {
+    memo.expanded_prediction = ComputeQueriesForPrediction();
+  }
+  return *memo.expanded_prediction;
+}
+
+Composer::PredictionQueries Composer::ComputeQueriesForPrediction() const {
+  PredictionQueries queries;
   // In case of the Latin input modes, we don't perform expansion.
   switch (input_mode_) {
     case transliteration::HALF_ASCII:
     case transliteration::FULL_ASCII: {
-      GetQueryForPrediction(base);
-      expanded->clear();
-      return;
+      queries.base = GetQueryForPrediction();
+      return queries;
     }
     default: {
     }
   }
+  std::set<std::string> *expanded = &queries.expanded;
   std::string base_query;
   composition_.GetExpandedStrings(&base_query, expanded);
   // The above `GetExpandedStrings` generates expansion for modifier key as
@@ -886,7 +925,21 @@ void Composer::GetQueriesForPrediction(std::string *base,
   composition_.GetStringWithTrimMode(ASIS, &asis);
   RemoveExpandedCharsForModifier(asis, base_query, expanded);
 
-  japanese_util::FullWidthAsciiToHalfWidthAscii(base_query, base);
+  japanese_util::FullWidthAsciiToHalfWidthAscii(base_query, &queries.base);
+  return queries;
+}
+
+Composer::QueryMemo &Composer::GetQueryMemo() const {
+  const uint64_t generation = Transliterators::GetGeneration();
+  if (query_memo_.composition_version != composition_.version() ||
+      query_memo_.t12r_generation != generation ||
+      query_memo_.input_mode != input_mode_) {
+    query_memo_ = QueryMemo();
+    query_memo_.composition_version = composition_.version();
+    query_memo_.t12r_generation = generation;
+    query_memo_.input_mode = input_mode_;
+  }
+  return query_memo_;
 }
 
 std::optional<std::vector<TypeCorrectedQuery>>
@@ -1285,5 +1338,25 @@ void Composer::SetInputFieldType(commands::Context::InputFieldType type) {
 commands::Context::InputFieldType Composer::GetInputFieldType() const {
   return input_field_type_;
 }
+
+void Composer::GetMemoryStats(MemoryStats *stats) const {
+  // A node of std::list has two links besides the value.
+  size_t bytes = sizeof(Composer) + MemoryStats::StringBytes(source_text_);
+  for (const CharChunk &chunk : composition_.chunks()) {
+    bytes += sizeof(CharChunk) + 2 * sizeof(void *) +
+             MemoryStats::StringBytes(chunk.raw()) +
+             MemoryStats::StringBytes(chunk.conversion()) +
+             MemoryStats::StringBytes(chunk.pending()) +
+             MemoryStats::StringBytes(chunk.ambiguous());
+  }
+  if (query_memo_.conversion.has_value()) {
+    bytes += MemoryStats::StringBytes(*query_memo_.conversion);
+  }
+  if (query_memo_.prediction.has_value()) {
+    bytes += MemoryStats::StringBytes(*query_memo_.prediction);
+  }
+  stats->Add("composer", bytes);
+}
+
 }  // namespace composer
 }  // namespace mozc
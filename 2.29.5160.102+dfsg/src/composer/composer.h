@@ -39,6 +39,7 @@
 #include <string>
 #include <vector>
 
+#include "base/memory_stats.h"
 #include "composer/internal/composition.h"
 #include "composer/internal/composition_input.h"
 #include "composer/internal/transliterators.h"
@@ -63,6 +64,13 @@ class Composer final {
     STOP_KEY_TOGGLING,
   };
 
+  // Base query and its expansions for prediction.
+  // See GetQueriesForPrediction().
+  struct PredictionQueries {
+    std::string base;
+    std::set<std::string> expanded;
+  };
+
   Composer();
   Composer(const Table *table, const commands::Request *request,
            const config::Config *config);
@@ -134,6 +142,15 @@ class Composer final {
   void GetQueriesForPrediction(std::string *base,
                                std::set<std::string> *expanded) const;
 
+  // Same as above, but return references to the queries memoized in this
+  // composer instead of copies. The memo is rebuilt only after the
+  // composition, the input mode or the character form rules change, so
+  // repeated calls for the same key event are cheap. The references are
+  // invalidated by the next modification of this composer.
+  const std::string &GetQueryForConversion() const;
+  const std::string &GetQueryForPrediction() const;
+  const PredictionQueries &GetQueriesForPrediction() const;
+
   // Returns type-corrected composition strings with SpellCheckerService.
   // `context` is the hiragana sequence typed just before the current
   // composition. Returns an empty vector when correction is not required.
@@ -264,6 +281,10 @@ class Composer final {
     return spellchecker_service_;
   }
 
+  // Adds the approximate memory held by the composition and the memoized
+  // queries to |stats|.
+  void GetMemoryStats(MemoryStats *stats) const;
+
  private:
   FRIEND_TEST(ComposerTest, ApplyTemporaryInputMode);
 
@@ -281,6 +302,25 @@ class Composer final {
                              size_t position, size_t size,
                              std::string *result) const;
 
+  // Queries memoized for the composition identified by the first three
+  // fields. Each query is computed on its first request.
+  struct QueryMemo {
+    uint64_t composition_version = 0;
+    uint64_t t12r_generation = 0;
+    transliteration::TransliterationType input_mode =
+        transliteration::HIRAGANA;
+    std::optional<std::string> conversion;
+    std::optional<std::string> prediction;
+    std::optional<PredictionQueries> expanded_prediction;
+  };
+
+  // Returns `query_memo_` after clearing it if it is stale.
+  QueryMemo &GetQueryMemo() const;
+
+  std::string ComputeQueryForConversion() const;
+  std::string ComputeQueryForPrediction() const;
+  PredictionQueries ComputeQueriesForPrediction() const;
+
   size_t position_;
   transliteration::TransliterationType input_mode_;
   transliteration::TransliterationType output_mode_;
@@ -323,6 +363,8 @@ class Composer final {
   // Composer doesn't have the ownership of spellchecker_service_,
   // SessionHandler owns this this instance. (usually a singleton object).
   const spelling::SpellCheckerServiceInterface *spellchecker_service_ = nullptr;
+
+  mutable QueryMemo query_memo_;
 };
 
 }  // namespace composer
@@ -0,0 +1,131 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Microbenchmark of Composer::InsertCharacter.
+//
+// Usage:
+//   composer_benchmark_main --table=system://romanji-hiragana.tsv
+//                           --iterations=100
+//
+// Each iteration types long sentences character by character, and gets the
+// preedit after each character as the session does. The second figure also
+// includes the conversion and prediction queries requested by the converter
+// and the predictors for every key.
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <ostream>
+#include <set>
+#include <string>
+
+#include "base/init_mozc.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "absl/flags/flag.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(std::string, table, "system://romanji-hiragana.tsv",
+          "preedit conversion table file.");
+ABSL_FLAG(int32_t, iterations, 100, "number of iterations");
+
+namespace mozc {
+namespace composer {
+namespace {
+
+constexpr absl::string_view kSentences[] = {
+    "watashinonamaehanakanodesu.kyouhaiitenkidesune.",
+    "kinounobangohanniha,tomodachitoissyoniresutorandeitariantabemashita.",
+    "konsyuunokaigihamokuyoubinogogosanjikarakaisaisaremasunode,"
+    "shiryouwojunbishiteokimasu.",
+    "shinkansennnikippuwokattesuruuzawakaraonsennnimukaimasyou.",
+    "XMLtoJSONnoryouhouwosapo-tosuruhitsuyougaarimasu.",
+    "nnnnnnnnkkkkttttxtsuxyaxyuxyoltsuwwwyyyvvv-----",
+};
+
+void GetQueries(const Composer &composer) {
+  // The session converter, the dictionary predictor and the user history
+  // predictor each ask for the queries on a key event.
+  std::string query;
+  std::set<std::string> expanded;
+  for (int i = 0; i < 2; ++i) {
+    composer.GetQueryForConversion(&query);
+    composer.GetQueryForPrediction(&query);
+    composer.GetQueriesForPrediction(&query, &expanded);
+  }
+}
+
+void Run(const Table &table, const bool with_queries) {
+  const int iterations = absl::GetFlag(FLAGS_iterations);
+  absl::Duration total;
+  size_t num_chars = 0;
+  std::string preedit;
+  for (int i = 0; i < iterations; ++i) {
+    for (const absl::string_view sentence : kSentences) {
+      Composer composer(&table, &commands::Request::default_instance(),
+                        &config::Config::default_instance());
+      const absl::Time start = absl::Now();
+      for (const char c : sentence) {
+        composer.InsertCharacter(std::string(1, c));
+        composer.GetStringForPreedit(&preedit);
+        if (with_queries) {
+          GetQueries(composer);
+        }
+      }
+      total += absl::Now() - start;
+      num_chars += sentence.size();
+    }
+  }
+  std::cout << (with_queries ? "InsertCharacter+queries: "
+                             : "InsertCharacter: ")
+            << absl::ToDoubleNanoseconds(total) / num_chars << " ns/char"
+            << std::endl;
+}
+
+}  // namespace
+}  // namespace composer
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  mozc::composer::Table table;
+  if (!table.LoadFromFile(absl::GetFlag(FLAGS_table).c_str())) {
+    std::cerr << "Failed to load " << absl::GetFlag(FLAGS_table) << std::endl;
+    return 1;
+  }
+  mozc::composer::Run(table, false);
+  mozc::composer::Run(table, true);
+  return 0;
+}
@@ -65,6 +65,7 @@ using ::mozc::config::CharacterFormManager;
 using ::mozc::config::Config;
 using ::mozc::config::ConfigHandler;
 using ::testing::_;
+using ::testing::ElementsAre;
 using ::testing::Return;
 
 // ProbableKeyEvent is the innter-class member so needs to define as alias.
@@ -606,6 +607,50 @@ TEST_F(ComposerTest, GetQueriesForPredictionRoman) {
   }
 }
 
+TEST_F(ComposerTest, MemoizedQueries) {
+  table_->AddRule("ka", "か", "");
+  table_->AddRule("ki", "き", "");
+  table_->AddRule("nn", "ん", "");
+  table_->AddRule("n", "ん", "");
+
+  composer_->InsertCharacter("kak");
+  EXPECT_EQ(composer_->GetQueryForConversion(), "かk");
+  EXPECT_EQ(composer_->GetQueryForPrediction(), "か");
+  const Composer::PredictionQueries &queries =
+      composer_->GetQueriesForPrediction();
+  EXPECT_EQ(queries.base, "か");
+  EXPECT_THAT(queries.expanded, ElementsAre("k", "か", "き"));
+  // Repeated calls return the memoized values.
+  EXPECT_EQ(&composer_->GetQueryForConversion(),
+            &composer_->GetQueryForConversion());
+  EXPECT_EQ(&composer_->GetQueriesForPrediction(), &queries);
+
+  // Editing the composition invalidates the memo.
+  composer_->InsertCharacter("i");
+  EXPECT_EQ(composer_->GetQueryForConversion(), "かき");
+  EXPECT_EQ(composer_->GetQueryForPrediction(), "かき");
+  EXPECT_EQ(composer_->GetQueriesForPrediction().base, "かき");
+  EXPECT_TRUE(composer_->GetQueriesForPrediction().expanded.empty());
+
+  composer_->Backspace();
+  EXPECT_EQ(composer_->GetQueryForConversion(), "か");
+
+  composer_->InsertCharacter("n");
+  EXPECT_EQ(composer_->GetQueryForConversion(), "かん");
+  EXPECT_EQ(composer_->GetQueryForPrediction(), "か");
+
+  // So does changing the input mode.
+  composer_->SetInputMode(transliteration::HALF_ASCII);
+  EXPECT_EQ(composer_->GetQueryForPrediction(), "かn");
+  EXPECT_TRUE(composer_->GetQueriesForPrediction().expanded.empty());
+
+  // Copies keep returning their own queries.
+  const Composer copy = *composer_;
+  composer_->EditErase();
+  EXPECT_EQ(composer_->GetQueryForConversion(), "");
+  EXPECT_EQ(copy.GetQueryForConversion(), "かん");
+}
+
 TEST_F(ComposerTest, GetQueriesForPredictionMobile) {
   table_->AddRule("_", "", "い");
   table_->AddRule("い*", "", "ぃ");
@@ -112,8 +112,7 @@ CharChunk::CharChunk(Transliterators::Transliterator transliterator,
                      const Table *table)
     : table_(table),
       transliterator_(transliterator),
-      attributes_(NO_TABLE_ATTRIBUTE),
-      local_length_cache_(std::string::npos) {
+      attributes_(NO_TABLE_ATTRIBUTE) {
   DCHECK_NE(Transliterators::LOCAL, transliterator);
 }
 
@@ -122,29 +121,16 @@ void CharChunk::Clear() {
   conversion_.clear();
   pending_.clear();
   ambiguous_.clear();
-  local_length_cache_ = std::string::npos;
+  InvalidateCache();
 }
 
 size_t CharChunk::GetLength(Transliterators::Transliterator t12r) const {
-  if (t12r == Transliterators::LOCAL &&
-      local_length_cache_ != std::string::npos) {
-    return local_length_cache_;
-  }
-  const std::string t13n = Transliterate(
-      t12r, DeleteSpecialKeys(raw_), DeleteSpecialKeys(conversion_ + pending_));
-  size_t length = Util::CharsLen(t13n);
-  if (t12r == Transliterators::LOCAL) {
-    local_length_cache_ = length;
-  }
-  return length;
+  return GetResult(t12r).length;
 }
 
 void CharChunk::AppendResult(Transliterators::Transliterator t12r,
                              std::string *result) const {
-  const std::string t13n =
-      Transliterate(t12r, DeleteSpecialKeys(raw_),
-                    DeleteSpecialKeys(absl::StrCat(conversion_, pending_)));
-  result->append(t13n);
+  result->append(GetResult(t12r).result);
 }
 
 void CharChunk::AppendTrimedResult(Transliterators::Transliterator t12r,
@@ -165,21 +151,20 @@ void CharChunk::AppendTrimedResult(Transliterators::Transliterator t12r,
 
 void CharChunk::AppendFixedResult(Transliterators::Transliterator t12r,
                                   std::string *result) const {
-  std::string converted;
-  if (!ambiguous_.empty()) {
-    // Add the |ambiguous_| value as a fixed value.  |ambiguous_|
-    // contains an undetermined result string like "ん" converted
-    // from a single 'n'.
-    converted = absl::StrCat(conversion_, ambiguous_);
-  } else {
+  if (ambiguous_.empty()) {
     // If |pending_| exists but |ambiguous_| does not exist,
     // |pending_| is appended.  If |ambiguous_| exists, the value of
     // |pending_| is usually equal to |ambiguous_| so it is not
     // appended.
-    converted = absl::StrCat(conversion_, pending_);
+    AppendResult(t12r, result);
+    return;
   }
-  result->append(Transliterate(t12r, DeleteSpecialKeys(raw_),
-                               DeleteSpecialKeys(converted)));
+  // Add the |ambiguous_| value as a fixed value.  |ambiguous_|
+  // contains an undetermined result string like "ん" converted
+  // from a single 'n'.
+  result->append(
+      Transliterate(t12r, DeleteSpecialKeys(raw_),
+                    DeleteSpecialKeys(absl::StrCat(conversion_, ambiguous_))));
 }
 
 // If we have the rule (roman),
@@ -278,7 +263,7 @@ bool CharChunk::IsConvertible(Transliterators::Transliterator t12r,
 void CharChunk::Combine(const CharChunk &left_chunk) {
   conversion_ = left_chunk.conversion_ + conversion_;
   raw_ = left_chunk.raw_ + raw_;
-  local_length_cache_ = std::string::npos;
+  InvalidateCache();
   // TODO(komatsu): This is a hacky way.  We should look up the
   // conversion table with the new |raw_| value.
   if (left_chunk.ambiguous_.empty()) {
@@ -302,7 +287,7 @@ std::pair<bool, absl::string_view> CharChunk::AddInputInternal(
   bool fixed = false;
   std::string key = absl::StrCat(pending_, input);
   const Entry *entry = table_->LookUpPrefix(key, &used_key_length, &fixed);
-  local_length_cache_ = std::string::npos;
+  InvalidateCache();
 
   if (entry == nullptr) {
     if (used_key_length == 0) {
@@ -411,7 +396,7 @@ void CharChunk::AddInput(std::string *input) {
 }
 
 void CharChunk::AddInputAndConvertedChar(CompositionInput *input) {
-  local_length_cache_ = std::string::npos;
+  InvalidateCache();
 
   if (input->is_asis()) {
     if (raw_.empty() && pending_.empty() && conversion_.empty()) {
@@ -509,7 +494,7 @@ bool CharChunk::ShouldInsertNewChunk(const CompositionInput &input) const {
 }
 
 void CharChunk::AddCompositionInput(CompositionInput *input) {
-  local_length_cache_ = std::string::npos;
+  InvalidateCache();
   if (!input->conversion().empty()) {
     AddInputAndConvertedChar(input);
     return;
@@ -528,13 +513,13 @@ void CharChunk::SetTransliterator(
     // Just ignore.
     return;
   }
-  local_length_cache_ = std::string::npos;
+  InvalidateCache();
   transliterator_ = transliterator;
 }
 
 void CharChunk::set_attributes(TableAttributes attributes) {
   attributes_ = attributes;
-  local_length_cache_ = std::string::npos;
+  InvalidateCache();
 }
 
 absl::StatusOr<CharChunk> CharChunk::SplitChunk(
@@ -544,7 +529,7 @@ absl::StatusOr<CharChunk> CharChunk::SplitChunk(
         absl::StrCat("Invalid position: ", position));
   }
 
-  local_length_cache_ = std::string::npos;
+  InvalidateCache();
   std::string raw_lhs, raw_rhs, converted_lhs, converted_rhs;
   Transliterators::GetTransliterator(GetTransliterator(t12r))
       ->Split(position, DeleteSpecialKeys(raw_),
@@ -591,6 +576,22 @@ Transliterators::Transliterator CharChunk::GetTransliterator(
   return transliterator;
 }
 
+const CharChunk::ResultCache &CharChunk::GetResult(
+    Transliterators::Transliterator t12r) const {
+  const Transliterators::Transliterator resolved = GetTransliterator(t12r);
+  const uint64_t generation = Transliterators::GetGeneration();
+  if (!result_cache_.has_value() || result_cache_->t12r != resolved ||
+      result_cache_->generation != generation) {
+    std::string result = Transliterate(
+        resolved, DeleteSpecialKeys(raw_),
+        DeleteSpecialKeys(absl::StrCat(conversion_, pending_)));
+    const size_t length = Util::CharsLen(result);
+    result_cache_.emplace(
+        ResultCache{resolved, generation, length, std::move(result)});
+  }
+  return *result_cache_;
+}
+
 std::string CharChunk::Transliterate(
     Transliterators::Transliterator transliterator, const absl::string_view raw,
     const absl::string_view converted) const {
@@ -30,6 +30,8 @@
 #ifndef MOZC_COMPOSER_INTERNAL_CHAR_CHUNK_H_
 #define MOZC_COMPOSER_INTERNAL_CHAR_CHUNK_H_
 
+#include <cstdint>
+#include <optional>
 #include <set>
 #include <string>
 #include <tuple>
@@ -144,28 +146,28 @@ class CharChunk final {
   template <typename String>
   void set_raw(String &&raw) {
     strings::Assign(raw_, std::forward<String>(raw));
-    local_length_cache_ = std::string::npos;
+    InvalidateCache();
   }
 
   const std::string &conversion() const { return conversion_; }
   template <typename String>
   void set_conversion(String &&conversion) {
     strings::Assign(conversion_, std::forward<String>(conversion));
-    local_length_cache_ = std::string::npos;
+    InvalidateCache();
   }
 
   const std::string &pending() const { return pending_; }
   template <typename String>
   void set_pending(String &&pending) {
     strings::Assign(pending_, std::forward<String>(pending));
-    local_length_cache_ = std::string::npos;
+    InvalidateCache();
   }
 
   const std::string &ambiguous() const { return ambiguous_; }
   template <typename String>
   void set_ambiguous(String &&ambiguous) {
     strings::Assign(ambiguous_, std::forward<String>(ambiguous));
-    local_length_cache_ = std::string::npos;
+    InvalidateCache();
   }
 
   TableAttributes attributes() const { return attributes_; }
@@ -196,8 +198,20 @@ class CharChunk final {
   std::pair<bool, absl::string_view> AddInputInternal(absl::string_view input);
 
  private:
+  struct ResultCache {
+    Transliterators::Transliterator t12r;
+    uint64_t generation;
+    size_t length;
+    std::string result;
+  };
+
   void AddInputAndConvertedChar(CompositionInput *composition_input);
 
+  // Returns the transliteration of `raw_` and `conversion_ + pending_`,
+  // reusing `result_cache_` when it is still valid for `t12r`.
+  const ResultCache &GetResult(Transliterators::Transliterator t12r) const;
+  void InvalidateCache() { result_cache_.reset(); }
+
   const Table *table_;
 
   // There are four variables to represent a composing text:
@@ -230,7 +244,10 @@ class CharChunk final {
   std::string ambiguous_;
   Transliterators::Transliterator transliterator_;
   TableAttributes attributes_;
-  mutable size_t local_length_cache_;
+  // The last result of GetResult(). Composition::GetString() transliterates
+  // every chunk on each key event, so this keeps the chunks the key did not
+  // touch from being transliterated again.
+  mutable std::optional<ResultCache> result_cache_;
 };
 
 }  // namespace composer
@@ -39,6 +39,8 @@
 #include "composer/internal/composition_input.h"
 #include "composer/internal/transliterators.h"
 #include "composer/table.h"
+#include "config/character_form_manager.h"
+#include "protocol/config.pb.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
 #include "absl/strings/string_view.h"
@@ -46,6 +48,9 @@
 namespace mozc {
 namespace composer {
 
+using ::mozc::config::CharacterFormManager;
+using ::mozc::config::Config;
+
 MATCHER(Loop, "") { return arg.first; }
 MATCHER(NoLoop, "") { return !arg.first; }
 MATCHER_P(RestIs, rest, "") { return arg.second == rest; }
@@ -2041,5 +2046,60 @@ TEST(CharChunkTest, GetTransliterator) {
   }
 }
 
+TEST(CharChunkTest, CachedResult) {
+  Table table;
+  CharChunk chunk(Transliterators::HIRAGANA, &table);
+  chunk.set_raw("ka");
+  chunk.set_conversion("か");
+
+  std::string result;
+  chunk.AppendResult(Transliterators::LOCAL, &result);
+  EXPECT_EQ(result, "か");
+  EXPECT_EQ(chunk.GetLength(Transliterators::LOCAL), 1);
+
+  // Mutations invalidate the cached result.
+  chunk.set_pending("k");
+  result.clear();
+  chunk.AppendResult(Transliterators::LOCAL, &result);
+  EXPECT_EQ(result, "かｋ");
+  EXPECT_EQ(chunk.GetLength(Transliterators::LOCAL), 2);
+
+  // Other transliterators do not reuse the cached result.
+  result.clear();
+  chunk.AppendResult(Transliterators::HALF_ASCII, &result);
+  EXPECT_EQ(result, "ka");
+  result.clear();
+  chunk.AppendResult(Transliterators::FULL_KATAKANA, &result);
+  EXPECT_EQ(result, "カｋ");
+
+  chunk.SetTransliterator(Transliterators::HALF_ASCII);
+  result.clear();
+  chunk.AppendResult(Transliterators::LOCAL, &result);
+  EXPECT_EQ(result, "ka");
+}
+
+TEST(CharChunkTest, CachedResultFollowsCharacterFormRules) {
+  CharacterFormManager *manager =
+      CharacterFormManager::GetCharacterFormManager();
+  manager->Clear();
+  manager->AddPreeditRule("1", Config::FULL_WIDTH);
+
+  Table table;
+  CharChunk chunk(Transliterators::HIRAGANA, &table);
+  chunk.set_raw("1");
+  chunk.set_conversion("1");
+  std::string result;
+  chunk.AppendResult(Transliterators::LOCAL, &result);
+  EXPECT_EQ(result, "１");
+
+  manager->Clear();
+  manager->AddPreeditRule("1", Config::HALF_WIDTH);
+  result.clear();
+  chunk.AppendResult(Transliterators::LOCAL, &result);
+  EXPECT_EQ(result, "1");
+
+  manager->SetDefaultRule();
+}
+
 }  // namespace composer
 }  // namespace mozc
@@ -49,7 +49,10 @@
 namespace mozc {
 namespace composer {
 
-void Composition::Erase() { chunks_.clear(); }
+void Composition::Erase() {
+  chunks_.clear();
+  ++version_;
+}
 
 size_t Composition::InsertAt(size_t pos, std::string input) {
   CompositionInput composition_input;
@@ -69,6 +72,7 @@ size_t Composition::InsertInput(size_t pos, CompositionInput input) {
   if (input.Empty()) {
     return pos;
   }
+  ++version_;
 
   CharChunkList::iterator right_chunk = MaybeSplitChunkAt(pos);
   while (right_chunk != chunks_.end() &&
@@ -94,6 +98,7 @@ size_t Composition::InsertInput(size_t pos, CompositionInput input) {
 
 // Deletes a right-hand character of the composition at the position.
 size_t Composition::DeleteAt(const size_t position) {
+  ++version_;
   const size_t original_size = GetLength();
   size_t new_position = position;
   // We have to perform deletion repeatedly because there might be 0-length
@@ -196,6 +201,7 @@ void Composition::SetTransliterator(
   if (chunks_.empty()) {
     return;
   }
+  ++version_;
 
   size_t inner_position_from;
   auto chunk_it =
@@ -366,6 +372,7 @@ size_t Composition::GetPosition(Transliterators::Transliterator transliterator,
 // Return the iterator to the right side CharChunk at the `position`.
 // If the `position` is in the middle of a CharChunk, that CharChunk is split.
 CharChunkList::iterator Composition::MaybeSplitChunkAt(const size_t position) {
+  ++version_;
   size_t inner_position;
   CharChunkList::iterator it =
       GetChunkAt(position, Transliterators::LOCAL, &inner_position);
@@ -392,6 +399,7 @@ void Composition::CombinePendingChunks(CharChunkList::iterator it,
   if (input.is_asis()) {
     return;
   }
+  ++version_;
   // Combine |**it| and |**(--it)| into |**it| as long as possible.
   const absl::string_view next_input =
       input.conversion().empty() ? input.raw() : input.conversion();
@@ -412,6 +420,7 @@ void Composition::CombinePendingChunks(CharChunkList::iterator it,
 // Insert a chunk to the prev of it.
 CharChunkList::iterator Composition::InsertChunk(
     CharChunkList::const_iterator it) {
+  ++version_;
   return chunks_.insert(it, CharChunk(input_t12r_, table_));
 }
 
@@ -425,6 +434,7 @@ bool Composition::ShouldCommit() const {
 // Return charchunk to be inserted and iterator of the *next* char chunk.
 CharChunkList::iterator Composition::GetInsertionChunk(
     CharChunkList::iterator it) {
+  ++version_;
   if (it == chunks_.begin()) {
     return InsertChunk(it);
   }
@@ -440,7 +450,10 @@ void Composition::SetInputMode(Transliterators::Transliterator transliterator) {
   input_t12r_ = transliterator;
 }
 
-void Composition::SetTable(const Table *table) { table_ = table; }
+void Composition::SetTable(const Table *table) {
+  table_ = table;
+  ++version_;
+}
 
 bool Composition::IsToggleable(size_t position) const {
   size_t inner_position = 0;
@@ -30,6 +30,7 @@
 #ifndef MOZC_COMPOSER_INTERNAL_COMPOSITION_H_
 #define MOZC_COMPOSER_INTERNAL_COMPOSITION_H_
 
+#include <cstdint>
 #include <list>
 #include <set>
 #include <string>
@@ -200,6 +201,11 @@ class Composition final {
   const CharChunkList &chunks() const { return chunks_; }
   Transliterators::Transliterator input_t12r() const { return input_t12r_; }
 
+  // Returns a counter which is incremented whenever the chunks are modified
+  // through this class. Callers memoizing strings derived from the
+  // composition compare it to detect stale values.
+  uint64_t version() const { return version_; }
+
   friend bool operator==(const Composition &lhs, const Composition &rhs) {
     return std::tie(lhs.table_, lhs.chunks_, lhs.input_t12r_) ==
            std::tie(rhs.table_, rhs.chunks_, rhs.input_t12r_);
@@ -222,6 +228,7 @@ class Composition final {
   const Table *table_;
   CharChunkList chunks_;
   Transliterators::Transliterator input_t12r_;
+  uint64_t version_ = 0;
 };
 
 }  // namespace composer
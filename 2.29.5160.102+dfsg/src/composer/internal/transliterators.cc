@@ -29,6 +29,7 @@
 
 #include "composer/internal/transliterators.h"
 
+#include <cstdint>
 #include <string>
 
 #include "base/japanese_util.h"
@@ -294,6 +295,11 @@ const TransliteratorInterface *Transliterators::GetTransliterator(
   }
 }
 
+// static
+uint64_t Transliterators::GetGeneration() {
+  return CharacterFormManager::GetCharacterFormManager()->preedit_generation();
+}
+
 // static
 bool Transliterators::SplitRaw(const size_t position,
                                const absl::string_view raw,
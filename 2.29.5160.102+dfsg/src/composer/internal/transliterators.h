@@ -30,6 +30,7 @@
 #ifndef MOZC_COMPOSER_INTERNAL_TRANSLITERATORS_H_
 #define MOZC_COMPOSER_INTERNAL_TRANSLITERATORS_H_
 
+#include <cstdint>
 #include <string>
 
 #include "composer/internal/transliterator_interface.h"
@@ -70,6 +71,11 @@ class Transliterators {
   static const TransliteratorInterface *GetTransliterator(
       Transliterator transliterator);
 
+  // Returns a value that changes whenever the transliterators may return a
+  // different output for the same input, e.g. after the preedit character
+  // form rules are updated.
+  static uint64_t GetGeneration();
+
   static bool SplitRaw(size_t position, absl::string_view raw,
                        absl::string_view converted, std::string *raw_lhs,
                        std::string *raw_rhs, std::string *converted_lhs,
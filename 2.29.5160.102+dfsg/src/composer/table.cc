@@ -50,6 +50,8 @@
 #include "composer/internal/typing_model.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "absl/algorithm/container.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
@@ -61,6 +63,15 @@ namespace {
 
 using internal::DeleteSpecialKeys;
 
+// Returns false if `input` has no characters normalized by
+// Util::LowerString(), i.e. 'A'-'Z' and 'Ａ'-'Ｚ' (U+FF21-FF3A, which start with
+// 0xEF in UTF-8), so that the normalization can be skipped.
+bool MayHaveUpperCase(const absl::string_view input) {
+  return absl::c_any_of(input, [](const char c) {
+    return absl::ascii_isupper(c) || c == '\xEF';
+  });
+}
+
 constexpr char kDefaultPreeditTableFile[] = "system://romanji-hiragana.tsv";
 constexpr char kRomajiPreeditTableFile[] = "system://romanji-hiragana.tsv";
 // Table for Kana combinations like "か゛" → "が".
@@ -222,7 +233,8 @@ bool Table::InitializeWithRequestAndConfig(
       default:
         table_file_name = nullptr;
     }
-    if (table_file_name && LoadFromFile(table_file_name)) {
+    if (table_file_name && AddRulesFromFile(table_file_name)) {
+      Compile();
       return true;
     }
   }
@@ -230,11 +242,11 @@ bool Table::InitializeWithRequestAndConfig(
     case config::Config::ROMAN:
       result = (config.has_custom_roman_table() &&
                 !config.custom_roman_table().empty())
-                   ? LoadFromString(config.custom_roman_table())
-                   : LoadFromFile(kRomajiPreeditTableFile);
+                   ? AddRulesFromString(config.custom_roman_table())
+                   : AddRulesFromFile(kRomajiPreeditTableFile);
       break;
     case config::Config::KANA:
-      result = LoadFromFile(kRomajiPreeditTableFile);
+      result = AddRulesFromFile(kRomajiPreeditTableFile);
       break;
     default:
       LOG(ERROR) << "Unkonwn preedit method: " << config.preedit_method();
@@ -242,7 +254,7 @@ bool Table::InitializeWithRequestAndConfig(
   }
 
   if (!result) {
-    result = LoadFromFile(kDefaultPreeditTableFile);
+    result = AddRulesFromFile(kDefaultPreeditTableFile);
     if (!result) {
       return false;
     }
@@ -320,7 +332,8 @@ bool Table::InitializeWithRequestAndConfig(
   CHECK(result);
 
   // Load Kana combination rules.
-  result = LoadFromFile(kKanaCombinationTableFile);
+  result = AddRulesFromFile(kKanaCombinationTableFile);
+  Compile();
   return result;
 }
 
@@ -388,6 +401,7 @@ const Entry *Table::AddRuleWithAttributes(
   if (entries_.LookUp(input, &old_entry)) {
     DeleteEntry(old_entry);
   }
+  compiled_entries_.reset();
 
   Entry *entry = new Entry(input, output, pending, attributes);
   entries_.AddEntry(input, entry);
@@ -422,14 +436,31 @@ void Table::DeleteRule(const absl::string_view input) {
     DeleteEntry(old_entry);
   }
   entries_.DeleteEntry(input);
+  compiled_entries_.reset();
 }
 
 bool Table::LoadFromString(const std::string &str) {
+  if (!AddRulesFromString(str)) {
+    return false;
+  }
+  Compile();
+  return true;
+}
+
+bool Table::LoadFromFile(const char *filepath) {
+  if (!AddRulesFromFile(filepath)) {
+    return false;
+  }
+  Compile();
+  return true;
+}
+
+bool Table::AddRulesFromString(const std::string &str) {
   std::istringstream is(str);
   return LoadFromStream(&is);
 }
 
-bool Table::LoadFromFile(const char *filepath) {
+bool Table::AddRulesFromFile(const char *filepath) {
   std::unique_ptr<std::istream> ifs(ConfigFileStream::LegacyOpen(filepath));
   if (ifs == nullptr) {
     return false;
@@ -490,44 +521,56 @@ bool Table::LoadFromStream(std::istream *is) {
       continue;
     }
   }
-
   return true;
 }
 
-const Entry *Table::LookUp(const absl::string_view input) const {
-  const Entry *entry = nullptr;
-  if (case_sensitive_) {
-    entries_.LookUp(input, &entry);
-  } else {
-    std::string normalized_input(input);
+void Table::Compile() {
+  std::vector<const Entry *> entries;
+  entries_.LookUpPredictiveAll("", &entries);
+  std::vector<std::pair<absl::string_view, const Entry *>> key_values;
+  key_values.reserve(entries.size());
+  for (const Entry *entry : entries) {
+    key_values.emplace_back(entry->input(), entry);
+  }
+  compiled_entries_.emplace(key_values);
+}
+
+template <typename F>
+decltype(auto) Table::LookUpWith(absl::string_view input, F f) const {
+  std::string normalized_input;
+  if (!case_sensitive_ && MayHaveUpperCase(input)) {
+    normalized_input.assign(input.data(), input.size());
     Util::LowerString(&normalized_input);
-    entries_.LookUp(normalized_input, &entry);
+    input = normalized_input;
   }
+  if (compiled_entries_.has_value()) {
+    return f(*compiled_entries_, input);
+  }
+  return f(entries_, input);
+}
+
+const Entry *Table::LookUp(const absl::string_view input) const {
+  const Entry *entry = nullptr;
+  LookUpWith(input, [&](const auto &trie, const absl::string_view key) {
+    trie.LookUp(key, &entry);
+  });
   return entry;
 }
 
 const Entry *Table::LookUpPrefix(const absl::string_view input,
                                  size_t *key_length, bool *fixed) const {
   const Entry *entry = nullptr;
-  if (case_sensitive_) {
-    entries_.LookUpPrefix(input, &entry, key_length, fixed);
-  } else {
-    std::string normalized_input(input);
-    Util::LowerString(&normalized_input);
-    entries_.LookUpPrefix(normalized_input, &entry, key_length, fixed);
-  }
+  LookUpWith(input, [&](const auto &trie, const absl::string_view key) {
+    trie.LookUpPrefix(key, &entry, key_length, fixed);
+  });
   return entry;
 }
 
 void Table::LookUpPredictiveAll(const absl::string_view input,
                                 std::vector<const Entry *> *results) const {
-  if (case_sensitive_) {
-    entries_.LookUpPredictiveAll(input, results);
-  } else {
-    std::string normalized_input(input);
-    Util::LowerString(&normalized_input);
-    entries_.LookUpPredictiveAll(normalized_input, results);
-  }
+  LookUpWith(input, [&](const auto &trie, const absl::string_view key) {
+    trie.LookUpPredictiveAll(key, results);
+  });
 }
 
 bool Table::HasNewChunkEntry(const absl::string_view input) const {
@@ -547,13 +590,9 @@ bool Table::HasNewChunkEntry(const absl::string_view input) const {
 }
 
 bool Table::HasSubRules(const absl::string_view input) const {
-  if (case_sensitive_) {
-    return entries_.HasSubTrie(input);
-  } else {
-    std::string normalized_input(input);
-    Util::LowerString(&normalized_input);
-    return entries_.HasSubTrie(normalized_input);
-  }
+  return LookUpWith(input, [](const auto &trie, const absl::string_view key) {
+    return trie.HasSubTrie(key);
+  });
 }
 
 void Table::DeleteEntry(const Entry *entry) {
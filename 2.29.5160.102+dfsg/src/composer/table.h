@@ -36,11 +36,13 @@
 #include <istream>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/container/flat_trie.h"
 #include "base/container/trie.h"
 #include "composer/internal/special_key.h"
 #include "composer/internal/typing_model.h"
@@ -149,11 +151,27 @@ class Table final {
   friend class TypingCorrectorTest;
   friend class TypingCorrectionTest;
 
+  // Adds the rules without compiling them, so that the rules loaded from
+  // several sources are compiled once.
+  bool AddRulesFromString(const std::string &str);
+  bool AddRulesFromFile(const char *filepath);
   bool LoadFromStream(std::istream *is);
   void DeleteEntry(const Entry *entry);
 
+  // Builds compiled_entries_ from entries_.
+  void Compile();
+
+  // Returns `f(trie, key)` where `trie` is compiled_entries_ if available or
+  // entries_ otherwise, and `key` is `input` normalized by case_sensitive_.
+  template <typename F>
+  decltype(auto) LookUpWith(absl::string_view input, F f) const;
+
   using EntryTrie = Trie<const Entry *>;
   EntryTrie entries_;
+  // Read-only copy of entries_ in flat arrays, which is faster to look up.
+  // It's built after the rules are loaded, and dropped when a rule is added or
+  // deleted later, in which case entries_ is used until the next load.
+  std::optional<FlatTrie<const Entry *>> compiled_entries_;
   using EntrySet = absl::flat_hash_set<const Entry *>;
   EntrySet entry_set_;
 
@@ -29,6 +29,7 @@
 
 #include "composer/table.h"
 
+#include <cstddef>
 #include <iterator>
 #include <string>
 #include <vector>
@@ -912,6 +913,40 @@ TEST_F(TableTest, LoadFromString) {
   EXPECT_EQ(entry->pending(), "");
 }
 
+TEST_F(TableTest, AddRuleAfterLoad) {
+  Table table;
+  table.LoadFromString("ka\tか\nkk\tっ\tk\n");
+  ASSERT_NE(table.LookUp("ka"), nullptr);
+
+  // The rules added after loading are also looked up.
+  table.AddRule("ki", "き", "");
+  table.AddRule("ka", "カ", "");
+  const Entry *entry = table.LookUp("ki");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->result(), "き");
+  entry = table.LookUp("ka");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->result(), "カ");
+  EXPECT_TRUE(table.HasSubRules("k"));
+
+  size_t key_length = 0;
+  bool fixed = false;
+  entry = table.LookUpPrefix("kkk", &key_length, &fixed);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->result(), "っ");
+  EXPECT_EQ(key_length, 2);
+  EXPECT_TRUE(fixed);
+
+  // Loading again includes the added rules.
+  table.LoadFromString("ku\tく\n");
+  entry = table.LookUp("ki");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->result(), "き");
+  std::vector<const Entry *> results;
+  table.LookUpPredictiveAll("k", &results);
+  EXPECT_EQ(results.size(), 4);
+}
+
 TEST_F(TableTest, SpecialKeys) {
   {
     Table table;
@@ -688,6 +688,7 @@ Config::CharacterForm CharacterFormManager::GetConversionCharacterForm(
 }
 
 void CharacterFormManager::ClearHistory() {
+  ++preedit_generation_;
   // no need to call, as storage is shared
   // GetPreeditManager()->ClearHistory();
   VLOG(1) << "CharacterFormManager::ClearHistory() is called";
@@ -695,6 +696,7 @@ void CharacterFormManager::ClearHistory() {
 }
 
 void CharacterFormManager::Clear() {
+  ++preedit_generation_;
   VLOG(1) << "CharacterFormManager::Clear() is called";
   data_->GetConversionManager()->Clear();
   data_->GetPreeditManager()->Clear();
@@ -702,6 +704,7 @@ void CharacterFormManager::Clear() {
 
 void CharacterFormManager::SetCharacterForm(const absl::string_view input,
                                             Config::CharacterForm form) {
+  ++preedit_generation_;
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
   data_->GetConversionManager()->SetCharacterForm(input, form);
@@ -709,6 +712,7 @@ void CharacterFormManager::SetCharacterForm(const absl::string_view input,
 
 void CharacterFormManager::GuessAndSetCharacterForm(
     const absl::string_view input) {
+  ++preedit_generation_;
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
   data_->GetConversionManager()->GuessAndSetCharacterForm(input);
@@ -726,6 +730,7 @@ CharacterFormManager::GetLastNumberStyle() const {
 
 void CharacterFormManager::AddPreeditRule(const absl::string_view input,
                                           Config::CharacterForm form) {
+  ++preedit_generation_;
   data_->GetPreeditManager()->AddRule(input, form);
 }
 
@@ -735,6 +740,7 @@ void CharacterFormManager::AddConversionRule(const absl::string_view input,
 }
 
 void CharacterFormManager::SetDefaultRule() {
+  ++preedit_generation_;
   data_->GetPreeditManager()->SetDefaultRule();
   data_->GetConversionManager()->SetDefaultRule();
 }
@@ -30,6 +30,7 @@
 #ifndef MOZC_CONFIG_CHARACTER_FORM_MANAGER_H_
 #define MOZC_CONFIG_CHARACTER_FORM_MANAGER_H_
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -121,6 +122,11 @@ class CharacterFormManager {
   // Reload config explicitly.
   void ReloadConfig(const Config &config);
 
+  // Returns a counter incremented whenever the rules or the history used by
+  // ConvertPreeditString() may have changed. Callers caching converted preedit
+  // strings compare it to detect stale entries.
+  uint64_t preedit_generation() const { return preedit_generation_; }
+
   // Utility function: pass character form.
   static std::string ConvertWidth(std::string input,
                                   Config::CharacterForm form);
@@ -159,6 +165,7 @@ class CharacterFormManager {
   ~CharacterFormManager() = default;
 
   std::unique_ptr<Data> data_;
+  uint64_t preedit_generation_ = 0;
 };
 
 }  // namespace config
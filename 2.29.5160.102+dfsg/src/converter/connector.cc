@@ -38,6 +38,7 @@
 #include <vector>
 
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/util.h"
 #include "data_manager/data_manager_interface.h"
 #include "storage/louds/simple_succinct_bit_vector_index.h"
@@ -322,6 +323,12 @@ int Connector::GetTransitionCost(uint16_t rid, uint16_t lid) const {
 
 void Connector::ClearCache() { absl::c_fill(cache_key_, kInvalidCacheKey); }
 
+void Connector::GetMemoryStats(MemoryStats *stats) const {
+  stats->Add("rows", rows_.capacity() * sizeof(Row));
+  stats->Add("cache", cache_key_.capacity() * sizeof(uint32_t) +
+                          cache_value_.capacity() * sizeof(int));
+}
+
 int Connector::LookupCost(uint16_t rid, uint16_t lid) const {
   std::optional<uint16_t> value = rows_[rid].GetValue(lid);
   if (!value.has_value()) {
@@ -35,6 +35,7 @@
 #include <optional>
 #include <vector>
 
+#include "base/memory_stats.h"
 #include "data_manager/data_manager_interface.h"
 #include "storage/louds/simple_succinct_bit_vector_index.h"
 #include "absl/status/status.h"
@@ -58,6 +59,9 @@ class Connector final {
 
   void ClearCache();
 
+  // Adds the memory of the row index and the transition cost cache.
+  void GetMemoryStats(MemoryStats *stats) const;
+
  private:
   class Row;
 
@@ -39,7 +39,9 @@
 
 #include "base/japanese_util.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/strings/assign.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/immutable_converter_interface.h"
@@ -313,6 +315,7 @@ bool ConverterImpl::StartConversion(Segments *segments,
 bool ConverterImpl::Convert(const ConversionRequest &request,
                             const absl::string_view key,
                             Segments *segments) const {
+  ScopedTrace trace("ConverterImpl::Convert");
   SetKey(segments, key);
   if (!immutable_converter_->ConvertForRequest(request, segments)) {
     // Conversion can fail for keys like "12". Even in such cases, rewriters
@@ -328,6 +331,13 @@ bool ConverterImpl::Convert(const ConversionRequest &request,
 
 bool ConverterImpl::StartReverseConversion(Segments *segments,
                                            const absl::string_view key) const {
+  const ConversionRequest default_request;
+  return StartReverseConversionForRequest(default_request, segments, key);
+}
+
+bool ConverterImpl::StartReverseConversionForRequest(
+    const ConversionRequest &original_request, Segments *segments,
+    const absl::string_view key) const {
   segments->Clear();
   if (key.empty()) {
     return false;
@@ -348,9 +358,10 @@ bool ConverterImpl::StartReverseConversion(Segments *segments,
     }
   }
 
-  ConversionRequest default_request;
-  default_request.set_request_type(ConversionRequest::REVERSE_CONVERSION);
-  if (!immutable_converter_->ConvertForRequest(default_request, segments)) {
+  ConversionRequest request;
+  request.set_request_type(ConversionRequest::REVERSE_CONVERSION);
+  request.set_deadline(original_request.deadline());
+  if (!immutable_converter_->ConvertForRequest(request, segments)) {
     return false;
   }
   if (segments->segments_size() == 0) {
@@ -397,6 +408,7 @@ void ConverterImpl::MaybeSetConsumedKeySizeToSegment(size_t consumed_key_size,
 bool ConverterImpl::Predict(const ConversionRequest &request,
                             const absl::string_view key,
                             Segments *segments) const {
+  ScopedTrace trace("ConverterImpl::Predict");
   if (ShouldSetKeyForPrediction(request, key, *segments)) {
     SetKey(segments, key);
   }
@@ -860,6 +872,17 @@ bool ConverterImpl::ResizeSegment(
   return true;
 }
 
+void ConverterImpl::GetMemoryStats(MemoryStats *stats) const {
+  {
+    MemoryStats::Scope scope(stats, "predictor");
+    predictor_->GetMemoryStats(stats);
+  }
+  {
+    MemoryStats::Scope scope(stats, "rewriter");
+    rewriter_->GetMemoryStats(stats);
+  }
+}
+
 void ConverterImpl::CompletePosIds(Segment::Candidate *candidate) const {
   DCHECK(candidate);
   if (candidate->value.empty() || candidate->key.empty()) {
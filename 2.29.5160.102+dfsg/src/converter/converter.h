@@ -73,6 +73,10 @@ class ConverterImpl final : public ConverterInterface {
   bool StartReverseConversion(Segments *segments,
                               absl::string_view key) const override;
   ABSL_MUST_USE_RESULT
+  bool StartReverseConversionForRequest(const ConversionRequest &request,
+                                        Segments *segments,
+                                        absl::string_view key) const override;
+  ABSL_MUST_USE_RESULT
   bool StartPredictionForRequest(const ConversionRequest &request,
                                  Segments *segments) const override;
   ABSL_MUST_USE_RESULT
@@ -130,6 +134,7 @@ class ConverterImpl final : public ConverterInterface {
       Segments *segments, const ConversionRequest &request,
       size_t start_segment_index, size_t segments_size,
       absl::Span<const uint8_t> new_size_array) const override;
+  void GetMemoryStats(MemoryStats *stats) const override;
 
  private:
   FRIEND_TEST(ConverterTest, CompletePosIds);
@@ -34,6 +34,7 @@
 #include <string>
 #include <vector>
 
+#include "base/memory_stats.h"
 #include "base/port.h"
 #include "converter/segments.h"
 #include "request/conversion_request.h"
@@ -71,6 +72,13 @@ class ConverterInterface {
   virtual bool StartReverseConversion(Segments *segments,
                                       absl::string_view key) const = 0;
 
+  // Start reverse conversion with key for given request. Only the deadline of
+  // |request| is used.
+  ABSL_MUST_USE_RESULT
+  virtual bool StartReverseConversionForRequest(
+      const ConversionRequest &request, Segments *segments,
+      absl::string_view key) const = 0;
+
   // Starts prediction for given request.
   ABSL_MUST_USE_RESULT
   virtual bool StartPredictionForRequest(const ConversionRequest &request,
@@ -183,6 +191,9 @@ class ConverterInterface {
       size_t start_segment_index, size_t segments_size,
       absl::Span<const uint8_t> new_size_array) const = 0;
 
+  // Adds the approximate memory held by the converter to |stats|.
+  virtual void GetMemoryStats(MemoryStats *stats) const {}
+
  protected:
   ConverterInterface() = default;
 };
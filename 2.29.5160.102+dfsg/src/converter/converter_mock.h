@@ -47,6 +47,10 @@ class StrictMockConverter : public ConverterInterface {
               (Segments * segments, absl::string_view key), (const, override));
   MOCK_METHOD(bool, StartReverseConversion,
               (Segments * segments, absl::string_view key), (const, override));
+  MOCK_METHOD(bool, StartReverseConversionForRequest,
+              (const ConversionRequest &request, Segments *segments,
+               absl::string_view key),
+              (const, override));
   MOCK_METHOD(bool, StartPredictionForRequest,
               (const ConversionRequest &request, Segments *segments),
               (const, override));
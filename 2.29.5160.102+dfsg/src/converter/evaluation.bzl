@@ -39,9 +39,13 @@ def evaluation(
         engine_type,
         test_files,
         base_file,
+        num_threads = 1,
         visibility = None,
         **kwargs):
-    """Generates a dictionary evaluation tsv file."""
+    """Generates a dictionary evaluation tsv file.
+
+    The test items are split into num_threads shards run in parallel.
+    """
     evaluation_name = name + "_result"
     evaluation_out = evaluation_name + ".tsv"
     test_file_locations = ["$(location %s)" % file for file in test_files]
@@ -57,12 +61,14 @@ def evaluation(
                 --test_files="{test_file_locations}" \
                 --data_file="$(location {data_file})" \
                 --data_type="{data_type}" \
-                --engine_type="{engine_type}" > "$@"
+                --engine_type="{engine_type}" \
+                --num_threads={num_threads} > "$@"
         """.format(
             test_file_locations = ",".join(test_file_locations),
             data_file = data_file,
             data_type = data_type,
             engine_type = engine_type,
+            num_threads = num_threads,
         ),
         tags = ["manual"],
         tools = ["//converter:quality_regression_main"],
@@ -41,6 +41,7 @@
 
 #include "base/japanese_util.h"
 #include "base/logging.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "converter/connector.h"
 #include "converter/key_corrector.h"
@@ -133,7 +134,7 @@ void InsertCorrectedNodes(size_t pos, const std::string &key,
                           const KeyCorrector *key_corrector,
                           const DictionaryInterface *dictionary,
                           Lattice *lattice) {
-  if (key_corrector == nullptr) {
+  if (key_corrector == nullptr || request.IsDeadlineExceeded()) {
     return;
   }
   size_t length = 0;
@@ -144,6 +145,7 @@ void InsertCorrectedNodes(size_t pos, const std::string &key,
   KeyCorrectedNodeListBuilder builder(pos, key, key_corrector,
                                       GetSpatialCostParams(request),
                                       lattice->node_allocator());
+  builder.set_deadline(request.deadline());
   dictionary->LookupPrefix(absl::string_view(str, length), request, &builder);
   if (builder.tail() != nullptr) {
     builder.tail()->bnext = nullptr;
@@ -741,10 +743,16 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos, const int end_pos,
 
   lattice->node_allocator()->set_max_nodes_size(8192);
   Node *result_node = nullptr;
+  if (request.IsDeadlineExceeded()) {
+    // Past the deadline, the rest of the key gets only the character type
+    // based nodes, which keeps the lattice connected at a small cost.
+    return AddCharacterTypeBasedNodes(begin, end, lattice, result_node);
+  }
   if (is_reverse) {
     BaseNodeListBuilder builder(lattice->node_allocator(),
                                 lattice->node_allocator()->max_nodes_size(),
                                 GetSpatialCostParams(request));
+    builder.set_deadline(request.deadline());
     dictionary_->LookupReverse(absl::string_view(begin, len), request,
                                &builder);
     result_node = builder.result();
@@ -753,6 +761,8 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos, const int end_pos,
       NodeListBuilderWithCacheEnabled builder(
           lattice->node_allocator(), lattice->cache_info(begin_pos) + 1,
           GetSpatialCostParams(request));
+      // The deadline is not passed to |builder| as the cache info below
+      // assumes that the lookup is complete.
       dictionary_->LookupPrefix(absl::string_view(begin, len), request,
                                 &builder);
       result_node = builder.result();
@@ -762,6 +772,7 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos, const int end_pos,
       BaseNodeListBuilder builder(lattice->node_allocator(),
                                   lattice->node_allocator()->max_nodes_size(),
                                   GetSpatialCostParams(request));
+      builder.set_deadline(request.deadline());
       dictionary_->LookupPrefix(absl::string_view(begin, len), request,
                                 &builder);
       result_node = builder.result();
@@ -967,6 +978,7 @@ inline void ViterbiInternal(const Connector &connector, size_t pos,
 
 bool ImmutableConverterImpl::Viterbi(const Segments &segments,
                                      Lattice *lattice) const {
+  ScopedTrace trace("ImmutableConverterImpl::Viterbi");
   const std::string &key = lattice->key();
 
   // Process BOS.
@@ -1289,7 +1301,8 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
   // - Predictive nodes with zero-length prefix string are not generated.
   // do nothing if the conversion key is short
   constexpr size_t kKeyMinLength = 7;
-  if (conversion_key_chars.size() < kKeyMinLength) {
+  if (conversion_key_chars.size() < kKeyMinLength ||
+      request.IsDeadlineExceeded()) {
     return;
   }
 
@@ -1309,6 +1322,7 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
           lattice->node_allocator(),
           lattice->node_allocator()->max_nodes_size(),
           GetSpatialCostParams(request), pos_matcher_);
+      builder.set_deadline(request.deadline());
       suffix_dictionary_->LookupPredictive(
           absl::string_view(key.data() + pos, key.size() - pos), request,
           &builder);
@@ -1340,6 +1354,7 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
           lattice->node_allocator(),
           lattice->node_allocator()->max_nodes_size(),
           GetSpatialCostParams(request), pos_matcher_);
+      builder.set_deadline(request.deadline());
       dictionary_->LookupPredictive(
           absl::string_view(key.data() + pos, key.size() - pos), request,
           &builder);
@@ -1353,6 +1368,7 @@ void ImmutableConverterImpl::MakeLatticeNodesForPredictiveNodes(
 bool ImmutableConverterImpl::MakeLattice(const ConversionRequest &request,
                                          Segments *segments,
                                          Lattice *lattice) const {
+  ScopedTrace trace("ImmutableConverterImpl::MakeLattice");
   if (segments == nullptr) {
     LOG(ERROR) << "Segments is nullptr";
     return false;
@@ -1422,7 +1438,8 @@ bool ImmutableConverterImpl::MakeLattice(const ConversionRequest &request,
 
   if (is_reverse) {
     // Reverse lookup for each prefix string in key is slow with current
-    // implementation, so run it for them at once and cache the result.
+    // implementation, so run it for them at once and cache the result.  The
+    // cache is bounded and kept for the following reverse conversions.
     dictionary_->PopulateReverseLookupCache(key);
   }
 
@@ -1439,11 +1456,6 @@ bool ImmutableConverterImpl::MakeLattice(const ConversionRequest &request,
                                           lattice);
   }
 
-  if (is_reverse) {
-    // No reverse look up will happen afterwards.
-    dictionary_->ClearReverseLookupCache();
-  }
-
   // Nodes look up for real time conversion
   // If "enrich_partial_candidates" is true, stop adding predictive nodes here.
   if (is_prediction && !IsMobileRequest(request)) {
@@ -59,6 +59,7 @@
 #include "testing/gunit.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 namespace {
@@ -415,6 +416,28 @@ TEST(ImmutableConverterTest, NotConnectedTest) {
   EXPECT_TRUE(tested);
 }
 
+TEST(ImmutableConverterTest, ConvertAfterDeadline) {
+  std::unique_ptr<MockDataAndImmutableConverter> data_and_converter(
+      new MockDataAndImmutableConverter);
+  Segments segments;
+  ConversionRequest request;
+  request.set_deadline(absl::InfinitePast());
+  Segment *segment = segments.add_segment();
+  const std::string kRequestKey = "わたしのなまえはなかのです";
+  segment->set_key(kRequestKey);
+
+  // The lattice has only the character type based nodes, but the conversion
+  // still covers the whole key with at least one candidate per segment.
+  EXPECT_TRUE(data_and_converter->GetConverter()->ConvertForRequest(request,
+                                                                    &segments));
+  std::string key;
+  for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+    EXPECT_GT(segments.conversion_segment(i).candidates_size(), 0);
+    key.append(segments.conversion_segment(i).key());
+  }
+  EXPECT_EQ(key, kRequestKey);
+}
+
 TEST(ImmutableConverterTest, HistoryKeyLengthIsVeryLong) {
   // "あ..." (100 times)
   const std::string kA100 =
@@ -36,6 +36,7 @@
 #include <vector>
 
 #include "base/logging.h"
+#include "base/trace.h"
 #include "converter/candidate_filter.h"
 #include "converter/connector.h"
 #include "converter/lattice.h"
@@ -253,6 +254,7 @@ void NBestGenerator::MakeCandidate(
 void NBestGenerator::SetCandidates(const ConversionRequest &request,
                                    const std::string &original_key,
                                    const size_t expand_size, Segment *segment) {
+  ScopedTrace trace("NBestGenerator::SetCandidates");
   DCHECK(begin_node_);
   DCHECK(end_node_);
 
@@ -262,6 +264,11 @@ void NBestGenerator::SetCandidates(const ConversionRequest &request,
   }
 
   while (segment->candidates_size() < expand_size) {
+    // Past the deadline, the candidates generated so far are the result as
+    // long as there is at least one.
+    if (segment->candidates_size() > 0 && request.IsDeadlineExceeded()) {
+      break;
+    }
     Segment::Candidate *candidate = segment->push_back_candidate();
     DCHECK(candidate);
 
@@ -32,6 +32,7 @@
 
 #include <cstdint>
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "base/util.h"
 #include "converter/node.h"
@@ -41,6 +42,7 @@
 #include "protocol/commands.pb.h"
 #include "request/conversion_request.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 
@@ -94,6 +96,9 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
   // Determines a penalty for tokens of this (key, actual_key) pair.
   ResultType OnActualKey(absl::string_view key, absl::string_view actual_key,
                          int num_expanded) override {
+    if (IsDeadlineExceeded()) {
+      return TRAVERSE_DONE;
+    }
     penalty_ = num_expanded > 0 ? spatial_cost_params_.GetPenalty(key) : 0;
     return TRAVERSE_CONTINUE;
   }
@@ -106,6 +111,10 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
     return (limit_ <= 0) ? TRAVERSE_DONE : TRAVERSE_CONTINUE;
   }
 
+  // Stops the traversal once |deadline| has passed, keeping the nodes built so
+  // far. See ConversionRequest::deadline().
+  void set_deadline(absl::Time deadline) { deadline_ = deadline; }
+
   int limit() const { return limit_; }
   int penalty() const { return penalty_; }
   Node *result() const { return result_; }
@@ -130,6 +139,22 @@ class BaseNodeListBuilder : public dictionary::DictionaryInterface::Callback {
   int penalty_;
   const SpatialCostParams spatial_cost_params_;
   Node *result_;
+
+ private:
+  // The clock is read once per this number of keys since a key usually
+  // carries only a few tokens.
+  static constexpr int kDeadlineCheckInterval = 64;
+
+  bool IsDeadlineExceeded() {
+    if (deadline_ == absl::InfiniteFuture() ||
+        ++num_keys_ % kDeadlineCheckInterval != 0) {
+      return false;
+    }
+    return Clock::GetAbslTime() >= deadline_;
+  }
+
+  absl::Time deadline_ = absl::InfiniteFuture();
+  int num_keys_ = 0;
 };
 
 // Implements key filtering rule for LookupPrefix().
@@ -27,28 +27,48 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/file/temp_dir.h"
 #include "base/init_mozc.h"
+#include "base/stopwatch.h"
 #include "base/system_util.h"
+#include "base/thread_pool.h"
 #include "converter/quality_regression_util.h"
 #include "engine/eval_engine_factory.h"
+#include "absl/container/btree_map.h"
 #include "absl/flags/flag.h"
 #include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 
 ABSL_FLAG(std::vector<std::string>, test_files, {}, "regression test files");
 ABSL_FLAG(std::string, data_file, "", "engine data file");
 ABSL_FLAG(std::string, data_type, "", "engine data type");
 ABSL_FLAG(std::string, engine_type, "desktop", "engine type");
 ABSL_FLAG(std::string, output, "", "output file");
+ABSL_FLAG(int32_t, num_threads, 1,
+          "number of threads to run the test items on. Each thread has its "
+          "own engine and runs a contiguous shard of the items. As all the "
+          "engines share the user profile, the items learning the user "
+          "history (e.g. zero query) run one by one after the other items "
+          "when this is greater than 1.");
+ABSL_FLAG(std::string, stats_output, "",
+          "file to write the accuracy per label and the latency histogram of "
+          "the test items to");
 
 namespace {
 
@@ -56,26 +76,151 @@ using ::mozc::Engine;
 using ::mozc::TempDirectory;
 using ::mozc::quality_regression::QualityRegressionUtil;
 
-absl::Status Run(std::ostream &out, const Engine &engine,
-                 const std::vector<QualityRegressionUtil::TestItem> &items) {
+struct ItemResult {
+  bool passed = false;
+  std::string line;
+  absl::Duration latency;
+};
+
+// Runs |items| at |indices| on |engine| one by one.
+absl::Status RunShard(const Engine &engine,
+                      absl::Span<const QualityRegressionUtil::TestItem> items,
+                      absl::Span<const size_t> indices,
+                      absl::Span<ItemResult> results) {
   QualityRegressionUtil util(engine.GetConverter());
-  for (const QualityRegressionUtil::TestItem &item : items) {
+  for (const size_t i : indices) {
+    const QualityRegressionUtil::TestItem &item = items[i];
     std::string actual_value;
+    const mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
     const absl::StatusOr<bool> result =
         util.ConvertAndTest(item, &actual_value);
     if (!result.ok()) {
       return result.status();
     }
-    out << (result.value() ? "OK:\t" : "FAILED:\t") << item.key << "\t"
-        << actual_value << "\t" << item.command;
+    ItemResult &item_result = results[i];
+    item_result.latency = stopwatch.GetElapsed();
+    item_result.passed = result.value();
+    absl::StrAppend(&item_result.line, (result.value() ? "OK:\t" : "FAILED:\t"),
+                    item.key, "\t", actual_value, "\t", item.command);
     if (item.expected_rank != 0) {
-      out << " " << item.expected_rank;
+      absl::StrAppend(&item_result.line, " ", item.expected_rank);
     }
-    out << "\t" << item.expected_value << "\t" << std::endl;
+    absl::StrAppend(&item_result.line, "\t", item.expected_value, "\t");
   }
   return absl::OkStatus();
 }
 
+// Runs the shards of |items| on |engines| in parallel.
+//
+// All the engines share the user profile directory, which is process-global,
+// so the user history databases and the singletons they use must not be
+// updated while other engines read them.  Thus the items learning the user
+// history run one by one on the first engine after all the shards finish.
+absl::Status Run(absl::Span<const std::unique_ptr<Engine>> engines,
+                 const std::vector<QualityRegressionUtil::TestItem> &items,
+                 std::vector<ItemResult> *results) {
+  results->assign(items.size(), ItemResult());
+  const size_t num_shards = engines.size();
+  std::vector<size_t> parallel_indices, serial_indices;
+  for (size_t i = 0; i < items.size(); ++i) {
+    if (num_shards > 1 && QualityRegressionUtil::LearnsUserHistory(items[i])) {
+      serial_indices.push_back(i);
+    } else {
+      parallel_indices.push_back(i);
+    }
+  }
+  auto run_shard = [&](size_t shard) {
+    const size_t begin = parallel_indices.size() * shard / num_shards;
+    const size_t end = parallel_indices.size() * (shard + 1) / num_shards;
+    return RunShard(*engines[shard], items,
+                    absl::MakeConstSpan(parallel_indices)
+                        .subspan(begin, end - begin),
+                    absl::MakeSpan(*results));
+  };
+  if (num_shards == 1) {
+    return run_shard(0);
+  }
+
+  // The calling thread runs the first shard.
+  std::vector<absl::Status> statuses(num_shards);
+  mozc::ThreadPool pool(num_shards - 1);
+  std::vector<mozc::TaskFuture<void>> futures;
+  futures.reserve(num_shards - 1);
+  for (size_t shard = 1; shard < num_shards; ++shard) {
+    futures.push_back(pool.Schedule([&run_shard, &statuses, shard] {
+      statuses[shard] = run_shard(shard);
+    }));
+  }
+  statuses[0] = run_shard(0);
+  for (const mozc::TaskFuture<void> &future : futures) {
+    future.Wait();
+  }
+  for (const absl::Status &status : statuses) {
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return RunShard(*engines[0], items, serial_indices,
+                  absl::MakeSpan(*results));
+}
+
+void WriteStats(std::ostream &out,
+                const std::vector<QualityRegressionUtil::TestItem> &items,
+                const std::vector<ItemResult> &results) {
+  // label -> (passed, total)
+  absl::btree_map<std::string, std::pair<size_t, size_t>> accuracy;
+  size_t passed = 0;
+  std::vector<absl::Duration> latencies;
+  latencies.reserve(results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    std::pair<size_t, size_t> &counts = accuracy[items[i].label];
+    if (results[i].passed) {
+      ++counts.first;
+      ++passed;
+    }
+    ++counts.second;
+    latencies.push_back(results[i].latency);
+  }
+
+  auto write_accuracy = [&out](absl::string_view label, size_t passed,
+                               size_t total) {
+    out << "accuracy\t" << label << "\t" << passed << "\t" << total << "\t"
+        << (total == 0 ? 0.0 : static_cast<double>(passed) / total) << "\n";
+  };
+  write_accuracy("total", passed, results.size());
+  for (const auto &[label, counts] : accuracy) {
+    write_accuracy(label, counts.first, counts.second);
+  }
+  if (latencies.empty()) {
+    return;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  for (const int percentile : {50, 90, 99, 100}) {
+    const size_t index =
+        std::min(latencies.size() - 1, latencies.size() * percentile / 100);
+    out << "latency_usec\tp" << percentile << "\t"
+        << absl::ToInt64Microseconds(latencies[index]) << "\n";
+  }
+  // Buckets of [0, 1), [1, 2), [2, 4), ... in microseconds.
+  std::vector<size_t> histogram;
+  for (const absl::Duration latency : latencies) {
+    size_t bucket = 0;
+    for (int64_t usec = absl::ToInt64Microseconds(latency); usec > 0;
+         usec >>= 1) {
+      ++bucket;
+    }
+    if (histogram.size() <= bucket) {
+      histogram.resize(bucket + 1);
+    }
+    ++histogram[bucket];
+  }
+  for (size_t bucket = 0; bucket < histogram.size(); ++bucket) {
+    out << "histogram_usec\t" << (bucket == 0 ? 0 : int64_t{1} << (bucket - 1))
+        << "\t" << (int64_t{1} << bucket) << "\t" << histogram[bucket] << "\n";
+  }
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -85,13 +230,20 @@ int main(int argc, char **argv) {
   CHECK_OK(temp_dir);
   mozc::SystemUtil::SetUserProfileDirectory(temp_dir->path());
 
-  absl::StatusOr<std::unique_ptr<Engine>> create_result =
-      mozc::CreateEvalEngine(absl::GetFlag(FLAGS_data_file),
-                             absl::GetFlag(FLAGS_data_type),
-                             absl::GetFlag(FLAGS_engine_type));
-  if (!create_result.ok()) {
-    LOG(ERROR) << create_result.status();
-    return static_cast<int>(create_result.status().code());
+  // Engines are not thread safe, so each shard has its own one. They share
+  // the mapped data file.
+  const int num_threads = std::max(1, absl::GetFlag(FLAGS_num_threads));
+  std::vector<std::unique_ptr<Engine>> engines;
+  for (int i = 0; i < num_threads; ++i) {
+    absl::StatusOr<std::unique_ptr<Engine>> create_result =
+        mozc::CreateEvalEngine(absl::GetFlag(FLAGS_data_file),
+                               absl::GetFlag(FLAGS_data_type),
+                               absl::GetFlag(FLAGS_engine_type));
+    if (!create_result.ok()) {
+      LOG(ERROR) << create_result.status();
+      return static_cast<int>(create_result.status().code());
+    }
+    engines.push_back(*std::move(create_result));
   }
 
   std::vector<QualityRegressionUtil::TestItem> items;
@@ -102,16 +254,29 @@ int main(int argc, char **argv) {
     return static_cast<int>(parse_result.code());
   }
 
-  absl::Status status;
+  std::vector<ItemResult> results;
+  const absl::Status status = Run(engines, items, &results);
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+    return static_cast<int>(status.code());
+  }
+
+  // The results are written in the order of the items regardless of the
+  // sharding.
+  auto write_results = [&results](std::ostream &out) {
+    for (const ItemResult &result : results) {
+      out << result.line << std::endl;
+    }
+  };
   if (!absl::GetFlag(FLAGS_output).empty()) {
     std::ofstream out(absl::GetFlag(FLAGS_output));
-    status = Run(out, *create_result.value(), items);
+    write_results(out);
   } else {
-    status = Run(std::cout, *create_result.value(), items);
+    write_results(std::cout);
   }
-  if (!status.ok()) {
-    LOG(ERROR) << status;
-    return static_cast<int>(status.code());
+  if (!absl::GetFlag(FLAGS_stats_output).empty()) {
+    std::ofstream out(absl::GetFlag(FLAGS_stats_output));
+    WriteStats(out, items, results);
   }
 
   return 0;
@@ -349,6 +349,12 @@ void QualityRegressionUtil::SetConfig(const config::Config &config) {
   config_ = config;
 }
 
+// static
+bool QualityRegressionUtil::LearnsUserHistory(const TestItem &item) {
+  return item.command == kZeroQueryExpect ||
+         item.command == kZeroQueryNotExpect;
+}
+
 // static
 std::string QualityRegressionUtil::GetPlatformString(
     uint32_t platform_bitfiled) {
@@ -87,6 +87,10 @@ class QualityRegressionUtil {
   absl::StatusOr<bool> ConvertAndTest(const TestItem &item,
                                       std::string *actual_value);
 
+  // Returns true if ConvertAndTest() commits a candidate for |item|, which
+  // updates the user history stored in the user profile directory.
+  static bool LearnsUserHistory(const TestItem &item);
+
   void SetRequest(const commands::Request &request);
   void SetConfig(const config::Config &config);
   static std::string GetPlatformString(uint32_t platform_bitfiled);
@@ -30,7 +30,9 @@
 #include "data_manager/data_manager.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <initializer_list>
 #include <memory>
 #include <new>
 #include <optional>
@@ -41,10 +43,12 @@
 
 #include "base/container/serialized_string_array.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/version.h"
 #include "data_manager/dataset_reader.h"
 #include "data_manager/serialized_dictionary.h"
 #include "protocol/segmenter_data.pb.h"
+#include "absl/algorithm/container.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
@@ -88,6 +92,28 @@ DataManager::Status InitUserPosManagerDataFromReader(
   return DataManager::Status::OK;
 }
 
+// Gets the data of |name| unless it's compressed.  The data of a compressed
+// section is left empty and read by DataManager::GetSection() on the first
+// access, so that it's decompressed only when it's used.
+bool GetMappedSection(const DataSetReader &reader, absl::string_view name,
+                      absl::string_view *data) {
+  if (reader.IsCompressed(name)) {
+    *data = absl::string_view();
+    return true;
+  }
+  return reader.Get(name, data);
+}
+
+// Returns true if any of |names| is compressed.  The compressed sections are
+// not verified at the initialization, as it would decompress them; only
+// their sizes are checked on decompression.
+bool IsAnyCompressed(const DataSetReader &reader,
+                     std::initializer_list<absl::string_view> names) {
+  return absl::c_any_of(names, [&reader](absl::string_view name) {
+    return reader.IsCompressed(name);
+  });
+}
+
 template <typename T>
 absl::Span<const T> MakeSpanFromAlignedBuffer(const absl::string_view buf) {
   return absl::MakeSpan(std::launder(reinterpret_cast<const T *>(buf.data())),
@@ -96,6 +122,9 @@ absl::Span<const T> MakeSpanFromAlignedBuffer(const absl::string_view buf) {
 
 }  // namespace
 
+DataManager::DataManager() = default;
+DataManager::~DataManager() = default;
+
 // static
 std::string DataManager::StatusCodeToString(Status code) {
   std::string s;
@@ -154,12 +183,13 @@ DataManager::Status DataManager::InitFromArray(absl::string_view array) {
 
 DataManager::Status DataManager::InitFromArray(absl::string_view array,
                                                absl::string_view magic) {
-  DataSetReader reader;
-  if (!reader.Init(array, magic)) {
+  // The reader is kept as it owns the decompressed data.
+  reader_ = std::make_unique<DataSetReader>();
+  if (!reader_->Init(array, magic)) {
     LOG(ERROR) << "Binary data of size " << array.size() << " is broken";
     return DataManager::Status::DATA_BROKEN;
   }
-  return InitFromReader(reader);
+  return InitFromReader(*reader_);
 }
 
 DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
@@ -283,129 +313,155 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
       return Status::DATA_BROKEN;
     }
   }
-  if (!reader.Get("symbol_token", &symbol_token_array_data_)) {
+  if (!GetMappedSection(reader, "symbol_token", &symbol_token_array_data_)) {
     LOG(ERROR) << "Cannot find a symbol token array";
     return Status::DATA_MISSING;
   }
-  if (!reader.Get("symbol_string", &symbol_string_array_data_)) {
+  if (!GetMappedSection(reader, "symbol_string",
+                        &symbol_string_array_data_)) {
     LOG(ERROR) << "Cannot find a symbol string array or data is broken";
     return Status::DATA_MISSING;
   }
-  if (!SerializedDictionary::VerifyData(symbol_token_array_data_,
+  if (!IsAnyCompressed(reader, {"symbol_token", "symbol_string"}) &&
+      !SerializedDictionary::VerifyData(symbol_token_array_data_,
                                         symbol_string_array_data_)) {
     LOG(ERROR) << "Symbol dictionary data is broken";
     return Status::DATA_BROKEN;
   }
-  if (!reader.Get("emoticon_token", &emoticon_token_array_data_)) {
+  if (!GetMappedSection(reader, "emoticon_token",
+                        &emoticon_token_array_data_)) {
     LOG(ERROR) << "Cannot find an emoticon token array";
     return Status::DATA_MISSING;
   }
-  if (!reader.Get("emoticon_string", &emoticon_string_array_data_)) {
+  if (!GetMappedSection(reader, "emoticon_string",
+                        &emoticon_string_array_data_)) {
     LOG(ERROR) << "Cannot find an emoticon string array or data is broken";
     return Status::DATA_MISSING;
   }
-  if (!SerializedDictionary::VerifyData(emoticon_token_array_data_,
+  if (!IsAnyCompressed(reader, {"emoticon_token", "emoticon_string"}) &&
+      !SerializedDictionary::VerifyData(emoticon_token_array_data_,
                                         emoticon_string_array_data_)) {
     LOG(ERROR) << "Emoticon dictionary data is broken";
     return Status::DATA_BROKEN;
   }
-  if (!reader.Get("emoji_token", &emoji_token_array_data_)) {
+  if (!GetMappedSection(reader, "emoji_token", &emoji_token_array_data_)) {
     LOG(ERROR) << "Cannot find an emoji token array";
     return Status::DATA_MISSING;
   }
-  if (!reader.Get("emoji_string", &emoji_string_array_data_)) {
+  if (!GetMappedSection(reader, "emoji_string", &emoji_string_array_data_)) {
     LOG(ERROR) << "Cannot find an emoji string array or data is broken";
     return Status::DATA_MISSING;
   }
-  if (!SerializedStringArray::VerifyData(emoji_string_array_data_)) {
+  if (!IsAnyCompressed(reader, {"emoji_string"}) &&
+      !SerializedStringArray::VerifyData(emoji_string_array_data_)) {
     LOG(ERROR) << "Emoji rewriter string array data is broken";
     return Status::DATA_BROKEN;
   }
-  if (!reader.Get("single_kanji_token", &single_kanji_token_array_data_) ||
-      !reader.Get("single_kanji_string", &single_kanji_string_array_data_) ||
-      !reader.Get("single_kanji_variant_type",
-                  &single_kanji_variant_type_data_) ||
-      !reader.Get("single_kanji_variant_token",
-                  &single_kanji_variant_token_array_data_) ||
-      !reader.Get("single_kanji_variant_string",
-                  &single_kanji_variant_string_array_data_) ||
-      !reader.Get("single_kanji_noun_prefix_token",
-                  &single_kanji_noun_prefix_token_array_data_) ||
-      !reader.Get("single_kanji_noun_prefix_string",
-                  &single_kanji_noun_prefix_string_array_data_)) {
+  if (!GetMappedSection(reader, "single_kanji_token",
+                        &single_kanji_token_array_data_) ||
+      !GetMappedSection(reader, "single_kanji_string",
+                        &single_kanji_string_array_data_) ||
+      !GetMappedSection(reader, "single_kanji_variant_type",
+                        &single_kanji_variant_type_data_) ||
+      !GetMappedSection(reader, "single_kanji_variant_token",
+                        &single_kanji_variant_token_array_data_) ||
+      !GetMappedSection(reader, "single_kanji_variant_string",
+                        &single_kanji_variant_string_array_data_) ||
+      !GetMappedSection(reader, "single_kanji_noun_prefix_token",
+                        &single_kanji_noun_prefix_token_array_data_) ||
+      !GetMappedSection(reader, "single_kanji_noun_prefix_string",
+                        &single_kanji_noun_prefix_string_array_data_)) {
     LOG(ERROR) << "Cannot find single Kanji rewriter data";
     return Status::DATA_MISSING;
   }
-  if (!SerializedStringArray::VerifyData(single_kanji_string_array_data_) ||
-      !SerializedStringArray::VerifyData(single_kanji_variant_type_data_) ||
-      !SerializedStringArray::VerifyData(
-          single_kanji_variant_string_array_data_) ||
-      !SerializedDictionary::VerifyData(
-          single_kanji_noun_prefix_token_array_data_,
-          single_kanji_noun_prefix_string_array_data_)) {
+  if (!IsAnyCompressed(reader, {"single_kanji_string",
+                                "single_kanji_variant_type",
+                                "single_kanji_variant_string",
+                                "single_kanji_noun_prefix_token",
+                                "single_kanji_noun_prefix_string"}) &&
+      (!SerializedStringArray::VerifyData(single_kanji_string_array_data_) ||
+       !SerializedStringArray::VerifyData(single_kanji_variant_type_data_) ||
+       !SerializedStringArray::VerifyData(
+           single_kanji_variant_string_array_data_) ||
+       !SerializedDictionary::VerifyData(
+           single_kanji_noun_prefix_token_array_data_,
+           single_kanji_noun_prefix_string_array_data_))) {
     LOG(ERROR) << "Single Kanji data is broken";
     return Status::DATA_BROKEN;
   }
-  if (!reader.Get("a11y_description_token",
-                  &a11y_description_token_array_data_)) {
+  if (!GetMappedSection(reader, "a11y_description_token",
+                        &a11y_description_token_array_data_)) {
     VLOG(2) << "A11y description dictionary's token array is not provided";
     a11y_description_token_array_data_ = "";
     // A11y description dictionary is optional, so don't return false here.
   }
-  if (!reader.Get("a11y_description_string",
-                  &a11y_description_string_array_data_)) {
+  if (!GetMappedSection(reader, "a11y_description_string",
+                        &a11y_description_string_array_data_)) {
     VLOG(2) << "A11y description dictionary's string array is not provided";
     a11y_description_string_array_data_ = "";
     // A11y description dictionary is optional, so don't return false here.
   }
-  if (!(a11y_description_token_array_data_.empty() &&
+  if (!IsAnyCompressed(reader,
+                       {"a11y_description_token", "a11y_description_string"}) &&
+      !(a11y_description_token_array_data_.empty() &&
         a11y_description_string_array_data_.empty()) &&
       !SerializedDictionary::VerifyData(a11y_description_token_array_data_,
                                         a11y_description_string_array_data_)) {
     LOG(ERROR) << "A11y description dictionary data is broken";
     return Status::DATA_BROKEN;
   }
-  if (!reader.Get("zero_query_token_array", &zero_query_token_array_data_) ||
-      !reader.Get("zero_query_string_array", &zero_query_string_array_data_) ||
-      !reader.Get("zero_query_number_token_array",
-                  &zero_query_number_token_array_data_) ||
-      !reader.Get("zero_query_number_string_array",
-                  &zero_query_number_string_array_data_)) {
+  if (!GetMappedSection(reader, "zero_query_token_array",
+                        &zero_query_token_array_data_) ||
+      !GetMappedSection(reader, "zero_query_string_array",
+                        &zero_query_string_array_data_) ||
+      !GetMappedSection(reader, "zero_query_number_token_array",
+                        &zero_query_number_token_array_data_) ||
+      !GetMappedSection(reader, "zero_query_number_string_array",
+                        &zero_query_number_string_array_data_)) {
     LOG(ERROR) << "Cannot find zero query data";
     return Status::DATA_MISSING;
   }
-  if (!SerializedStringArray::VerifyData(zero_query_string_array_data_) ||
-      !SerializedStringArray::VerifyData(
-          zero_query_number_string_array_data_)) {
+  if (!IsAnyCompressed(reader, {"zero_query_string_array",
+                                "zero_query_number_string_array"}) &&
+      (!SerializedStringArray::VerifyData(zero_query_string_array_data_) ||
+       !SerializedStringArray::VerifyData(
+           zero_query_number_string_array_data_))) {
     LOG(ERROR) << "Zero query data is broken";
     return Status::DATA_BROKEN;
   }
 
-  if (!reader.Get("usage_item_array", &usage_items_data_)) {
+  if (!GetMappedSection(reader, "usage_item_array", &usage_items_data_)) {
     VLOG(2) << "Usage dictionary is not provided";
     // Usage dictionary is optional, so don't return false here.
   } else {
-    if (!reader.Get("usage_base_conjugation_suffix",
-                    &usage_base_conjugation_suffix_data_) ||
-        !reader.Get("usage_conjugation_suffix",
-                    &usage_conjugation_suffix_data_) ||
-        !reader.Get("usage_conjugation_index",
-                    &usage_conjugation_index_data_) ||
-        !reader.Get("usage_string_array", &usage_string_array_data_)) {
+    if (!GetMappedSection(reader, "usage_base_conjugation_suffix",
+                          &usage_base_conjugation_suffix_data_) ||
+        !GetMappedSection(reader, "usage_conjugation_suffix",
+                          &usage_conjugation_suffix_data_) ||
+        !GetMappedSection(reader, "usage_conjugation_index",
+                          &usage_conjugation_index_data_) ||
+        !GetMappedSection(reader, "usage_string_array",
+                          &usage_string_array_data_)) {
       LOG(ERROR) << "Cannot find some usage dictionary data components";
       return Status::DATA_MISSING;
     }
-    if (!SerializedStringArray::VerifyData(usage_string_array_data_)) {
+    if (!IsAnyCompressed(reader, {"usage_string_array"}) &&
+        !SerializedStringArray::VerifyData(usage_string_array_data_)) {
       LOG(ERROR) << "Usage dictionary's string array is broken";
       return Status::DATA_BROKEN;
     }
   }
 
-  for (const auto &kv : reader.name_to_data_map()) {
-    if (!absl::StartsWith(kv.first, "typing_model")) {
+  for (const auto &[name, stored_data] : reader.name_to_data_map()) {
+    if (!absl::StartsWith(name, "typing_model")) {
       continue;
     }
-    typing_model_data_.push_back(kv);
+    absl::string_view data;
+    if (!GetMappedSection(reader, name, &data)) {
+      LOG(ERROR) << "Typing model " << name << " is broken";
+      return Status::DATA_BROKEN;
+    }
+    typing_model_data_.emplace_back(name, data);
   }
   std::sort(typing_model_data_.begin(), typing_model_data_.end(),
             [](const std::pair<std::string, absl::string_view> &l,
@@ -413,6 +469,14 @@ DataManager::Status DataManager::InitFromReader(const DataSetReader &reader) {
               return l.first < r.first;
             });
 
+  for (const auto &[name, data] : reader.name_to_data_map()) {
+    // Compressed data is not in the data set image.
+    if (const auto offset_and_size = reader.GetOffsetAndSize(name);
+        offset_and_size.has_value()) {
+      offset_and_size_[name] = *offset_and_size;
+    }
+  }
+
   if (!reader.Get("version", &data_version_)) {
     LOG(ERROR) << "Cannot find data version";
     return Status::DATA_MISSING;
@@ -451,15 +515,29 @@ DataManager::Status DataManager::InitFromFile(const std::string &path,
   return InitFromArray(data, magic);
 }
 
+void DataManager::Prefault() const {
+  // Smaller than or equal to the page size of the supported platforms.
+  constexpr size_t kPageSize = 4096;
+  if (mmap_.empty()) {
+    return;
+  }
+  // Written through volatile so that the reads are not optimized out.
+  [[maybe_unused]] volatile char sink = 0;
+  for (size_t i = 0; i < mmap_.size(); i += kPageSize) {
+    sink = mmap_[i];
+  }
+  sink = mmap_[mmap_.size() - 1];
+}
+
 DataManager::Status DataManager::InitUserPosManagerDataFromArray(
     absl::string_view array, absl::string_view magic) {
-  DataSetReader reader;
-  if (!reader.Init(array, magic)) {
+  reader_ = std::make_unique<DataSetReader>();
+  if (!reader_->Init(array, magic)) {
     LOG(ERROR) << "Binary data of size " << array.size() << " is broken";
     return Status::DATA_BROKEN;
   }
   const Status status = InitUserPosManagerDataFromReader(
-      reader, &pos_matcher_data_, &user_pos_token_array_data_,
+      *reader_, &pos_matcher_data_, &user_pos_token_array_data_,
       &user_pos_string_array_data_);
   LOG_IF(ERROR, status != Status::OK) << "User POS manager data is broken";
   return status;
@@ -546,22 +624,23 @@ void DataManager::GetReadingCorrectionData(
 void DataManager::GetSymbolRewriterData(
     absl::string_view *token_array_data,
     absl::string_view *string_array_data) const {
-  *token_array_data = symbol_token_array_data_;
-  *string_array_data = symbol_string_array_data_;
+  *token_array_data = GetSection("symbol_token", symbol_token_array_data_);
+  *string_array_data = GetSection("symbol_string", symbol_string_array_data_);
 }
 
 void DataManager::GetEmoticonRewriterData(
     absl::string_view *token_array_data,
     absl::string_view *string_array_data) const {
-  *token_array_data = emoticon_token_array_data_;
-  *string_array_data = emoticon_string_array_data_;
+  *token_array_data = GetSection("emoticon_token", emoticon_token_array_data_);
+  *string_array_data =
+      GetSection("emoticon_string", emoticon_string_array_data_);
 }
 
 void DataManager::GetEmojiRewriterData(
     absl::string_view *token_array_data,
     absl::string_view *string_array_data) const {
-  *token_array_data = emoji_token_array_data_;
-  *string_array_data = emoji_string_array_data_;
+  *token_array_data = GetSection("emoji_token", emoji_token_array_data_);
+  *string_array_data = GetSection("emoji_string", emoji_string_array_data_);
 }
 
 void DataManager::GetSingleKanjiRewriterData(
@@ -571,20 +650,34 @@ void DataManager::GetSingleKanjiRewriterData(
     absl::string_view *variant_string_array_data,
     absl::string_view *noun_prefix_token_array_data,
     absl::string_view *noun_prefix_string_array_data) const {
-  *token_array_data = single_kanji_token_array_data_;
-  *string_array_data = single_kanji_string_array_data_;
-  *variant_type_array_data = single_kanji_variant_type_data_;
-  *variant_token_array_data = single_kanji_variant_token_array_data_;
-  *variant_string_array_data = single_kanji_variant_string_array_data_;
-  *noun_prefix_token_array_data = single_kanji_noun_prefix_token_array_data_;
-  *noun_prefix_string_array_data = single_kanji_noun_prefix_string_array_data_;
+  *token_array_data =
+      GetSection("single_kanji_token", single_kanji_token_array_data_);
+  *string_array_data =
+      GetSection("single_kanji_string", single_kanji_string_array_data_);
+  *variant_type_array_data =
+      GetSection("single_kanji_variant_type", single_kanji_variant_type_data_);
+  *variant_token_array_data =
+      GetSection("single_kanji_variant_token",
+                 single_kanji_variant_token_array_data_);
+  *variant_string_array_data =
+      GetSection("single_kanji_variant_string",
+                 single_kanji_variant_string_array_data_);
+  *noun_prefix_token_array_data =
+      GetSection("single_kanji_noun_prefix_token",
+                 single_kanji_noun_prefix_token_array_data_);
+  *noun_prefix_string_array_data =
+      GetSection("single_kanji_noun_prefix_string",
+                 single_kanji_noun_prefix_string_array_data_);
 }
 
 void DataManager::GetA11yDescriptionRewriterData(
     absl::string_view *token_array_data,
     absl::string_view *string_array_data) const {
-  *token_array_data = a11y_description_token_array_data_;
-  *string_array_data = a11y_description_string_array_data_;
+  *token_array_data =
+      GetSection("a11y_description_token", a11y_description_token_array_data_);
+  *string_array_data =
+      GetSection("a11y_description_string",
+                 a11y_description_string_array_data_);
 }
 
 void DataManager::GetCounterSuffixSortedArray(const char **array,
@@ -598,10 +691,16 @@ void DataManager::GetZeroQueryData(
     absl::string_view *zero_query_string_array_data,
     absl::string_view *zero_query_number_token_array_data,
     absl::string_view *zero_query_number_string_array_data) const {
-  *zero_query_token_array_data = zero_query_token_array_data_;
-  *zero_query_string_array_data = zero_query_string_array_data_;
-  *zero_query_number_token_array_data = zero_query_number_token_array_data_;
-  *zero_query_number_string_array_data = zero_query_number_string_array_data_;
+  *zero_query_token_array_data =
+      GetSection("zero_query_token_array", zero_query_token_array_data_);
+  *zero_query_string_array_data =
+      GetSection("zero_query_string_array", zero_query_string_array_data_);
+  *zero_query_number_token_array_data =
+      GetSection("zero_query_number_token_array",
+                 zero_query_number_token_array_data_);
+  *zero_query_number_string_array_data =
+      GetSection("zero_query_number_string_array",
+                 zero_query_number_string_array_data_);
 }
 
 #ifndef NO_USAGE_REWRITER
@@ -611,11 +710,16 @@ void DataManager::GetUsageRewriterData(
     absl::string_view *conjugation_index_data,
     absl::string_view *usage_items_data,
     absl::string_view *string_array_data) const {
-  *base_conjugation_suffix_data = usage_base_conjugation_suffix_data_;
-  *conjugation_suffix_data = usage_conjugation_suffix_data_;
-  *conjugation_index_data = usage_conjugation_index_data_;
-  *usage_items_data = usage_items_data_;
-  *string_array_data = usage_string_array_data_;
+  *base_conjugation_suffix_data =
+      GetSection("usage_base_conjugation_suffix",
+                 usage_base_conjugation_suffix_data_);
+  *conjugation_suffix_data =
+      GetSection("usage_conjugation_suffix", usage_conjugation_suffix_data_);
+  *conjugation_index_data =
+      GetSection("usage_conjugation_index", usage_conjugation_index_data_);
+  *usage_items_data = GetSection("usage_item_array", usage_items_data_);
+  *string_array_data =
+      GetSection("usage_string_array", usage_string_array_data_);
 }
 #endif  // NO_USAGE_REWRITER
 
@@ -627,11 +731,34 @@ absl::string_view DataManager::GetTypingModel(const std::string &name) const {
   if (iter == typing_model_data_.end() || iter->first != name) {
     return absl::string_view();
   }
-  return iter->second;
+  return GetSection(iter->first, iter->second);
+}
+
+absl::string_view DataManager::GetSection(absl::string_view name,
+                                          absl::string_view data) const {
+  if (!data.empty() || reader_ == nullptr || !reader_->IsCompressed(name)) {
+    return data;
+  }
+  // The reader decompresses the section once and keeps the result, so the
+  // following accesses return the same view.
+  if (!reader_->Get(name, &data)) {
+    LOG(ERROR) << "Cannot decompress " << name;
+    return absl::string_view();
+  }
+  return data;
 }
 
 absl::string_view DataManager::GetDataVersion() const { return data_version_; }
 
+void DataManager::GetMemoryStats(MemoryStats *stats) const {
+  for (const auto &[name, offset_and_size] : offset_and_size_) {
+    stats->Add(name, offset_and_size.second);
+  }
+  if (reader_ != nullptr) {
+    stats->Add("decompressed", reader_->GetDecompressedBytes());
+  }
+}
+
 std::optional<std::pair<size_t, size_t>> DataManager::GetOffsetAndSize(
     absl::string_view name) const {
   if (const auto iter = offset_and_size_.find(name);
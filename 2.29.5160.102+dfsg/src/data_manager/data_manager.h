@@ -39,6 +39,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/memory_stats.h"
 #include "base/mmap.h"
 #include "data_manager/data_manager_interface.h"
 #include "absl/container/flat_hash_map.h"
@@ -75,9 +76,10 @@ class DataManager : public DataManagerInterface {
   static absl::StatusOr<std::unique_ptr<DataManager>> CreateFromFile(
       const std::string &path, absl::string_view magic);
 
-  DataManager() = default;
+  DataManager();
   DataManager(const DataManager &) = delete;
   DataManager &operator=(const DataManager &) = delete;
+  ~DataManager() override;
 
   // Parses |array| and extracts byte blocks of data set.  The |array| must
   // outlive this instance.  The second version specifies a custom magic number
@@ -90,6 +92,11 @@ class DataManager : public DataManagerInterface {
   Status InitFromFile(const std::string &path);
   Status InitFromFile(const std::string &path, absl::string_view magic);
 
+  // Reads every page of the data mapped by InitFromFile() so that the first
+  // conversions with it don't wait for the disk. Intended to be called on a
+  // background thread. Does nothing for the data given by InitFromArray().
+  void Prefault() const;
+
   // The same as above InitFromArray() but only parses data set for user pos
   // manager.  For mozc runtime modules, use InitFromArray() because this method
   // is only for build tools, e.g., rewriter/dictionary_generator.cc (some build
@@ -159,15 +166,23 @@ class DataManager : public DataManagerInterface {
 
   absl::string_view GetTypingModel(const std::string &name) const override;
   absl::string_view GetDataVersion() const override;
+  void GetMemoryStats(MemoryStats *stats) const override;
 
   std::optional<std::pair<size_t, size_t>> GetOffsetAndSize(
       absl::string_view name) const override;
 
  private:
   Status InitFromReader(const DataSetReader &reader);
+  // Returns |data|, or the decompressed data of the section |name| if the
+  // section is compressed.  Compressed sections are decompressed on the first
+  // access.
+  absl::string_view GetSection(absl::string_view name,
+                               absl::string_view data) const;
 
   std::optional<std::string> filename_ = std::nullopt;
   Mmap mmap_;
+  // Owns the decompressed data of compressed sections.
+  std::unique_ptr<DataSetReader> reader_;
   absl::string_view pos_matcher_data_;
   absl::string_view user_pos_token_array_data_;
   absl::string_view user_pos_string_array_data_;
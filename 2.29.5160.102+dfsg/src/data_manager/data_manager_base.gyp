@@ -77,6 +77,17 @@
         'genproto_dataset_proto#host',
       ],
     },
+    {
+      'target_name': 'dataset_compressor',
+      'type': 'static_library',
+      'toolsets': [ 'target', 'host' ],
+      'sources': [
+        'dataset_compressor.cc',
+      ],
+      'dependencies': [
+        '../base/absl.gyp:absl_base',
+      ],
+    },
     {
       'target_name': 'dataset_writer',
       'type': 'static_library',
@@ -88,6 +99,7 @@
         '../base/absl.gyp:absl_base',
         '../base/base.gyp:base',
         '../base/base.gyp:obfuscator_support',
+        'dataset_compressor',
         'dataset_proto',
       ],
     },
@@ -102,6 +114,7 @@
         '../base/absl.gyp:absl_base',
         '../base/base.gyp:base',
         '../base/base.gyp:obfuscator_support',
+        'dataset_compressor',
         'dataset_proto',
       ],
     },
@@ -36,6 +36,7 @@
 #include <string>
 #include <utility>
 
+#include "base/memory_stats.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 
@@ -155,6 +156,9 @@ class DataManagerInterface {
   // Gets the data version string.
   virtual absl::string_view GetDataVersion() const = 0;
 
+  // Adds the size of each data section to |stats|.
+  virtual void GetMemoryStats(MemoryStats *stats) const {}
+
   // Gets the offset and size of the given data section.
   virtual std::optional<std::pair<size_t, size_t>> GetOffsetAndSize(
       absl::string_view name) const {
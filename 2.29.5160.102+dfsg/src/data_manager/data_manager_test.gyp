@@ -66,6 +66,20 @@
         'data_manager_base.gyp:dataset_writer',
       ],
     },
+    {
+      'target_name': 'dataset_compressor_test',
+      'type': 'executable',
+      'toolsets': [ 'target' ],
+      'sources': [
+        'dataset_compressor_test.cc',
+      ],
+      'dependencies': [
+        '../base/absl.gyp:absl_base',
+        '../base/base.gyp:base',
+        '../testing/testing.gyp:gtest_main',
+        'data_manager_base.gyp:dataset_compressor',
+      ],
+    },
     {
       'target_name': 'dataset_reader_test',
       'type': 'executable',
@@ -0,0 +1,155 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "data_manager/dataset_compressor.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/bits.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+namespace {
+
+constexpr int kHashBits = 16;
+
+uint32_t Hash(const char *p) {
+  // Multiplicative hash of the 4 bytes at |p|.
+  return (LoadUnaligned<uint32_t>(p) * 2654435761u) >> (32 - kHashBits);
+}
+
+void AppendVarint(uint64_t value, std::string *output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(absl::string_view *input, uint64_t *value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && !input->empty(); shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(input->front());
+    input->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void AppendLiterals(absl::string_view literals, std::string *output) {
+  AppendVarint(literals.size(), output);
+  output->append(literals.data(), literals.size());
+}
+
+}  // namespace
+
+std::string DataSetCompressor::Compress(absl::string_view data) {
+  static_assert(kMinMatchLength == sizeof(uint32_t));
+  std::string output;
+  output.reserve(data.size() / 2);
+
+  // The last position seen for each hash of kMinMatchLength bytes.
+  std::vector<int64_t> table(1 << kHashBits, -1);
+  size_t literal_begin = 0;
+  size_t pos = 0;
+  while (pos + kMinMatchLength <= data.size()) {
+    const uint32_t hash = Hash(data.data() + pos);
+    const int64_t candidate = table[hash];
+    table[hash] = pos;
+    if (candidate < 0 ||
+        memcmp(data.data() + candidate, data.data() + pos, kMinMatchLength) !=
+            0) {
+      ++pos;
+      continue;
+    }
+    size_t length = kMinMatchLength;
+    while (pos + length < data.size() &&
+           data[candidate + length] == data[pos + length]) {
+      ++length;
+    }
+    AppendLiterals(data.substr(literal_begin, pos - literal_begin), &output);
+    AppendVarint(length - kMinMatchLength, &output);
+    AppendVarint(pos - candidate, &output);
+    // Registers the positions inside the match for the following matches.
+    const size_t match_end = pos + length;
+    for (++pos; pos < match_end && pos + kMinMatchLength <= data.size();
+         ++pos) {
+      table[Hash(data.data() + pos)] = pos;
+    }
+    pos = match_end;
+    literal_begin = pos;
+  }
+  AppendLiterals(data.substr(literal_begin), &output);
+  return output;
+}
+
+bool DataSetCompressor::Decompress(absl::string_view compressed,
+                                   absl::Span<char> output) {
+  size_t pos = 0;
+  while (true) {
+    uint64_t literal_length = 0;
+    if (!ReadVarint(&compressed, &literal_length) ||
+        literal_length > compressed.size() ||
+        literal_length > output.size() - pos) {
+      return false;
+    }
+    memcpy(output.data() + pos, compressed.data(), literal_length);
+    compressed.remove_prefix(literal_length);
+    pos += literal_length;
+    if (compressed.empty()) {
+      // The last block.
+      break;
+    }
+
+    uint64_t length = 0, offset = 0;
+    if (!ReadVarint(&compressed, &length) ||
+        !ReadVarint(&compressed, &offset) || offset == 0 || offset > pos ||
+        output.size() - pos < kMinMatchLength ||
+        length > output.size() - pos - kMinMatchLength) {
+      return false;
+    }
+    length += kMinMatchLength;
+    // Copies byte by byte as the source may overlap the destination.
+    for (const char *src = output.data() + pos - offset; length > 0;
+         --length) {
+      output[pos++] = *src++;
+    }
+  }
+  return pos == output.size();
+}
+
+}  // namespace mozc
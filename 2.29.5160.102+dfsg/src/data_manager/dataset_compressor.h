@@ -0,0 +1,66 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_DATA_MANAGER_DATASET_COMPRESSOR_H_
+#define MOZC_DATA_MANAGER_DATASET_COMPRESSOR_H_
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+
+// A small LZ77 codec for the data set sections that are rarely used, such as
+// emoji and symbol dictionaries.  It has no external dependency and is fast
+// to decode.  The compressed data is a sequence of the following blocks:
+//
+//   <literal length (varint)> <literals>
+//   [<match length - kMinMatchLength (varint)> <match offset (varint)>]
+//
+// The match copies bytes from the already decoded data |match offset| bytes
+// before the current position (the source may overlap the destination).  The
+// last block has no match part.
+class DataSetCompressor {
+ public:
+  DataSetCompressor() = delete;
+
+  static constexpr size_t kMinMatchLength = 4;
+
+  static std::string Compress(absl::string_view data);
+
+  // Decompresses |compressed| into |output|, whose size must be the size of
+  // the original data.  Returns false if |compressed| is broken.
+  static bool Decompress(absl::string_view compressed, absl::Span<char> output);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_DATA_MANAGER_DATASET_COMPRESSOR_H_
@@ -0,0 +1,121 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "data_manager/dataset_compressor.h"
+
+#include <string>
+
+#include "base/random.h"
+#include "testing/gunit.h"
+#include "absl/random/distributions.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace mozc {
+namespace {
+
+std::string CompressAndDecompress(absl::string_view data) {
+  const std::string compressed = DataSetCompressor::Compress(data);
+  std::string output(data.size(), '\0');
+  EXPECT_TRUE(
+      DataSetCompressor::Decompress(compressed, absl::MakeSpan(output)));
+  return output;
+}
+
+TEST(DataSetCompressorTest, RoundTrip) {
+  EXPECT_EQ(CompressAndDecompress(""), "");
+  EXPECT_EQ(CompressAndDecompress("a"), "a");
+  EXPECT_EQ(CompressAndDecompress("abcd"), "abcd");
+  EXPECT_EQ(CompressAndDecompress("abcdabcd"), "abcdabcd");
+  // Overlapping match.
+  EXPECT_EQ(CompressAndDecompress(std::string(100, 'a')),
+            std::string(100, 'a'));
+  const std::string binary("\0\xFF\0\xFF\0\xFF\0\xFF\0\x01", 10);
+  EXPECT_EQ(CompressAndDecompress(binary), binary);
+
+  Random random;
+  for (int i = 0; i < 100; ++i) {
+    // Random bytes from a small alphabet to have some matches.
+    const std::string data = random.ByteString(absl::Uniform(random, 0, 4096));
+    std::string text;
+    for (const char c : data) {
+      text.push_back('a' + static_cast<unsigned char>(c) % 4);
+    }
+    EXPECT_EQ(CompressAndDecompress(data), data);
+    EXPECT_EQ(CompressAndDecompress(text), text);
+  }
+}
+
+TEST(DataSetCompressorTest, Compress) {
+  std::string data;
+  for (int i = 0; i < 1000; ++i) {
+    absl::StrAppend(&data, "emoji", i % 10, "\t");
+  }
+  EXPECT_LT(DataSetCompressor::Compress(data).size(), data.size() / 10);
+}
+
+TEST(DataSetCompressorTest, BrokenData) {
+  const std::string data = "abcdabcdabcdabcd";
+  const std::string compressed = DataSetCompressor::Compress(data);
+  std::string output(data.size(), '\0');
+
+  // Wrong output size.
+  std::string short_output(data.size() - 1, '\0');
+  EXPECT_FALSE(
+      DataSetCompressor::Decompress(compressed, absl::MakeSpan(short_output)));
+  std::string long_output(data.size() + 1, '\0');
+  EXPECT_FALSE(
+      DataSetCompressor::Decompress(compressed, absl::MakeSpan(long_output)));
+
+  // Truncated data.
+  for (size_t i = 0; i < compressed.size(); ++i) {
+    EXPECT_FALSE(DataSetCompressor::Decompress(
+        absl::string_view(compressed).substr(0, i), absl::MakeSpan(output)));
+  }
+
+  // Literals longer than the data, and a match before the beginning.
+  EXPECT_FALSE(DataSetCompressor::Decompress("\x10" "abcd",
+                                             absl::MakeSpan(output)));
+  EXPECT_FALSE(DataSetCompressor::Decompress(absl::string_view("\x00\x00\x01",
+                                                               3),
+                                             absl::MakeSpan(output)));
+
+  // Random bytes must not crash.
+  Random random;
+  for (int i = 0; i < 1000; ++i) {
+    DataSetCompressor::Decompress(
+        random.ByteString(absl::Uniform(random, 0, 64)),
+        absl::MakeSpan(output));
+  }
+}
+
+}  // namespace
+}  // namespace mozc
@@ -29,7 +29,9 @@
 
 #include "data_manager/dataset_reader.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
@@ -38,8 +40,11 @@
 #include "base/unverified_sha1.h"
 #include "base/util.h"
 #include "data_manager/dataset.pb.h"
+#include "data_manager/dataset_compressor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace {
@@ -47,11 +52,20 @@ namespace {
 // The size of the file footer, which contains some metadata; see dataset.proto.
 constexpr size_t kFooterSize = 36;
 
+// The upper bound of the uncompressed data size to reject broken metadata
+// before allocating a buffer.  Real data is far smaller than this.
+constexpr uint64_t kMaxUncompressedSize = 1 << 30;
+
 }  // namespace
 
 bool DataSetReader::Init(absl::string_view memblock, absl::string_view magic) {
   memblock_ = memblock;
   name_to_data_map_.clear();
+  uncompressed_size_map_.clear();
+  {
+    absl::MutexLock l(&mutex_);
+    decompressed_data_map_.clear();
+  }
 
   // Initializes |name_to_data_map_| from |memblock|.  For binary data format,
   // see dataset.proto.
@@ -132,6 +146,15 @@ bool DataSetReader::Init(absl::string_view memblock, absl::string_view magic) {
                  << ", metadata offset = " << metadata_offset;
       return false;
     }
+    if (e.compression() == DataSetMetadata::Entry::LZ77) {
+      if (!e.has_uncompressed_size() ||
+          e.uncompressed_size() > kMaxUncompressedSize) {
+        LOG(ERROR) << "Broken: Invalid uncompressed size: "
+                   << e.Utf8DebugString();
+        return false;
+      }
+      uncompressed_size_map_[e.name()] = e.uncompressed_size();
+    }
     name_to_data_map_[e.name()] =
         absl::ClippedSubstr(memblock, e.offset(), e.size());
     prev_chunk_end = e.offset() + e.size();
@@ -145,20 +168,50 @@ bool DataSetReader::Get(absl::string_view name, absl::string_view* data) const {
   if (iter == name_to_data_map_.end()) {
     return false;
   }
-  *data = iter->second;
+  const auto size_iter = uncompressed_size_map_.find(name);
+  if (size_iter == uncompressed_size_map_.end()) {
+    *data = iter->second;
+    return true;
+  }
+
+  absl::MutexLock l(&mutex_);
+  std::unique_ptr<char[]> &buffer = decompressed_data_map_[name];
+  if (buffer == nullptr) {
+    auto decompressed = std::make_unique<char[]>(size_iter->second);
+    if (!DataSetCompressor::Decompress(
+            iter->second,
+            absl::MakeSpan(decompressed.get(), size_iter->second))) {
+      LOG(ERROR) << "Broken: Failed to decompress " << name;
+      decompressed_data_map_.erase(name);
+      return false;
+    }
+    buffer = std::move(decompressed);
+  }
+  *data = absl::string_view(buffer.get(), size_iter->second);
   return true;
 }
 
 std::optional<std::pair<size_t, size_t>> DataSetReader::GetOffsetAndSize(
     absl::string_view name) const {
-  absl::string_view data;
-  if (!Get(name, &data)) {
+  auto iter = name_to_data_map_.find(name);
+  if (iter == name_to_data_map_.end() ||
+      uncompressed_size_map_.contains(name)) {
     return std::nullopt;
   }
+  const absl::string_view data = iter->second;
   const size_t offset = data.data() - memblock_.data();
   return std::make_pair(offset, data.size());
 }
 
+size_t DataSetReader::GetDecompressedBytes() const {
+  absl::MutexLock l(&mutex_);
+  size_t bytes = 0;
+  for (const auto &[name, buffer] : decompressed_data_map_) {
+    bytes += uncompressed_size_map_.at(name);
+  }
+  return bytes;
+}
+
 bool DataSetReader::VerifyChecksum(absl::string_view memblock) {
   if (memblock.size() < kFooterSize) {
     return false;
@@ -30,17 +30,25 @@
 #ifndef MOZC_DATA_MANAGER_DATASET_READER_H_
 #define MOZC_DATA_MANAGER_DATASET_READER_H_
 
+#include <cstddef>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 
 class DataSetReader {
  public:
+  DataSetReader() = default;
+  DataSetReader(const DataSetReader &) = delete;
+  DataSetReader &operator=(const DataSetReader &) = delete;
+
   // Initializes the reader from the binary image of dataset file and expected
   // magic number.  The caller is responsible to load the content of a dataset
   // file into memory, and |memblock| must outlive this instance.  Note: this
@@ -49,16 +57,29 @@ class DataSetReader {
   bool Init(absl::string_view memblock, absl::string_view magic);
 
   // Gets the byte data corresponding to |name|.  If the data for |name| doesn't
-  // exist, returns false.
+  // exist or is broken, returns false.  Compressed data is decompressed on the
+  // first call for |name| and is owned by this instance, so |data| is valid
+  // only while this instance is alive.  This method is thread-safe.
   bool Get(absl::string_view name, absl::string_view *data) const;
 
   // Gets the byte offset and size of the data corresponding to `name`.
+  // Returns std::nullopt for compressed data, as it's not in the binary image.
   std::optional<std::pair<size_t, size_t>> GetOffsetAndSize(
       absl::string_view name) const;
 
+  // Returns true if the data corresponding to |name| is compressed.
+  bool IsCompressed(absl::string_view name) const {
+    return uncompressed_size_map_.contains(name);
+  }
+
+  // Returns the total byte size of the decompressed data.
+  size_t GetDecompressedBytes() const;
+
   // Verifies the checksum of binary image.
   static bool VerifyChecksum(absl::string_view memblock);
 
+  // Note that the values are the data stored in the binary image, which may be
+  // compressed.  Use Get() to read the data.
   const absl::flat_hash_map<std::string, absl::string_view> &name_to_data_map()
       const {
     return name_to_data_map_;
@@ -69,6 +90,13 @@ class DataSetReader {
 
   // The value points to a block of the specified |memblock|.
   absl::flat_hash_map<std::string, absl::string_view> name_to_data_map_;
+
+  // Maps the names of compressed data to their uncompressed sizes.
+  absl::flat_hash_map<std::string, size_t> uncompressed_size_map_;
+
+  mutable absl::Mutex mutex_;
+  mutable absl::flat_hash_map<std::string, std::unique_ptr<char[]>>
+      decompressed_data_map_ ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace mozc
@@ -48,6 +48,7 @@
 namespace mozc {
 namespace {
 
+using ::testing::_;
 using ::testing::Optional;
 using ::testing::Pair;
 
@@ -83,6 +84,46 @@ TEST(DataSetReaderTest, ValidData) {
   EXPECT_EQ(r.GetOffsetAndSize("foo"), std::nullopt);
 }
 
+TEST(DataSetReaderTest, CompressedData) {
+  const std::string kEmoji(1000, 'e');
+  constexpr absl::string_view kMozc("m\0zc\xEF", 5);
+  std::string image;
+  {
+    DataSetWriter w(kTestMagicNumber);
+    w.AddCompressed("emoji", 32, kEmoji);
+    // Stored uncompressed as compression doesn't make it smaller.
+    w.AddCompressed("mozc", 64, kMozc);
+    std::stringstream out;
+    w.Finish(&out);
+    image = out.str();
+  }
+  EXPECT_LT(image.size(), kEmoji.size());
+
+  DataSetReader r;
+  ASSERT_TRUE(DataSetReader::VerifyChecksum(image));
+  ASSERT_TRUE(r.Init(image, kTestMagicNumber));
+  EXPECT_EQ(r.GetDecompressedBytes(), 0);
+  EXPECT_TRUE(r.IsCompressed("emoji"));
+  EXPECT_FALSE(r.IsCompressed("mozc"));
+  EXPECT_FALSE(r.IsCompressed("unknown"));
+
+  absl::string_view data;
+  EXPECT_TRUE(r.Get("emoji", &data));
+  EXPECT_EQ(data, kEmoji);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(data.data()) % 4, 0);
+  EXPECT_EQ(r.GetOffsetAndSize("emoji"), std::nullopt);
+  EXPECT_EQ(r.GetDecompressedBytes(), kEmoji.size());
+
+  // The decompressed data is reused.
+  absl::string_view data2;
+  EXPECT_TRUE(r.Get("emoji", &data2));
+  EXPECT_EQ(data2.data(), data.data());
+
+  EXPECT_TRUE(r.Get("mozc", &data));
+  EXPECT_EQ(data, kMozc);
+  EXPECT_THAT(r.GetOffsetAndSize("mozc"), Optional(Pair(_, kMozc.size())));
+}
+
 TEST(DataSetReaderTest, InvalidMagicString) {
   DataSetReader r;
   EXPECT_FALSE(r.Init("", kTestMagicNumber));
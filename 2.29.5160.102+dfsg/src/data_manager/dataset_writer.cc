@@ -29,6 +29,7 @@
 
 #include "data_manager/dataset_writer.h"
 
+#include <cstddef>
 #include <ostream>
 #include <string>
 
@@ -38,6 +39,7 @@
 #include "base/status.h"
 #include "base/unverified_sha1.h"
 #include "base/util.h"
+#include "data_manager/dataset_compressor.h"
 #include "absl/numeric/bits.h"
 #include "absl/strings/string_view.h"
 
@@ -62,6 +64,28 @@ void DataSetWriter::Add(const std::string &name, int alignment,
   image_.append(data.data(), data.size());
 }
 
+void DataSetWriter::AddCompressed(const std::string &name, int alignment,
+                                  absl::string_view data) {
+  const std::string compressed = DataSetCompressor::Compress(data);
+  if (compressed.size() >= data.size()) {
+    Add(name, alignment, data);
+    return;
+  }
+  // The compressed data needs no padding, as DataSetReader decompresses it
+  // into a newly allocated buffer, which has the fundamental alignment.
+  CHECK(IsValidAlignment(alignment)) << "Invalid alignment: " << alignment;
+  CHECK_LE(static_cast<size_t>(alignment / 8), alignof(std::max_align_t))
+      << "Too large alignment for compressed data: " << alignment;
+  CHECK(seen_names_.insert(name).second) << name << " was already added";
+  DataSetMetadata::Entry *entry = metadata_.add_entries();
+  entry->set_name(name);
+  entry->set_offset(image_.size());
+  entry->set_size(compressed.size());
+  entry->set_compression(DataSetMetadata::Entry::LZ77);
+  entry->set_uncompressed_size(data.size());
+  image_.append(compressed);
+}
+
 void DataSetWriter::AddFile(const std::string &name, int alignment,
                             const std::string &filepath) {
   absl::StatusOr<std::string> content = FileUtil::GetContents(filepath);
@@ -69,6 +93,13 @@ void DataSetWriter::AddFile(const std::string &name, int alignment,
   Add(name, alignment, *content);
 }
 
+void DataSetWriter::AddCompressedFile(const std::string &name, int alignment,
+                                      const std::string &filepath) {
+  absl::StatusOr<std::string> content = FileUtil::GetContents(filepath);
+  CHECK_OK(content);
+  AddCompressed(name, alignment, *content);
+}
+
 void DataSetWriter::Finish(std::ostream *output) {
   const std::string s = metadata_.SerializeAsString();
   image_.append(s);                                // Metadata
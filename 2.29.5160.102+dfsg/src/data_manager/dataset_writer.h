@@ -50,10 +50,21 @@ class DataSetWriter {
   // specified bit boundary (8, 16, 32, 64, ...).
   void Add(const std::string &name, int alignment, absl::string_view data);
 
+  // Adds a binary image compressed by DataSetCompressor.  The data is stored
+  // uncompressed if compression doesn't make it smaller.  The alignment is
+  // applied to the decompressed data and must not exceed the fundamental
+  // alignment, i.e., alignof(std::max_align_t) bytes.
+  void AddCompressed(const std::string &name, int alignment,
+                     absl::string_view data);
+
   // Similar to Add() for absl::string_view but data is read from file.
   void AddFile(const std::string &name, int alignment,
                const std::string &filepath);
 
+  // Similar to AddCompressed() but data is read from file.
+  void AddCompressedFile(const std::string &name, int alignment,
+                         const std::string &filepath);
+
   // Writes the image to output.  If |output| is a file, it should be opened in
   // binary mode.
   void Finish(std::ostream *output);
@@ -33,6 +33,7 @@
 // $ ./path/to/artifacts/dataset_writer_main
 //   --magic=\xNN\xNN\xNN
 //   --output=/path/to/output
+//   [--compressed_sections=name1,name2,...]
 //   [arg1, [arg2, ...]]
 //
 // Here, each argument has the following form:
@@ -41,7 +42,9 @@
 //
 // where alignment must be a power of 2 greater than or equal to 8 (i.e., 8, 16,
 // 32, 64, ...). Each packed file can be retrieved by DataSetReader through its
-// name.
+// name.  The files named in --compressed_sections are compressed and
+// decompressed by DataSetReader on the first access, which is suitable for
+// large and rarely used data, e.g., emoji and symbol dictionaries.
 
 #include <ios>
 #include <string>
@@ -55,12 +58,15 @@
 #include "base/status.h"
 #include "base/util.h"
 #include "data_manager/dataset_writer.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_split.h"
 
 ABSL_FLAG(std::string, magic, "", "Hex-encoded magic number to be embedded");
 ABSL_FLAG(std::string, output, "", "Output file");
+ABSL_FLAG(std::string, compressed_sections, "",
+          "Comma-separated names of the files to be compressed");
 
 int main(int argc, char **argv) {
   mozc::InitMozc(argv[0], &argc, &argv);
@@ -94,6 +100,10 @@ int main(int argc, char **argv) {
 
   CHECK(!absl::GetFlag(FLAGS_output).empty()) << "--output is required";
 
+  const absl::flat_hash_set<std::string> compressed_sections =
+      absl::StrSplit(absl::GetFlag(FLAGS_compressed_sections), ',',
+                     absl::SkipEmpty());
+
   // DataSetWriter directly writes to the specified stream, so if it fails for
   // an input, the output contains a partial result.  To avoid such partial file
   // creation, write to a temporary file then rename it.
@@ -103,7 +113,11 @@ int main(int argc, char **argv) {
     for (const auto &input : inputs) {
       VLOG(1) << "Writing " << input.name << ", alignment = " << input.alignment
               << ", file = " << input.filename;
-      writer.AddFile(input.name, input.alignment, input.filename);
+      if (compressed_sections.contains(input.name)) {
+        writer.AddCompressedFile(input.name, input.alignment, input.filename);
+      } else {
+        writer.AddFile(input.name, input.alignment, input.filename);
+      }
     }
     mozc::OutputFileStream output(tmpfile,
                                   std::ios_base::out | std::ios_base::binary);
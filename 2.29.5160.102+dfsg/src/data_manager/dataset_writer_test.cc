@@ -133,5 +133,27 @@ TEST(DatasetWriterTest, Write) {
   EXPECT_EQ(actual, expected);
 }
 
+TEST(DatasetWriterTest, AddCompressed) {
+  const std::string data(100, 'x');
+  DataSetWriter w("magic");
+  w.AddCompressed("compressed", 64, data);
+  w.AddCompressed("small", 64, "xyz");
+
+  const DataSetMetadata &metadata = w.metadata();
+  ASSERT_EQ(metadata.entries_size(), 2);
+  const DataSetMetadata::Entry &compressed = metadata.entries(0);
+  EXPECT_EQ(compressed.offset(), 5);
+  EXPECT_LT(compressed.size(), data.size());
+  EXPECT_EQ(compressed.compression(), DataSetMetadata::Entry::LZ77);
+  EXPECT_EQ(compressed.uncompressed_size(), data.size());
+
+  // Small data is stored as is since compression doesn't make it smaller.
+  const DataSetMetadata::Entry &small = metadata.entries(1);
+  EXPECT_EQ(small.offset() % 8, 0);
+  EXPECT_EQ(small.size(), 3);
+  EXPECT_EQ(small.compression(), DataSetMetadata::Entry::NONE);
+  EXPECT_FALSE(small.has_uncompressed_size());
+}
+
 }  // namespace
 }  // namespace mozc
@@ -167,6 +167,7 @@
       'sources': [
         '<(gen_out_dir)/pos_map.inc',
         'user_dictionary.cc',
+        'user_dictionary_image.cc',
         'user_dictionary_importer.cc',
         'user_dictionary_session.cc',
         'user_dictionary_session_handler.cc',
@@ -179,9 +180,13 @@
         '../base/base.gyp:config_file_stream',
         '../base/base.gyp:number_util',
         '../config/config.gyp:config_handler',
+        '../data_manager/data_manager_base.gyp:dataset_reader',
+        '../data_manager/data_manager_base.gyp:dataset_writer',
         '../protocol/protocol.gyp:config_proto',
         '../protocol/protocol.gyp:user_dictionary_storage_proto',
         '../request/request.gyp:conversion_request',
+        '../storage/louds/louds.gyp:louds_trie',
+        '../storage/louds/louds.gyp:louds_trie_builder',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
         'gen_pos_map#host',
         'pos_matcher',
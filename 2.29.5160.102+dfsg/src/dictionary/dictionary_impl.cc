@@ -34,6 +34,7 @@
 #include <utility>
 
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/util.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/dictionary_token.h"
@@ -225,5 +226,17 @@ void DictionaryImpl::ClearReverseLookupCache() const {
   }
 }
 
+void DictionaryImpl::GetMemoryStats(MemoryStats *stats) const {
+  // The user dictionary is reported by its owner.
+  {
+    MemoryStats::Scope scope(stats, "system");
+    system_dictionary_->GetMemoryStats(stats);
+  }
+  {
+    MemoryStats::Scope scope(stats, "value");
+    value_dictionary_->GetMemoryStats(stats);
+  }
+}
+
 }  // namespace dictionary
 }  // namespace mozc
@@ -87,6 +87,7 @@ class DictionaryImpl : public DictionaryInterface {
   bool Reload() override;
   void PopulateReverseLookupCache(absl::string_view str) const override;
   void ClearReverseLookupCache() const override;
+  void GetMemoryStats(MemoryStats *stats) const override;
 
  private:
   enum LookupType {
@@ -33,6 +33,7 @@
 #include <string>
 #include <vector>
 
+#include "base/memory_stats.h"
 #include "base/port.h"
 #include "dictionary/dictionary_token.h"
 #include "request/conversion_request.h"
@@ -162,6 +163,9 @@ class DictionaryInterface {
   // Reload dictionary data from local disk.
   virtual bool Reload() { return true; }
 
+  // Adds the approximate memory held by the dictionary to |stats|.
+  virtual void GetMemoryStats(MemoryStats *stats) const {}
+
  protected:
   // Do not allow instantiation
   DictionaryInterface() = default;
@@ -44,6 +44,7 @@
         'user_dictionary_session_handler_test.cc',
         'user_dictionary_session_test.cc',
         'user_dictionary_storage_test.cc',
+        'user_dictionary_image_test.cc',
         'user_dictionary_test.cc',
         'user_dictionary_util_test.cc',
         'user_pos_test.cc',
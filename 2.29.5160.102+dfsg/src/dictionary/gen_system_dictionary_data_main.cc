@@ -33,7 +33,17 @@
 //  --input="dictionary0.txt dictionary1.txt"
 //  --output="output.h"
 //  --make_header
+//
+// With --frequency_ordered_layout, the entries for frequent keys are placed
+// close to each other in the output image.  The key frequency is taken from
+// --key_frequency_profile and --key_frequency_corpus if given, or estimated
+// from the token costs otherwise.
+//
+// With --num_threads, the input is parsed and the dictionary is built on
+// multiple threads.  The output is identical to the one built on one thread.
 
+#include <algorithm>
+#include <cstdint>
 #include <ios>
 #include <memory>
 #include <ostream>
@@ -45,12 +55,16 @@
 #include "base/file_stream.h"
 #include "base/init_mozc.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
+#include "base/strings/unicode.h"
 #include "data_manager/data_manager.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/system/system_dictionary_builder.h"
 #include "dictionary/text_dictionary_loader.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
@@ -58,6 +72,17 @@
 ABSL_FLAG(std::string, input, "", "space separated input text files");
 ABSL_FLAG(std::string, user_pos_manager_data, "", "user pos manager data");
 ABSL_FLAG(std::string, output, "", "output binary file");
+ABSL_FLAG(bool, frequency_ordered_layout, false,
+          "place the entries for frequent keys close to each other");
+ABSL_FLAG(std::string, key_frequency_profile, "",
+          "comma separated TSV files of \"key<TAB>frequency\" lines used by "
+          "--frequency_ordered_layout");
+ABSL_FLAG(int32_t, num_threads, 1,
+          "number of threads to parse the input and build the dictionary");
+ABSL_FLAG(std::string, key_frequency_corpus, "",
+          "comma separated TSV files in the quality regression test format. "
+          "Every dictionary key contained in the key column is counted for "
+          "--frequency_ordered_layout");
 
 namespace mozc {
 namespace {
@@ -91,6 +116,77 @@ std::pair<std::string, std::string> GetInputFileName(
           absl::StrJoin(reading_correction_inputs, kDelimiter)};
 }
 
+using KeyFrequencyMap = dictionary::SystemDictionaryBuilder::KeyFrequencyMap;
+
+void LoadKeyFrequencyProfile(const absl::string_view files,
+                             KeyFrequencyMap *key_frequency) {
+  for (absl::string_view file : absl::StrSplit(files, ',', absl::SkipEmpty())) {
+    InputFileStream ifs((std::string(file)));
+    CHECK(ifs) << "Cannot open " << file;
+    std::string line;
+    while (std::getline(ifs, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      const std::vector<absl::string_view> fields =
+          absl::StrSplit(line, '\t');
+      uint64_t frequency = 1;
+      if (fields.size() >= 2) {
+        CHECK(absl::SimpleAtoi(fields[1], &frequency)) << "Invalid: " << line;
+      }
+      (*key_frequency)[fields[0]] += frequency;
+    }
+  }
+}
+
+// Counts the dictionary keys contained in the key column of the quality
+// regression test files.
+void LoadKeyFrequencyCorpus(
+    const absl::string_view files,
+    const std::vector<std::unique_ptr<dictionary::Token>> &tokens,
+    KeyFrequencyMap *key_frequency) {
+  absl::flat_hash_set<absl::string_view> keys;
+  size_t max_key_length = 0;
+  for (const std::unique_ptr<dictionary::Token> &token : tokens) {
+    keys.insert(token->key);
+    max_key_length = std::max(max_key_length, token->key.size());
+  }
+  for (absl::string_view file : absl::StrSplit(files, ',', absl::SkipEmpty())) {
+    InputFileStream ifs((std::string(file)));
+    CHECK(ifs) << "Cannot open " << file;
+    std::string line;
+    while (std::getline(ifs, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      const std::vector<absl::string_view> fields =
+          absl::StrSplit(line, '\t');
+      if (fields.size() < 2) {
+        continue;
+      }
+      // Byte offsets of the character boundaries in |sentence|.
+      const absl::string_view sentence = fields[1];
+      std::vector<size_t> boundaries = {0};
+      while (boundaries.back() < sentence.size()) {
+        boundaries.push_back(boundaries.back() +
+                             strings::OneCharLen(sentence.begin() +
+                                                 boundaries.back()));
+      }
+      for (size_t i = 0; i < boundaries.size(); ++i) {
+        for (size_t j = i + 1; j < boundaries.size() &&
+                               boundaries[j] - boundaries[i] <= max_key_length;
+             ++j) {
+          const absl::string_view key =
+              sentence.substr(boundaries[i], boundaries[j] - boundaries[i]);
+          if (keys.contains(key)) {
+            ++(*key_frequency)[key];
+          }
+        }
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace mozc
 
@@ -114,10 +210,29 @@ int main(int argc, char **argv) {
   const mozc::dictionary::PosMatcher pos_matcher(
       data_manager.GetPosMatcherData());
 
+  // The main thread works as well, so the pool has one thread fewer.
+  std::unique_ptr<mozc::ThreadPool> pool;
+  if (absl::GetFlag(FLAGS_num_threads) > 1) {
+    pool = std::make_unique<mozc::ThreadPool>(
+        absl::GetFlag(FLAGS_num_threads) - 1);
+  }
+
   mozc::dictionary::TextDictionaryLoader loader(pos_matcher);
+  loader.EnableParallelLoad(pool.get());
   loader.Load(system_dictionary_input, reading_correction_input);
 
   mozc::dictionary::SystemDictionaryBuilder builder;
+  builder.EnableParallelBuild(pool.get());
+  if (absl::GetFlag(FLAGS_frequency_ordered_layout)) {
+    mozc::KeyFrequencyMap key_frequency;
+    mozc::LoadKeyFrequencyProfile(absl::GetFlag(FLAGS_key_frequency_profile),
+                                  &key_frequency);
+    mozc::LoadKeyFrequencyCorpus(absl::GetFlag(FLAGS_key_frequency_corpus),
+                                 loader.tokens(), &key_frequency);
+    LOG(INFO) << "Frequency ordered layout with " << key_frequency.size()
+              << " profiled keys";
+    builder.EnableFrequencyOrderedLayout(std::move(key_frequency));
+  }
   builder.BuildFromTokens(loader.tokens());
 
   std::unique_ptr<std::ostream> output_stream(new mozc::OutputFileStream(
@@ -30,8 +30,8 @@
 #include "dictionary/suppression_dictionary.h"
 
 #include <atomic>
+#include <memory>
 #include <string>
-#include <thread>  // NOLINT for portability
 #include <utility>
 
 #include "base/logging.h"
@@ -40,18 +40,9 @@
 
 namespace mozc {
 namespace dictionary {
-namespace {
 
-class Unlocker final {
- public:
-  explicit Unlocker(std::atomic<bool> *locked) : locked_{locked} {}
-  ~Unlocker() { locked_->store(false, std::memory_order_release); }
-
- private:
-  std::atomic<bool> *locked_;
-};
-
-}  // namespace
+SuppressionDictionary::SuppressionDictionary()
+    : data_(std::make_shared<const Data>()) {}
 
 bool SuppressionDictionary::AddEntry(std::string key, std::string value) {
   if (!locked_.load(std::memory_order_relaxed)) {
@@ -64,12 +55,14 @@ bool SuppressionDictionary::AddEntry(std::string key, std::string value) {
     return false;
   }
 
+  // The lock is held by Lock() and released by UnLock().
+  mutex_.AssertHeld();
   if (key.empty()) {
-    values_only_.insert(std::move(value));
+    pending_->values_only.insert(std::move(value));
   } else if (value.empty()) {
-    keys_only_.insert(std::move(key));
+    pending_->keys_only.insert(std::move(key));
   } else {
-    keys_values_.emplace(std::move(key), std::move(value));
+    pending_->keys_values.emplace(std::move(key), std::move(value));
   }
 
   return true;
@@ -80,61 +73,41 @@ void SuppressionDictionary::Clear() {
     LOG(ERROR) << "Dictionary is not locked";
     return;
   }
-  keys_values_.clear();
-  keys_only_.clear();
-  values_only_.clear();
+  mutex_.AssertHeld();
+  pending_->keys_values.clear();
+  pending_->keys_only.clear();
+  pending_->values_only.clear();
 }
 
-void SuppressionDictionary::Lock() {
-  absl::MutexLock l(&mutex_);  // TODO(noriyukit): Check if we need this lock.
-  for (;;) {
-    bool expected = false;
-    if (locked_.compare_exchange_weak(expected, true, std::memory_order_acquire,
-                                      std::memory_order_relaxed)) {
-      return;
-    }
-    std::this_thread::yield();
-  }
+void SuppressionDictionary::Lock() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+  mutex_.Lock();
+  pending_ = std::make_unique<Data>(*std::atomic_load(&data_));
+  locked_.store(true, std::memory_order_relaxed);
 }
 
-void SuppressionDictionary::UnLock() {
-  absl::MutexLock l(&mutex_);  // TODO(noriyukit): Check if we need this lock.
-  bool expected = true;
-  if (!locked_.compare_exchange_weak(expected, false, std::memory_order_release,
-                                     std::memory_order_relaxed)) {
+void SuppressionDictionary::UnLock() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+  if (!locked_.load(std::memory_order_relaxed)) {
     LOG(DFATAL) << "The dictionary was not locked";
+    return;
   }
-}
-
-bool SuppressionDictionary::IsEmpty() const {
-  bool expected = false;
-  if (!locked_.compare_exchange_weak(expected, true, std::memory_order_acquire,
-                                     std::memory_order_relaxed)) {
-    VLOG(2) << "Dictionary is locked now";
-    return true;
-  }
-  Unlocker u(&locked_);
-  return keys_only_.empty() && values_only_.empty() && keys_values_.empty();
+  const bool empty = pending_->empty();
+  std::atomic_store(&data_, std::shared_ptr<const Data>(std::move(pending_)));
+  empty_.store(empty, std::memory_order_release);
+  locked_.store(false, std::memory_order_relaxed);
+  mutex_.Unlock();
 }
 
 bool SuppressionDictionary::SuppressEntry(const absl::string_view key,
                                           const absl::string_view value) const {
-  bool expected = false;
-  if (!locked_.compare_exchange_weak(expected, true, std::memory_order_acquire,
-                                     std::memory_order_relaxed)) {
-    VLOG(2) << "Dictionary is locked now";
-    return false;
-  }
-  Unlocker u(&locked_);
-
-  if (keys_only_.empty() && values_only_.empty() && keys_values_.empty()) {
+  if (IsEmpty()) {
     // Almost all users don't use word suppression function.
     // We can return false as early as possible.
     return false;
   }
 
-  return keys_values_.contains(std::make_pair(key, value)) ||
-         keys_only_.contains(key) || values_only_.contains(value);
+  const std::shared_ptr<const Data> data = std::atomic_load(&data_);
+  return data->keys_values.contains(std::make_pair(key, value)) ||
+         data->keys_only.contains(key) || data->values_only.contains(value);
 }
 
 }  // namespace dictionary
@@ -32,9 +32,11 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
 #include "absl/strings/string_view.h"
@@ -44,13 +46,15 @@ namespace mozc {
 namespace dictionary {
 
 // Provides a functionality to test if a word should be suppressed in conversion
-// results. This class is not thread safe in general use but is safe under
-// single-producer single-consumer model, provided that the usage is correct. In
-// our usage, the producer is UserDictionary::UserDictionaryReloader thread and
-// the consumer is the main converter thread.
+// results. The contents are held in an immutable snapshot, which the producer
+// replaces atomically when it finishes an update. Therefore, the consumer
+// methods are safe to be called from any thread at any time, and they keep
+// seeing the previous contents while the producer is updating the dictionary.
+// In our usage, the producer is UserDictionary::UserDictionaryReloader thread
+// and the consumers are the converter and predictor threads.
 class SuppressionDictionary final {
  public:
-  SuppressionDictionary() = default;
+  SuppressionDictionary();
   SuppressionDictionary(const SuppressionDictionary &) = delete;
   SuppressionDictionary &operator=(const SuppressionDictionary &) = delete;
 
@@ -62,11 +66,12 @@ class SuppressionDictionary final {
   //
   // The producer thread must not call the other methods.
 
-  // Locks the dictionary (the producer thread is blocked until it gets the
-  // lock). Should not be called recursively.
+  // Locks the dictionary and starts editing a copy of the current contents
+  // (the producer thread is blocked until it gets the lock). Should not be
+  // called recursively.
   void Lock();
 
-  // Unlocks the dictionary.
+  // Publishes the edited contents to the consumers and unlocks the dictionary.
   void UnLock();
 
   // Adds an entry into the dictionary.
@@ -78,12 +83,12 @@ class SuppressionDictionary final {
   // Returns true if the dictionary is locked. This method is for debugging.
   bool IsLocked() const { return locked_.load(std::memory_order_relaxed); }
 
-  // Methods for the consumer thread. If the producer thread is updating the
-  // dictionary contents, the following methods behave as if the dictionary is
-  // empty.
+  // Methods for the consumer threads. While the producer thread is updating
+  // the dictionary, the following methods see the contents published by the
+  // last UnLock().
 
   // Returns true if SuppressionDictionary doesn't have any entries.
-  bool IsEmpty() const;
+  bool IsEmpty() const { return empty_.load(std::memory_order_acquire); }
 
   // Returns true if a word having `key` and `value` should be suppressed.
   bool SuppressEntry(absl::string_view key, absl::string_view value) const;
@@ -98,12 +103,27 @@ class SuppressionDictionary final {
     using is_transparent = void;
   };
 
-  absl::flat_hash_set<KeyValue, KeyValueHash, KeyValueEq> keys_values_;
-  absl::flat_hash_set<std::string> keys_only_;
-  absl::flat_hash_set<std::string> values_only_;
+  // Immutable once published.
+  struct Data {
+    bool empty() const {
+      return keys_values.empty() && keys_only.empty() && values_only.empty();
+    }
 
-  mutable std::atomic<bool> locked_ = false;
-  // TODO(noriyukit): Check if this mutex is still necessary.
+    absl::flat_hash_set<KeyValue, KeyValueHash, KeyValueEq> keys_values;
+    absl::flat_hash_set<std::string> keys_only;
+    absl::flat_hash_set<std::string> values_only;
+  };
+
+  // The published snapshot. Accessed only through std::atomic_load() and
+  // std::atomic_store().
+  std::shared_ptr<const Data> data_;
+  // Caches data_->empty() so that the consumers can skip loading the snapshot
+  // in the common case where the user has no suppression entries.
+  std::atomic<bool> empty_ = true;
+
+  // The contents being edited by the producer.
+  std::unique_ptr<Data> pending_ ABSL_GUARDED_BY(mutex_);
+  std::atomic<bool> locked_ = false;
   absl::Mutex mutex_;
 };
 
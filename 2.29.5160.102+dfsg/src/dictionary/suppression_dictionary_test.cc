@@ -35,6 +35,7 @@
 #include "base/thread2.h"
 #include "testing/gunit.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 
@@ -54,7 +55,7 @@ TEST(SuppressionDictionary, BasicTest) {
     // Not locked
     EXPECT_FALSE(dic.AddEntry("test", "test"));
 
-    // IsEmpty() returns always true when dic is locked
+    // IsEmpty() doesn't see the entries until the dic is unlocked
     {
       const SuppressionDictionaryLock l(&dic);
       EXPECT_TRUE(dic.IsEmpty());
@@ -74,10 +75,18 @@ TEST(SuppressionDictionary, BasicTest) {
     // Not locked
     EXPECT_FALSE(dic.AddEntry("test", "test"));
 
-    // locked now => SuppressEntry always returns false
+    // locked now => SuppressEntry sees the previous contents
     {
       const SuppressionDictionaryLock l(&dic);
-      EXPECT_FALSE(dic.SuppressEntry("key1", "value1"));
+      dic.Clear();
+      EXPECT_TRUE(dic.SuppressEntry("key1", "value1"));
+      EXPECT_TRUE(dic.AddEntry("key1", "value1"));
+      EXPECT_TRUE(dic.AddEntry("key2", "value2"));
+      EXPECT_TRUE(dic.AddEntry("key3", "value3"));
+      EXPECT_TRUE(dic.AddEntry("key4", ""));
+      EXPECT_TRUE(dic.AddEntry("key5", ""));
+      EXPECT_TRUE(dic.AddEntry("", "value4"));
+      EXPECT_TRUE(dic.AddEntry("", "value5"));
     }
 
     EXPECT_TRUE(dic.SuppressEntry("key1", "value1"));
@@ -143,6 +152,35 @@ TEST(SuppressionDictionary, ThreadTest) {
   }
 }
 
+TEST(SuppressionDictionary, ReadDuringUpdate) {
+  SuppressionDictionary dic;
+  {
+    const SuppressionDictionaryLock l(&dic);
+    EXPECT_TRUE(dic.AddEntry("key1", "value1"));
+  }
+
+  absl::Notification cleared, checked;
+  mozc::Thread2 producer([&dic, &cleared, &checked] {
+    const SuppressionDictionaryLock l(&dic);
+    dic.Clear();
+    EXPECT_TRUE(dic.AddEntry("key2", "value2"));
+    cleared.Notify();
+    checked.WaitForNotification();
+  });
+
+  // The previous contents are visible until the producer unlocks the dic.
+  cleared.WaitForNotification();
+  EXPECT_TRUE(dic.IsLocked());
+  EXPECT_FALSE(dic.IsEmpty());
+  EXPECT_TRUE(dic.SuppressEntry("key1", "value1"));
+  EXPECT_FALSE(dic.SuppressEntry("key2", "value2"));
+  checked.Notify();
+  producer.Join();
+
+  EXPECT_FALSE(dic.SuppressEntry("key1", "value1"));
+  EXPECT_TRUE(dic.SuppressEntry("key2", "value2"));
+}
+
 }  // namespace
 }  // namespace dictionary
 }  // namespace mozc
@@ -60,6 +60,7 @@
 
 #include "base/japanese_util.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/mmap.h"
 #include "base/port.h"
 #include "base/util.h"
@@ -71,8 +72,10 @@
 #include "dictionary/system/words_info.h"
 #include "storage/louds/bit_vector_based_array.h"
 #include "storage/louds/louds_trie.h"
+#include "storage/lru_cache.h"
 #include "absl/container/btree_set.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 namespace dictionary {
@@ -99,6 +102,12 @@ constexpr size_t kValueTrieSelect0CacheSize = 1 * 1024;
 constexpr size_t kValueTrieSelect1CacheSize = 16 * 1024;
 constexpr size_t kValueTrieTermvecCacheSize = 4 * 1024;
 
+// The max number of value IDs whose reverse lookup results are cached.  Each
+// ID typically has one or two tokens, so the cache is at most a few hundred
+// KB, while a reverse conversion of a sentence touches a few hundred IDs.
+// The IDs of the current reverse conversion are pinned on top of this bound.
+constexpr size_t kReverseLookupCacheSize = 16 * 1024;
+
 // Expansion table format:
 // "<Character to expand>[<Expanded character 1><Expanded character 2>...]"
 //
@@ -236,7 +245,9 @@ class TokenScanIterator {
   int index_;
 };
 
-struct ReverseLookupResult {
+}  // namespace
+
+struct SystemDictionary::ReverseLookupResult {
   ReverseLookupResult() : tokens_offset(-1), id_in_key_trie(-1) {}
   // Offset from the tokens section beginning.
   // (token_array_.Get(id_in_key_trie) == token_array_.Get(0) + tokens_offset)
@@ -245,25 +256,100 @@ struct ReverseLookupResult {
   int id_in_key_trie;
 };
 
-}  // namespace
-
+// Caches the reverse lookup results of the recently used value IDs so that
+// the reverse conversions of the same or overlapping text don't scan the
+// token array again.  The cache is shared by all the conversions using this
+// dictionary, i.e. by all the sessions, and is bounded by the number of IDs.
+// The results of the last populated text are pinned outside of the bound, so
+// that a long text doesn't evict its own results before they are used.
 class SystemDictionary::ReverseLookupCache {
  public:
-  ReverseLookupCache() = default;
+  explicit ReverseLookupCache(size_t max_ids) : cache_(max_ids) {}
   ReverseLookupCache(const ReverseLookupCache &) = delete;
   ReverseLookupCache &operator=(const ReverseLookupCache &) = delete;
 
-  bool IsAvailable(const absl::btree_set<int> &id_set) const {
-    for (absl::btree_set<int>::const_iterator itr = id_set.begin();
-         itr != id_set.end(); ++itr) {
-      if (results.find(*itr) == results.end()) {
-        return false;
+  // Adds the cached results of |id_set| to |results| if it's not nullptr, and
+  // returns the IDs not cached.
+  absl::btree_set<int> Lookup(const absl::btree_set<int> &id_set,
+                              ReverseLookupResultMap *results) const {
+    absl::btree_set<int> missing_ids;
+    absl::MutexLock l(&mutex_);
+    for (const int id : id_set) {
+      if (pinned_ids_.contains(id)) {
+        if (results != nullptr) {
+          const auto [begin, end] = pinned_results_.equal_range(id);
+          results->insert(begin, end);
+        }
+        continue;
+      }
+      const std::vector<ReverseLookupResult> *cached = cache_.Lookup(id);
+      if (cached == nullptr) {
+        missing_ids.insert(id);
+        continue;
+      }
+      if (results == nullptr) {
+        continue;
+      }
+      for (const ReverseLookupResult &result : *cached) {
+        results->emplace(id, result);
       }
     }
-    return true;
+    return missing_ids;
+  }
+
+  // Caches |results| for |ids|.  The IDs without results are cached too, so
+  // that they are not scanned again.
+  void Insert(const absl::btree_set<int> &ids,
+              const ReverseLookupResultMap &results) {
+    absl::MutexLock l(&mutex_);
+    for (const int id : ids) {
+      std::vector<ReverseLookupResult> &cached = cache_.Insert(id)->value;
+      cached.clear();
+      const auto [begin, end] = results.equal_range(id);
+      for (auto it = begin; it != end; ++it) {
+        cached.push_back(it->second);
+      }
+    }
+  }
+
+  // Keeps |results| for |ids| regardless of the bound, in place of the
+  // previously pinned ones.
+  void Pin(absl::btree_set<int> ids, ReverseLookupResultMap results) {
+    absl::MutexLock l(&mutex_);
+    pinned_ids_ = std::move(ids);
+    pinned_results_ = std::move(results);
+  }
+
+  void Clear() {
+    absl::MutexLock l(&mutex_);
+    cache_.Clear();
+    pinned_ids_.clear();
+    pinned_results_.clear();
+  }
+
+  // Approximates a slot of the hash table by the key and the pointer, and a
+  // node of the pinned containers by the value and three pointers.
+  size_t MemoryBytes() const {
+    absl::MutexLock l(&mutex_);
+    size_t bytes = cache_.Size() * (sizeof(Cache::Element) + sizeof(int) +
+                                    sizeof(Cache::Element *));
+    bytes += pinned_ids_.size() * sizeof(int);
+    bytes += pinned_results_.size() *
+             (sizeof(ReverseLookupResultMap::value_type) + 3 * sizeof(void *));
+    for (const Cache::Element *e = cache_.Head(); e != nullptr; e = e->next) {
+      bytes += e->value.capacity() * sizeof(ReverseLookupResult);
+    }
+    return bytes;
   }
 
-  std::multimap<int, ReverseLookupResult> results;
+ private:
+  using Cache = storage::LruCache<int, std::vector<ReverseLookupResult>>;
+
+  mutable absl::Mutex mutex_;
+  // LruCache::Lookup() updates the order, hence mutable.
+  mutable Cache cache_ ABSL_GUARDED_BY(mutex_);
+  absl::btree_set<int> pinned_ids_ ABSL_GUARDED_BY(mutex_);
+  ReverseLookupResultMap pinned_results_ ABSL_GUARDED_BY(mutex_);
 };
 
 class SystemDictionary::ReverseLookupIndex {
@@ -332,7 +418,7 @@ class SystemDictionary::ReverseLookupIndex {
   ~ReverseLookupIndex() = default;
 
   void FillResultMap(const absl::btree_set<int> &id_set,
-                     std::multimap<int, ReverseLookupResult> *result_map) {
+                     ReverseLookupResultMap *result_map) {
     for (absl::btree_set<int>::const_iterator id_itr = id_set.begin();
          id_itr != id_set.end(); ++id_itr) {
       const ReverseLookupResultArray &result_array = index_[*id_itr];
@@ -342,6 +428,14 @@ class SystemDictionary::ReverseLookupIndex {
     }
   }
 
+  size_t MemoryBytes() const {
+    size_t bytes = index_size_ * sizeof(ReverseLookupResultArray);
+    for (size_t i = 0; i < index_size_; ++i) {
+      bytes += index_[i].size * sizeof(ReverseLookupResult);
+    }
+    return bytes;
+  }
+
  private:
   struct ReverseLookupResultArray {
     ReverseLookupResultArray() : size(0) {}
@@ -481,6 +575,9 @@ bool SystemDictionary::OpenDictionaryFile(bool enable_reverse_lookup_index) {
 
   if (enable_reverse_lookup_index) {
     InitReverseLookupIndex();
+  } else {
+    reverse_lookup_cache_ =
+        std::make_unique<ReverseLookupCache>(kReverseLookupCacheSize);
   }
 
   return true;
@@ -1006,8 +1103,7 @@ void SystemDictionary::PopulateReverseLookupCache(absl::string_view str) const {
     // as we have already built the index for reverse lookup.
     return;
   }
-  reverse_lookup_cache_ = std::make_unique<ReverseLookupCache>();
-  DCHECK(reverse_lookup_cache_.get());
+  DCHECK(reverse_lookup_cache_);
 
   // Iterate each suffix and collect IDs of all substrings.
   absl::btree_set<int> id_set;
@@ -1021,12 +1117,28 @@ void SystemDictionary::PopulateReverseLookupCache(absl::string_view str) const {
     AddKeyIdsOfAllPrefixes(value_trie_, lookup_key, &id_set);
     pos += Util::OneCharLen(suffix.data());
   }
-  // Collect tokens for all IDs.
-  ScanTokens(id_set, reverse_lookup_cache_.get());
+  // Collect tokens for the IDs not cached yet, and pin the results of all the
+  // IDs for the lookups of this conversion.
+  ReverseLookupResultMap results;
+  CollectReverseLookupResults(id_set, &results);
+  reverse_lookup_cache_->Pin(std::move(id_set), std::move(results));
 }
 
 void SystemDictionary::ClearReverseLookupCache() const {
-  reverse_lookup_cache_.reset();
+  // The cache is bounded and shared by all the reverse conversions, so the
+  // results are kept until this is called explicitly to release the memory.
+  if (reverse_lookup_cache_ != nullptr) {
+    reverse_lookup_cache_->Clear();
+  }
+}
+
+void SystemDictionary::GetMemoryStats(MemoryStats *stats) const {
+  if (reverse_lookup_cache_ != nullptr) {
+    stats->Add("reverse_lookup_cache", reverse_lookup_cache_->MemoryBytes());
+  }
+  if (reverse_lookup_index_ != nullptr) {
+    stats->Add("reverse_lookup_index", reverse_lookup_index_->MemoryBytes());
+  }
 }
 
 namespace {
@@ -1079,26 +1191,34 @@ void SystemDictionary::RegisterReverseLookupTokensForValue(
   absl::btree_set<int> id_set;
   AddKeyIdsOfAllPrefixes(value_trie_, lookup_key, &id_set);
 
-  ReverseLookupCache *results = nullptr;
-  ReverseLookupCache non_cached_results;
+  ReverseLookupResultMap results;
   if (reverse_lookup_index_ != nullptr) {
-    reverse_lookup_index_->FillResultMap(id_set, &non_cached_results.results);
-    results = &non_cached_results;
-  } else if (reverse_lookup_cache_ != nullptr &&
-             reverse_lookup_cache_->IsAvailable(id_set)) {
-    results = reverse_lookup_cache_.get();
+    reverse_lookup_index_->FillResultMap(id_set, &results);
   } else {
-    // Cache is not available. Get token for each ID.
-    ScanTokens(id_set, &non_cached_results);
-    results = &non_cached_results;
+    CollectReverseLookupResults(id_set, &results);
   }
-  DCHECK(results != nullptr);
+  RegisterReverseLookupResults(id_set, results, callback);
+}
 
-  RegisterReverseLookupResults(id_set, *results, callback);
+void SystemDictionary::CollectReverseLookupResults(
+    const absl::btree_set<int> &id_set, ReverseLookupResultMap *results) const {
+  DCHECK(reverse_lookup_cache_);
+  const absl::btree_set<int> missing_ids =
+      reverse_lookup_cache_->Lookup(id_set, results);
+  if (missing_ids.empty()) {
+    return;
+  }
+  // Scan the token array only for the IDs not cached.
+  ReverseLookupResultMap scanned_results;
+  ScanTokens(missing_ids, &scanned_results);
+  reverse_lookup_cache_->Insert(missing_ids, scanned_results);
+  if (results != nullptr) {
+    results->insert(scanned_results.begin(), scanned_results.end());
+  }
 }
 
 void SystemDictionary::ScanTokens(const absl::btree_set<int> &id_set,
-                                  ReverseLookupCache *cache) const {
+                                  ReverseLookupResultMap *results) const {
   for (TokenScanIterator iter(codec_, token_array_); !iter.Done();
        iter.Next()) {
     const TokenScanIterator::Result &result = iter.Get();
@@ -1106,21 +1226,21 @@ void SystemDictionary::ScanTokens(const absl::btree_set<int> &id_set,
       ReverseLookupResult lookup_result;
       lookup_result.tokens_offset = result.tokens_offset;
       lookup_result.id_in_key_trie = result.index;
-      cache->results.insert(std::make_pair(result.value_id, lookup_result));
+      results->insert(std::make_pair(result.value_id, lookup_result));
     }
   }
 }
 
 void SystemDictionary::RegisterReverseLookupResults(
-    const absl::btree_set<int> &id_set, const ReverseLookupCache &cache,
+    const absl::btree_set<int> &id_set, const ReverseLookupResultMap &results,
     Callback *callback) const {
   const uint8_t *encoded_tokens_ptr = GetTokenArrayPtr(token_array_, 0);
   char buffer[LoudsTrie::kMaxDepth + 1];
   for (absl::btree_set<int>::const_iterator set_itr = id_set.begin();
        set_itr != id_set.end(); ++set_itr) {
     const int value_id = *set_itr;
-    typedef std::multimap<int, ReverseLookupResult>::const_iterator ResultItr;
-    std::pair<ResultItr, ResultItr> range = cache.results.equal_range(*set_itr);
+    typedef ReverseLookupResultMap::const_iterator ResultItr;
+    std::pair<ResultItr, ResultItr> range = results.equal_range(*set_itr);
     for (ResultItr result_itr = range.first; result_itr != range.second;
          ++result_itr) {
       const ReverseLookupResult &reverse_result = result_itr->second;
@@ -31,6 +31,7 @@
 #define MOZC_DICTIONARY_SYSTEM_SYSTEM_DICTIONARY_H_
 
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -156,9 +157,14 @@ class SystemDictionary : public DictionaryInterface {
   void PopulateReverseLookupCache(absl::string_view str) const override;
   void ClearReverseLookupCache() const override;
 
+  void GetMemoryStats(MemoryStats *stats) const override;
+
  private:
+  struct ReverseLookupResult;
   class ReverseLookupCache;
   class ReverseLookupIndex;
+  // Maps value IDs to the positions of their tokens.
+  using ReverseLookupResultMap = std::multimap<int, ReverseLookupResult>;
   struct PredictiveLookupSearchState;
 
   SystemDictionary(const SystemDictionaryCodecInterface *codec,
@@ -170,10 +176,12 @@ class SystemDictionary : public DictionaryInterface {
                                           Callback *callback) const;
   void RegisterReverseLookupTokensForValue(absl::string_view value,
                                            Callback *callback) const;
+  void CollectReverseLookupResults(const absl::btree_set<int> &id_set,
+                                   ReverseLookupResultMap *results) const;
   void ScanTokens(const absl::btree_set<int> &id_set,
-                  ReverseLookupCache *cache) const;
+                  ReverseLookupResultMap *results) const;
   void RegisterReverseLookupResults(const absl::btree_set<int> &id_set,
-                                    const ReverseLookupCache &cache,
+                                    const ReverseLookupResultMap &results,
                                     Callback *callback) const;
   void InitReverseLookupIndex();
 
@@ -195,7 +203,8 @@ class SystemDictionary : public DictionaryInterface {
   const SystemDictionaryCodecInterface *codec_;
   KeyExpansionTable hiragana_expansion_table_;
   std::unique_ptr<DictionaryFile> dictionary_file_;
-  mutable std::unique_ptr<ReverseLookupCache> reverse_lookup_cache_;
+  // Shared by all the reverse conversions; not used when the index is built.
+  std::unique_ptr<ReverseLookupCache> reverse_lookup_cache_;
   std::unique_ptr<ReverseLookupIndex> reverse_lookup_index_;
 };
 
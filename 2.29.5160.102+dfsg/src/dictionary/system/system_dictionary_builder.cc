@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <climits>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <ios>
@@ -45,6 +46,7 @@
 #include "base/file_util.h"
 #include "base/japanese_util.h"
 #include "base/logging.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/file/codec_interface.h"
@@ -85,6 +87,63 @@ struct TokenGreaterThan {
   }
 };
 
+// Minimum number of keys processed by a task of the parallel build.
+constexpr size_t kMinKeysPerTask = 4096;
+
+// Calls |f| for each element of |key_info_list|, on the threads of |pool| if
+// it is not nullptr.
+template <class KeyInfoList, class F>
+void ForEachKeyInfo(ThreadPool *pool, KeyInfoList &key_info_list, const F &f) {
+  ParallelFor(pool, key_info_list.size(), kMinKeysPerTask,
+              [&key_info_list, &f](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                  f(key_info_list[i]);
+                }
+              });
+}
+
+// Same as std::stable_sort(). With |pool|, sorts a range per thread in
+// parallel and then merges adjacent ranges, which keeps the relative order of
+// equivalent elements as well.
+template <class T, class Compare>
+void StableSort(ThreadPool *pool, std::vector<T> &v, Compare compare) {
+  const size_t num_ranges = pool == nullptr ? 1 : pool->num_threads() + 1;
+  if (num_ranges == 1 || v.size() < kMinKeysPerTask * num_ranges) {
+    std::stable_sort(v.begin(), v.end(), compare);
+    return;
+  }
+  std::vector<size_t> bounds;
+  for (size_t i = 0; i <= num_ranges; ++i) {
+    bounds.push_back(v.size() * i / num_ranges);
+  }
+  ParallelFor(pool, num_ranges, 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      std::stable_sort(v.begin() + bounds[i], v.begin() + bounds[i + 1],
+                       compare);
+    }
+  });
+  while (bounds.size() > 2) {
+    // Merges the ranges [bounds[2i], bounds[2i + 1]) and
+    // [bounds[2i + 1], bounds[2i + 2]).
+    const size_t num_pairs = (bounds.size() - 1) / 2;
+    ParallelFor(pool, num_pairs, 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        std::inplace_merge(v.begin() + bounds[2 * i],
+                           v.begin() + bounds[2 * i + 1],
+                           v.begin() + bounds[2 * i + 2], compare);
+      }
+    });
+    std::vector<size_t> merged;
+    for (size_t i = 0; i < bounds.size(); i += 2) {
+      merged.push_back(bounds[i]);
+    }
+    if (merged.back() != bounds.back()) {
+      merged.push_back(bounds.back());
+    }
+    bounds = std::move(merged);
+  }
+}
+
 void WriteSectionToFile(const DictionaryFileSection &section,
                         const std::string &filename) {
   if (absl::Status s = FileUtil::SetContents(
@@ -111,8 +170,16 @@ void SystemDictionaryBuilder::BuildFromTokensInternal(
   KeyInfoList key_info_list = ReadTokens(std::move(tokens));
 
   BuildFrequentPos(key_info_list);
-  BuildValueTrie(key_info_list);
-  BuildKeyTrie(key_info_list);
+  if (pool_ == nullptr) {
+    BuildValueTrie(key_info_list);
+    BuildKeyTrie(key_info_list);
+  } else {
+    // The two tries are independent of each other.
+    TaskFuture<void> value_trie = pool_->Schedule(
+        [this, &key_info_list] { BuildValueTrie(key_info_list); });
+    BuildKeyTrie(key_info_list);
+    value_trie.Wait();
+  }
 
   SetIdForValue(&key_info_list);
   SetIdForKey(&key_info_list);
@@ -184,6 +251,15 @@ uint32_t GetCombinedPos(uint16_t lid, uint16_t rid) {
   return (lid << 16) | rid;
 }
 
+// Converts a cost, i.e. -500 * log(probability), to an integral weight
+// proportional to the probability.  Very rare tokens get zero weight.
+uint64_t CostToWeight(int cost) {
+  constexpr double kCostScale = 500.0;
+  constexpr double kMaxWeight = static_cast<double>(uint64_t{1} << 40);
+  return static_cast<uint64_t>(kMaxWeight *
+                               std::exp(-std::max(cost, 0) / kCostScale));
+}
+
 TokenInfo::ValueType GetValueType(const Token *token) {
   if (token->value == token->key) {
     return TokenInfo::AS_IS_HIRAGANA;
@@ -242,9 +318,8 @@ SystemDictionaryBuilder::KeyInfoList SystemDictionaryBuilder::ReadTokens(
   //    [KeyInfo(key:aaa)[Token 1][Token 2]][KeyInfo(key:abc)[Token 3]][...]
 
   // Step 1.
-  std::stable_sort(
-      tokens.begin(), tokens.end(),
-      [](const Token *l, const Token *r) { return l->key < r->key; });
+  StableSort(pool_, tokens,
+             [](const Token *l, const Token *r) { return l->key < r->key; });
 
   // Step 2.
   KeyInfoList key_info_list;
@@ -260,9 +335,14 @@ SystemDictionaryBuilder::KeyInfoList SystemDictionaryBuilder::ReadTokens(
       last_key_info.key = token->key;
     }
     last_key_info.tokens.emplace_back(token);
-    last_key_info.tokens.back().value_type = GetValueType(token);
   }
   key_info_list.push_back(std::move(last_key_info));
+
+  ForEachKeyInfo(pool_, key_info_list, [](KeyInfo &key_info) {
+    for (TokenInfo &token_info : key_info.tokens) {
+      token_info.value_type = GetValueType(token_info.token);
+    }
+  });
   return key_info_list;
 }
 
@@ -324,27 +404,27 @@ void SystemDictionaryBuilder::BuildValueTrie(const KeyInfoList &key_info_list) {
       }
       std::string value_str;
       codec_->EncodeValue(token_info.token->value, &value_str);
-      value_trie_builder_.Add(value_str);
+      value_trie_builder_.Add(value_str, GetValueWeight(key_info, token_info));
     }
   }
   value_trie_builder_.Build();
 }
 
 void SystemDictionaryBuilder::SetIdForValue(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+  ForEachKeyInfo(pool_, *key_info_list, [this](KeyInfo &key_info) {
     for (TokenInfo &token_info : key_info.tokens) {
       std::string value_str;
       codec_->EncodeValue(token_info.token->value, &value_str);
       token_info.id_in_value_trie = value_trie_builder_.GetId(value_str);
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SortTokenInfo(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+  ForEachKeyInfo(pool_, *key_info_list, [](KeyInfo &key_info) {
     std::sort(key_info.tokens.begin(), key_info.tokens.end(),
               TokenGreaterThan());
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
@@ -374,17 +454,17 @@ void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
 
   const int min_key_len =
       absl::GetFlag(FLAGS_min_key_length_to_use_small_cost_encoding);
-  for (KeyInfo &key_info : *key_info_list) {
+  ForEachKeyInfo(pool_, *key_info_list, [&](KeyInfo &key_info) {
     if (Util::CharsLen(key_info.key) < min_key_len) {
       // Do not use small cost encoding for short keys.
-      continue;
+      return;
     }
     if (HasHomonymsInSamePos(key_info)) {
-      continue;
+      return;
     }
     if (HasHeterophones(key_info, heterophone_values)) {
       // We want to keep the cost order for LookupReverse().
-      continue;
+      return;
     }
 
     for (TokenInfo &token_info : key_info.tokens) {
@@ -394,11 +474,11 @@ void SystemDictionaryBuilder::SetCostType(KeyInfoList *key_info_list) const {
       }
       token_info.cost_type = TokenInfo::CAN_USE_SMALL_ENCODING;
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+  ForEachKeyInfo(pool_, *key_info_list, [this](KeyInfo &key_info) {
     for (size_t i = 0; i < key_info.tokens.size(); ++i) {
       TokenInfo *token_info = &(key_info.tokens[i]);
       const uint32_t pos =
@@ -417,11 +497,11 @@ void SystemDictionaryBuilder::SetPosType(KeyInfoList *key_info_list) const {
         }
       }
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::SetValueType(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+  ForEachKeyInfo(pool_, *key_info_list, [](KeyInfo &key_info) {
     for (size_t i = 1; i < key_info.tokens.size(); ++i) {
       const TokenInfo &prev_token_info = key_info.tokens[i - 1];
       TokenInfo *token_info = &(key_info.tokens[i]);
@@ -431,24 +511,50 @@ void SystemDictionaryBuilder::SetValueType(KeyInfoList *key_info_list) const {
         token_info->value_type = TokenInfo::SAME_AS_PREV_VALUE;
       }
     }
-  }
+  });
 }
 
 void SystemDictionaryBuilder::BuildKeyTrie(const KeyInfoList &key_info_list) {
   for (const KeyInfo &key_info : key_info_list) {
     std::string key_str;
     codec_->EncodeKey(key_info.key, &key_str);
-    key_trie_builder_.Add(key_str);
+    key_trie_builder_.Add(key_str, GetKeyWeight(key_info));
   }
   key_trie_builder_.Build();
 }
 
+uint64_t SystemDictionaryBuilder::GetKeyWeight(const KeyInfo &key_info) const {
+  if (!frequency_ordered_layout_) {
+    return 0;
+  }
+  if (!key_frequency_.empty()) {
+    const auto iter = key_frequency_.find(key_info.key);
+    return iter == key_frequency_.end() ? 0 : iter->second;
+  }
+  uint64_t weight = 0;
+  for (const TokenInfo &token_info : key_info.tokens) {
+    weight = std::max(weight, CostToWeight(token_info.token->cost));
+  }
+  return weight;
+}
+
+uint64_t SystemDictionaryBuilder::GetValueWeight(
+    const KeyInfo &key_info, const TokenInfo &token_info) const {
+  if (!frequency_ordered_layout_) {
+    return 0;
+  }
+  if (!key_frequency_.empty()) {
+    return GetKeyWeight(key_info);
+  }
+  return CostToWeight(token_info.token->cost);
+}
+
 void SystemDictionaryBuilder::SetIdForKey(KeyInfoList *key_info_list) const {
-  for (KeyInfo &key_info : *key_info_list) {
+  ForEachKeyInfo(pool_, *key_info_list, [this](KeyInfo &key_info) {
     std::string key_str;
     codec_->EncodeKey(key_info.key, &key_str);
     key_info.id_in_key_trie = key_trie_builder_.GetId(key_str);
-  }
+  });
 }
 
 void SystemDictionaryBuilder::BuildTokenArray(
@@ -463,9 +569,16 @@ void SystemDictionaryBuilder::BuildTokenArray(
       id_to_keyinfo_table[id] = &key_info;
     }
 
-    for (const KeyInfo *key_info : id_to_keyinfo_table) {
-      std::string tokens_str;
-      codec_->EncodeTokens(key_info->tokens, &tokens_str);
+    // Encodes the tokens in parallel, and then adds them in order of id.
+    std::vector<std::string> tokens_strs(id_to_keyinfo_table.size());
+    ParallelFor(pool_, id_to_keyinfo_table.size(), kMinKeysPerTask,
+                [&](size_t begin, size_t end) {
+                  for (size_t id = begin; id < end; ++id) {
+                    codec_->EncodeTokens(id_to_keyinfo_table[id]->tokens,
+                                         &tokens_strs[id]);
+                  }
+                });
+    for (const std::string &tokens_str : tokens_strs) {
       token_array_builder_.Add(tokens_str);
     }
   }
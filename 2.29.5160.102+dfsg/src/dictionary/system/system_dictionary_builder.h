@@ -36,8 +36,10 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/thread_pool.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/file/codec_factory.h"
 #include "dictionary/file/codec_interface.h"
@@ -45,6 +47,7 @@
 #include "dictionary/system/words_info.h"
 #include "storage/louds/bit_vector_based_array_builder.h"
 #include "storage/louds/louds_trie_builder.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 
 namespace mozc {
@@ -71,6 +74,25 @@ class SystemDictionaryBuilder final {
   SystemDictionaryBuilder(const SystemDictionaryBuilder &) = delete;
   SystemDictionaryBuilder &operator=(const SystemDictionaryBuilder &) = delete;
 
+  // Map from key (reading) to its lookup frequency.
+  using KeyFrequencyMap = absl::flat_hash_map<std::string, uint64_t>;
+
+  // Lays out the key trie, the value trie and the token array so that the
+  // entries for frequent keys are placed close to each other.  Lookups of
+  // such keys then touch fewer pages of the mapped image.  If |key_frequency|
+  // is empty, the frequency is estimated from the costs of tokens.  Must be
+  // called before BuildFromTokens().
+  void EnableFrequencyOrderedLayout(KeyFrequencyMap key_frequency = {}) {
+    frequency_ordered_layout_ = true;
+    key_frequency_ = std::move(key_frequency);
+  }
+
+  // Builds the sections using the threads of |pool| as well as the calling
+  // thread. The output is identical to the one built on a single thread.
+  // |pool| must outlive BuildFromTokens(). Must be called before
+  // BuildFromTokens().
+  void EnableParallelBuild(ThreadPool *pool) { pool_ = pool; }
+
   void BuildFromTokens(const std::vector<Token *> &tokens) {
     BuildFromTokensInternal(tokens);
   }
@@ -103,6 +125,11 @@ class SystemDictionaryBuilder final {
   void SetPosType(KeyInfoList *key_info_list) const;
   void SetValueType(KeyInfoList *key_info_list) const;
 
+  // Returns the layout weights used when frequency ordered layout is enabled.
+  uint64_t GetKeyWeight(const KeyInfo &key_info) const;
+  uint64_t GetValueWeight(const KeyInfo &key_info,
+                          const TokenInfo &token_info) const;
+
   storage::louds::LoudsTrieBuilder value_trie_builder_;
   storage::louds::LoudsTrieBuilder key_trie_builder_;
   storage::louds::BitVectorBasedArrayBuilder token_array_builder_;
@@ -110,6 +137,12 @@ class SystemDictionaryBuilder final {
   // mapping from {left_id, right_id} to POS index (0--255)
   std::map<uint32_t, int> frequent_pos_;
 
+  bool frequency_ordered_layout_ = false;
+  KeyFrequencyMap key_frequency_;
+
+  // Not owned. Builds on the calling thread only if nullptr.
+  ThreadPool *pool_ = nullptr;
+
   const SystemDictionaryCodecInterface *codec_ =
       SystemDictionaryCodecFactory::GetCodec();
   const DictionaryFileCodecInterface *file_codec_ =
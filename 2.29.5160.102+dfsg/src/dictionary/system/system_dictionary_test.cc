@@ -36,11 +36,14 @@
 #include <limits>
 #include <memory>
 #include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/file_util.h"
+#include "base/memory_stats.h"
+#include "base/thread_pool.h"
 #include "config/config_handler.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_test_util.h"
@@ -300,6 +303,57 @@ TEST_F(SystemDictionaryTest, LookupAllWords) {
   }
 }
 
+TEST_F(SystemDictionaryTest, LookupAllWordsWithFrequencyOrderedLayout) {
+  const std::vector<std::unique_ptr<Token>> &source_tokens =
+      text_dict_.tokens();
+  const SystemDictionaryBuilder::KeyFrequencyMap kProfiles[] = {
+      {},  // Estimates the frequency from costs.
+      {{source_tokens.back()->key, 100}, {source_tokens.front()->key, 10}},
+  };
+  for (const SystemDictionaryBuilder::KeyFrequencyMap &profile : kProfiles) {
+    SystemDictionaryBuilder builder;
+    builder.EnableFrequencyOrderedLayout(profile);
+    builder.BuildFromTokens(source_tokens);
+    builder.WriteToFile(dic_fn_);
+    std::unique_ptr<SystemDictionary> system_dic =
+        SystemDictionary::Builder(dic_fn_).Build().value();
+    ASSERT_TRUE(system_dic);
+
+    for (size_t i = 0; i < source_tokens.size(); ++i) {
+      CheckTokenExistenceCallback callback(source_tokens[i].get());
+      system_dic->LookupPrefix(source_tokens[i]->key, convreq_, &callback);
+      EXPECT_TRUE(callback.found())
+          << "Token was not found: " << PrintToken(*source_tokens[i]);
+    }
+  }
+}
+
+TEST_F(SystemDictionaryTest, ParallelBuildIsIdentical) {
+  const std::vector<std::unique_ptr<Token>> &source_tokens =
+      text_dict_.tokens();
+  ThreadPool pool(3);
+  for (const int32_t min_key_length : {std::numeric_limits<int32_t>::max(),
+                                       1}) {
+    // Small cost encoding needs more analysis of tokens.
+    absl::SetFlag(&FLAGS_min_key_length_to_use_small_cost_encoding,
+                  min_key_length);
+    std::ostringstream serial, parallel;
+    {
+      SystemDictionaryBuilder builder;
+      builder.BuildFromTokens(source_tokens);
+      builder.WriteToStream("", &serial);
+    }
+    {
+      SystemDictionaryBuilder builder;
+      builder.EnableParallelBuild(&pool);
+      builder.BuildFromTokens(source_tokens);
+      builder.WriteToStream("", &parallel);
+    }
+    ASSERT_FALSE(serial.str().empty());
+    EXPECT_TRUE(serial.str() == parallel.str()) << min_key_length;
+  }
+}
+
 TEST_F(SystemDictionaryTest, SimpleLookupPrefix) {
   const std::string k0 = "は";
   const std::string k1 = "はひふへほ";
@@ -690,6 +744,45 @@ TEST_F(SystemDictionaryTest, LookupReverseWithCache) {
   system_dic->ClearReverseLookupCache();
 }
 
+TEST_F(SystemDictionaryTest, LookupReverseWithSharedCache) {
+  std::vector<Token> tokens = {
+      {"どらえもん", "ドラえもん", 1, 2, 3, Token::NONE},
+      {"のびた", "のび太", 1, 2, 3, Token::NONE},
+  };
+  std::vector<Token *> source_tokens = MakeTokenPointers(&tokens);
+  std::unique_ptr<SystemDictionary> system_dic =
+      BuildSystemDictionary(source_tokens, source_tokens.size());
+  ASSERT_TRUE(system_dic);
+
+  MemoryStats empty_stats;
+  system_dic->GetMemoryStats(&empty_stats);
+
+  // The results cached for the first text are kept while the second one is
+  // populated, as the cache is shared by the reverse conversions.
+  system_dic->PopulateReverseLookupCache(tokens[0].value);
+  system_dic->PopulateReverseLookupCache(tokens[1].value);
+  MemoryStats stats;
+  system_dic->GetMemoryStats(&stats);
+  EXPECT_GT(stats.Get("reverse_lookup_cache"),
+            empty_stats.Get("reverse_lookup_cache"));
+
+  for (const Token &token : tokens) {
+    Token target_token = token;
+    target_token.key.swap(target_token.value);
+    CheckTokenExistenceCallback callback(&target_token);
+    system_dic->LookupReverse(token.value, convreq_, &callback);
+    EXPECT_TRUE(callback.found()) << "Could not find " << PrintToken(token);
+  }
+
+  // Lookups still work after the cache is released.
+  system_dic->ClearReverseLookupCache();
+  Token target_token = tokens[0];
+  target_token.key.swap(target_token.value);
+  CheckTokenExistenceCallback callback(&target_token);
+  system_dic->LookupReverse(tokens[0].value, convreq_, &callback);
+  EXPECT_TRUE(callback.found()) << "Could not find " << PrintToken(tokens[0]);
+}
+
 TEST_F(SystemDictionaryTest, SpellingCorrectionTokens) {
   std::vector<Token> tokens = {
       {"あぼがど", "アボカド", 1, 0, 2, Token::SPELLING_CORRECTION},
@@ -163,16 +163,40 @@ void TextDictionaryLoader::LoadWithLineLimit(
     tokens_.reserve(limit);
   }
 
-  // Read system dictionary.
+  // Read system dictionary. Lines are read in batches, and each batch is
+  // parsed on the threads of |pool_| if available.
   {
+    constexpr size_t kBatchSize = 1 << 16;
+    constexpr size_t kMinLinesPerTask = 1024;
     InputMultiFile file(dictionary_filename);
+    std::vector<std::string> lines;
+    std::vector<std::unique_ptr<Token>> batch;
     std::string line;
-    while (limit > 0 && file.ReadLine(&line)) {
-      Util::ChopReturns(&line);
-      std::unique_ptr<Token> token = ParseTSVLine(line);
-      if (token) {
-        tokens_.push_back(std::move(token));
-        --limit;
+    bool eof = false;
+    while (limit > 0 && !eof) {
+      lines.clear();
+      const size_t batch_size = std::min<size_t>(kBatchSize, limit);
+      while (lines.size() < batch_size) {
+        if (!file.ReadLine(&line)) {
+          eof = true;
+          break;
+        }
+        Util::ChopReturns(&line);
+        lines.push_back(std::move(line));
+      }
+      batch.clear();
+      batch.resize(lines.size());
+      ParallelFor(pool_, lines.size(), kMinLinesPerTask,
+                  [this, &lines, &batch](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                      batch[i] = ParseTSVLine(lines[i]);
+                    }
+                  });
+      for (std::unique_ptr<Token> &token : batch) {
+        if (token) {
+          tokens_.push_back(std::move(token));
+          --limit;
+        }
       }
     }
     LOG(INFO) << tokens_.size() << " tokens from " << dictionary_filename;
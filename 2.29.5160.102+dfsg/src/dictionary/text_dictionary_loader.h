@@ -36,6 +36,7 @@
 #include <vector>
 
 #include "base/port.h"
+#include "base/thread_pool.h"
 #include "dictionary/dictionary_token.h"
 #include "testing/gunit_prod.h"
 #include "absl/strings/string_view.h"
@@ -57,6 +58,11 @@ class TextDictionaryLoader {
 
   virtual ~TextDictionaryLoader() = default;
 
+  // Parses the dictionary files on the threads of |pool| as well as the
+  // calling thread. The loaded tokens are the same as the ones loaded on a
+  // single thread. |pool| must outlive the calls of Load().
+  void EnableParallelLoad(ThreadPool *pool) { pool_ = pool; }
+
   // Loads tokens from system dictionary files and reading correction
   // files. Each file name can take multiple file names by separating commas.
   // The reading correction file is optional and can be an empty string.  Note
@@ -107,6 +113,7 @@ class TextDictionaryLoader {
   const uint16_t zipcode_id_;
   const uint16_t isolated_word_id_;
   std::vector<std::unique_ptr<Token>> tokens_;
+  ThreadPool *pool_ = nullptr;
 
   FRIEND_TEST(TextDictionaryLoaderTest, RewriteSpecialTokenTest);
 };
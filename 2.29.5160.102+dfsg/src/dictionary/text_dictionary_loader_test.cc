@@ -34,6 +34,7 @@
 #include <vector>
 
 #include "base/file_util.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "data_manager/testing/mock_data_manager.h"
 #include "dictionary/dictionary_token.h"
@@ -42,6 +43,7 @@
 #include "testing/googletest.h"
 #include "testing/gunit.h"
 #include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
 
 namespace mozc {
 namespace dictionary {
@@ -222,6 +224,42 @@ TEST_F(TextDictionaryLoaderTest, LoadMultipleFilesTest) {
   }
 }
 
+TEST_F(TextDictionaryLoaderTest, ParallelLoadTest) {
+  const std::string filename =
+      FileUtil::JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "test.tsv");
+  std::string lines;
+  for (int i = 0; i < 10000; ++i) {
+    absl::StrAppend(&lines, "key", i, "\t", i % 7, "\t", i % 11, "\t", i,
+                    "\tvalue", i, "\n");
+  }
+  ASSERT_OK(FileUtil::SetContents(filename, lines));
+  FileUnlinker unlinker(filename);
+
+  std::unique_ptr<TextDictionaryLoader> serial = CreateTextDictionaryLoader();
+  serial->Load(filename, "");
+  ASSERT_EQ(serial->tokens().size(), 10000);
+
+  ThreadPool pool(3);
+  std::unique_ptr<TextDictionaryLoader> parallel =
+      CreateTextDictionaryLoader();
+  parallel->EnableParallelLoad(&pool);
+  parallel->Load(filename, "");
+  ASSERT_EQ(parallel->tokens().size(), serial->tokens().size());
+  for (size_t i = 0; i < serial->tokens().size(); ++i) {
+    const Token &expected = *serial->tokens()[i];
+    const Token &actual = *parallel->tokens()[i];
+    EXPECT_EQ(actual.key, expected.key);
+    EXPECT_EQ(actual.value, expected.value);
+    EXPECT_EQ(actual.lid, expected.lid);
+    EXPECT_EQ(actual.rid, expected.rid);
+    EXPECT_EQ(actual.cost, expected.cost);
+  }
+
+  parallel->LoadWithLineLimit(filename, "", 5000);
+  ASSERT_EQ(parallel->tokens().size(), 5000);
+  EXPECT_EQ(parallel->tokens().back()->key, "key4999");
+}
+
 TEST_F(TextDictionaryLoaderTest, ReadingCorrectionTest) {
   std::unique_ptr<TextDictionaryLoader> loader = CreateTextDictionaryLoader();
 
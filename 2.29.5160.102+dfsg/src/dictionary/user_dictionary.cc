@@ -34,7 +34,7 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
-#include <set>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -43,14 +43,17 @@
 #include "base/hash.h"
 #include "base/japanese_util.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
+#include "base/mmap.h"
 #include "base/singleton.h"
 #include "base/strings/assign.h"
-#include "base/thread.h"
+#include "base/thread_pool.h"
 #include "base/util.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/dictionary_token.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suppression_dictionary.h"
+#include "dictionary/user_dictionary_image.h"
 #include "dictionary/user_dictionary_storage.h"
 #include "dictionary/user_dictionary_util.h"
 #include "dictionary/user_pos.h"
@@ -59,10 +62,12 @@
 #include "protocol/user_dictionary_storage.pb.h"
 #include "request/conversion_request.h"
 #include "usage_stats/usage_stats.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
-#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 
@@ -97,6 +102,16 @@ struct OrderByKeyThenById {
   }
 };
 
+// Memory-mapped compiled image of the user dictionary.
+struct MappedImage {
+  Mmap mmap;
+  UserDictionaryImage image;
+};
+
+// The compiled image is stored next to the user dictionary file with this
+// suffix.
+constexpr absl::string_view kImageFileSuffix = ".image";
+
 class UserDictionaryFileManager {
  public:
   UserDictionaryFileManager() = default;
@@ -134,20 +149,83 @@ class UserDictionary::TokensIndex {
 
   ~TokensIndex() = default;
 
-  bool empty() const { return user_pos_tokens_.empty(); }
-  size_t size() const { return user_pos_tokens_.size(); }
+  bool empty() const {
+    return user_pos_tokens_.empty() &&
+           (image_ == nullptr || image_->image.tokens_size() == 0);
+  }
+  size_t size() const {
+    return user_pos_tokens_.size() +
+           (image_ == nullptr ? 0 : image_->image.tokens_size());
+  }
+
+  // Returns the image from which the tokens are served, or nullptr.
+  const std::shared_ptr<const MappedImage> &image() const { return image_; }
 
-  std::vector<UserPos::Token>::const_iterator begin() const {
-    return user_pos_tokens_.begin();
+  // Returns true if the tokens are served only from the image of
+  // |source_fingerprint|, i.e., no entry is edited after the image is built.
+  bool IsServedFromImage(uint64_t source_fingerprint) const {
+    return image_ != nullptr &&
+           image_->image.source_fingerprint() == source_fingerprint &&
+           user_pos_tokens_.empty() && removed_image_entries_.empty();
   }
-  std::vector<UserPos::Token>::const_iterator end() const {
-    return user_pos_tokens_.end();
+
+  // Calls |func| for the tokens whose key is |key|.  |func| needs to have the
+  // signature bool(const UserPos::Token &), and the iteration stops when it
+  // returns false.  Returns false if the iteration is stopped.
+  template <typename Func>
+  bool ForEachToken(absl::string_view key, Func func) const {
+    if (image_ != nullptr) {
+      const int key_id = image_->image.ExactSearch(key);
+      if (key_id >= 0 && !ForEachImageToken(key, key_id, func)) {
+        return false;
+      }
+    }
+    for (auto [begin, end] = std::equal_range(
+             user_pos_tokens_.begin(), user_pos_tokens_.end(), key,
+             OrderByKey());
+         begin != end; ++begin) {
+      if (!func(*begin)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Same as ForEachToken() but for the tokens whose key starts with |prefix|.
+  template <typename Func>
+  void ForEachPredictiveToken(absl::string_view prefix, Func func) const {
+    if (image_ != nullptr) {
+      bool stopped = false;
+      image_->image.PredictiveSearch(
+          prefix, [this, &func, &stopped](absl::string_view key, int key_id) {
+            stopped = !ForEachImageToken(key, key_id, func);
+            return !stopped;
+          });
+      if (stopped) {
+        return;
+      }
+    }
+    for (auto [begin, end] = std::equal_range(
+             user_pos_tokens_.begin(), user_pos_tokens_.end(), prefix,
+             OrderByKeyPrefix());
+         begin != end; ++begin) {
+      if (!func(*begin)) {
+        return;
+      }
+    }
   }
 
   void Load(const user_dictionary::UserDictionaryStorage &storage) {
     user_pos_tokens_.clear();
-    std::set<uint64_t> seen;
-    std::vector<UserPos::Token> tokens;
+    token_entry_ids_.clear();
+    entry_counts_.clear();
+    entry_word_ids_.clear();
+    word_counts_.clear();
+    image_.reset();
+    removed_image_entries_.clear();
+    suppression_entries_.clear();
+    absl::flat_hash_set<uint64_t> seen;
+    std::vector<TokenWithEntryId> tokens;
 
     const SuppressionDictionaryLock l(suppression_dictionary_);
     suppression_dictionary_->Clear();
@@ -158,30 +236,23 @@ class UserDictionary::TokensIndex {
         continue;
       }
 
-      const bool is_shortcuts =
-          (dic.name() == "__auto_imported_android_shortcuts_dictionary");
-
+      const bool is_shortcuts = IsShortcutsDictionary(dic);
       for (const UserDictionaryStorage::UserDictionaryEntry &entry :
            dic.entries()) {
         if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
           continue;
         }
 
-        std::string tmp, reading;
-        UserDictionaryUtil::NormalizeReading(entry.key(), &tmp);
-
-        // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
-        // because the normalization is user-visible.
-        // http://b/2480844
-        japanese_util::NormalizeVoicedSoundMark(tmp, &reading);
-
-        DCHECK(user_dictionary::UserDictionary_PosType_IsValid(entry.pos()));
-        static_assert(user_dictionary::UserDictionary_PosType_PosType_MAX <=
-                      std::numeric_limits<char>::max());
-        const uint64_t fp =
-            Hash::Fingerprint(reading + "\t" + entry.value() + "\t" +
-                              static_cast<char>(entry.pos()));
-        if (!seen.insert(fp).second) {
+        const std::string reading = GetReading(entry);
+        const uint64_t word_id = GetWordId(reading, entry);
+        uint64_t entry_id = 0;
+        if (entry.pos() != user_dictionary::UserDictionary::SUPPRESSION_WORD) {
+          entry_id = GetEntryId(entry, is_shortcuts);
+          ++entry_counts_[entry_id];
+          entry_word_ids_[entry_id] = word_id;
+          ++word_counts_[word_id];
+        }
+        if (!seen.insert(word_id).second) {
           VLOG(1) << "Found dup item";
           continue;
         }
@@ -189,50 +260,501 @@ class UserDictionary::TokensIndex {
         // "抑制単語"
         if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
           suppression_dictionary_->AddEntry(reading, entry.value());
+          suppression_entries_.emplace_back(reading, entry.value());
         } else {
-          tokens.clear();
-          user_pos_->GetTokens(
-              reading, entry.value(),
-              UserDictionaryUtil::GetStringPosType(entry.pos()), &tokens);
-          const absl::string_view comment =
-              absl::StripAsciiWhitespace(entry.comment());
-          for (auto &token : tokens) {
-            strings::Assign(token.comment, comment);
-            if (is_shortcuts &&
-                token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
-              // Words fed by Android shortcut are registered as SUGGESTION_ONLY
-              // POS in order to minimize the side-effect of extremely short
-              // reading. However, user expect that they should appear in the
-              // normal conversion. Here we replace the attribute from
-              // SUGGESTION_ONLY to SHORTCUT, which has more adaptive cost based
-              // on the length of the key.
-              token.remove_attribute(UserPos::Token::SUGGESTION_ONLY);
-              token.add_attribute(UserPos::Token::SHORTCUT);
-            }
-            user_pos_tokens_.push_back(std::move(token));
-          }
+          AppendTokens(reading, entry, is_shortcuts, entry_id, &tokens);
         }
       }
     }
-    user_pos_tokens_.shrink_to_fit();
 
     // Sort first by key and then by POS ID.
-    std::sort(user_pos_tokens_.begin(), user_pos_tokens_.end(),
-              OrderByKeyThenById());
+    std::sort(tokens.begin(), tokens.end(), OrderTokenWithEntryId());
+    user_pos_tokens_.reserve(tokens.size());
+    token_entry_ids_.reserve(tokens.size());
+    for (TokenWithEntryId &token : tokens) {
+      user_pos_tokens_.push_back(std::move(token.first));
+      token_entry_ids_.push_back(token.second);
+    }
+    OnLoaded();
+  }
 
-    VLOG(1) << user_pos_tokens_.size() << " user dic entries loaded";
+  // Loads |storage| by applying the difference between |storage| and the
+  // entries of |base| to the tokens of |base|.  Only the tokens of added
+  // entries are generated, so this is much faster than Load() when a few
+  // entries of a big dictionary are edited.  Returns false without modifying
+  // anything if the difference can't be applied, e.g., when the edited entries
+  // have duplicates or when most of the entries are edited.  Load() needs to be
+  // used in that case.
+  bool LoadIncrementally(const user_dictionary::UserDictionaryStorage &storage,
+                         const TokensIndex &base) {
+    // The bookkeeping of |base| doesn't cover the entries in its image.
+    if (base.image_ != nullptr || base.entry_counts_.empty()) {
+      return false;
+    }
 
-    usage_stats::UsageStats::SetInteger(
-        "UserRegisteredWord", static_cast<int>(user_pos_tokens_.size()));
+    // Counts the entries in |storage| to find the added ones.
+    absl::flat_hash_map<uint64_t, int> entry_counts;
+    std::vector<const UserDictionaryStorage::UserDictionaryEntry *>
+        suppression_entries;
+    std::vector<std::pair<const UserDictionaryStorage::UserDictionaryEntry *,
+                          bool>>
+        added_entries;
+    for (const UserDictionaryStorage::UserDictionary &dic :
+         storage.dictionaries()) {
+      if (!dic.enabled() || dic.entries_size() == 0) {
+        continue;
+      }
+      const bool is_shortcuts = IsShortcutsDictionary(dic);
+      for (const UserDictionaryStorage::UserDictionaryEntry &entry :
+           dic.entries()) {
+        if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
+          continue;
+        }
+        if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
+          suppression_entries.push_back(&entry);
+          continue;
+        }
+        const uint64_t entry_id = GetEntryId(entry, is_shortcuts);
+        const auto it = base.entry_counts_.find(entry_id);
+        const int base_count = it == base.entry_counts_.end() ? 0 : it->second;
+        if (++entry_counts[entry_id] > base_count) {
+          added_entries.emplace_back(&entry, is_shortcuts);
+        }
+      }
+    }
+
+    // The removed entries.  The tokens of a duplicated word belong to the
+    // first entry in the storage, so we give up when such words are edited.
+    absl::flat_hash_set<uint64_t> removed_entry_ids;
+    for (const auto &[entry_id, base_count] : base.entry_counts_) {
+      const auto it = entry_counts.find(entry_id);
+      if (it != entry_counts.end() && it->second >= base_count) {
+        continue;
+      }
+      if (base.word_counts_.at(base.entry_word_ids_.at(entry_id)) > 1) {
+        return false;
+      }
+      removed_entry_ids.insert(entry_id);
+    }
+    if ((added_entries.size() + removed_entry_ids.size()) * 4 >
+        entry_counts.size()) {
+      return false;
+    }
+
+    // The word of an added entry must be new, or its only entry must be
+    // removed (e.g., when the comment is edited).
+    absl::flat_hash_set<uint64_t> removed_word_ids;
+    for (const uint64_t entry_id : removed_entry_ids) {
+      removed_word_ids.insert(base.entry_word_ids_.at(entry_id));
+    }
+    std::vector<TokenWithEntryId> added_tokens;
+    absl::flat_hash_map<uint64_t, uint64_t> added_word_ids;
+    absl::flat_hash_set<uint64_t> seen;
+    for (const auto &[entry, is_shortcuts] : added_entries) {
+      const std::string reading = GetReading(*entry);
+      const uint64_t word_id = GetWordId(reading, *entry);
+      const uint64_t entry_id = GetEntryId(*entry, is_shortcuts);
+      if ((base.word_counts_.contains(word_id) &&
+           !removed_word_ids.contains(word_id)) ||
+          !seen.insert(word_id).second) {
+        return false;
+      }
+      added_word_ids.emplace(entry_id, word_id);
+      AppendTokens(reading, *entry, is_shortcuts, entry_id, &added_tokens);
+    }
+    std::sort(added_tokens.begin(), added_tokens.end(),
+              OrderTokenWithEntryId());
+
+    entry_counts_ = std::move(entry_counts);
+    entry_word_ids_ = base.entry_word_ids_;
+    word_counts_ = base.word_counts_;
+    for (const uint64_t entry_id : removed_entry_ids) {
+      const auto it = entry_word_ids_.find(entry_id);
+      word_counts_.erase(it->second);
+      entry_word_ids_.erase(it);
+    }
+    for (const auto &[entry_id, word_id] : added_word_ids) {
+      entry_word_ids_[entry_id] = word_id;
+      word_counts_[word_id] = 1;
+    }
+
+    // Merges the tokens of |base| which are not removed and the added tokens.
+    user_pos_tokens_.clear();
+    token_entry_ids_.clear();
+    user_pos_tokens_.reserve(base.size() + added_tokens.size());
+    token_entry_ids_.reserve(base.size() + added_tokens.size());
+    auto added_it = added_tokens.begin();
+    for (size_t i = 0; i < base.size(); ++i) {
+      if (removed_entry_ids.contains(base.token_entry_ids_[i])) {
+        continue;
+      }
+      const UserPos::Token &token = base.user_pos_tokens_[i];
+      for (; added_it != added_tokens.end() &&
+             OrderByKeyThenById()(added_it->first, token);
+           ++added_it) {
+        user_pos_tokens_.push_back(std::move(added_it->first));
+        token_entry_ids_.push_back(added_it->second);
+      }
+      user_pos_tokens_.push_back(token);
+      token_entry_ids_.push_back(base.token_entry_ids_[i]);
+    }
+    for (; added_it != added_tokens.end(); ++added_it) {
+      user_pos_tokens_.push_back(std::move(added_it->first));
+      token_entry_ids_.push_back(added_it->second);
+    }
+
+    // Suppression entries are few, so they are always reloaded.
+    LoadSuppressionEntries(suppression_entries);
+
+    VLOG(1) << added_entries.size() << " user dic entries added and "
+            << removed_entry_ids.size() << " removed";
+    OnLoaded();
+    return true;
+  }
+
+  // Serves the tokens from |image|.  The suppression words are also loaded
+  // from |image|.
+  void LoadFromImage(std::shared_ptr<const MappedImage> image) {
+    user_pos_tokens_.clear();
+    token_entry_ids_.clear();
+    entry_counts_.clear();
+    entry_word_ids_.clear();
+    word_counts_.clear();
+    removed_image_entries_.clear();
+    suppression_entries_.clear();
+    image_ = std::move(image);
+
+    const SuppressionDictionaryLock l(suppression_dictionary_);
+    suppression_dictionary_->Clear();
+    for (size_t i = 0; i < image_->image.suppression_entries_size(); ++i) {
+      const auto [key, value] = image_->image.GetSuppressionEntry(i);
+      suppression_dictionary_->AddEntry(std::string(key), std::string(value));
+      suppression_entries_.emplace_back(key, value);
+    }
+    OnLoaded();
+  }
+
+  // Loads |storage| by serving the tokens of the unchanged entries from
+  // |image| and keeping only the tokens of the entries added after |image| is
+  // built.  Like LoadIncrementally(), returns false without modifying anything
+  // if the difference can't be applied.
+  bool LoadWithImage(const user_dictionary::UserDictionaryStorage &storage,
+                     std::shared_ptr<const MappedImage> image) {
+    const UserDictionaryImage &base = image->image;
+    if (base.entries_size() == 0) {
+      return false;
+    }
+
+    absl::flat_hash_map<uint64_t, uint32_t> entry_counts;
+    std::vector<const UserDictionaryStorage::UserDictionaryEntry *>
+        suppression_entries;
+    std::vector<std::pair<const UserDictionaryStorage::UserDictionaryEntry *,
+                          bool>>
+        added_entries;
+    for (const UserDictionaryStorage::UserDictionary &dic :
+         storage.dictionaries()) {
+      if (!dic.enabled() || dic.entries_size() == 0) {
+        continue;
+      }
+      const bool is_shortcuts = IsShortcutsDictionary(dic);
+      for (const UserDictionaryStorage::UserDictionaryEntry &entry :
+           dic.entries()) {
+        if (!UserDictionaryUtil::IsValidEntry(*user_pos_, entry)) {
+          continue;
+        }
+        if (entry.pos() == user_dictionary::UserDictionary::SUPPRESSION_WORD) {
+          suppression_entries.push_back(&entry);
+          continue;
+        }
+        const uint64_t entry_id = GetEntryId(entry, is_shortcuts);
+        const int index = base.FindEntry(entry_id);
+        const uint32_t base_count =
+            index < 0 ? 0 : base.GetEntry(index).count;
+        if (++entry_counts[entry_id] > base_count) {
+          added_entries.emplace_back(&entry, is_shortcuts);
+        }
+      }
+    }
+
+    // The same conditions as LoadIncrementally().
+    absl::flat_hash_set<uint32_t> removed_entries;
+    absl::flat_hash_set<uint64_t> removed_word_ids;
+    for (uint32_t i = 0; i < base.entries_size(); ++i) {
+      const UserDictionaryImage::Entry entry = base.GetEntry(i);
+      const auto it = entry_counts.find(entry.entry_id);
+      if (it != entry_counts.end() && it->second >= entry.count) {
+        continue;
+      }
+      if (entry.word_count > 1) {
+        return false;
+      }
+      removed_entries.insert(i);
+      removed_word_ids.insert(entry.word_id);
+    }
+    if ((added_entries.size() + removed_entries.size()) * 4 >
+        entry_counts.size()) {
+      return false;
+    }
+
+    std::vector<TokenWithEntryId> added_tokens;
+    absl::flat_hash_map<uint64_t, uint64_t> added_word_ids;
+    absl::flat_hash_set<uint64_t> seen;
+    for (const auto &[entry, is_shortcuts] : added_entries) {
+      const std::string reading = GetReading(*entry);
+      const uint64_t word_id = GetWordId(reading, *entry);
+      const uint64_t entry_id = GetEntryId(*entry, is_shortcuts);
+      if ((base.HasWord(word_id) && !removed_word_ids.contains(word_id)) ||
+          !seen.insert(word_id).second) {
+        return false;
+      }
+      added_word_ids.emplace(entry_id, word_id);
+      AppendTokens(reading, *entry, is_shortcuts, entry_id, &added_tokens);
+    }
+    std::sort(added_tokens.begin(), added_tokens.end(),
+              OrderTokenWithEntryId());
+
+    // Only the added entries are kept in the bookkeeping; the others are in
+    // the image.
+    user_pos_tokens_.clear();
+    token_entry_ids_.clear();
+    entry_counts_.clear();
+    entry_word_ids_.clear();
+    word_counts_.clear();
+    for (const auto &[entry_id, word_id] : added_word_ids) {
+      entry_counts_[entry_id] = 1;
+      entry_word_ids_[entry_id] = word_id;
+      word_counts_[word_id] = 1;
+    }
+    user_pos_tokens_.reserve(added_tokens.size());
+    token_entry_ids_.reserve(added_tokens.size());
+    for (TokenWithEntryId &token : added_tokens) {
+      user_pos_tokens_.push_back(std::move(token.first));
+      token_entry_ids_.push_back(token.second);
+    }
+    image_ = std::move(image);
+    removed_image_entries_ = std::move(removed_entries);
+    LoadSuppressionEntries(suppression_entries);
+
+    VLOG(1) << added_entries.size() << " user dic entries added to and "
+            << removed_image_entries_.size() << " removed from the image";
+    OnLoaded();
+    return true;
+  }
+
+  // Adds all the tokens, entries and suppression words to |builder|.
+  void BuildImage(UserDictionaryImageBuilder *builder) const {
+    if (image_ != nullptr) {
+      const UserDictionaryImage &image = image_->image;
+      for (uint32_t i = 0; i < image.entries_size(); ++i) {
+        if (removed_image_entries_.contains(i)) {
+          continue;
+        }
+        const UserDictionaryImage::Entry entry = image.GetEntry(i);
+        builder->AddEntry(entry.entry_id, entry.word_id, entry.count);
+      }
+      UserPos::Token token;
+      image.PredictiveSearch("", [&](absl::string_view key, int key_id) {
+        const auto [begin, end] = image.GetTokenRange(key_id);
+        for (size_t i = begin; i < end; ++i) {
+          const uint32_t entry_index = image.GetEntryIndex(i);
+          if (removed_image_entries_.contains(entry_index)) {
+            continue;
+          }
+          strings::Assign(token.key, key);
+          image.GetToken(i, &token);
+          builder->AddToken(token, image.GetEntry(entry_index).entry_id);
+        }
+        return true;
+      });
+    }
+    for (const auto &[entry_id, count] : entry_counts_) {
+      builder->AddEntry(entry_id, entry_word_ids_.at(entry_id), count);
+    }
+    for (size_t i = 0; i < user_pos_tokens_.size(); ++i) {
+      builder->AddToken(user_pos_tokens_[i], token_entry_ids_[i]);
+    }
+    for (const auto &[key, value] : suppression_entries_) {
+      builder->AddSuppressionEntry(key, value);
+    }
+  }
+
+  // Adds the memory of the tokens, the bookkeeping for LoadIncrementally()
+  // and the mapped image.
+  void GetMemoryStats(MemoryStats *stats) const {
+    size_t token_bytes = user_pos_tokens_.capacity() * sizeof(UserPos::Token);
+    for (const UserPos::Token &token : user_pos_tokens_) {
+      token_bytes += MemoryStats::StringBytes(token.key) +
+                     MemoryStats::StringBytes(token.value) +
+                     MemoryStats::StringBytes(token.comment);
+    }
+    stats->Add("tokens", token_bytes);
+    stats->Add("bookkeeping",
+               token_entry_ids_.capacity() * sizeof(uint64_t) +
+                   HashMapBytes(entry_counts_) + HashMapBytes(entry_word_ids_) +
+                   HashMapBytes(word_counts_) +
+                   HashMapBytes(removed_image_entries_));
+    size_t suppression_bytes = suppression_entries_.capacity() *
+                               sizeof(std::pair<std::string, std::string>);
+    for (const auto &[key, value] : suppression_entries_) {
+      suppression_bytes +=
+          MemoryStats::StringBytes(key) + MemoryStats::StringBytes(value);
+    }
+    stats->Add("suppression_entries", suppression_bytes);
+    if (image_ != nullptr) {
+      stats->Add("image", image_->mmap.size());
+    }
   }
 
  private:
+  // A token and the ID of the user dictionary entry from which it comes.
+  using TokenWithEntryId = std::pair<UserPos::Token, uint64_t>;
+
+  struct OrderTokenWithEntryId {
+    bool operator()(const TokenWithEntryId &lhs,
+                    const TokenWithEntryId &rhs) const {
+      return OrderByKeyThenById()(lhs.first, rhs.first);
+    }
+  };
+
+  static bool IsShortcutsDictionary(
+      const UserDictionaryStorage::UserDictionary &dic) {
+    return dic.name() == "__auto_imported_android_shortcuts_dictionary";
+  }
+
+  static std::string GetReading(
+      const UserDictionaryStorage::UserDictionaryEntry &entry) {
+    std::string tmp, reading;
+    UserDictionaryUtil::NormalizeReading(entry.key(), &tmp);
+
+    // We cannot call NormalizeVoiceSoundMark inside NormalizeReading,
+    // because the normalization is user-visible.
+    // http://b/2480844
+    japanese_util::NormalizeVoicedSoundMark(tmp, &reading);
+    return reading;
+  }
+
+  // Identifies a word, which is registered only once even if it appears in
+  // multiple entries.
+  static uint64_t GetWordId(
+      absl::string_view reading,
+      const UserDictionaryStorage::UserDictionaryEntry &entry) {
+    DCHECK(user_dictionary::UserDictionary_PosType_IsValid(entry.pos()));
+    static_assert(user_dictionary::UserDictionary_PosType_PosType_MAX <=
+                  std::numeric_limits<char>::max());
+    return Hash::Fingerprint(absl::StrCat(reading, "\t", entry.value(), "\t")
+                             .append(1, static_cast<char>(entry.pos())));
+  }
+
+  // Identifies an entry by all the fields that affect its tokens.  Unlike
+  // GetWordId(), this doesn't need the normalization of the key.
+  static uint64_t GetEntryId(
+      const UserDictionaryStorage::UserDictionaryEntry &entry,
+      bool is_shortcuts) {
+    return Hash::Fingerprint(absl::StrCat(
+        entry.key(), "\t", entry.value(), "\t", entry.pos(), "\t",
+        absl::StripAsciiWhitespace(entry.comment()), "\t", is_shortcuts));
+  }
+
+  void AppendTokens(absl::string_view reading,
+                    const UserDictionaryStorage::UserDictionaryEntry &entry,
+                    bool is_shortcuts, uint64_t entry_id,
+                    std::vector<TokenWithEntryId> *output) const {
+    std::vector<UserPos::Token> tokens;
+    user_pos_->GetTokens(reading, entry.value(),
+                         UserDictionaryUtil::GetStringPosType(entry.pos()),
+                         &tokens);
+    const absl::string_view comment =
+        absl::StripAsciiWhitespace(entry.comment());
+    for (auto &token : tokens) {
+      strings::Assign(token.comment, comment);
+      if (is_shortcuts &&
+          token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
+        // Words fed by Android shortcut are registered as SUGGESTION_ONLY
+        // POS in order to minimize the side-effect of extremely short
+        // reading. However, user expect that they should appear in the
+        // normal conversion. Here we replace the attribute from
+        // SUGGESTION_ONLY to SHORTCUT, which has more adaptive cost based
+        // on the length of the key.
+        token.remove_attribute(UserPos::Token::SUGGESTION_ONLY);
+        token.add_attribute(UserPos::Token::SHORTCUT);
+      }
+      output->emplace_back(std::move(token), entry_id);
+    }
+  }
+
+  template <typename Func>
+  bool ForEachImageToken(absl::string_view key, int key_id, Func &func) const {
+    const UserDictionaryImage &image = image_->image;
+    UserPos::Token token;
+    strings::Assign(token.key, key);
+    const auto [begin, end] = image.GetTokenRange(key_id);
+    for (size_t i = begin; i < end; ++i) {
+      if (!removed_image_entries_.empty() &&
+          removed_image_entries_.contains(image.GetEntryIndex(i))) {
+        continue;
+      }
+      image.GetToken(i, &token);
+      if (!func(static_cast<const UserPos::Token &>(token))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void LoadSuppressionEntries(
+      const std::vector<const UserDictionaryStorage::UserDictionaryEntry *>
+          &entries) {
+    suppression_entries_.clear();
+    const SuppressionDictionaryLock l(suppression_dictionary_);
+    suppression_dictionary_->Clear();
+    for (const UserDictionaryStorage::UserDictionaryEntry *entry : entries) {
+      std::string reading = GetReading(*entry);
+      suppression_dictionary_->AddEntry(reading, entry->value());
+      suppression_entries_.emplace_back(std::move(reading), entry->value());
+    }
+  }
+
+  void OnLoaded() {
+    VLOG(1) << size() << " user dic entries loaded";
+
+    usage_stats::UsageStats::SetInteger("UserRegisteredWord",
+                                        static_cast<int>(size()));
+  }
+
+  // Slots of the swiss table plus one control byte per slot.
+  template <typename HashContainer>
+  static size_t HashMapBytes(const HashContainer &container) {
+    return container.capacity() *
+           (sizeof(typename HashContainer::value_type) + 1);
+  }
+
   const UserPosInterface *user_pos_;
   SuppressionDictionary *suppression_dictionary_;
+  // Sorted by OrderByKeyThenById.
   std::vector<UserPos::Token> user_pos_tokens_;
+  // token_entry_ids_[i] is the entry ID of user_pos_tokens_[i].
+  std::vector<uint64_t> token_entry_ids_;
+
+  // Bookkeeping of the loaded entries (except for suppression words) for
+  // LoadIncrementally().
+  // Entry ID -> number of entries.
+  absl::flat_hash_map<uint64_t, int> entry_counts_;
+  // Entry ID -> word ID.
+  absl::flat_hash_map<uint64_t, uint64_t> entry_word_ids_;
+  // Word ID -> number of entries.
+  absl::flat_hash_map<uint64_t, int> word_counts_;
+
+  // When the image is set, the tokens are served from both the image and
+  // user_pos_tokens_, which then has only the tokens of the entries added after
+  // the image is built, and the bookkeeping above covers only those entries.
+  std::shared_ptr<const MappedImage> image_;
+  // Indices of the entries of the image removed after the image is built.
+  absl::flat_hash_set<uint32_t> removed_image_entries_;
+  // Key and value of the suppression words, for BuildImage().
+  std::vector<std::pair<std::string, std::string>> suppression_entries_;
 };
 
-class UserDictionary::UserDictionaryReloader : public Thread {
+class UserDictionary::UserDictionaryReloader {
  public:
   explicit UserDictionaryReloader(UserDictionary *dic)
       : modified_at_(0), dic_(dic) {
@@ -242,10 +764,20 @@ class UserDictionary::UserDictionaryReloader : public Thread {
   UserDictionaryReloader(const UserDictionaryReloader &) = delete;
   UserDictionaryReloader &operator=(const UserDictionaryReloader &) = delete;
 
-  ~UserDictionaryReloader() override { Join(); }
+  ~UserDictionaryReloader() { Join(); }
+
+  bool IsRunning() const { return reload_.has_value() && !reload_->Ready(); }
+
+  // Waits for the running reload, if any.
+  void Join() {
+    if (reload_.has_value()) {
+      reload_->Wait();
+      reload_.reset();
+    }
+  }
 
   // When the user dictionary exists AND the modification time has been updated,
-  // reloads the dictionary.  Returns true when reloader thread is started.
+  // reloads the dictionary.  Returns true when the reload is scheduled.
   bool MaybeStartReload() {
     absl::StatusOr<FileTimeStamp> modification_time =
         FileUtil::GetModificationTime(
@@ -263,36 +795,75 @@ class UserDictionary::UserDictionaryReloader : public Thread {
       return false;
     }
     modified_at_ = *modification_time;
-    Start("UserDictionaryReloader");
+    Join();
+    reload_.emplace(
+        ThreadPool::GetDefaultThreadPool()->Schedule([this] { Run(); }));
     return true;
   }
 
-  void Run() override {
-    UserDictionaryStorage storage(
-        Singleton<UserDictionaryFileManager>::get()->GetFileName());
+  void Run() {
+    const std::string filename =
+        Singleton<UserDictionaryFileManager>::get()->GetFileName();
+    const std::string image_filename = absl::StrCat(filename, kImageFileSuffix);
+
+    // The file is mapped once and both the fingerprint and the dictionary come
+    // from the mapped data, so that the fingerprint identifies what is loaded
+    // even if the file is replaced in the meantime.  The compiled image is
+    // used without parsing the file if it's built from the same data.
+    absl::StatusOr<Mmap> source = Mmap::Map(filename);
+    std::optional<uint64_t> fingerprint;
+    if (source.ok()) {
+      fingerprint = dic_->GetSourceFingerprint(
+          absl::string_view(source->data(), source->size()));
+      if (dic_->LoadImage(image_filename, *fingerprint)) {
+        return;
+      }
+    }
+
+    UserDictionaryStorage storage(filename);
 
     // Load from file
-    if (absl::Status s = storage.Load(); !s.ok()) {
+    if (absl::Status s =
+            source.ok() ? storage.LoadFromString(absl::string_view(
+                              source->data(), source->size()))
+                        : storage.Load();
+        !s.ok()) {
       LOG(ERROR) << "Failed to load the user dictionary: " << s;
       return;
     }
 
     if (storage.ConvertSyncDictionariesToNormalDictionaries()) {
       LOG(INFO) << "Syncable dictionaries are converted to normal dictionaries";
+      fingerprint.reset();
       if (storage.Lock()) {
         if (absl::Status s = storage.Save(); !s.ok()) {
           LOG(ERROR) << "Failed to save to storage: " << s;
+        } else if (absl::StatusOr<Mmap> saved = Mmap::Map(filename);
+                   saved.ok()) {
+          // The file can't be replaced by others while it's locked.
+          fingerprint = dic_->GetSourceFingerprint(
+              absl::string_view(saved->data(), saved->size()));
         }
         storage.UnLock();
       }
     }
 
     dic_->Load(storage.GetProto());
+
+    // Compiles the loaded dictionary for the next reload.  This runs after the
+    // new contents are already served.
+    if (fingerprint.has_value()) {
+      if (absl::Status s = dic_->SaveImage(image_filename, *fingerprint);
+          !s.ok()) {
+        LOG(WARNING) << "Failed to save the user dictionary image: " << s;
+      }
+    }
   }
 
  private:
   FileTimeStamp modified_at_;
   UserDictionary *dic_;
+  std::optional<TaskFuture<void>> reload_;
   std::string key_;
   std::string value_;
 };
@@ -304,7 +875,8 @@ UserDictionary::UserDictionary(std::unique_ptr<const UserPosInterface> user_pos,
       user_pos_(std::move(user_pos)),
       pos_matcher_(pos_matcher),
       suppression_dictionary_(suppression_dictionary),
-      tokens_(new TokensIndex(user_pos_.get(), suppression_dictionary)) {
+      tokens_(new TokensIndex(user_pos_.get(), suppression_dictionary)),
+      user_pos_fingerprint_(user_pos_->GetFingerprint()) {
   DCHECK(user_pos_.get());
   DCHECK(suppression_dictionary_);
   Reload();
@@ -346,27 +918,22 @@ void UserDictionary::LookupPredictive(
     return;
   }
 
-  // Find the starting point of iteration over dictionary contents.
   Token token;
-  for (auto [begin, end] = std::equal_range(tokens_->begin(), tokens_->end(),
-                                            key, OrderByKeyPrefix());
-       begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
-    switch (callback->OnKey(user_pos_token.key)) {
-      case Callback::TRAVERSE_DONE:
-        return;
-      case Callback::TRAVERSE_NEXT_KEY:
-      case Callback::TRAVERSE_CULL:
-        continue;
-      default:
-        break;
-    }
-    PopulateTokenFromUserPosToken(user_pos_token, PREDICTIVE, &token);
-    if (callback->OnToken(user_pos_token.key, user_pos_token.key, token) ==
-        Callback::TRAVERSE_DONE) {
-      return;
-    }
-  }
+  tokens_->ForEachPredictiveToken(
+      key, [this, callback, &token](const UserPos::Token &user_pos_token) {
+        switch (callback->OnKey(user_pos_token.key)) {
+          case Callback::TRAVERSE_DONE:
+            return false;
+          case Callback::TRAVERSE_NEXT_KEY:
+          case Callback::TRAVERSE_CULL:
+            return true;
+          default:
+            break;
+        }
+        PopulateTokenFromUserPosToken(user_pos_token, PREDICTIVE, &token);
+        return callback->OnToken(user_pos_token.key, user_pos_token.key,
+                                 token) != Callback::TRAVERSE_DONE;
+      });
 }
 
 // UserDictionary doesn't support kana modifier insensitive lookup.
@@ -386,28 +953,19 @@ void UserDictionary::LookupPrefix(absl::string_view key,
     return;
   }
 
-  // Find the starting point for iteration over dictionary contents.
-  const absl::string_view first_char =
-      key.substr(0, Util::OneCharLen(key.data()));
+  // Look up each prefix of |key| in the ascending order of length, instead of
+  // scanning all the tokens between the first character and |key|.
   Token token;
-  for (auto it = std::lower_bound(tokens_->begin(), tokens_->end(), first_char,
-                                  OrderByKey());
-       it != tokens_->end(); ++it) {
-    const UserPos::Token &user_pos_token = *it;
-    if (user_pos_token.key > key) {
-      break;
-    }
+  auto on_token = [this, callback,
+                   &token](const UserPos::Token &user_pos_token) {
     if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
-      continue;
-    }
-    if (!absl::StartsWith(key, user_pos_token.key)) {
-      continue;
+      return true;
     }
     switch (callback->OnKey(user_pos_token.key)) {
       case Callback::TRAVERSE_DONE:
-        return;
+        return false;
       case Callback::TRAVERSE_NEXT_KEY:
-        continue;
+        return true;
       case Callback::TRAVERSE_CULL:
         LOG(FATAL) << "UserDictionary doesn't support culling.";
         break;
@@ -417,13 +975,20 @@ void UserDictionary::LookupPrefix(absl::string_view key,
     PopulateTokenFromUserPosToken(user_pos_token, PREFIX, &token);
     switch (callback->OnToken(user_pos_token.key, user_pos_token.key, token)) {
       case Callback::TRAVERSE_DONE:
-        return;
+        return false;
       case Callback::TRAVERSE_CULL:
         LOG(FATAL) << "UserDictionary doesn't support culling.";
         break;
       default:
         break;
     }
+    return true;
+  };
+  for (size_t len = 0; len < key.size();) {
+    len += Util::OneCharLen(key.data() + len);
+    if (!tokens_->ForEachToken(key.substr(0, len), on_token)) {
+      return;
+    }
   }
 }
 
@@ -435,26 +1000,22 @@ void UserDictionary::LookupExact(absl::string_view key,
       conversion_request.config().incognito_mode()) {
     return;
   }
-  auto [begin, end] =
-      std::equal_range(tokens_->begin(), tokens_->end(), key, OrderByKey());
-  if (begin == end) {
-    return;
-  }
-  if (callback->OnKey(key) != Callback::TRAVERSE_CONTINUE) {
-    return;
-  }
-
+  // OnKey() is called once before the first token.
+  bool key_accepted = false;
   Token token;
-  for (; begin != end; ++begin) {
-    const UserPos::Token &user_pos_token = *begin;
+  tokens_->ForEachToken(key, [&](const UserPos::Token &user_pos_token) {
+    if (!key_accepted) {
+      if (callback->OnKey(key) != Callback::TRAVERSE_CONTINUE) {
+        return false;
+      }
+      key_accepted = true;
+    }
     if (user_pos_token.has_attribute(UserPos::Token::SUGGESTION_ONLY)) {
-      continue;
+      return true;
     }
     PopulateTokenFromUserPosToken(user_pos_token, EXACT, &token);
-    if (callback->OnToken(key, key, token) != Callback::TRAVERSE_CONTINUE) {
-      return;
-    }
-  }
+    return callback->OnToken(key, key, token) == Callback::TRAVERSE_CONTINUE;
+  });
 }
 
 void UserDictionary::LookupReverse(absl::string_view key,
@@ -475,16 +1036,13 @@ bool UserDictionary::LookupComment(absl::string_view key,
   }
 
   // Set the comment that was found first.
-  for (auto [begin, end] = std::equal_range(tokens_->begin(), tokens_->end(),
-                                            key, OrderByKey());
-       begin != end; ++begin) {
-    const UserPos::Token &token = *begin;
+  return !tokens_->ForEachToken(key, [&](const UserPos::Token &token) {
     if (token.value == value && !token.comment.empty()) {
       comment->assign(token.comment);
-      return true;
+      return false;
     }
-  }
-  return false;
+    return true;
+  });
 }
 
 bool UserDictionary::Reload() {
@@ -525,6 +1083,11 @@ class FindValueCallback : public DictionaryInterface::Callback {
 
 void UserDictionary::WaitForReloader() { reloader_->Join(); }
 
+void UserDictionary::GetMemoryStats(MemoryStats *stats) const {
+  absl::ReaderMutexLock l(&mutex_);
+  tokens_->GetMemoryStats(stats);
+}
+
 void UserDictionary::Swap(TokensIndex *new_tokens) {
   DCHECK(new_tokens);
   TokensIndex *old_tokens = tokens_;
@@ -537,10 +1100,24 @@ void UserDictionary::Swap(TokensIndex *new_tokens) {
 
 bool UserDictionary::Load(
     const user_dictionary::UserDictionaryStorage &storage) {
+  // Applies the difference to the current tokens if only a few entries are
+  // edited.
+  // Applies the difference to the compiled image if the current tokens are
+  // served from it.
+  TokensIndex *tokens =
+      new TokensIndex(user_pos_.get(), suppression_dictionary_);
   size_t size = 0;
+  bool loaded = false;
   {
     absl::ReaderMutexLock l(&mutex_);
     size = tokens_->size();
+    loaded = tokens_->image() == nullptr
+                 ? tokens->LoadIncrementally(storage, *tokens_)
+                 : tokens->LoadWithImage(storage, tokens_->image());
+  }
+  if (loaded) {
+    Swap(tokens);
+    return true;
   }
 
   // If UserDictionary is pretty big, we first remove the
@@ -557,13 +1134,82 @@ bool UserDictionary::Load(
     Swap(dummy_empty_tokens);
   }
 
-  TokensIndex *tokens =
-      new TokensIndex(user_pos_.get(), suppression_dictionary_);
   tokens->Load(storage);
   Swap(tokens);
   return true;
 }
 
+uint64_t UserDictionary::GetSourceFingerprint(
+    absl::string_view contents) const {
+  // The image depends on both the contents and the POS data.
+  return FingerprintBuilder()
+      .Append(absl::string_view(
+          reinterpret_cast<const char *>(&user_pos_fingerprint_),
+          sizeof(user_pos_fingerprint_)))
+      .Append(contents)
+      .Finish();
+}
+
+bool UserDictionary::LoadImage(const std::string &filename,
+                               uint64_t source_fingerprint) {
+  auto image = std::make_shared<MappedImage>();
+  absl::StatusOr<Mmap> mmap = Mmap::Map(filename);
+  if (!mmap.ok()) {
+    VLOG(1) << "Cannot map the user dictionary image: " << mmap.status();
+    return false;
+  }
+  image->mmap = *std::move(mmap);
+  if (!image->image.Open(
+          absl::string_view(image->mmap.data(), image->mmap.size()))) {
+    // Removes the broken image, as SaveImage() keeps the image of the same
+    // source fingerprint.
+    image->mmap.Close();
+    FileUtil::UnlinkOrLogError(filename);
+    return false;
+  }
+  if (image->image.source_fingerprint() != source_fingerprint) {
+    VLOG(1) << "The user dictionary image is outdated";
+    return false;
+  }
+
+  auto tokens = std::make_unique<TokensIndex>(user_pos_.get(),
+                                              suppression_dictionary_);
+  tokens->LoadFromImage(std::move(image));
+  Swap(tokens.release());
+  return true;
+}
+
+absl::Status UserDictionary::SaveImage(const std::string &filename,
+                                       uint64_t source_fingerprint) const {
+  // The image on disk is kept if it's already built from the same source,
+  // e.g., by another process.  Only its metadata is read.
+  if (absl::StatusOr<Mmap> mmap = Mmap::Map(filename); mmap.ok()) {
+    uint64_t image_fingerprint = 0;
+    if (UserDictionaryImage::ReadSourceFingerprint(
+            absl::string_view(mmap->data(), mmap->size()),
+            &image_fingerprint) &&
+        image_fingerprint == source_fingerprint) {
+      return absl::OkStatus();
+    }
+  }
+
+  UserDictionaryImageBuilder builder;
+  {
+    absl::ReaderMutexLock l(&mutex_);
+    if (tokens_->IsServedFromImage(source_fingerprint)) {
+      return absl::OkStatus();
+    }
+    tokens_->BuildImage(&builder);
+  }
+  const std::string tmp_filename = absl::StrCat(filename, ".tmp");
+  if (absl::Status s =
+          FileUtil::SetContents(tmp_filename, builder.Build(source_fingerprint));
+      !s.ok()) {
+    return s;
+  }
+  return FileUtil::AtomicRename(tmp_filename, filename);
+}
+
 std::vector<std::string> UserDictionary::GetPosList() const {
   std::vector<std::string> pos_list;
   user_pos_->GetPosList(&pos_list);
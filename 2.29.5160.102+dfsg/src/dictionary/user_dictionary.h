@@ -30,6 +30,7 @@
 #ifndef MOZC_DICTIONARY_USER_DICTIONARY_H_
 #define MOZC_DICTIONARY_USER_DICTIONARY_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -41,6 +42,8 @@
 #include "dictionary/user_pos_interface.h"
 #include "protocol/user_dictionary_storage.pb.h"
 #include "request/conversion_request.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 
@@ -93,6 +96,9 @@ class UserDictionary : public DictionaryInterface {
   // Waits until reloader finishes
   void WaitForReloader();
 
+  // Adds the memory of the tokens index and the mapped image.
+  void GetMemoryStats(MemoryStats *stats) const override;
+
   // Gets the user POS list.
   std::vector<std::string> GetPosList() const;
 
@@ -115,11 +121,24 @@ class UserDictionary : public DictionaryInterface {
   // Swaps internal tokens index to |new_tokens|.
   void Swap(TokensIndex *new_tokens);
 
+  // Returns the fingerprint of |contents| of the user dictionary file, which
+  // identifies the compiled image built from the file.
+  uint64_t GetSourceFingerprint(absl::string_view contents) const;
+
+  // Serves the tokens from the compiled image file if it's built from the
+  // source of |source_fingerprint|.
+  bool LoadImage(const std::string &filename, uint64_t source_fingerprint);
+
+  // Writes the compiled image of the current tokens to the file.
+  absl::Status SaveImage(const std::string &filename,
+                         uint64_t source_fingerprint) const;
+
   std::unique_ptr<UserDictionaryReloader> reloader_;
   std::unique_ptr<const UserPosInterface> user_pos_;
   const PosMatcher pos_matcher_;
   SuppressionDictionary *suppression_dictionary_;
   TokensIndex *tokens_;
+  const uint64_t user_pos_fingerprint_;
   mutable absl::Mutex mutex_;
 
   friend class UserDictionaryTest;
@@ -0,0 +1,341 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "dictionary/user_dictionary_image.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/bits.h"
+#include "base/container/serialized_string_array.h"
+#include "base/logging.h"
+#include "data_manager/dataset_reader.h"
+#include "data_manager/dataset_writer.h"
+#include "dictionary/user_pos.h"
+#include "storage/louds/louds_trie_builder.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+template <typename T>
+void AppendUnaligned(T value, std::string *output) {
+  const size_t pos = output->size();
+  output->resize(pos + sizeof(T));
+  StoreUnaligned<T>(value, output->begin() + pos);
+}
+
+}  // namespace
+
+bool UserDictionaryImage::Open(absl::string_view image) {
+  DataSetReader reader;
+  if (!reader.Init(image, kMagic)) {
+    LOG(ERROR) << "Broken user dictionary image";
+    return false;
+  }
+
+  absl::string_view source, trie, strings, suppression_entries;
+  if (!reader.Get("source", &source) || source.size() != sizeof(uint64_t) ||
+      !reader.Get("trie", &trie) || !reader.Get("token_index", &token_index_) ||
+      !reader.Get("tokens", &tokens_) || !reader.Get("strings", &strings) ||
+      !reader.Get("entries", &entries_) || !reader.Get("words", &words_) ||
+      !reader.Get("suppression", &suppression_entries)) {
+    LOG(ERROR) << "User dictionary image doesn't have required sections";
+    return false;
+  }
+  if (tokens_.size() % kTokenByteLength != 0 ||
+      entries_.size() % kEntryByteLength != 0 ||
+      words_.size() % sizeof(uint64_t) != 0 ||
+      token_index_.size() % sizeof(uint32_t) != 0 || token_index_.empty() ||
+      LoadUnaligned<uint32_t>(token_index_.end() - sizeof(uint32_t)) !=
+          tokens_size()) {
+    LOG(ERROR) << "Broken user dictionary image: invalid section size";
+    return false;
+  }
+  if (!strings_.Init(strings) ||
+      !suppression_entries_.Init(suppression_entries) ||
+      suppression_entries_.size() % 2 != 0) {
+    LOG(ERROR) << "Broken user dictionary image: invalid string array";
+    return false;
+  }
+  if (!trie_.Open(reinterpret_cast<const uint8_t *>(trie.data()))) {
+    LOG(ERROR) << "Broken user dictionary image: invalid key trie";
+    return false;
+  }
+
+  // The accessors use the indices in the image without range checks, so all of
+  // them are verified here.  The caller falls back to the user dictionary file
+  // if the image is broken.
+  const size_t num_keys = token_index_.size() / sizeof(uint32_t) - 1;
+  for (size_t i = 0; i < num_keys; ++i) {
+    const char *ptr = token_index_.data() + i * sizeof(uint32_t);
+    if (LoadUnaligned<uint32_t>(ptr) >
+        LoadUnaligned<uint32_t>(ptr + sizeof(uint32_t))) {
+      LOG(ERROR) << "Broken user dictionary image: invalid token index";
+      return false;
+    }
+  }
+  for (size_t i = 0; i < tokens_size(); ++i) {
+    const char *ptr = tokens_.data() + i * kTokenByteLength;
+    if (LoadUnaligned<uint32_t>(ptr + 4) >= strings_.size() ||
+        LoadUnaligned<uint32_t>(ptr + 8) >= strings_.size() ||
+        LoadUnaligned<uint32_t>(ptr + 12) >= entries_size()) {
+      LOG(ERROR) << "Broken user dictionary image: invalid token";
+      return false;
+    }
+  }
+  bool valid_key_ids = true;
+  PredictiveSearch("", [&](absl::string_view key, int key_id) {
+    valid_key_ids = key_id >= 0 && static_cast<size_t>(key_id) < num_keys;
+    return valid_key_ids;
+  });
+  if (!valid_key_ids) {
+    LOG(ERROR) << "Broken user dictionary image: invalid key ID";
+    return false;
+  }
+
+  source_fingerprint_ = LoadUnaligned<uint64_t>(source.data());
+  return true;
+}
+
+bool UserDictionaryImage::ReadSourceFingerprint(absl::string_view image,
+                                                uint64_t *source_fingerprint) {
+  DataSetReader reader;
+  absl::string_view source;
+  if (!reader.Init(image, kMagic) || !reader.Get("source", &source) ||
+      source.size() != sizeof(uint64_t)) {
+    return false;
+  }
+  *source_fingerprint = LoadUnaligned<uint64_t>(source.data());
+  return true;
+}
+
+std::pair<size_t, size_t> UserDictionaryImage::GetTokenRange(
+    int key_id) const {
+  DCHECK_GE(key_id, 0);
+  const char *ptr = token_index_.data() + key_id * sizeof(uint32_t);
+  return {LoadUnaligned<uint32_t>(ptr),
+          LoadUnaligned<uint32_t>(ptr + sizeof(uint32_t))};
+}
+
+void UserDictionaryImage::GetToken(size_t i, UserPos::Token *token) const {
+  DCHECK_LT(i, tokens_size());
+  const char *ptr = tokens_.data() + i * kTokenByteLength;
+  token->id = LoadUnaligned<uint16_t>(ptr);
+  token->attributes = LoadUnaligned<uint16_t>(ptr + 2);
+  const absl::string_view value = strings_[LoadUnaligned<uint32_t>(ptr + 4)];
+  token->value.assign(value.data(), value.size());
+  const absl::string_view comment = strings_[LoadUnaligned<uint32_t>(ptr + 8)];
+  token->comment.assign(comment.data(), comment.size());
+}
+
+uint32_t UserDictionaryImage::GetEntryIndex(size_t i) const {
+  DCHECK_LT(i, tokens_size());
+  return LoadUnaligned<uint32_t>(tokens_.data() + i * kTokenByteLength + 12);
+}
+
+UserDictionaryImage::Entry UserDictionaryImage::GetEntry(size_t i) const {
+  DCHECK_LT(i, entries_size());
+  const char *ptr = entries_.data() + i * kEntryByteLength;
+  Entry entry;
+  entry.entry_id = LoadUnaligned<uint64_t>(ptr);
+  entry.word_id = LoadUnaligned<uint64_t>(ptr + 8);
+  entry.count = LoadUnaligned<uint32_t>(ptr + 16);
+  entry.word_count = LoadUnaligned<uint32_t>(ptr + 20);
+  return entry;
+}
+
+int UserDictionaryImage::FindEntry(uint64_t entry_id) const {
+  size_t begin = 0, end = entries_size();
+  while (begin < end) {
+    const size_t mid = begin + (end - begin) / 2;
+    const uint64_t id =
+        LoadUnaligned<uint64_t>(entries_.data() + mid * kEntryByteLength);
+    if (id == entry_id) {
+      return static_cast<int>(mid);
+    }
+    if (id < entry_id) {
+      begin = mid + 1;
+    } else {
+      end = mid;
+    }
+  }
+  return -1;
+}
+
+bool UserDictionaryImage::HasWord(uint64_t word_id) const {
+  size_t begin = 0, end = words_.size() / sizeof(uint64_t);
+  while (begin < end) {
+    const size_t mid = begin + (end - begin) / 2;
+    const uint64_t id =
+        LoadUnaligned<uint64_t>(words_.data() + mid * sizeof(uint64_t));
+    if (id == word_id) {
+      return true;
+    }
+    if (id < word_id) {
+      begin = mid + 1;
+    } else {
+      end = mid;
+    }
+  }
+  return false;
+}
+
+void UserDictionaryImageBuilder::AddToken(const UserPos::Token &token,
+                                          uint64_t entry_id) {
+  tokens_.emplace_back(token, entry_id);
+}
+
+void UserDictionaryImageBuilder::AddEntry(uint64_t entry_id, uint64_t word_id,
+                                          int count) {
+  auto &[id, total] = entries_[entry_id];
+  id = word_id;
+  total += count;
+}
+
+void UserDictionaryImageBuilder::AddSuppressionEntry(absl::string_view key,
+                                                     absl::string_view value) {
+  suppression_entries_.emplace_back(key);
+  suppression_entries_.emplace_back(value);
+}
+
+std::string UserDictionaryImageBuilder::Build(
+    uint64_t source_fingerprint) const {
+  // Entries sorted by ID, and the number of entries of each word.
+  std::vector<std::pair<uint64_t, std::pair<uint64_t, int>>> entries(
+      entries_.begin(), entries_.end());
+  std::sort(entries.begin(), entries.end());
+  absl::flat_hash_map<uint64_t, int> word_counts;
+  absl::flat_hash_map<uint64_t, uint32_t> entry_indices;
+  for (const auto &[entry_id, word] : entries) {
+    word_counts[word.first] += word.second;
+    entry_indices.emplace(entry_id, entry_indices.size());
+  }
+
+  std::string entries_image;
+  for (const auto &[entry_id, word] : entries) {
+    AppendUnaligned<uint64_t>(entry_id, &entries_image);
+    AppendUnaligned<uint64_t>(word.first, &entries_image);
+    AppendUnaligned<uint32_t>(word.second, &entries_image);
+    AppendUnaligned<uint32_t>(word_counts[word.first], &entries_image);
+  }
+
+  std::vector<uint64_t> words;
+  words.reserve(word_counts.size());
+  for (const auto &[word_id, unused_count] : word_counts) {
+    words.push_back(word_id);
+  }
+  std::sort(words.begin(), words.end());
+  std::string words_image;
+  for (const uint64_t word_id : words) {
+    AppendUnaligned<uint64_t>(word_id, &words_image);
+  }
+
+  // The tokens are grouped by the key ID of the trie.
+  storage::louds::LoudsTrieBuilder trie_builder;
+  for (const auto &[token, unused_entry_id] : tokens_) {
+    trie_builder.Add(token.key);
+  }
+  trie_builder.Build();
+  std::vector<std::vector<const std::pair<UserPos::Token, uint64_t> *>>
+      key_tokens;
+  for (const auto &token : tokens_) {
+    const int key_id = trie_builder.GetId(token.first.key);
+    DCHECK_GE(key_id, 0);
+    if (static_cast<size_t>(key_id) >= key_tokens.size()) {
+      key_tokens.resize(key_id + 1);
+    }
+    key_tokens[key_id].push_back(&token);
+  }
+
+  std::vector<absl::string_view> strings;
+  absl::flat_hash_map<absl::string_view, uint32_t> string_indices;
+  auto get_string_index = [&strings,
+                           &string_indices](absl::string_view str) {
+    const auto [it, inserted] = string_indices.emplace(str, strings.size());
+    if (inserted) {
+      strings.push_back(str);
+    }
+    return it->second;
+  };
+  std::string token_index_image, tokens_image;
+  uint32_t num_tokens = 0;
+  for (const auto &tokens : key_tokens) {
+    AppendUnaligned<uint32_t>(num_tokens, &token_index_image);
+    for (const auto *token : tokens) {
+      AppendUnaligned<uint16_t>(token->first.id, &tokens_image);
+      AppendUnaligned<uint16_t>(token->first.attributes, &tokens_image);
+      AppendUnaligned<uint32_t>(get_string_index(token->first.value),
+                                &tokens_image);
+      AppendUnaligned<uint32_t>(get_string_index(token->first.comment),
+                                &tokens_image);
+      DCHECK(entry_indices.contains(token->second));
+      AppendUnaligned<uint32_t>(entry_indices[token->second], &tokens_image);
+      ++num_tokens;
+    }
+  }
+  AppendUnaligned<uint32_t>(num_tokens, &token_index_image);
+
+  std::unique_ptr<uint32_t[]> strings_buffer;
+  const absl::string_view strings_image =
+      SerializedStringArray::SerializeToBuffer(strings, &strings_buffer);
+  const std::vector<absl::string_view> suppression_entries(
+      suppression_entries_.begin(), suppression_entries_.end());
+  std::unique_ptr<uint32_t[]> suppression_buffer;
+  const absl::string_view suppression_image =
+      SerializedStringArray::SerializeToBuffer(suppression_entries,
+                                               &suppression_buffer);
+  std::string source_image;
+  AppendUnaligned<uint64_t>(source_fingerprint, &source_image);
+
+  DataSetWriter writer(UserDictionaryImage::kMagic);
+  writer.Add("source", 64, source_image);
+  writer.Add("trie", 32, trie_builder.image());
+  writer.Add("token_index", 32, token_index_image);
+  writer.Add("tokens", 32, tokens_image);
+  writer.Add("strings", 32, strings_image);
+  writer.Add("entries", 64, entries_image);
+  writer.Add("words", 64, words_image);
+  writer.Add("suppression", 32, suppression_image);
+  std::ostringstream output;
+  writer.Finish(&output);
+  return output.str();
+}
+
+}  // namespace dictionary
+}  // namespace mozc
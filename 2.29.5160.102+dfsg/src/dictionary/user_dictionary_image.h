@@ -0,0 +1,263 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MOZC_DICTIONARY_USER_DICTIONARY_IMAGE_H_
+#define MOZC_DICTIONARY_USER_DICTIONARY_IMAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/container/serialized_string_array.h"
+#include "dictionary/user_pos.h"
+#include "storage/louds/louds_trie.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+
+// Compiled binary image of the tokens of a user dictionary.  The image is
+// generated from the tokens which UserDictionary expands from the entries of
+// UserDictionaryStorage, so that a big user dictionary can be served directly
+// from a memory-mapped file without parsing the storage and expanding the
+// entries again.
+//
+// * Prerequisite
+// Little endian is assumed.
+//
+// * Binary format
+// The image is a data set (see data_manager/dataset.proto) with the following
+// sections:
+//
+// ** "source"
+// The 64-bit fingerprint of the data from which the image is built.  The
+// client uses it to check whether the image is up to date.
+//
+// ** "trie"
+// LOUDS trie of the token keys (readings).
+//
+// ** "token_index"
+// Array of uint32_t of size (number of keys + 1).  The tokens of the key of ID
+// i are stored in [token_index[i], token_index[i + 1]) of the token array.
+//
+// ** "tokens"
+// The token array.  Each token has the following layout:
+//
+// Token layout (16 bytes)
+// +---------------------------------------+
+// | POS ID  (2 bytes)                     |
+// + - - - - - - - - - - - - - - - - - - - +
+// | Attributes  (2 bytes)                 |
+// + - - - - - - - - - - - - - - - - - - - +
+// | Value index  (4 bytes)                |
+// + - - - - - - - - - - - - - - - - - - - +
+// | Comment index  (4 bytes)              |
+// + - - - - - - - - - - - - - - - - - - - +
+// | Entry index  (4 bytes)                |
+// +---------------------------------------+
+//
+// The value and comment are indices to "strings".  The entry index is an index
+// to "entries" and identifies the entry from which the token comes.
+//
+// ** "strings"
+// SerializedStringArray of the values and comments.
+//
+// ** "entries"
+// The entries of the dictionary, sorted by the entry ID, which is used to
+// compute the difference between the image and an edited dictionary.
+//
+// Entry layout (24 bytes)
+// +---------------------------------------+
+// | Entry ID  (8 bytes)                   |
+// + - - - - - - - - - - - - - - - - - - - +
+// | Word ID  (8 bytes)                    |
+// + - - - - - - - - - - - - - - - - - - - +
+// | Number of the entries  (4 bytes)      |
+// + - - - - - - - - - - - - - - - - - - - +
+// | Number of the entries of the word     |
+// | (4 bytes)                             |
+// +---------------------------------------+
+//
+// ** "words"
+// Sorted array of the word IDs (uint64_t) of the entries.
+//
+// ** "suppression"
+// SerializedStringArray of the keys and values of suppression words, i.e.,
+// [key0, value0, key1, value1, ...].
+class UserDictionaryImage {
+ public:
+  struct Entry {
+    uint64_t entry_id = 0;
+    uint64_t word_id = 0;
+    uint32_t count = 0;
+    uint32_t word_count = 0;
+  };
+
+  UserDictionaryImage() = default;
+  UserDictionaryImage(const UserDictionaryImage &) = delete;
+  UserDictionaryImage &operator=(const UserDictionaryImage &) = delete;
+
+  // Opens the binary image.  This class doesn't own the |image|, so it is
+  // caller's responsibility to keep the data alive.  Returns false if the image
+  // is broken.
+  bool Open(absl::string_view image);
+
+  uint64_t source_fingerprint() const { return source_fingerprint_; }
+
+  // Reads the source fingerprint of |image| without verifying the other
+  // sections, so that it doesn't touch the whole image.  Returns false if
+  // |image| is not a user dictionary image.
+  static bool ReadSourceFingerprint(absl::string_view image,
+                                    uint64_t *source_fingerprint);
+
+  size_t tokens_size() const { return tokens_.size() / kTokenByteLength; }
+  size_t entries_size() const { return entries_.size() / kEntryByteLength; }
+  size_t suppression_entries_size() const {
+    return suppression_entries_.size() / 2;
+  }
+
+  // Returns the key ID of |key|, or -1 if |key| is not in the image.
+  int ExactSearch(absl::string_view key) const {
+    return trie_.ExactSearch(key);
+  }
+
+  // Runs a functor for the keys that start with |prefix|.  All the keys are
+  // enumerated when |prefix| is empty.  |func| needs to have the following
+  // signature:
+  //
+  // bool(absl::string_view key, int key_id)
+  //
+  // The traversal stops when |func| returns false.
+  template <typename Func>
+  void PredictiveSearch(absl::string_view prefix, Func func) const;
+
+  // Returns the range of the indices of the tokens of |key_id|.
+  std::pair<size_t, size_t> GetTokenRange(int key_id) const;
+
+  // Fills the fields of |token| except for the key from the |i|-th token.
+  void GetToken(size_t i, UserPos::Token *token) const;
+
+  // Returns the index of the entry from which the |i|-th token comes.
+  uint32_t GetEntryIndex(size_t i) const;
+
+  Entry GetEntry(size_t i) const;
+
+  // Returns the index of the entry of |entry_id|, or -1 if not found.
+  int FindEntry(uint64_t entry_id) const;
+
+  // Returns true if the image has the word of |word_id|.
+  bool HasWord(uint64_t word_id) const;
+
+  // Returns the key and value of the |i|-th suppression word.
+  std::pair<absl::string_view, absl::string_view> GetSuppressionEntry(
+      size_t i) const {
+    return {suppression_entries_[2 * i], suppression_entries_[2 * i + 1]};
+  }
+
+ private:
+  friend class UserDictionaryImageBuilder;
+
+  static constexpr char kMagic[] = "\xEFMOZC_USER_DIC\r\n";
+  static constexpr size_t kTokenByteLength = 16;
+  static constexpr size_t kEntryByteLength = 24;
+
+  uint64_t source_fingerprint_ = 0;
+  storage::louds::LoudsTrie trie_;
+  absl::string_view token_index_;
+  absl::string_view tokens_;
+  SerializedStringArray strings_;
+  absl::string_view entries_;
+  absl::string_view words_;
+  SerializedStringArray suppression_entries_;
+};
+
+// Builds the binary image of UserDictionaryImage.
+class UserDictionaryImageBuilder {
+ public:
+  UserDictionaryImageBuilder() = default;
+  UserDictionaryImageBuilder(const UserDictionaryImageBuilder &) = delete;
+  UserDictionaryImageBuilder &operator=(const UserDictionaryImageBuilder &) =
+      delete;
+
+  // Adds a token which comes from the entry of |entry_id|.  The entry needs to
+  // be added by AddEntry() too.
+  void AddToken(const UserPos::Token &token, uint64_t entry_id);
+
+  // Adds |count| entries of |entry_id|, which register the word of |word_id|.
+  void AddEntry(uint64_t entry_id, uint64_t word_id, int count);
+
+  void AddSuppressionEntry(absl::string_view key, absl::string_view value);
+
+  // Builds the image.  |source_fingerprint| is stored in the image as is.
+  std::string Build(uint64_t source_fingerprint) const;
+
+ private:
+  std::vector<std::pair<UserPos::Token, uint64_t>> tokens_;
+  absl::flat_hash_map<uint64_t, std::pair<uint64_t, int>> entries_;
+  std::vector<std::string> suppression_entries_;
+};
+
+template <typename Func>
+void UserDictionaryImage::PredictiveSearch(absl::string_view prefix,
+                                           Func func) const {
+  using Node = storage::louds::LoudsTrie::Node;
+  Node node;
+  if (!trie_.Traverse(prefix, &node)) {
+    return;
+  }
+
+  // Depth first search from the node of |prefix|.  The second element of each
+  // state is the length of the key reaching to the node.
+  std::string key(prefix);
+  std::vector<std::pair<Node, size_t>> stack = {{node, key.size()}};
+  while (!stack.empty()) {
+    const auto [current, length] = stack.back();
+    stack.pop_back();
+    if (length > prefix.size()) {
+      key.resize(length - 1);
+      key.push_back(trie_.GetEdgeLabelToParentNode(current));
+    }
+    if (trie_.IsTerminalNode(current) &&
+        !func(absl::string_view(key), trie_.GetKeyIdOfTerminalNode(current))) {
+      return;
+    }
+    for (Node child = trie_.MoveToFirstChild(current); trie_.IsValidNode(child);
+         trie_.MoveToNextSibling(&child)) {
+      stack.emplace_back(child, length + 1);
+    }
+  }
+}
+
+}  // namespace dictionary
+}  // namespace mozc
+
+#endif  // MOZC_DICTIONARY_USER_DICTIONARY_IMAGE_H_
@@ -0,0 +1,214 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "dictionary/user_dictionary_image.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/bits.h"
+#include "data_manager/dataset_reader.h"
+#include "dictionary/user_pos.h"
+#include "testing/gunit.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace mozc {
+namespace dictionary {
+namespace {
+
+UserPos::Token MakeToken(absl::string_view key, absl::string_view value,
+                         uint16_t id, absl::string_view comment) {
+  UserPos::Token token;
+  token.key = std::string(key);
+  token.value = std::string(value);
+  token.id = id;
+  token.comment = std::string(comment);
+  return token;
+}
+
+class UserDictionaryImageTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    UserDictionaryImageBuilder builder;
+    builder.AddEntry(100, 1000, 1);
+    builder.AddEntry(200, 2000, 2);
+    builder.AddEntry(300, 2000, 1);
+    builder.AddToken(MakeToken("start", "start", 10, ""), 100);
+    builder.AddToken(MakeToken("start", "START", 11, "comment"), 100);
+    builder.AddToken(MakeToken("star", "star", 20, ""), 200);
+    builder.AddToken(MakeToken("starting", "starting", 30, ""), 300);
+    builder.AddSuppressionEntry("stamp", "stamp");
+    data_ = builder.Build(12345);
+    ASSERT_TRUE(image_.Open(data_));
+  }
+
+  // Returns "key:value" of the tokens of |key_id|.
+  std::vector<std::string> GetTokens(absl::string_view key, int key_id) const {
+    std::vector<std::string> result;
+    UserPos::Token token;
+    const auto [begin, end] = image_.GetTokenRange(key_id);
+    for (size_t i = begin; i < end; ++i) {
+      image_.GetToken(i, &token);
+      result.push_back(absl::StrCat(key, ":", token.value));
+    }
+    return result;
+  }
+
+  std::string data_;
+  UserDictionaryImage image_;
+};
+
+TEST_F(UserDictionaryImageTest, ExactSearch) {
+  EXPECT_EQ(image_.source_fingerprint(), 12345);
+  EXPECT_EQ(image_.tokens_size(), 4);
+  EXPECT_EQ(image_.ExactSearch("sta"), -1);
+  EXPECT_EQ(image_.ExactSearch("startin"), -1);
+
+  const int key_id = image_.ExactSearch("start");
+  ASSERT_GE(key_id, 0);
+  const auto [begin, end] = image_.GetTokenRange(key_id);
+  ASSERT_EQ(end - begin, 2);
+  UserPos::Token token;
+  image_.GetToken(begin + 1, &token);
+  EXPECT_EQ(token.value, "START");
+  EXPECT_EQ(token.id, 11);
+  EXPECT_EQ(token.comment, "comment");
+  EXPECT_EQ(image_.GetEntry(image_.GetEntryIndex(begin)).entry_id, 100);
+}
+
+TEST_F(UserDictionaryImageTest, PredictiveSearch) {
+  std::vector<std::string> result;
+  image_.PredictiveSearch("star", [&](absl::string_view key, int key_id) {
+    for (std::string &token : GetTokens(key, key_id)) {
+      result.push_back(std::move(token));
+    }
+    return true;
+  });
+  std::sort(result.begin(), result.end());
+  EXPECT_EQ(result, (std::vector<std::string>{"star:star", "start:START",
+                                              "start:start",
+                                              "starting:starting"}));
+
+  // All the keys are enumerated for the empty prefix.
+  int num_keys = 0;
+  image_.PredictiveSearch("", [&num_keys](absl::string_view, int) {
+    ++num_keys;
+    return true;
+  });
+  EXPECT_EQ(num_keys, 3);
+
+  // Stops when the functor returns false.
+  num_keys = 0;
+  image_.PredictiveSearch("s", [&num_keys](absl::string_view, int) {
+    ++num_keys;
+    return false;
+  });
+  EXPECT_EQ(num_keys, 1);
+
+  image_.PredictiveSearch("x", [](absl::string_view, int) {
+    ADD_FAILURE() << "Unexpected key";
+    return true;
+  });
+}
+
+TEST_F(UserDictionaryImageTest, Entries) {
+  ASSERT_EQ(image_.entries_size(), 3);
+  const int index = image_.FindEntry(200);
+  ASSERT_GE(index, 0);
+  const UserDictionaryImage::Entry entry = image_.GetEntry(index);
+  EXPECT_EQ(entry.word_id, 2000);
+  EXPECT_EQ(entry.count, 2);
+  EXPECT_EQ(entry.word_count, 3);
+  EXPECT_EQ(image_.GetEntry(image_.FindEntry(100)).word_count, 1);
+  EXPECT_EQ(image_.FindEntry(150), -1);
+
+  EXPECT_TRUE(image_.HasWord(1000));
+  EXPECT_TRUE(image_.HasWord(2000));
+  EXPECT_FALSE(image_.HasWord(3000));
+
+  ASSERT_EQ(image_.suppression_entries_size(), 1);
+  EXPECT_EQ(image_.GetSuppressionEntry(0),
+            std::make_pair(absl::string_view("stamp"),
+                           absl::string_view("stamp")));
+}
+
+TEST(UserDictionaryImageOpenTest, BrokenImage) {
+  UserDictionaryImage image;
+  EXPECT_FALSE(image.Open(""));
+  EXPECT_FALSE(image.Open("broken user dictionary image"));
+
+  UserDictionaryImageBuilder builder;
+  std::string data = builder.Build(0);
+  EXPECT_TRUE(image.Open(data));
+  EXPECT_EQ(image.tokens_size(), 0);
+  data.pop_back();
+  EXPECT_FALSE(image.Open(data));
+}
+
+TEST_F(UserDictionaryImageTest, BrokenIndex) {
+  constexpr absl::string_view kMagic = "\xEFMOZC_USER_DIC\r\n";
+  DataSetReader reader;
+  ASSERT_TRUE(reader.Init(data_, kMagic));
+  const size_t token_index = reader.GetOffsetAndSize("token_index")->first;
+  const size_t tokens = reader.GetOffsetAndSize("tokens")->first;
+
+  // Returns true if the image is opened after |value| is written at |offset|.
+  const auto open_modified = [this](size_t offset, uint32_t value) {
+    std::string data = data_;
+    StoreUnaligned<uint32_t>(value, data.data() + offset);
+    UserDictionaryImage image;
+    return image.Open(data);
+  };
+  EXPECT_TRUE(open_modified(tokens + 4, 0));
+  // Decreasing token index.
+  EXPECT_FALSE(open_modified(token_index + sizeof(uint32_t), 4));
+  // Value, comment and entry indices out of range.
+  EXPECT_FALSE(open_modified(tokens + 4, 100));
+  EXPECT_FALSE(open_modified(tokens + 8, 100));
+  EXPECT_FALSE(open_modified(tokens + 12, 3));
+}
+
+TEST_F(UserDictionaryImageTest, ReadSourceFingerprint) {
+  uint64_t source_fingerprint = 0;
+  EXPECT_TRUE(
+      UserDictionaryImage::ReadSourceFingerprint(data_, &source_fingerprint));
+  EXPECT_EQ(source_fingerprint, 12345);
+  EXPECT_FALSE(UserDictionaryImage::ReadSourceFingerprint(
+      "broken user dictionary image", &source_fingerprint));
+}
+
+}  // namespace
+}  // namespace dictionary
+}  // namespace mozc
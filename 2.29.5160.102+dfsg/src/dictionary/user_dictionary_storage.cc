@@ -132,6 +132,31 @@ absl::Status UserDictionaryStorage::Load() {
     last_error_type_ = UNKNOWN_ERROR;
   }
 
+  AssignDictionaryIds();
+  return status;
+}
+
+absl::Status UserDictionaryStorage::LoadFromString(
+    absl::string_view contents) {
+  last_error_type_ = USER_DICTIONARY_STORAGE_NO_ERROR;
+
+  absl::Status status;
+  mozc::protobuf::io::ArrayInputStream zero_copy_input(
+      contents.data(), static_cast<int>(contents.size()));
+  mozc::protobuf::io::CodedInputStream decoder(&zero_copy_input);
+  decoder.SetTotalBytesLimit(kDefaultTotalBytesLimit);
+  if (!proto_.ParseFromCodedStream(&decoder) ||
+      !decoder.ConsumedEntireMessage()) {
+    last_error_type_ = BROKEN_FILE;
+    status =
+        absl::UnknownError("ParseFromCodedStream failed. File seems broken");
+  }
+
+  AssignDictionaryIds();
+  return status;
+}
+
+void UserDictionaryStorage::AssignDictionaryIds() {
   // Check dictionary id here. if id is 0, assign random ID.
   for (int i = 0; i < proto_.dictionaries_size(); ++i) {
     const UserDictionary &dict = proto_.dictionaries(i);
@@ -140,8 +165,6 @@ absl::Status UserDictionaryStorage::Load() {
           UserDictionaryUtil::CreateNewDictionaryId(proto_));
     }
   }
-
-  return status;
 }
 
 absl::Status UserDictionaryStorage::Save() {
@@ -115,6 +115,10 @@ class UserDictionaryStorage {
   //       is kept as is.
   absl::Status Load();
 
+  // Loads a user dictionary from |contents| read from the file.  Used when the
+  // caller needs to know the exact data from which the dictionary is loaded.
+  absl::Status LoadFromString(absl::string_view contents);
+
   // Serialize user dictionary to local file.
   // Need to call Lock() the dictionary before calling Save().
   absl::Status Save();
@@ -196,6 +200,9 @@ class UserDictionaryStorage {
   // Load the data from file_name actually.
   absl::Status LoadInternal();
 
+  // Assigns a random ID to the dictionaries whose ID is 0.
+  void AssignDictionaryIds();
+
   user_dictionary::UserDictionaryStorage proto_;
   std::string file_name_;
   bool locked_ = false;
@@ -274,6 +274,27 @@ TEST_F(UserDictionaryStorageTest, SerializeTest) {
   }
 }
 
+TEST_F(UserDictionaryStorageTest, LoadFromString) {
+  UserDictionaryStorage storage1(GetUserDictionaryFile());
+  uint64_t id = 0;
+  ASSERT_TRUE(storage1.CreateDictionary("test", &id));
+  UserDictionaryStorage::UserDictionaryEntry *entry =
+      storage1.GetProto().mutable_dictionaries(0)->add_entries();
+  entry->set_key("key");
+  entry->set_value("value");
+  entry->set_pos(UserDictionary::NOUN);
+  const std::string contents = storage1.GetProto().SerializeAsString();
+
+  // The file is not read.
+  UserDictionaryStorage storage2(GetUserDictionaryFile());
+  EXPECT_OK(storage2.LoadFromString(contents));
+  EXPECT_EQ(storage2.GetProto().DebugString(),
+            storage1.GetProto().DebugString());
+
+  EXPECT_FALSE(storage2.LoadFromString("broken").ok());
+  EXPECT_EQ(storage2.GetLastError(), UserDictionaryStorage::BROKEN_FILE);
+}
+
 TEST_F(UserDictionaryStorageTest, GetUserDictionaryIdTest) {
   UserDictionaryStorage storage(GetUserDictionaryFile());
   EXPECT_FALSE(storage.Load().ok());
@@ -30,8 +30,10 @@
 #include "dictionary/user_dictionary.h"
 
 #include <algorithm>
+#include <chrono>  // NOLINT
 #include <cstdint>
 #include <cstring>
+#include <filesystem>
 #include <iterator>
 #include <memory>
 #include <random>
@@ -63,7 +65,9 @@
 #include "usage_stats/usage_stats.h"
 #include "usage_stats/usage_stats_testing_util.h"
 #include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 
@@ -176,6 +180,8 @@ class UserPosMock : public UserPosInterface {
   bool GetPosIds(absl::string_view pos, uint16_t *id) const override {
     return false;
   }
+
+  uint64_t GetFingerprint() const override { return 0; }
 };
 
 class UserDictionaryTest : public ::testing::Test {
@@ -903,6 +909,167 @@ TEST_F(UserDictionaryTest, LookupComment) {
   EXPECT_TRUE(LookupComment(*dic, "mismatching_key", "comment_value4").empty());
 }
 
+TEST_F(UserDictionaryTest, IncrementalLoad) {
+  std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  // Wait for async reload called from the constructor.
+  dic->WaitForReloader();
+
+  // Adds enough entries so that a few edits are applied incrementally.
+  std::string contents = kUserDictionary0;
+  for (int i = 0; i < 100; ++i) {
+    absl::StrAppend(&contents, "filler", i, "\tfiller\tnoun\n");
+  }
+  {
+    UserDictionaryStorage storage("");
+    LoadFromString(contents, &storage);
+    dic->Load(storage.GetProto());
+  }
+
+  // Adds, removes and edits a few entries.
+  contents = absl::StrReplaceAll(
+      contents, {{"smog\tsmog\tnoun\n", ""},
+                 {"comment_key2\tcomment_value2\tnoun\tcomment\n",
+                  "comment_key2\tcomment_value2\tnoun\tedited\n"}});
+  absl::StrAppend(&contents, "starter\tstarter\tverb\n");
+  UserDictionaryStorage storage("");
+  LoadFromString(contents, &storage);
+  UserDictionaryStorage::UserDictionaryEntry *entry =
+      storage.GetProto().mutable_dictionaries(0)->add_entries();
+  entry->set_key("stamp");
+  entry->set_value("stamp");
+  entry->set_pos(user_dictionary::UserDictionary::SUPPRESSION_WORD);
+  dic->Load(storage.GetProto());
+
+  // The result should be the same as the one loaded from scratch.
+  std::unique_ptr<UserDictionary> expected(CreateDictionaryWithMockPos());
+  expected->WaitForReloader();
+  expected->Load(storage.GetProto());
+
+  auto lookup = [this](const UserDictionary &dic, absl::string_view key,
+                       bool predictive) {
+    EntryCollector collector;
+    if (predictive) {
+      dic.LookupPredictive(key, convreq_, &collector);
+    } else {
+      dic.LookupPrefix(key, convreq_, &collector);
+    }
+    std::vector<std::string> result;
+    for (const Entry &entry : collector.entries()) {
+      result.push_back(
+          absl::StrCat(entry.key, "\t", entry.value, "\t", entry.lid));
+    }
+    return result;
+  };
+  for (const absl::string_view key : {"s", "c", "f", "水"}) {
+    EXPECT_EQ(lookup(*dic, key, true), lookup(*expected, key, true)) << key;
+  }
+  EXPECT_EQ(lookup(*dic, "startered", false),
+            lookup(*expected, "startered", false));
+  EXPECT_TRUE(lookup(*dic, "smog", false).empty());
+  EXPECT_EQ(lookup(*dic, "starter", false).size(), 3);
+
+  EXPECT_EQ(LookupComment(*dic, "comment_key2", "comment_value2"), "edited");
+  EXPECT_TRUE(suppression_dictionary_->SuppressEntry("stamp", "stamp"));
+}
+
+TEST_F(UserDictionaryTest, LoadFromCompiledImage) {
+  const std::string filename0 = FileUtil::JoinPath(
+      absl::GetFlag(FLAGS_test_tmpdir), "compiled_image_test0.db");
+  const std::string filename1 = FileUtil::JoinPath(
+      absl::GetFlag(FLAGS_test_tmpdir), "compiled_image_test1.db");
+  for (const std::string &filename : {filename0, filename1}) {
+    ASSERT_OK(FileUtil::UnlinkIfExists(filename));
+    ASSERT_OK(FileUtil::UnlinkIfExists(absl::StrCat(filename, ".image")));
+  }
+
+  std::string contents = kUserDictionary0;
+  for (int i = 0; i < 100; ++i) {
+    absl::StrAppend(&contents, "filler", i, "\tfiller\tnoun\n");
+  }
+  UserDictionaryStorage storage0(filename0);
+  LoadFromString(contents, &storage0);
+  UserDictionaryStorage::UserDictionaryEntry *entry =
+      storage0.GetProto().mutable_dictionaries(0)->add_entries();
+  entry->set_key("stamp");
+  entry->set_value("stamp");
+  entry->set_pos(user_dictionary::UserDictionary::SUPPRESSION_WORD);
+  ASSERT_TRUE(storage0.Lock());
+  ASSERT_OK(storage0.Save());
+  ASSERT_TRUE(storage0.UnLock());
+
+  // A few entries are edited in the second file.
+  contents = absl::StrReplaceAll(
+      contents, {{"smog\tsmog\tnoun\n", ""},
+                 {"comment_key2\tcomment_value2\tnoun\tcomment\n",
+                  "comment_key2\tcomment_value2\tnoun\tedited\n"}});
+  absl::StrAppend(&contents, "starter\tstarter\tverb\n");
+  UserDictionaryStorage storage1(filename1);
+  LoadFromString(contents, &storage1);
+  ASSERT_TRUE(storage1.Lock());
+  ASSERT_OK(storage1.Save());
+  ASSERT_TRUE(storage1.UnLock());
+
+  auto lookup = [this](const UserDictionary &dic, absl::string_view key) {
+    EntryCollector collector;
+    dic.LookupPredictive(key, convreq_, &collector);
+    std::vector<std::string> result;
+    for (const Entry &entry : collector.entries()) {
+      result.push_back(
+          absl::StrCat(entry.key, "\t", entry.value, "\t", entry.lid));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  auto expect_same = [&](const UserDictionary &dic,
+                         const UserDictionaryStorage &storage) {
+    std::unique_ptr<UserDictionary> expected(CreateDictionaryWithMockPos());
+    expected->WaitForReloader();
+    expected->Load(storage.GetProto());
+    for (const absl::string_view key : {"s", "c", "f", "水"}) {
+      EXPECT_EQ(lookup(dic, key), lookup(*expected, key)) << key;
+    }
+  };
+
+  // The image is compiled after the first load of the file.
+  UserDictionary::SetUserDictionaryName(filename0);
+  {
+    std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+    dic->WaitForReloader();
+  }
+  EXPECT_OK(FileUtil::FileExists(absl::StrCat(filename0, ".image")));
+
+  // The next load is served from the image.
+  std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+  EXPECT_TRUE(suppression_dictionary_->SuppressEntry("stamp", "stamp"));
+  EXPECT_EQ(LookupComment(*dic, "comment_key2", "comment_value2"), "comment");
+  expect_same(*dic, storage0);
+
+  // The edits are applied on top of the image, and a new image is compiled.
+  // The modification time is changed so that the reloader doesn't skip it.
+  std::filesystem::last_write_time(
+      filename1,
+      std::filesystem::last_write_time(filename0) + std::chrono::seconds(10));
+  UserDictionary::SetUserDictionaryName(filename1);
+  dic->Reload();
+  dic->WaitForReloader();
+  EXPECT_FALSE(suppression_dictionary_->SuppressEntry("stamp", "stamp"));
+  EXPECT_EQ(LookupComment(*dic, "comment_key2", "comment_value2"), "edited");
+  expect_same(*dic, storage1);
+  EXPECT_OK(FileUtil::FileExists(absl::StrCat(filename1, ".image")));
+
+  // The next load is served from the new image.
+  dic.reset(CreateDictionaryWithMockPos());
+  dic->WaitForReloader();
+  expect_same(*dic, storage1);
+  EXPECT_EQ(LookupComment(*dic, "comment_key2", "comment_value2"), "edited");
+
+  for (const std::string &filename : {filename0, filename1}) {
+    EXPECT_OK(FileUtil::UnlinkIfExists(filename));
+    EXPECT_OK(FileUtil::UnlinkIfExists(absl::StrCat(filename, ".image")));
+  }
+}
+
 TEST_F(UserDictionaryTest, TestPopulateTokenFromUserPosToken) {
   std::unique_ptr<UserDictionary> dic(CreateDictionaryWithMockPos());
   dic->WaitForReloader();
@@ -38,6 +38,7 @@
 #include <vector>
 
 #include "base/container/serialized_string_array.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/strings/assign.h"
 #include "data_manager/data_manager_interface.h"
@@ -92,6 +93,11 @@ bool UserPos::GetPosIds(absl::string_view pos, uint16_t *id) const {
   return true;
 }
 
+uint64_t UserPos::GetFingerprint() const {
+  return Hash::FingerprintWithSeed(
+      token_array_data_, Hash::Fingerprint32(string_array_.data()));
+}
+
 bool UserPos::GetTokens(absl::string_view key, absl::string_view value,
                         absl::string_view pos, absl::string_view locale,
                         std::vector<Token> *tokens) const {
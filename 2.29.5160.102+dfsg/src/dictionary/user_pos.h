@@ -188,6 +188,7 @@ class UserPos : public UserPosInterface {
   void GetPosList(std::vector<std::string> *pos_list) const override;
   bool IsValidPos(absl::string_view pos) const override;
   bool GetPosIds(absl::string_view pos, uint16_t *id) const override;
+  uint64_t GetFingerprint() const override;
   bool GetTokens(absl::string_view key, absl::string_view value,
                  absl::string_view pos, absl::string_view locale,
                  std::vector<Token> *tokens) const override;
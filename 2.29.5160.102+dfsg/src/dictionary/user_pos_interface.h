@@ -97,6 +97,10 @@ class UserPosInterface : public PosListProviderInterface {
   // returns the ids of base form.
   virtual bool GetPosIds(absl::string_view pos, uint16_t *id) const = 0;
 
+  // Returns the fingerprint of the POS data, which changes when the POS list,
+  // the conjugation forms or their ids change.
+  virtual uint64_t GetFingerprint() const = 0;
+
   // Converts the given tuple (key, value, pos, locale) to Token.  If the pos
   // has inflection, this function expands possible inflections automatically.
   virtual bool GetTokens(absl::string_view key, absl::string_view value,
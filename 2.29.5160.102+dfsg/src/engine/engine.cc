@@ -36,6 +36,7 @@
 #include <utility>
 
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "converter/connector.h"
 #include "converter/converter.h"
 #include "converter/immutable_converter.h"
@@ -93,6 +94,7 @@ class UserDataManagerImpl final : public UserDataManagerInterface {
   bool ClearUserPredictionEntry(absl::string_view key,
                                 absl::string_view value) override;
   bool Wait() override;
+  void StopSaving() override;
 
  private:
   PredictorInterface *predictor_;
@@ -133,6 +135,10 @@ bool UserDataManagerImpl::ClearUserPredictionEntry(
 
 bool UserDataManagerImpl::Wait() { return predictor_->Wait(); }
 
+// The rewriters write their learning to the mapped storage files directly, so
+// only the predictor holds the user data to be saved.
+void UserDataManagerImpl::StopSaving() { predictor_->StopSaving(); }
+
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<Engine>> Engine::CreateDesktopEngine(
@@ -318,4 +324,25 @@ bool Engine::ReloadAndWait() {
   return GetUserDataManager()->Wait();
 }
 
+void Engine::GetMemoryStats(MemoryStats *stats) const {
+  {
+    MemoryStats::Scope scope(stats, "data_set");
+    data_manager_->GetMemoryStats(stats);
+  }
+  {
+    MemoryStats::Scope scope(stats, "connector");
+    connector_.GetMemoryStats(stats);
+  }
+  {
+    MemoryStats::Scope scope(stats, "dictionary");
+    dictionary_->GetMemoryStats(stats);
+  }
+  {
+    MemoryStats::Scope scope(stats, "user_dictionary");
+    user_dictionary_->GetMemoryStats(stats);
+  }
+  // Adds "predictor/..." and "rewriter/...".
+  converter_->GetMemoryStats(stats);
+}
+
 }  // namespace mozc
@@ -120,6 +120,8 @@ class Engine : public EngineInterface {
     return user_dictionary_->GetPosList();
   }
 
+  void GetMemoryStats(MemoryStats *stats) const override;
+
  private:
   // Initializes the object by the given data manager and is_mobile flag.
   // The is_mobile flag is used to select DefaultPredictor and MobilePredictor.
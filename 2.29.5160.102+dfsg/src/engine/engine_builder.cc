@@ -39,7 +39,7 @@
 #include "base/file_util.h"
 #include "base/hash.h"
 #include "base/logging.h"
-#include "base/thread2.h"
+#include "base/thread_pool.h"
 #include "data_manager/data_manager.h"
 #include "engine/engine.h"
 #include "engine/engine_interface.h"
@@ -99,7 +99,7 @@ void EngineBuilder::PrepareAsync(const EngineReloadRequest &request,
     VLOG(1) << "Previously loaded data is discarded";
   }
 
-  prepare_.emplace([request]() -> Prepared {
+  auto prepare = [request]() -> Prepared {
     EngineReloadResponse response;
     *response.mutable_request() = request;
 
@@ -135,9 +135,16 @@ void EngineBuilder::PrepareAsync(const EngineReloadRequest &request,
       }
     }
 
+    // Pages the data in here rather than on the first key strokes with the
+    // new engine.
+    data_manager->Prefault();
     response.set_status(EngineReloadResponse::RELOAD_READY);
     return {std::move(response), std::move(data_manager)};
-  });
+  };
+  // Loading a data set is what the user is waiting for, so it takes priority
+  // over the other background jobs.
+  prepare_.emplace(ThreadPool::GetDefaultThreadPool()->Schedule(
+      ThreadPool::HIGH, std::move(prepare)));
   response->set_status(EngineReloadResponse::ACCEPTED);
 }
 
@@ -155,17 +162,19 @@ void EngineBuilder::GetResponse(EngineReloadResponse *response) const {
   if (!HasResponse()) {
     return;
   }
-  *response = prepare_->Get().response;
+  *response = prepare_->Get()->response;
 }
 
 std::unique_ptr<EngineInterface> EngineBuilder::BuildFromPreparedData() {
-  if (!HasResponse() || prepare_->Get().data_manager == nullptr ||
-      prepare_->Get().response.status() != EngineReloadResponse::RELOAD_READY) {
+  if (!HasResponse() || prepare_->Get()->data_manager == nullptr ||
+      prepare_->Get()->response.status() !=
+          EngineReloadResponse::RELOAD_READY) {
     LOG(ERROR) << "Build() is called in invalid state";
     return nullptr;
   }
   // operator-> doesn't support rvalue delegation :/
-  Prepared prepared = (*std::move(prepare_)).Get();
+  // The task is never cancelled, so the result is always available.
+  Prepared prepared = *(*std::move(prepare_)).Get();
   prepare_.reset();
 
   absl::StatusOr<std::unique_ptr<Engine>> engine;
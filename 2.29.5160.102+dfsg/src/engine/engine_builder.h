@@ -35,7 +35,7 @@
 #include <memory>
 #include <optional>
 
-#include "base/thread2.h"
+#include "base/thread_pool.h"
 #include "data_manager/data_manager.h"
 #include "engine/engine_builder_interface.h"
 #include "engine/engine_interface.h"
@@ -69,7 +69,7 @@ class EngineBuilder : public EngineBuilderInterface {
     EngineReloadResponse response;
     std::unique_ptr<DataManager> data_manager;
   };
-  std::optional<BackgroundFuture<Prepared>> prepare_;
+  std::optional<TaskFuture<Prepared>> prepare_;
 };
 
 }  // namespace mozc
@@ -33,6 +33,7 @@
 #include <string>
 #include <vector>
 
+#include "base/memory_stats.h"
 #include "converter/converter_interface.h"
 #include "data_manager/data_manager_interface.h"
 #include "dictionary/suppression_dictionary.h"
@@ -83,6 +84,9 @@ class EngineInterface {
   // Gets the user POS list.
   virtual std::vector<std::string> GetPosList() const = 0;
 
+  // Adds the approximate memory held by the engine to |stats|.
+  virtual void GetMemoryStats(MemoryStats *stats) const {}
+
  protected:
   EngineInterface() = default;
 };
@@ -64,6 +64,7 @@ class UserDataManagerStub : public UserDataManagerInterface {
     return true;
   }
   bool Wait() override { return true; }
+  void StopSaving() override {}
 };
 
 bool AddAsIsCandidate(const absl::string_view key, Segments *segments) {
@@ -117,6 +118,12 @@ class MinimalConverter : public ConverterInterface {
     return false;
   }
 
+  bool StartReverseConversionForRequest(
+      const ConversionRequest &request, Segments *segments,
+      const absl::string_view key) const override {
+    return false;
+  }
+
   bool StartPredictionForRequest(const ConversionRequest &request,
                                  Segments *segments) const override {
     return AddAsIsCandidate(request, segments);
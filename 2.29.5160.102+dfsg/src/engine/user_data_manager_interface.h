@@ -63,6 +63,10 @@ class UserDataManagerInterface {
 
   // Waits for syncer thread to complete.
   virtual bool Wait() = 0;
+
+  // Stops writing the user data held in memory to local file system, e.g.,
+  // when another engine takes over the files.
+  virtual void StopSaving() = 0;
 };
 
 }  // namespace mozc
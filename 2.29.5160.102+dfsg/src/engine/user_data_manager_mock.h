@@ -49,6 +49,7 @@ class MockUserDataManager : public UserDataManagerInterface {
   MOCK_METHOD(bool, ClearUserPredictionEntry,
               (absl::string_view key, absl::string_view value), (override));
   MOCK_METHOD(bool, Wait, (), (override));
+  MOCK_METHOD(void, StopSaving, (), (override));
 };
 
 }  // namespace mozc
@@ -42,6 +42,7 @@
         'mach_ipc.cc',
         'named_event.cc',
         'process_watch_dog.cc',
+        'shm_ipc.cc',
         'unix_ipc.cc',
         'win32_ipc.cc',
       ],
@@ -130,6 +131,7 @@
         'ipc_test.cc',
         'named_event_test.cc',
         'process_watch_dog_test.cc',
+        'shm_ipc_test.cc',
       ],
       'dependencies': [
         '../base/absl.gyp:absl_base',
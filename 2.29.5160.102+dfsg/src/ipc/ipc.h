@@ -30,11 +30,14 @@
 #ifndef MOZC_IPC_IPC_H_
 #define MOZC_IPC_IPC_H_
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 
 #ifdef __APPLE__
@@ -146,6 +149,18 @@ class IPCClient : public IPCClientInterface {
 
   IPCErrorType GetLastIPCError() const override { return last_ipc_error_; }
 
+#if defined(__linux__) && !defined(__ANDROID__)
+  // Same as Call(), but also receives a file descriptor passed by the server
+  // with SCM_RIGHTS and keeps the connection open afterwards, so that the
+  // server can tell when this client goes away. |fd| is set to -1 if no
+  // descriptor is passed. Used to negotiate the transport in ipc/shm_ipc.h.
+  bool CallWithFileDescriptor(const std::string &request,
+                              std::string *response, int *fd,
+                              absl::Duration timeout);
+
+  int socket() const { return socket_; }
+#endif  // __linux__ && !__ANDROID__
+
   // terminate the server process named |name|
   // Do not use it unless version mismatch happens
   static bool TerminateServer(absl::string_view name);
@@ -269,8 +284,22 @@ class IPCServer {
   std::string name_;
   MachPortManagerInterface *mach_port_manager_;
 #else   // _WIN32
+  // Serves a client that has switched to the shared-memory transport.
+  class SharedMemoryChannel;
+
+  // Hands |socket| over to a new SharedMemoryChannel. Takes the ownership of
+  // |socket|.
+  void StartSharedMemoryChannel(int socket);
+
+  // Makes Loop() return as if Process() returned false there.
+  void RequestQuit();
+
   int socket_;
   std::string server_address_;
+  std::atomic<bool> quit_requested_;
+  // Process() is called from the channel threads as well as from Loop().
+  absl::Mutex process_mutex_;
+  std::vector<std::unique_ptr<SharedMemoryChannel>> shm_channels_;
 #endif  // _WIN32
 
   absl::Duration timeout_;
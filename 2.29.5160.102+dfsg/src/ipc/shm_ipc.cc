@@ -0,0 +1,453 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "ipc/shm_ipc.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/singleton.h"
+#include "ipc/ipc.h"
+#include "ipc/ipc_path_manager.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#endif  // __linux__ && !__ANDROID__
+
+namespace mozc {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+namespace {
+
+// The message follows the header at the next cache line.
+constexpr size_t kHeaderSize = 64;
+constexpr size_t kInitialBufferSize = IPC_INITIAL_READ_BUFFER_SIZE;
+constexpr size_t kMaxBufferSize = 64 * 1024 * 1024;
+
+// How often a waiting side checks whether the peer is still there.
+constexpr absl::Duration kPeerCheckInterval = absl::Milliseconds(500);
+
+// Returns false if the wait timed out.
+bool FutexWait(std::atomic<uint32_t> *word, uint32_t value,
+               absl::Duration timeout) {
+  const timespec ts = absl::ToTimespec(timeout);
+  if (::syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT,
+                value, &ts, nullptr, 0) < 0) {
+    return errno != ETIMEDOUT;
+  }
+  return true;
+}
+
+void FutexWake(std::atomic<uint32_t> *word) {
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, 1,
+            nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+struct SharedMemoryBuffer::Header {
+  std::atomic<uint32_t> state;
+  // Size of the message that follows the header.
+  uint32_t size;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+// static
+std::unique_ptr<SharedMemoryBuffer> SharedMemoryBuffer::Create() {
+  static_assert(sizeof(Header) <= kHeaderSize);
+  const int fd = ::memfd_create("mozc_ipc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) {
+    LOG(ERROR) << "memfd_create failed: " << strerror(errno);
+    return nullptr;
+  }
+  if (::ftruncate(fd, kInitialBufferSize) != 0 ||
+      ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) != 0) {
+    LOG(ERROR) << "cannot prepare memfd: " << strerror(errno);
+    ::close(fd);
+    return nullptr;
+  }
+  // A fresh memfd is zero-filled, so the state starts with kIdle.
+  return Map(fd);
+}
+
+// static
+std::unique_ptr<SharedMemoryBuffer> SharedMemoryBuffer::Map(int fd) {
+  // Without the seal the peer could shrink the file under our mapping.
+  const int seals = ::fcntl(fd, F_GET_SEALS);
+  struct stat st;
+  if (seals < 0 || !(seals & F_SEAL_SHRINK) || ::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < kHeaderSize) {
+    LOG(ERROR) << "invalid shared memory";
+    ::close(fd);
+    return nullptr;
+  }
+  void *data = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "mmap failed: " << strerror(errno);
+    ::close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<SharedMemoryBuffer>(
+      new SharedMemoryBuffer(fd, static_cast<char *>(data), st.st_size));
+}
+
+// static
+bool SharedMemoryBuffer::IsPeerClosed(int socket) {
+  pollfd pfd = {socket, 0, 0};
+  // POLLHUP is reported only when both directions are shut down, i.e. when
+  // the peer has closed the socket rather than just half-closed it.
+  return ::poll(&pfd, 1, 0) != 0 && (pfd.revents & (POLLHUP | POLLERR));
+}
+
+SharedMemoryBuffer::~SharedMemoryBuffer() {
+  ::munmap(data_, mapped_size_);
+  ::close(fd_);
+}
+
+bool SharedMemoryBuffer::Remap(size_t size) {
+  void *data = ::mremap(data_, mapped_size_, size, MREMAP_MAYMOVE);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "mremap failed: " << strerror(errno);
+    return false;
+  }
+  data_ = static_cast<char *>(data);
+  mapped_size_ = size;
+  return true;
+}
+
+bool SharedMemoryBuffer::Post(State state, absl::string_view message) {
+  const size_t required = kHeaderSize + message.size();
+  if (required > mapped_size_) {
+    if (required > kMaxBufferSize) {
+      LOG(ERROR) << "message is too large: " << message.size();
+      return false;
+    }
+    const size_t size = std::min(
+        kMaxBufferSize, std::max(required, mapped_size_ * 2));
+    if (::ftruncate(fd_, size) != 0) {
+      LOG(ERROR) << "ftruncate failed: " << strerror(errno);
+      return false;
+    }
+    if (!Remap(size)) {
+      return false;
+    }
+  }
+
+  Header *h = header();
+  uint32_t current = h->state.load(std::memory_order_relaxed);
+  if (current == kClosed) {
+    return false;
+  }
+  h->size = message.size();
+  std::memcpy(data_ + kHeaderSize, message.data(), message.size());
+  // Never overwrite kClosed set by the other side in the meantime.
+  while (!h->state.compare_exchange_weak(current, state,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+    if (current == kClosed) {
+      return false;
+    }
+  }
+  FutexWake(&h->state);
+  return true;
+}
+
+IPCErrorType SharedMemoryBuffer::Wait(State state, absl::Time deadline,
+                                      int peer_socket) {
+  std::atomic<uint32_t> *word = &header()->state;
+  while (true) {
+    const uint32_t current = word->load(std::memory_order_acquire);
+    if (current == state) {
+      return IPC_NO_ERROR;
+    }
+    if (current == kClosed) {
+      return IPC_READ_ERROR;
+    }
+    const absl::Duration remaining = deadline - absl::Now();
+    if (remaining <= absl::ZeroDuration()) {
+      return IPC_TIMEOUT_ERROR;
+    }
+    // Only check the socket after a quiet interval so that the usual round
+    // trip costs no more than the futex calls.
+    if (!FutexWait(word, current, std::min(remaining, kPeerCheckInterval)) &&
+        IsPeerClosed(peer_socket)) {
+      return IPC_READ_ERROR;
+    }
+  }
+}
+
+bool SharedMemoryBuffer::Read(absl::string_view *message) {
+  const size_t size = header()->size;
+  const size_t required = kHeaderSize + size;
+  if (required > mapped_size_) {
+    // The peer has grown the buffer for a large message.
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < required || !Remap(st.st_size)) {
+      LOG(ERROR) << "invalid message size: " << size;
+      return false;
+    }
+  }
+  *message = absl::string_view(data_ + kHeaderSize, size);
+  return true;
+}
+
+void SharedMemoryBuffer::Close() {
+  header()->state.store(kClosed, std::memory_order_release);
+  FutexWake(&header()->state);
+}
+
+// A negotiated shared-memory channel. |connection| keeps the socket open so
+// that the server can tell when the channel is abandoned.
+class SharedMemoryIPCClientFactory::Channel {
+ public:
+  Channel(std::string name, std::string path_name,
+          std::unique_ptr<IPCClient> connection,
+          std::unique_ptr<SharedMemoryBuffer> buffer)
+      : name_(std::move(name)),
+        path_name_(std::move(path_name)),
+        connection_(std::move(connection)),
+        buffer_(std::move(buffer)),
+        broken_(false) {}
+
+  ~Channel() { buffer_->Close(); }
+
+  bool Matches(absl::string_view name, absl::string_view path_name) const {
+    return name_ == name && path_name_ == path_name;
+  }
+
+  bool IsAlive() const {
+    return !broken_ && !SharedMemoryBuffer::IsPeerClosed(connection_->socket());
+  }
+
+  const IPCClient &connection() const { return *connection_; }
+
+  IPCErrorType Call(const std::string &request, std::string *response,
+                    absl::Duration timeout) {
+    const absl::Time deadline = timeout < absl::ZeroDuration()
+                                    ? absl::InfiniteFuture()
+                                    : absl::Now() + timeout;
+    if (!buffer_->Post(SharedMemoryBuffer::kRequest, request)) {
+      broken_ = true;
+      return IPC_WRITE_ERROR;
+    }
+    // A late response would confuse the next call, so the channel is given
+    // up on any error including timeout.
+    const IPCErrorType error = buffer_->Wait(SharedMemoryBuffer::kResponse,
+                                             deadline, connection_->socket());
+    if (error != IPC_NO_ERROR) {
+      broken_ = true;
+      return error;
+    }
+    absl::string_view message;
+    if (!buffer_->Read(&message)) {
+      broken_ = true;
+      return IPC_READ_ERROR;
+    }
+    response->assign(message.data(), message.size());
+    return IPC_NO_ERROR;
+  }
+
+ private:
+  const std::string name_;
+  const std::string path_name_;
+  std::unique_ptr<IPCClient> connection_;
+  std::unique_ptr<SharedMemoryBuffer> buffer_;
+  bool broken_;
+};
+
+// Borrows a channel from the factory and returns it on destruction.
+class SharedMemoryIPCClientFactory::Client : public IPCClientInterface {
+ public:
+  Client(SharedMemoryIPCClientFactory *factory,
+         std::unique_ptr<Channel> channel)
+      : factory_(factory),
+        channel_(std::move(channel)),
+        last_ipc_error_(IPC_NO_ERROR) {}
+
+  ~Client() override { factory_->ReleaseChannel(std::move(channel_)); }
+
+  bool Connected() const override { return true; }
+
+  bool Call(const std::string &request, std::string *response,
+            absl::Duration timeout) override {
+    last_ipc_error_ = channel_->Call(request, response, timeout);
+    if (last_ipc_error_ != IPC_NO_ERROR) {
+      LOG(ERROR) << "shared memory call failed: " << last_ipc_error_;
+      return false;
+    }
+    return true;
+  }
+
+  uint32_t GetServerProtocolVersion() const override {
+    return channel_->connection().GetServerProtocolVersion();
+  }
+
+  const std::string &GetServerProductVersion() const override {
+    return channel_->connection().GetServerProductVersion();
+  }
+
+  uint32_t GetServerProcessId() const override {
+    return channel_->connection().GetServerProcessId();
+  }
+
+  IPCErrorType GetLastIPCError() const override { return last_ipc_error_; }
+
+ private:
+  SharedMemoryIPCClientFactory *factory_;
+  std::unique_ptr<Channel> channel_;
+  IPCErrorType last_ipc_error_;
+};
+
+std::unique_ptr<IPCClientInterface> SharedMemoryIPCClientFactory::NewClient(
+    const std::string &name, const std::string &path_name) {
+  std::unique_ptr<Channel> channel = AcquireChannel(name, path_name);
+  if (channel == nullptr) {
+    return std::make_unique<IPCClient>(name, path_name);
+  }
+  return std::make_unique<Client>(this, std::move(channel));
+}
+
+std::unique_ptr<SharedMemoryIPCClientFactory::Channel>
+SharedMemoryIPCClientFactory::AcquireChannel(const std::string &name,
+                                             const std::string &path_name) {
+  {
+    absl::MutexLock l(&mutex_);
+    while (!idle_channels_.empty()) {
+      auto it = std::find_if(idle_channels_.begin(), idle_channels_.end(),
+                             [&](const std::unique_ptr<Channel> &channel) {
+                               return channel->Matches(name, path_name);
+                             });
+      if (it == idle_channels_.end()) {
+        break;
+      }
+      std::unique_ptr<Channel> channel = std::move(*it);
+      idle_channels_.erase(it);
+      // The server may have restarted since the channel was released.
+      if (channel->IsAlive()) {
+        return channel;
+      }
+    }
+  }
+
+  IPCPathManager *manager = IPCPathManager::GetIPCPathManager(name);
+  if (const uint32_t server_pid =
+          manager == nullptr ? 0 : manager->GetServerProcessId();
+      server_pid != 0) {
+    absl::MutexLock l(&mutex_);
+    if (server_pid == unsupported_server_pid_) {
+      return nullptr;
+    }
+  }
+
+  auto connection = std::make_unique<IPCClient>(name, path_name);
+  if (!connection->Connected()) {
+    return nullptr;
+  }
+  std::string ack;
+  int fd = -1;
+  if (!connection->CallWithFileDescriptor(std::string(kSharedMemoryHandshake),
+                                          &ack, &fd, absl::Seconds(1))) {
+    return nullptr;
+  }
+  if (fd < 0) {
+    LOG(WARNING) << "The server does not support shared memory IPC";
+    const uint32_t server_pid = connection->GetServerProcessId();
+    absl::MutexLock l(&mutex_);
+    unsupported_server_pid_ = server_pid;
+    return nullptr;
+  }
+  std::unique_ptr<SharedMemoryBuffer> buffer = SharedMemoryBuffer::Map(fd);
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  return std::make_unique<Channel>(name, path_name, std::move(connection),
+                                   std::move(buffer));
+}
+
+void SharedMemoryIPCClientFactory::ReleaseChannel(
+    std::unique_ptr<Channel> channel) {
+  if (channel == nullptr || !channel->IsAlive()) {
+    return;
+  }
+  absl::MutexLock l(&mutex_);
+  idle_channels_.push_back(std::move(channel));
+}
+
+#else  // __linux__ && !__ANDROID__
+
+class SharedMemoryIPCClientFactory::Channel {};
+
+std::unique_ptr<IPCClientInterface> SharedMemoryIPCClientFactory::NewClient(
+    const std::string &name, const std::string &path_name) {
+  return std::make_unique<IPCClient>(name, path_name);
+}
+
+#endif  // __linux__ && !__ANDROID__
+
+SharedMemoryIPCClientFactory::SharedMemoryIPCClientFactory() = default;
+
+SharedMemoryIPCClientFactory::~SharedMemoryIPCClientFactory() = default;
+
+std::unique_ptr<IPCClientInterface> SharedMemoryIPCClientFactory::NewClient(
+    const std::string &name) {
+  return NewClient(name, "");
+}
+
+// static
+SharedMemoryIPCClientFactory *
+SharedMemoryIPCClientFactory::GetSharedMemoryIPCClientFactory() {
+  return Singleton<SharedMemoryIPCClientFactory>::get();
+}
+
+}  // namespace mozc
@@ -0,0 +1,176 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Shared-memory transport for same-user local IPC clients.
+//
+// A client first connects to the IPCServer over the regular socket and sends
+// kSharedMemoryHandshake. The server validates the peer as it does for any
+// other request, creates a memfd and passes it back with SCM_RIGHTS. From then
+// on requests and responses are exchanged through the mapped memory and the
+// two sides wake each other up with a futex on the state word. The socket is
+// kept open only so that each side can tell when the other goes away.
+//
+// The transport is available on Linux only. Elsewhere, and against servers
+// that do not understand the handshake, SharedMemoryIPCClientFactory falls
+// back to the regular IPCClient.
+
+#ifndef MOZC_IPC_SHM_IPC_H_
+#define MOZC_IPC_SHM_IPC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ipc/ipc.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+
+// Request sent over the socket to ask for a shared-memory channel. A
+// serialized protobuf never starts with a zero byte (field number 0 is
+// invalid), so it cannot be confused with a regular request.
+inline constexpr absl::string_view kSharedMemoryHandshake("\0mozc-shm-1", 11);
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+// A memfd mapped by both a client and the server. It holds one message at a
+// time: requests and responses strictly alternate, so a single slot is enough
+// and the state word doubles as the futex both sides sleep on. The memory
+// grows on demand for large messages; the memfd is sealed against shrinking so
+// that the peer can never make a mapped page disappear.
+class SharedMemoryBuffer {
+ public:
+  enum State : uint32_t {
+    kIdle = 0,
+    kRequest = 1,
+    kResponse = 2,
+    kClosed = 3,
+  };
+
+  SharedMemoryBuffer(const SharedMemoryBuffer &) = delete;
+  SharedMemoryBuffer &operator=(const SharedMemoryBuffer &) = delete;
+  ~SharedMemoryBuffer();
+
+  // Creates a new buffer. Returns nullptr on failure.
+  static std::unique_ptr<SharedMemoryBuffer> Create();
+
+  // Maps the buffer created by the peer. Takes the ownership of |fd| even on
+  // failure, in which case nullptr is returned.
+  static std::unique_ptr<SharedMemoryBuffer> Map(int fd);
+
+  // Returns true if the peer on the other end of |socket| has closed it.
+  static bool IsPeerClosed(int socket);
+
+  int fd() const { return fd_; }
+
+  // Copies |message| into the buffer, sets the state to |state| and wakes up
+  // the peer. Returns false if the buffer is closed or cannot hold |message|.
+  bool Post(State state, absl::string_view message);
+
+  // Waits until the state becomes |state|. Returns IPC_TIMEOUT_ERROR when
+  // |deadline| passes, and IPC_READ_ERROR when the buffer is closed or the
+  // peer on |peer_socket| goes away.
+  IPCErrorType Wait(State state, absl::Time deadline, int peer_socket);
+
+  // Sets |message| to the message posted by the peer. It points into the
+  // shared memory and is valid until the next call of Post().
+  bool Read(absl::string_view *message);
+
+  // Marks the buffer closed and wakes up the peer. Post() fails afterwards.
+  void Close();
+
+ private:
+  struct Header;
+
+  SharedMemoryBuffer(int fd, char *data, size_t size)
+      : fd_(fd), data_(data), mapped_size_(size) {}
+
+  Header *header() { return reinterpret_cast<Header *>(data_); }
+  bool Remap(size_t size);
+
+  int fd_;
+  char *data_;
+  size_t mapped_size_;
+};
+
+#endif  // __linux__ && !__ANDROID__
+
+// Creates IPC clients that talk to the server through a SharedMemoryBuffer.
+// Unlike IPCClient, whose connection is good for a single Call(), channels are
+// kept by the factory and handed out again to later clients of the same
+// server, so a steady stream of calls costs no connection setup at all.
+// A channel is used by one client at a time; concurrent clients get channels
+// of their own. The factory must outlive the clients it creates.
+//
+// This transport is opt-in: client::Client and RendererClient keep using
+// IPCClientFactory unless this factory is passed to their
+// SetIPCClientFactory(). Servers that don't support the handshake are served
+// by plain IPCClient connections.
+class SharedMemoryIPCClientFactory : public IPCClientFactoryInterface {
+ public:
+  SharedMemoryIPCClientFactory();
+  SharedMemoryIPCClientFactory(const SharedMemoryIPCClientFactory &) = delete;
+  SharedMemoryIPCClientFactory &operator=(
+      const SharedMemoryIPCClientFactory &) = delete;
+  ~SharedMemoryIPCClientFactory() override;
+
+  std::unique_ptr<IPCClientInterface> NewClient(
+      const std::string &name, const std::string &path_name) override;
+
+  std::unique_ptr<IPCClientInterface> NewClient(
+      const std::string &name) override;
+
+  // Return a singleton instance.
+  static SharedMemoryIPCClientFactory *GetSharedMemoryIPCClientFactory();
+
+ private:
+  class Channel;
+  class Client;
+
+  // Returns an idle channel to |name| if any, or negotiates a new one.
+  std::unique_ptr<Channel> AcquireChannel(const std::string &name,
+                                          const std::string &path_name);
+  void ReleaseChannel(std::unique_ptr<Channel> channel);
+
+  absl::Mutex mutex_;
+  std::vector<std::unique_ptr<Channel>> idle_channels_ ABSL_GUARDED_BY(mutex_);
+  // Process id of the last server that rejected the handshake. Negotiation is
+  // not retried until a different server process shows up.
+  uint32_t unsupported_server_pid_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_IPC_SHM_IPC_H_
@@ -0,0 +1,214 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "ipc/shm_ipc.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/thread2.h"
+#include "ipc/ipc.h"
+#include "testing/gunit.h"
+#include "testing/mozctest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace mozc {
+namespace {
+
+// Only Linux has the shared-memory transport. Other platforms fall back to
+// IPCClient, which is covered by ipc_test.
+#if defined(__linux__) && !defined(__ANDROID__)
+
+constexpr absl::Duration kTimeout = absl::Milliseconds(1000);
+
+class EchoServer : public IPCServer {
+ public:
+  explicit EchoServer(const std::string &path)
+      : IPCServer(path, 10, kTimeout) {}
+  bool Process(absl::string_view input, std::string *output) override {
+    if (input == "kill") {
+      output->clear();
+      return false;
+    }
+    output->assign(input.data(), input.size());
+    return true;
+  }
+};
+
+class SharedMemoryIPCTest : public testing::TestWithTempUserProfile {
+ protected:
+  void SetUp() override {
+    // IPCPathManager caches the path of each name, which does not survive the
+    // temporary profile directory of each test.
+    server_address_ = absl::StrCat(
+        "test_shm_echo_server_",
+        ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    server_ = std::make_unique<EchoServer>(server_address_);
+    ASSERT_TRUE(server_->Connected());
+    server_->LoopAndReturn();
+  }
+
+  void TearDown() override {
+    if (server_ != nullptr) {
+      IPCClient kill(server_address_, "");
+      std::string output;
+      kill.Call("kill", &output, kTimeout);
+      server_->Wait();
+    }
+  }
+
+  std::string server_address_;
+  std::unique_ptr<EchoServer> server_;
+};
+
+TEST_F(SharedMemoryIPCTest, Call) {
+  SharedMemoryIPCClientFactory factory;
+  std::unique_ptr<IPCClientInterface> client =
+      factory.NewClient(server_address_);
+  ASSERT_TRUE(client->Connected());
+  // Unlike IPCClient, the same client can be called repeatedly.
+  for (const size_t size : {0, 1, 100, 16 * 1024, 1024 * 1024, 16}) {
+    const std::string input(size, static_cast<char>('a' + size % 26));
+    std::string output;
+    ASSERT_TRUE(client->Call(input, &output, kTimeout)) << size;
+    EXPECT_EQ(output, input);
+  }
+}
+
+TEST_F(SharedMemoryIPCTest, ReusesChannel) {
+  SharedMemoryIPCClientFactory factory;
+  for (int i = 0; i < 100; ++i) {
+    std::unique_ptr<IPCClientInterface> client =
+        factory.NewClient(server_address_);
+    ASSERT_TRUE(client->Connected());
+    const std::string input = std::to_string(i);
+    std::string output;
+    ASSERT_TRUE(client->Call(input, &output, kTimeout));
+    EXPECT_EQ(output, input);
+  }
+}
+
+TEST_F(SharedMemoryIPCTest, ConcurrentClients) {
+  SharedMemoryIPCClientFactory factory;
+  std::vector<Thread2> threads;
+  for (int i = 0; i < 5; ++i) {
+    threads.push_back(Thread2([this, &factory, i] {
+      for (int j = 0; j < 100; ++j) {
+        std::unique_ptr<IPCClientInterface> client =
+            factory.NewClient(server_address_);
+        const std::string input(i * 1000 + j, 'x');
+        std::string output;
+        ASSERT_TRUE(client->Call(input, &output, kTimeout));
+        EXPECT_EQ(output, input);
+      }
+    }));
+  }
+  for (Thread2 &thread : threads) {
+    thread.Join();
+  }
+}
+
+TEST_F(SharedMemoryIPCTest, TooManyChannels) {
+  SharedMemoryIPCClientFactory factory;
+  // The server caps the number of live channels. Clients beyond the cap are
+  // served over the socket instead.
+  std::vector<std::unique_ptr<IPCClientInterface>> clients;
+  for (int i = 0; i < 100; ++i) {
+    clients.push_back(factory.NewClient(server_address_));
+    const std::string input = std::to_string(i);
+    std::string output;
+    ASSERT_TRUE(clients.back()->Call(input, &output, kTimeout)) << i;
+    EXPECT_EQ(output, input);
+  }
+  clients.clear();
+
+  // Channels of disconnected clients are released, so new clients get shared
+  // memory channels again.
+  for (int i = 0; i < 10; ++i) {
+    std::unique_ptr<IPCClientInterface> client =
+        factory.NewClient(server_address_);
+    std::string output;
+    ASSERT_TRUE(client->Call("again", &output, kTimeout));
+    EXPECT_EQ(output, "again");
+  }
+}
+
+TEST_F(SharedMemoryIPCTest, SocketClientsStillWork) {
+  SharedMemoryIPCClientFactory factory;
+  std::unique_ptr<IPCClientInterface> shm_client =
+      factory.NewClient(server_address_);
+  std::string output;
+  ASSERT_TRUE(shm_client->Call("shm", &output, kTimeout));
+  EXPECT_EQ(output, "shm");
+
+  IPCClient socket_client(server_address_, "");
+  ASSERT_TRUE(socket_client.Call("socket", &output, kTimeout));
+  EXPECT_EQ(output, "socket");
+
+  ASSERT_TRUE(shm_client->Call("shm again", &output, kTimeout));
+  EXPECT_EQ(output, "shm again");
+}
+
+TEST_F(SharedMemoryIPCTest, QuitThroughSharedMemory) {
+  SharedMemoryIPCClientFactory factory;
+  std::unique_ptr<IPCClientInterface> client =
+      factory.NewClient(server_address_);
+  std::string output;
+  EXPECT_FALSE(client->Call("kill", &output, kTimeout));
+  // Loop() returns once the channel asks it to quit.
+  server_->Wait();
+  server_.reset();
+}
+
+TEST_F(SharedMemoryIPCTest, ServerRestart) {
+  SharedMemoryIPCClientFactory factory;
+  std::string output;
+  factory.NewClient(server_address_)->Call("first", &output, kTimeout);
+  ASSERT_EQ(output, "first");
+
+  TearDown();
+  SetUp();
+
+  // The stale channel to the old server is dropped and a new one negotiated.
+  std::unique_ptr<IPCClientInterface> client =
+      factory.NewClient(server_address_);
+  ASSERT_TRUE(client->Call("second", &output, kTimeout));
+  EXPECT_EQ(output, "second");
+}
+
+#endif  // __linux__ && !__ANDROID__
+
+}  // namespace
+}  // namespace mozc
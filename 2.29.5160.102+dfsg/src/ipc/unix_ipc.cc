@@ -38,20 +38,27 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/thread.h"
+#include "base/thread2.h"
 #include "ipc/ipc.h"
 #include "ipc/ipc_path_manager.h"
+#include "ipc/shm_ipc.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 
 #ifndef UNIX_PATH_MAX
@@ -63,6 +70,10 @@ namespace {
 
 constexpr int kInvalidSocket = -1;
 
+// Each shared memory channel holds a thread, a socket and a mapped buffer
+// while its client is alive. Clients beyond this use the socket transport.
+constexpr size_t kMaxSharedMemoryChannels = 32;
+
 absl::Status mkdir_p(const std::string &dirname) {
   const std::string parent_dir = FileUtil::Dirname(dirname);
   struct stat st;
@@ -192,6 +203,67 @@ IPCErrorType RecvMessage(int socket, std::string *msg, absl::Duration timeout) {
   return IPC_NO_ERROR;
 }
 
+// Sends |msg| in a single message together with |fd|.
+IPCErrorType SendMessageWithFileDescriptor(int socket, const std::string &msg,
+                                           int fd, absl::Duration timeout) {
+  if (IsWriteTimeout(socket, timeout)) {
+    LOG(WARNING) << "Write timeout " << timeout;
+    return IPC_TIMEOUT_ERROR;
+  }
+  iovec iov = {const_cast<char *>(msg.data()), msg.size()};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr header = {};
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  header.msg_control = control;
+  header.msg_controllen = sizeof(control);
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&header);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  if (::sendmsg(socket, &header, MSG_NOSIGNAL) !=
+      static_cast<ssize_t>(msg.size())) {
+    LOG(ERROR) << "sendmsg() failed: " << strerror(errno);
+    return IPC_WRITE_ERROR;
+  }
+  return IPC_NO_ERROR;
+}
+
+// Receives a single message sent by SendMessageWithFileDescriptor(). |fd| is
+// set to -1 if the message does not carry a descriptor.
+IPCErrorType RecvMessageWithFileDescriptor(int socket, std::string *msg,
+                                           int *fd, absl::Duration timeout) {
+  *fd = -1;
+  if (IsReadTimeout(socket, timeout)) {
+    LOG(WARNING) << "Read timeout " << timeout;
+    return IPC_TIMEOUT_ERROR;
+  }
+  msg->resize(IPC_INITIAL_READ_BUFFER_SIZE);
+  iovec iov = {msg->data(), msg->size()};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr header = {};
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  header.msg_control = control;
+  header.msg_controllen = sizeof(control);
+  const ssize_t read_length = ::recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+  if (read_length < 0) {
+    LOG(ERROR) << "an error occurred during recvmsg(): " << strerror(errno);
+    msg->clear();
+    return IPC_READ_ERROR;
+  }
+  msg->resize(read_length);
+  for (cmsghdr *cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&header, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+      std::memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+  }
+  return IPC_NO_ERROR;
+}
+
 void SetCloseOnExecFlag(int fd) {
   int flags = ::fcntl(fd, F_GETFD, 0);
   if (flags < 0) {
@@ -256,7 +328,7 @@ void IPCClient::Init(const absl::string_view name,
     if (server_address.size() >= UNIX_PATH_MAX) {
       LOG(WARNING) << "too long path: " << server_address;
     }
-    socket_ = socket(PF_UNIX, SOCK_STREAM, 0);
+    socket_ = ::socket(PF_UNIX, SOCK_STREAM, 0);
     if (socket_ < 0) {
       LOG(WARNING) << "socket failed: " << strerror(errno);
       continue;
@@ -329,12 +401,100 @@ bool IPCClient::Call(const std::string &request, std::string *response,
   return true;
 }
 
+bool IPCClient::CallWithFileDescriptor(const std::string &request,
+                                       std::string *response, int *fd,
+                                       absl::Duration timeout) {
+  *fd = -1;
+  last_ipc_error_ = SendMessage(socket_, request, timeout);
+  if (last_ipc_error_ != IPC_NO_ERROR) {
+    LOG(ERROR) << "SendMessage failed";
+    return false;
+  }
+  ::shutdown(socket_, SHUT_WR);
+
+  last_ipc_error_ =
+      RecvMessageWithFileDescriptor(socket_, response, fd, timeout);
+  if (last_ipc_error_ != IPC_NO_ERROR) {
+    LOG(ERROR) << "RecvMessageWithFileDescriptor failed";
+    return false;
+  }
+  return true;
+}
+
 bool IPCClient::Connected() const { return connected_; }
 
 // Server
+class IPCServer::SharedMemoryChannel {
+ public:
+  SharedMemoryChannel(IPCServer *server, int socket,
+                      std::unique_ptr<SharedMemoryBuffer> buffer)
+      : server_(server),
+        socket_(socket),
+        buffer_(std::move(buffer)),
+        done_(false),
+        thread_([this] { Serve(); }) {}
+
+  ~SharedMemoryChannel() {
+    {
+      absl::MutexLock l(&mutex_);
+      if (buffer_ != nullptr) {
+        buffer_->Close();
+      }
+    }
+    thread_.Join();
+  }
+
+  bool done() const { return done_; }
+
+ private:
+  void Serve() {
+    std::string response;
+    while (buffer_->Wait(SharedMemoryBuffer::kRequest, absl::InfiniteFuture(),
+                         socket_) == IPC_NO_ERROR) {
+      // The client leaves the request untouched until the response is posted,
+      // so it can be processed in place.
+      absl::string_view request;
+      if (!buffer_->Read(&request)) {
+        break;
+      }
+      bool result;
+      {
+        absl::MutexLock l(&server_->process_mutex_);
+        result = server_->Process(request, &response);
+      }
+      if (!result) {
+        LOG(WARNING) << "Process() failed";
+        server_->RequestQuit();
+        break;
+      }
+      if (!buffer_->Post(SharedMemoryBuffer::kResponse, response)) {
+        break;
+      }
+    }
+    // Releases the buffer and the socket as soon as the client goes, rather
+    // than when the channel is reaped.
+    absl::MutexLock l(&mutex_);
+    buffer_->Close();
+    buffer_.reset();
+    ::close(socket_);
+    done_ = true;
+  }
+
+  IPCServer *server_;
+  const int socket_;
+  absl::Mutex mutex_;
+  // Reset by Serve() with |mutex_| held. Serve() reads it without |mutex_|.
+  std::unique_ptr<SharedMemoryBuffer> buffer_;
+  std::atomic<bool> done_;
+  Thread2 thread_;
+};
+
 IPCServer::IPCServer(const std::string &name, int32_t num_connections,
                      absl::Duration timeout)
-    : connected_(false), socket_(kInvalidSocket), timeout_(timeout) {
+    : connected_(false),
+      socket_(kInvalidSocket),
+      quit_requested_(false),
+      timeout_(timeout) {
   IPCPathManager *manager = IPCPathManager::GetIPCPathManager(name);
   if (!manager->CreateNewPathName() && !manager->LoadPathName()) {
     LOG(ERROR) << "Cannot prepare IPC path name";
@@ -403,6 +563,7 @@ IPCServer::~IPCServer() {
   if (server_thread_ != nullptr) {
     server_thread_->Terminate();
   }
+  shm_channels_.clear();
   ::shutdown(socket_, SHUT_RDWR);
   ::close(socket_);
   if (!IsAbstractSocket(server_address_)) {
@@ -416,6 +577,39 @@ IPCServer::~IPCServer() {
 
 bool IPCServer::Connected() const { return connected_; }
 
+void IPCServer::StartSharedMemoryChannel(int socket) {
+  // Reap the channels whose clients have gone.
+  shm_channels_.erase(
+      std::remove_if(shm_channels_.begin(), shm_channels_.end(),
+                     [](const std::unique_ptr<SharedMemoryChannel> &channel) {
+                       return channel->done();
+                     }),
+      shm_channels_.end());
+  if (shm_channels_.size() >= kMaxSharedMemoryChannels) {
+    // The client falls back to the socket transport.
+    LOG(WARNING) << "Too many shared memory channels";
+    ::close(socket);
+    return;
+  }
+
+  std::unique_ptr<SharedMemoryBuffer> buffer = SharedMemoryBuffer::Create();
+  if (buffer == nullptr ||
+      SendMessageWithFileDescriptor(socket, "ok", buffer->fd(), timeout_) !=
+          IPC_NO_ERROR) {
+    LOG(WARNING) << "Cannot start shared memory channel";
+    ::close(socket);
+    return;
+  }
+  shm_channels_.push_back(
+      std::make_unique<SharedMemoryChannel>(this, socket, std::move(buffer)));
+}
+
+void IPCServer::RequestQuit() {
+  quit_requested_ = true;
+  // Wakes up accept() in Loop().
+  ::shutdown(socket_, SHUT_RDWR);
+}
+
 void IPCServer::Loop() {
   // The most portable and straightforward single-thread server
   bool error = false;
@@ -424,6 +618,9 @@ void IPCServer::Loop() {
   std::string response;
   while (!error) {
     const int new_sock = ::accept(socket_, nullptr, nullptr);
+    if (new_sock < 0 && quit_requested_) {
+      break;
+    }
     if (new_sock < 0) {
       LOG(FATAL) << "accept() failed: " << strerror(errno);
       return;
@@ -438,7 +635,17 @@ void IPCServer::Loop() {
       continue;
     }
 
-    if (!Process(request, &response)) {
+    if (request == kSharedMemoryHandshake) {
+      StartSharedMemoryChannel(new_sock);
+      continue;
+    }
+
+    bool result;
+    {
+      absl::MutexLock l(&process_mutex_);
+      result = Process(request, &response);
+    }
+    if (!result) {
       LOG(WARNING) << "Process() failed";
       ::close(new_sock);
       error = true;
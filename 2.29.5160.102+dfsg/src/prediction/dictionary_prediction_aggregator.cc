@@ -1197,9 +1197,7 @@ void DictionaryPredictionAggregator::GetPredictiveResults(
   // "か", "き", etc
   // Example2 kana input: for "あか", we will get |base|, "あ" and |expanded|,
   // "か", and "が".
-  std::string base;
-  std::set<std::string> expanded;
-  request.composer().GetQueriesForPrediction(&base, &expanded);
+  const auto &[base, expanded] = request.composer().GetQueriesForPrediction();
   std::string input_key;
   if (expanded.empty()) {
     input_key = absl::StrCat(history_key, base);
@@ -1251,9 +1249,7 @@ void DictionaryPredictionAggregator::GetPredictiveResultsForBigram(
   // "か", "き", etc
   // Example2 kana input: for "あか", we will get |base|, "あ" and |expanded|,
   // "か", and "が".
-  std::string base;
-  std::set<std::string> expanded;
-  request.composer().GetQueriesForPrediction(&base, &expanded);
+  const auto &[base, expanded] = request.composer().GetQueriesForPrediction();
   const std::string input_key = absl::StrCat(history_key, base);
   const std::string non_expanded_original_key =
       absl::StrCat(history_key, segments.conversion_segment(0).key());
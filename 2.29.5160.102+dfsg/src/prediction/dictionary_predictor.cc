@@ -41,6 +41,7 @@
 #include "base/logging.h"
 #include "base/strings/assign.h"
 #include "base/strings/japanese.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/connector.h"
@@ -289,6 +290,7 @@ void DictionaryPredictor::MaybeRecordUsageStats(
 
 bool DictionaryPredictor::PredictForRequest(const ConversionRequest &request,
                                             Segments *segments) const {
+  ScopedTrace trace("DictionaryPredictor::PredictForRequest");
   if (segments == nullptr) {
     return false;
   }
@@ -37,6 +37,7 @@
 #include <utility>
 
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/util.h"
 #include "converter/segments.h"
 #include "prediction/predictor_interface.h"
@@ -160,6 +161,13 @@ bool BasePredictor::Sync() { return user_history_predictor_->Sync(); }
 
 bool BasePredictor::Reload() { return user_history_predictor_->Reload(); }
 
+void BasePredictor::StopSaving() { user_history_predictor_->StopSaving(); }
+
+void BasePredictor::GetMemoryStats(MemoryStats *stats) const {
+  dictionary_predictor_->GetMemoryStats(stats);
+  user_history_predictor_->GetMemoryStats(stats);
+}
+
 void BasePredictor::PopulateReadingOfCommittedCandidateIfMissing(
     Segments *segments) const {
   if (segments->conversion_segments_size() == 0) return;
@@ -74,6 +74,11 @@ class BasePredictor : public PredictorInterface {
   // Waits for syncer to complete.
   bool Wait() override;
 
+  // Stops saving user history.
+  void StopSaving() override;
+
+  void GetMemoryStats(MemoryStats *stats) const override;
+
   // The following interfaces are implemented in derived classes.
   // const string &GetPredictorName() const = 0;
   // bool PredictForRequest(const ConversionRequest &request,
@@ -32,6 +32,7 @@
 
 #include <string>
 
+#include "base/memory_stats.h"
 #include "converter/segments.h"
 #include "request/conversion_request.h"
 #include "absl/base/attributes.h"
@@ -79,6 +80,13 @@ class PredictorInterface {
   // Waits for syncer thread to complete.
   virtual bool Wait() { return true; }
 
+  // Stops saving user history to local disk, e.g., when another engine takes
+  // over the files.  The history learned afterwards is kept only in memory.
+  virtual void StopSaving() {}
+
+  // Adds the approximate memory held by this predictor to |stats|.
+  virtual void GetMemoryStats(MemoryStats *stats) const {}
+
   virtual const std::string &GetPredictorName() const = 0;
 };
 
@@ -51,7 +51,9 @@
 #include "base/hash.h"
 #include "base/japanese_util.h"
 #include "base/logging.h"
-#include "base/thread2.h"
+#include "base/memory_stats.h"
+#include "base/thread_pool.h"
+#include "base/trace.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "converter/segments.h"
@@ -64,7 +66,7 @@
 #include "request/conversion_request.h"
 #include "rewriter/variants_rewriter.h"
 #include "storage/encrypted_string_storage.h"
-#include "storage/lru_cache.h"
+#include "storage/flat_lru_cache.h"
 #include "usage_stats/usage_stats.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
@@ -381,6 +383,12 @@ bool UserHistoryPredictor::Wait() {
   return true;
 }
 
+void UserHistoryPredictor::StopSaving() {
+  // A running syncer may be in the middle of Save().
+  WaitForSyncer();
+  saving_stopped_ = true;
+}
+
 bool UserHistoryPredictor::CheckSyncerAndDelete() const {
   if (sync_.has_value()) {
     if (!sync_->Ready()) {
@@ -392,6 +400,19 @@ bool UserHistoryPredictor::CheckSyncerAndDelete() const {
   return true;
 }
 
+void UserHistoryPredictor::GetMemoryStats(MemoryStats *stats) const {
+  if (!CheckSyncerAndDelete()) {  // now loading/saving
+    return;
+  }
+  // Entries are protobuf messages, so their serialized sizes are used as the
+  // estimate of the heap they own.
+  size_t bytes = dic_->Size() * sizeof(DicElement);
+  for (const DicElement *elm = dic_->Head(); elm != nullptr; elm = elm->next) {
+    bytes += elm->value.ByteSizeLong();
+  }
+  stats->Add("user_history", bytes);
+}
+
 bool UserHistoryPredictor::Sync() {
   return AsyncSave();
   // return Save();   blocking version
@@ -407,16 +428,16 @@ bool UserHistoryPredictor::AsyncLoad() {
     return true;
   }
 
-  sync_.emplace([this] {
+  sync_.emplace(ThreadPool::GetDefaultThreadPool()->Schedule([this] {
     VLOG(1) << "Executing Reload method";
     Load();
-  });
+  }));
 
   return true;
 }
 
 bool UserHistoryPredictor::AsyncSave() {
-  if (!updated_) {
+  if (!updated_ || saving_stopped_) {
     return true;
   }
 
@@ -424,10 +445,12 @@ bool UserHistoryPredictor::AsyncSave() {
     return true;
   }
 
-  sync_.emplace([this] {
-    VLOG(1) << "Executing Sync method";
-    Save();
-  });
+  // Saving can wait for the other jobs.
+  sync_.emplace(ThreadPool::GetDefaultThreadPool()->Schedule(
+      ThreadPool::LOW, [this] {
+        VLOG(1) << "Executing Sync method";
+        Save();
+      }));
 
   return true;
 }
@@ -462,7 +485,7 @@ bool UserHistoryPredictor::Load(const UserHistoryStorage &history) {
 }
 
 bool UserHistoryPredictor::Save() {
-  if (!updated_) {
+  if (!updated_ || saving_stopped_) {
     return true;
   }
 
@@ -501,7 +524,7 @@ bool UserHistoryPredictor::ClearAllHistory() {
   WaitForSyncer();
 
   VLOG(1) << "Clearing user prediction";
-  // Renews DicCache as LruCache tries to reuse the internal value by
+  // Renews DicCache as the cache tries to reuse the internal value by
   // using FreeList
   dic_ = std::make_unique<DicCache>(UserHistoryPredictor::cache_size());
 
@@ -1122,6 +1145,7 @@ bool UserHistoryPredictor::Predict(Segments *segments) const {
 
 bool UserHistoryPredictor::PredictForRequest(const ConversionRequest &request,
                                              Segments *segments) const {
+  ScopedTrace trace("UserHistoryPredictor::PredictForRequest");
   const RequestType request_type = request.request().zero_query_suggestion()
                                        ? ZERO_QUERY_SUGGESTION
                                        : DEFAULT;
@@ -1343,14 +1367,14 @@ void UserHistoryPredictor::GetInputKeyFromSegments(
   }
 
   request.composer().GetStringForPreedit(input_key);
-  std::set<std::string> expanded_set;
-  request.composer().GetQueriesForPrediction(base, &expanded_set);
-  if (!expanded_set.empty()) {
+  const composer::Composer::PredictionQueries &queries =
+      request.composer().GetQueriesForPrediction();
+  *base = queries.base;
+  if (!queries.expanded.empty()) {
     *expanded = std::make_unique<Trie<std::string>>();
-    for (std::set<std::string>::const_iterator itr = expanded_set.begin();
-         itr != expanded_set.end(); ++itr) {
+    for (const std::string &key : queries.expanded) {
       // For getting matched key, insert values
-      (*expanded)->AddEntry(*itr, *itr);
+      (*expanded)->AddEntry(key, key);
     }
   }
 }
@@ -42,7 +42,7 @@
 
 #include "base/container/freelist.h"
 #include "base/container/trie.h"
-#include "base/thread2.h"
+#include "base/thread_pool.h"
 #include "converter/segments.h"
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
@@ -51,7 +51,7 @@
 #include "prediction/user_history_predictor.pb.h"
 #include "request/conversion_request.h"
 #include "storage/encrypted_string_storage.h"
-#include "storage/lru_cache.h"
+#include "storage/flat_lru_cache.h"
 #include "testing/gunit_prod.h"  // IWYU pragma: keep
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
@@ -137,6 +137,12 @@ class UserHistoryPredictor : public PredictorInterface {
   // Implements PredictorInterface.
   bool Wait() override;
 
+  // Makes Save() and AsyncSave() no-op, including the save in the destructor.
+  void StopSaving() override;
+
+  // Adds the memory of the LRU cache of the history entries.
+  void GetMemoryStats(MemoryStats *stats) const override;
+
   // Gets user history filename.
   static std::string GetUserHistoryFileName();
 
@@ -324,7 +330,7 @@ class UserHistoryPredictor : public PredictorInterface {
     absl::flat_hash_set<size_t> seen_;
   };
 
-  typedef mozc::storage::LruCache<uint32_t, Entry> DicCache;
+  typedef mozc::storage::FlatLruCache<uint32_t, Entry> DicCache;
   typedef DicCache::Element DicElement;
 
   bool CheckSyncerAndDelete() const;
@@ -473,8 +479,9 @@ class UserHistoryPredictor : public PredictorInterface {
 
   bool content_word_learning_enabled_;
   mutable std::atomic<bool> updated_;
+  std::atomic<bool> saving_stopped_ = false;
   std::unique_ptr<DicCache> dic_;
-  mutable std::optional<BackgroundFuture<void>> sync_;
+  mutable std::optional<TaskFuture<void>> sync_;
 };
 
 }  // namespace mozc::prediction
@@ -60,7 +60,7 @@
 #include "request/conversion_request.h"
 #include "session/request_test_util.h"
 #include "storage/encrypted_string_storage.h"
-#include "storage/lru_cache.h"
+#include "storage/flat_lru_cache.h"
 #include "testing/gmock.h"
 #include "testing/gunit.h"
 #include "testing/mozctest.h"
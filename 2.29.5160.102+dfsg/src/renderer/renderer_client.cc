@@ -32,9 +32,11 @@
 #include <climits>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 
 #include "base/clock.h"
 #include "base/logging.h"
@@ -525,5 +527,115 @@ std::unique_ptr<IPCClientInterface> RendererClient::CreateIPCClient() const {
   return ipc_client_factory_interface_->NewClient(name_, renderer_path_);
 }
 
+AsyncRendererClient::AsyncRendererClient()
+    : AsyncRendererClient(std::make_unique<RendererClient>()) {}
+
+AsyncRendererClient::AsyncRendererClient(
+    std::unique_ptr<RendererInterface> renderer)
+    : renderer_(std::move(renderer)) {
+  {
+    absl::MutexLock l(&mu_);
+    available_ = renderer_->IsAvailable();
+  }
+  sender_.emplace([this] { SenderMain(); });
+}
+
+AsyncRendererClient::~AsyncRendererClient() {
+  {
+    absl::MutexLock l(&mu_);
+    quit_ = true;
+  }
+  sender_->Wait();
+}
+
+bool AsyncRendererClient::Activate() {
+  absl::MutexLock l(&mu_);
+  activate_requested_ = true;
+  return true;
+}
+
+bool AsyncRendererClient::IsAvailable() const {
+  absl::MutexLock l(&mu_);
+  return available_;
+}
+
+bool AsyncRendererClient::ExecCommand(
+    const commands::RendererCommand &command) {
+  absl::MutexLock l(&mu_);
+  if (quit_) {
+    return false;
+  }
+  if (command.type() == commands::RendererCommand::UPDATE &&
+      !pending_commands_.empty() &&
+      pending_commands_.back().type() == commands::RendererCommand::UPDATE) {
+    pending_commands_.back() = command;
+    ++coalesced_count_;
+    return true;
+  }
+  pending_commands_.push_back(command);
+  return true;
+}
+
+void AsyncRendererClient::SetSendCommandInterface(
+    client::SendCommandInterface *send_command_interface) {
+  absl::MutexLock l(&mu_);
+  send_command_interface_ = send_command_interface;
+}
+
+void AsyncRendererClient::Flush() {
+  absl::MutexLock l(&mu_);
+  mu_.Await(absl::Condition(this, &AsyncRendererClient::IsIdle));
+}
+
+size_t AsyncRendererClient::coalesced_count() const {
+  absl::MutexLock l(&mu_);
+  return coalesced_count_;
+}
+
+bool AsyncRendererClient::HasTask() const {
+  return quit_ || !IsIdle();
+}
+
+bool AsyncRendererClient::IsIdle() const {
+  return !sending_ && !activate_requested_ &&
+         !send_command_interface_.has_value() && pending_commands_.empty();
+}
+
+void AsyncRendererClient::SenderMain() {
+  while (true) {
+    bool activate = false;
+    std::optional<client::SendCommandInterface *> send_command_interface;
+    std::optional<commands::RendererCommand> command;
+    {
+      absl::MutexLock l(&mu_);
+      mu_.Await(absl::Condition(this, &AsyncRendererClient::HasTask));
+      if (IsIdle()) {
+        // |quit_| is set and there is nothing left to send.
+        return;
+      }
+      activate = std::exchange(activate_requested_, false);
+      send_command_interface.swap(send_command_interface_);
+      if (!pending_commands_.empty()) {
+        command = std::move(pending_commands_.front());
+        pending_commands_.pop_front();
+      }
+      sending_ = true;
+    }
+    if (send_command_interface.has_value()) {
+      renderer_->SetSendCommandInterface(*send_command_interface);
+    }
+    if (activate && !renderer_->Activate()) {
+      LOG(ERROR) << "Failed to activate the renderer";
+    }
+    if (command.has_value() && !renderer_->ExecCommand(*command)) {
+      LOG(ERROR) << "Failed to send the renderer command";
+    }
+    const bool available = renderer_->IsAvailable();
+    absl::MutexLock l(&mu_);
+    available_ = available;
+    sending_ = false;
+  }
+}
+
 }  // namespace renderer
 }  // namespace mozc
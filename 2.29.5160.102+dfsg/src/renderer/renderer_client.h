@@ -30,12 +30,18 @@
 #ifndef MOZC_RENDERER_RENDERER_CLIENT_H_
 #define MOZC_RENDERER_RENDERER_CLIENT_H_
 
+#include <cstddef>
+#include <deque>
 #include <memory>
+#include <optional>
 #include <string>
 
+#include "base/thread2.h"
 #include "ipc/ipc.h"
 #include "protocol/renderer_command.pb.h"
 #include "renderer/renderer_interface.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 
 namespace mozc {
 
@@ -133,6 +139,70 @@ class RendererClient : public RendererInterface {
   RendererLauncherInterface *renderer_launcher_interface_;
 };
 
+// Forwards commands to another renderer on a background thread, so that the
+// caller, which is usually handling a key event, never waits for the IPC to
+// the renderer process.
+//
+// The commands are queued in order. An UPDATE command replaces the UPDATE
+// command at the end of the queue, if any, as the renderer only needs to show
+// the latest state. This coalesces the UPDATE commands sent during fast
+// typing, while the other commands, e.g. SHUTDOWN, are never dropped.
+//
+// The underlying renderer is used only by the sender thread.
+class AsyncRendererClient : public RendererInterface {
+ public:
+  // Uses RendererClient as the underlying renderer.
+  AsyncRendererClient();
+  explicit AsyncRendererClient(std::unique_ptr<RendererInterface> renderer);
+
+  AsyncRendererClient(const AsyncRendererClient &) = delete;
+  AsyncRendererClient &operator=(const AsyncRendererClient &) = delete;
+
+  // Sends the pending command, if any, before stopping the sender thread.
+  ~AsyncRendererClient() override;
+
+  // Returns true immediately. The renderer is activated on the sender thread.
+  bool Activate() override ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the availability of the renderer as of the last command sent.
+  bool IsAvailable() const override ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Posts |command| and returns true without waiting for it to be sent. The
+  // command is posted even if the renderer is not available, so that the
+  // sender thread launches it.
+  bool ExecCommand(const commands::RendererCommand &command) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Passes |send_command_interface| to the renderer on the sender thread.
+  void SetSendCommandInterface(
+      client::SendCommandInterface *send_command_interface) override
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Blocks until all the posted commands are handled by the renderer.
+  void Flush() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of commands replaced by newer ones before being sent.
+  size_t coalesced_count() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  void SenderMain() ABSL_LOCKS_EXCLUDED(mu_);
+
+  bool HasTask() const ABSL_SHARED_LOCKS_REQUIRED(mu_);
+  bool IsIdle() const ABSL_SHARED_LOCKS_REQUIRED(mu_);
+
+  std::unique_ptr<RendererInterface> renderer_;
+  mutable absl::Mutex mu_;
+  std::deque<commands::RendererCommand> pending_commands_ ABSL_GUARDED_BY(mu_);
+  std::optional<client::SendCommandInterface *> send_command_interface_
+      ABSL_GUARDED_BY(mu_);
+  bool available_ ABSL_GUARDED_BY(mu_) = false;
+  bool activate_requested_ ABSL_GUARDED_BY(mu_) = false;
+  bool sending_ ABSL_GUARDED_BY(mu_) = false;
+  bool quit_ ABSL_GUARDED_BY(mu_) = false;
+  size_t coalesced_count_ ABSL_GUARDED_BY(mu_) = 0;
+  std::optional<BackgroundFuture<void>> sender_;
+};
+
 }  // namespace renderer
 }  // namespace mozc
 
@@ -0,0 +1,187 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures how long the key event path is blocked by the renderer.
+//
+// Usage:
+//   renderer_client_benchmark_main --keys=500 --renderer_latency=5ms
+//
+// The renderer process is emulated by an IPC client which takes
+// --renderer_latency to handle each command. Each key sends an UPDATE
+// command every --key_interval, as the IME does while typing. The time spent
+// in ExecCommand() is reported for RendererClient, which sends the command
+// synchronously, and for AsyncRendererClient.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base/init_mozc.h"
+#include "base/version.h"
+#include "ipc/ipc.h"
+#include "protocol/renderer_command.pb.h"
+#include "renderer/renderer_client.h"
+#include "renderer/renderer_interface.h"
+#include "absl/flags/flag.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, keys, 500, "number of key events");
+ABSL_FLAG(absl::Duration, renderer_latency, absl::Milliseconds(5),
+          "time taken by the renderer to handle a command");
+ABSL_FLAG(absl::Duration, key_interval, absl::Milliseconds(1),
+          "interval between key events");
+
+namespace mozc {
+namespace renderer {
+namespace {
+
+class SlowIPCClient : public IPCClientInterface {
+ public:
+  SlowIPCClient(absl::Duration latency, absl::Mutex *mu, int *calls)
+      : latency_(latency), mu_(mu), calls_(calls) {}
+
+  bool Connected() const override { return true; }
+  uint32_t GetServerProtocolVersion() const override {
+    return IPC_PROTOCOL_VERSION;
+  }
+  const std::string &GetServerProductVersion() const override {
+    return version_;
+  }
+  uint32_t GetServerProcessId() const override { return 0; }
+  IPCErrorType GetLastIPCError() const override { return IPC_NO_ERROR; }
+
+  bool Call(const std::string &request, std::string *response,
+            absl::Duration timeout) override {
+    absl::SleepFor(std::min(latency_, timeout));
+    absl::MutexLock l(mu_);
+    ++*calls_;
+    return true;
+  }
+
+ private:
+  const absl::Duration latency_;
+  const std::string version_ = Version::GetMozcVersion();
+  absl::Mutex *mu_;
+  int *calls_;
+};
+
+class SlowIPCClientFactory : public IPCClientFactoryInterface {
+ public:
+  explicit SlowIPCClientFactory(absl::Duration latency) : latency_(latency) {}
+
+  std::unique_ptr<IPCClientInterface> NewClient(
+      const std::string &name, const std::string &path_name) override {
+    return std::make_unique<SlowIPCClient>(latency_, &mu_, &calls_);
+  }
+
+  std::unique_ptr<IPCClientInterface> NewClient(
+      const std::string &name) override {
+    return NewClient(name, "");
+  }
+
+  int calls() const {
+    absl::MutexLock l(&mu_);
+    return calls_;
+  }
+
+ private:
+  const absl::Duration latency_;
+  mutable absl::Mutex mu_;
+  int calls_ = 0;
+};
+
+std::unique_ptr<RendererClient> NewRendererClient(
+    IPCClientFactoryInterface *factory) {
+  auto client = std::make_unique<RendererClient>();
+  client->SetIPCClientFactory(factory);
+  client->DisableRendererServerCheck();
+  return client;
+}
+
+void Run(const std::string &name, RendererInterface *renderer) {
+  const int keys = absl::GetFlag(FLAGS_keys);
+  const absl::Duration key_interval = absl::GetFlag(FLAGS_key_interval);
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+
+  std::vector<absl::Duration> latencies;
+  latencies.reserve(keys);
+  for (int i = 0; i < keys; ++i) {
+    command.mutable_output()->set_id(i);
+    const absl::Time start = absl::Now();
+    renderer->ExecCommand(command);
+    latencies.push_back(absl::Now() - start);
+    absl::SleepFor(key_interval);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  absl::Duration total;
+  for (const absl::Duration latency : latencies) {
+    total += latency;
+  }
+  std::cout << name << ": "
+            << absl::ToDoubleMicroseconds(total) / keys << " us/key, p50 "
+            << absl::ToDoubleMicroseconds(latencies[keys / 2]) << " us, p99 "
+            << absl::ToDoubleMicroseconds(latencies[keys * 99 / 100])
+            << " us, ";
+}
+
+}  // namespace
+}  // namespace renderer
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+  const absl::Duration latency = absl::GetFlag(FLAGS_renderer_latency);
+
+  {
+    mozc::renderer::SlowIPCClientFactory factory(latency);
+    auto client = mozc::renderer::NewRendererClient(&factory);
+    mozc::renderer::Run("RendererClient", client.get());
+    std::cout << factory.calls() << " commands sent" << std::endl;
+  }
+  {
+    mozc::renderer::SlowIPCClientFactory factory(latency);
+    mozc::renderer::AsyncRendererClient client(
+        mozc::renderer::NewRendererClient(&factory));
+    mozc::renderer::Run("AsyncRendererClient", &client);
+    client.Flush();
+    std::cout << factory.calls() << " commands sent, "
+              << client.coalesced_count() << " coalesced" << std::endl;
+  }
+  return 0;
+}
@@ -41,16 +41,23 @@
 #include "protocol/commands.pb.h"
 #include "protocol/renderer_command.pb.h"
 #include "renderer/renderer_interface.h"
+#include "renderer/renderer_mock.h"
+#include "testing/gmock.h"
 #include "testing/gunit.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 
 namespace mozc {
 namespace renderer {
 namespace {
 
+using ::testing::Property;
+using ::testing::Return;
+
 std::string UpdateVersion(int diff) {
   std::vector<std::string> tokens =
       absl::StrSplit(Version::GetMozcVersion(), '.', absl::SkipEmpty());
@@ -183,6 +190,78 @@ class TestRendererLauncher : public RendererLauncherInterface {
   bool set_pending_command_called_;
 };
 
+// Records the commands, and blocks in ExecCommand() while it's closed. Like
+// RendererClient, it's unavailable until the first command launches it.
+class GatedRenderer : public RendererInterface {
+ public:
+  bool Activate() override ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    ++activate_count_;
+    return true;
+  }
+
+  bool IsAvailable() const override ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    return available_;
+  }
+
+  bool ExecCommand(const commands::RendererCommand &command) override
+      ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    ++entered_count_;
+    mu_.Await(absl::Condition(&open_));
+    commands_.push_back(command);
+    available_ = true;
+    return true;
+  }
+
+  void SetOpen(bool open) ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    open_ = open;
+  }
+
+  void SetAvailable(bool available) ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    available_ = available;
+  }
+
+  // Waits until |n| commands have entered ExecCommand().
+  void WaitForEntered(int n) ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    const auto entered = [this, n]() ABSL_SHARED_LOCKS_REQUIRED(mu_) {
+      return entered_count_ >= n;
+    };
+    mu_.Await(absl::Condition(&entered));
+  }
+
+  std::vector<commands::RendererCommand> commands() const
+      ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    return commands_;
+  }
+
+  int activate_count() const ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock l(&mu_);
+    return activate_count_;
+  }
+
+ private:
+  mutable absl::Mutex mu_;
+  bool open_ ABSL_GUARDED_BY(mu_) = true;
+  bool available_ ABSL_GUARDED_BY(mu_) = false;
+  int entered_count_ ABSL_GUARDED_BY(mu_) = 0;
+  int activate_count_ ABSL_GUARDED_BY(mu_) = 0;
+  std::vector<commands::RendererCommand> commands_ ABSL_GUARDED_BY(mu_);
+};
+
+commands::RendererCommand MakeUpdateCommand(int id) {
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  command.mutable_output()->set_id(id);
+  return command;
+}
+
 class RendererClientTest : public ::testing::Test {
  protected:
   RendererClientTest() : factory_(client_params_) {}
@@ -525,6 +604,122 @@ TEST_F(RendererClientTest, SetPendingCommandTest) {
   }
 }
 
+TEST(AsyncRendererClientTest, SendsCommands) {
+  auto renderer = std::make_unique<GatedRenderer>();
+  GatedRenderer *gated = renderer.get();
+  AsyncRendererClient client(std::move(renderer));
+
+  EXPECT_TRUE(client.Activate());
+  EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(1)));
+  client.Flush();
+  EXPECT_TRUE(client.IsAvailable());
+  EXPECT_EQ(gated->activate_count(), 1);
+  ASSERT_EQ(gated->commands().size(), 1);
+  EXPECT_EQ(gated->commands()[0].output().id(), 1);
+
+  EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(2)));
+  client.Flush();
+  ASSERT_EQ(gated->commands().size(), 2);
+  EXPECT_EQ(gated->commands()[1].output().id(), 2);
+  EXPECT_EQ(client.coalesced_count(), 0);
+}
+
+TEST(AsyncRendererClientTest, CoalescesStaleCommands) {
+  auto renderer = std::make_unique<GatedRenderer>();
+  GatedRenderer *gated = renderer.get();
+  AsyncRendererClient client(std::move(renderer));
+
+  // Keep the sender busy with the first command.
+  gated->SetOpen(false);
+  EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(1)));
+  gated->WaitForEntered(1);
+
+  // Only the latest one is sent after the first one.
+  for (int id = 2; id <= 10; ++id) {
+    EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(id)));
+  }
+  gated->SetOpen(true);
+  client.Flush();
+
+  const std::vector<commands::RendererCommand> commands = gated->commands();
+  ASSERT_EQ(commands.size(), 2);
+  EXPECT_EQ(commands[0].output().id(), 1);
+  EXPECT_EQ(commands[1].output().id(), 10);
+  EXPECT_EQ(client.coalesced_count(), 8);
+}
+
+TEST(AsyncRendererClientTest, KeepsOtherThanUpdateCommands) {
+  auto renderer = std::make_unique<GatedRenderer>();
+  GatedRenderer *gated = renderer.get();
+  AsyncRendererClient client(std::move(renderer));
+
+  gated->SetOpen(false);
+  EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(1)));
+  gated->WaitForEntered(1);
+
+  // Only the consecutive UPDATE commands are coalesced.
+  EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(2)));
+  commands::RendererCommand shutdown;
+  shutdown.set_type(commands::RendererCommand::SHUTDOWN);
+  EXPECT_TRUE(client.ExecCommand(shutdown));
+  EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(3)));
+  EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(4)));
+  gated->SetOpen(true);
+  client.Flush();
+
+  const std::vector<commands::RendererCommand> commands = gated->commands();
+  ASSERT_EQ(commands.size(), 4);
+  EXPECT_EQ(commands[0].output().id(), 1);
+  EXPECT_EQ(commands[1].output().id(), 2);
+  EXPECT_EQ(commands[2].type(), commands::RendererCommand::SHUTDOWN);
+  EXPECT_EQ(commands[3].output().id(), 4);
+  EXPECT_EQ(client.coalesced_count(), 1);
+}
+
+TEST(AsyncRendererClientTest, UnavailableRenderer) {
+  auto renderer = std::make_unique<GatedRenderer>();
+  GatedRenderer *gated = renderer.get();
+  AsyncRendererClient client(std::move(renderer));
+  EXPECT_FALSE(client.IsAvailable());
+
+  // The command is sent anyway, so that the renderer gets launched.
+  EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(1)));
+  client.Flush();
+  EXPECT_TRUE(client.IsAvailable());
+  EXPECT_EQ(gated->commands().size(), 1);
+
+  // A crashed renderer is launched again by the next command.
+  gated->SetAvailable(false);
+  EXPECT_TRUE(client.ExecCommand(MakeUpdateCommand(2)));
+  client.Flush();
+  EXPECT_TRUE(client.IsAvailable());
+  EXPECT_EQ(gated->commands().size(), 2);
+}
+
+TEST(AsyncRendererClientTest, SetSendCommandInterface) {
+  auto renderer = std::make_unique<RendererMock>();
+  client::SendCommandInterface *const kInterface =
+      reinterpret_cast<client::SendCommandInterface *>(0x1234);
+  EXPECT_CALL(*renderer, IsAvailable()).WillRepeatedly(Return(true));
+  EXPECT_CALL(*renderer, SetSendCommandInterface(kInterface));
+  AsyncRendererClient client(std::move(renderer));
+  client.SetSendCommandInterface(kInterface);
+  client.Flush();
+}
+
+TEST(AsyncRendererClientTest, SendsPendingCommandOnDestruction) {
+  auto renderer = std::make_unique<RendererMock>();
+  EXPECT_CALL(*renderer, IsAvailable()).WillRepeatedly(Return(true));
+  EXPECT_CALL(*renderer,
+              ExecCommand(Property(&commands::RendererCommand::visible, false)))
+      .WillOnce(Return(true));
+  AsyncRendererClient client(std::move(renderer));
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(false);
+  EXPECT_TRUE(client.ExecCommand(command));
+}
+
 }  // namespace
 }  // namespace renderer
 }  // namespace mozc
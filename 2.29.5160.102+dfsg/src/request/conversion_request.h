@@ -32,11 +32,13 @@
 
 #include <type_traits>
 
+#include "base/clock.h"
 #include "base/logging.h"
 #include "composer/composer.h"
 #include "config/config_handler.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 inline constexpr size_t kMaxConversionCandidatesSize = 200;
@@ -189,6 +191,18 @@ class ConversionRequest {
     kana_modifier_insensitive_conversion_ = value;
   }
 
+  absl::Time deadline() const { return deadline_; }
+  void set_deadline(absl::Time deadline) { deadline_ = deadline; }
+
+  // Returns true if the deadline has passed. The stages of the conversion
+  // check this at safe points and return their best partial result instead of
+  // completing the search. As this reads the clock, call it per lattice
+  // position or per candidate, not per dictionary token.
+  bool IsDeadlineExceeded() const {
+    return deadline_ != absl::InfiniteFuture() &&
+           Clock::GetAbslTime() >= deadline_;
+  }
+
  private:
   RequestType request_type_ = CONVERSION;
 
@@ -237,6 +251,9 @@ class ConversionRequest {
   // If true, enable kana modifier insensitive conversion.
   bool kana_modifier_insensitive_conversion_ = true;
 
+  // Time by which the conversion should return. See IsDeadlineExceeded().
+  absl::Time deadline_ = absl::InfiniteFuture();
+
   // TODO(noriyukit): Moves all the members of Segments that are irrelevant to
   // this structure, e.g., Segments::request_type_.
   // Also, a key for conversion is eligible to live in this class.
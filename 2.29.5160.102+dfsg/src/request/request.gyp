@@ -36,6 +36,7 @@
       'type': 'none',
       'dependencies': [
         '../base/base.gyp:base',
+        '../base/base.gyp:clock',
         '../config/config.gyp:config_handler',
         '../protocol/protocol.gyp:commands_proto',
         '../protocol/protocol.gyp:config_proto',
@@ -31,9 +31,12 @@
 #define MOZC_REWRITER_MERGER_REWRITER_H_
 
 #include <memory>
+#include <typeinfo>
 #include <utility>
 #include <vector>
 
+#include "base/memory_stats.h"
+#include "base/trace.h"
 #include "config/config_handler.h"
 #include "converter/segments.h"
 #include "protocol/commands.pb.h"
@@ -88,7 +91,13 @@ class MergerRewriter : public RewriterInterface {
                Segments *segments) const override {
     bool result = false;
     for (const std::unique_ptr<RewriterInterface> &rewriter : rewriters_) {
+      if (request.IsDeadlineExceeded()) {
+        // Returns the candidates rewritten so far.
+        break;
+      }
       if (CheckCapability(request, segments, *rewriter)) {
+        const RewriterInterface &r = *rewriter;
+        ScopedTrace trace(typeid(r));
         result |= rewriter->Rewrite(request, segments);
       }
     }
@@ -153,6 +162,12 @@ class MergerRewriter : public RewriterInterface {
     }
   }
 
+  void GetMemoryStats(MemoryStats *stats) const override {
+    for (const std::unique_ptr<RewriterInterface> &rewriter : rewriters_) {
+      rewriter->GetMemoryStats(stats);
+    }
+  }
+
  private:
   std::vector<std::unique_ptr<RewriterInterface>> rewriters_;
 };
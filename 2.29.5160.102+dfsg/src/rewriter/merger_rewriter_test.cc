@@ -38,6 +38,7 @@
 #include "testing/gunit.h"
 #include "testing/mozctest.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 namespace {
@@ -127,6 +128,19 @@ TEST_F(MergerRewriterTest, Rewrite) {
             "d.Rewrite();");
 }
 
+TEST_F(MergerRewriterTest, RewriteAfterDeadline) {
+  std::string call_result;
+  MergerRewriter merger;
+  Segments segments;
+  ConversionRequest request;
+  request.set_deadline(absl::InfinitePast());
+
+  merger.AddRewriter(std::make_unique<TestRewriter>(&call_result, "a", true));
+  merger.AddRewriter(std::make_unique<TestRewriter>(&call_result, "b", true));
+  EXPECT_FALSE(merger.Rewrite(request, &segments));
+  EXPECT_EQ(call_result, "");
+}
+
 TEST_F(MergerRewriterTest, RewriteSuggestion) {
   std::string call_result;
   MergerRewriter merger;
@@ -32,6 +32,7 @@
 
 #include <cstddef>  // for size_t
 
+#include "base/memory_stats.h"
 #include "converter/segments.h"
 #include "request/conversion_request.h"
 
@@ -88,6 +89,10 @@ class RewriterInterface {
   // on settings UI.
   virtual void Clear() {}
 
+  // Adds the approximate memory held by this rewriter, e.g. its tables and
+  // learning storage, to |stats|.
+  virtual void GetMemoryStats(MemoryStats *stats) const {}
+
  protected:
   RewriterInterface() = default;
 };
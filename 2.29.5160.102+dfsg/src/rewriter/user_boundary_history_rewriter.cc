@@ -39,6 +39,7 @@
 #include "base/config_file_stream.h"
 #include "base/file_util.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/util.h"
 #include "converter/converter_interface.h"
 #include "converter/segments.h"
@@ -337,4 +338,10 @@ void UserBoundaryHistoryRewriter::Clear() {
   }
 }
 
+void UserBoundaryHistoryRewriter::GetMemoryStats(MemoryStats *stats) const {
+  if (storage_ != nullptr) {
+    stats->Add("user_boundary_history", storage_->mapped_size());
+  }
+}
+
 }  // namespace mozc
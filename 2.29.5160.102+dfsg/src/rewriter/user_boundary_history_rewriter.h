@@ -52,6 +52,7 @@ class UserBoundaryHistoryRewriter : public RewriterInterface {
   bool Sync() override;
   bool Reload() override;
   void Clear() override;
+  void GetMemoryStats(MemoryStats *stats) const override;
 
  private:
   bool ResizeOrInsert(Segments *segments, const ConversionRequest &request,
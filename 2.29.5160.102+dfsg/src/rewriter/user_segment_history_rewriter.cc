@@ -34,6 +34,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <initializer_list>
 #include <memory>
 #include <new>
 #include <string>
@@ -41,7 +42,9 @@
 
 #include "base/config_file_stream.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/number_util.h"
 #include "base/util.h"
 #include "config/character_form_manager.h"
@@ -57,8 +60,8 @@
 #include "absl/container/btree_set.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
-#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace {
@@ -136,127 +139,146 @@ inline int GetDefaultCandidateIndex(const Segment &segment) {
   return 0;
 }
 
+// Returns the fingerprint of the tab-joined |strings|, which is the key
+// stored in LruStorage, without building the joined string.
 template <typename... Strings>
-std::string StrJoinWithTabs(const Strings &...strings) {
-  // Make sure we use the string_view overload so the buffer is preallocated.
-  return absl::StrJoin({static_cast<absl::string_view>(strings)...}, "\t");
+uint64_t FingerprintWithTabs(uint32_t seed, const Strings &...strings) {
+  FingerprintBuilder builder(seed);
+  bool first = true;
+  for (const absl::string_view str : {absl::string_view(strings)...}) {
+    if (!first) {
+      builder.Append("\t");
+    }
+    builder.Append(str);
+    first = false;
+  }
+  return builder.Finish();
 }
 
+// Feature keys are represented by their fingerprints. 0 means that the
+// feature is not available, which never collides with a real fingerprint as
+// Hash::FingerprintWithSeed() doesn't return 0.
+constexpr uint64_t kNoFeature = 0;
+
 class FeatureKey {
  public:
   FeatureKey(const Segments &segments, const PosMatcher &pos_matcher,
-             size_t index)
-      : segments_(segments), pos_matcher_(pos_matcher), index_(index) {}
+             size_t index, uint32_t seed)
+      : segments_(segments),
+        pos_matcher_(pos_matcher),
+        index_(index),
+        seed_(seed) {}
 
-  std::string LeftRight(absl::string_view base_key,
-                        absl::string_view base_value) const;
-  std::string LeftLeft(absl::string_view base_key,
-                       absl::string_view base_value) const;
-  std::string RightRight(absl::string_view base_key,
-                         absl::string_view base_value) const;
-  std::string Left(absl::string_view base_key,
-                   absl::string_view base_value) const;
-  std::string Right(absl::string_view base_key,
+  uint64_t LeftRight(absl::string_view base_key,
+                     absl::string_view base_value) const;
+  uint64_t LeftLeft(absl::string_view base_key,
                     absl::string_view base_value) const;
-  std::string Current(absl::string_view base_key,
+  uint64_t RightRight(absl::string_view base_key,
                       absl::string_view base_value) const;
-  std::string Single(absl::string_view base_key,
-                     absl::string_view base_value) const;
-  std::string LeftNumber(absl::string_view base_key,
-                         absl::string_view base_value) const;
-  std::string RightNumber(absl::string_view base_key,
-                          absl::string_view base_value) const;
+  uint64_t Left(absl::string_view base_key,
+                absl::string_view base_value) const;
+  uint64_t Right(absl::string_view base_key,
+                 absl::string_view base_value) const;
+  uint64_t Current(absl::string_view base_key,
+                   absl::string_view base_value) const;
+  uint64_t Single(absl::string_view base_key,
+                  absl::string_view base_value) const;
+  uint64_t LeftNumber(absl::string_view base_key,
+                      absl::string_view base_value) const;
+  uint64_t RightNumber(absl::string_view base_key,
+                       absl::string_view base_value) const;
 
-  static std::string Number(uint16_t type);
+  static uint64_t Number(uint16_t type, uint32_t seed);
 
  private:
   const Segments &segments_;
   const PosMatcher &pos_matcher_;
   const size_t index_;
+  const uint32_t seed_;
 };
 
 // Feature "Left Right"
-std::string FeatureKey::LeftRight(absl::string_view base_key,
-                                  absl::string_view base_value) const {
+uint64_t FeatureKey::LeftRight(absl::string_view base_key,
+                               absl::string_view base_value) const {
   if (index_ + 1 >= segments_.segments_size() || index_ <= 0) {
-    return "";
+    return kNoFeature;
   }
   const int j1 = GetDefaultCandidateIndex(segments_.segment(index_ - 1));
   const int j2 = GetDefaultCandidateIndex(segments_.segment(index_ + 1));
-  return StrJoinWithTabs(
-      "LR", base_key, segments_.segment(index_ - 1).candidate(j1).value,
+  return FingerprintWithTabs(
+      seed_, "LR", base_key, segments_.segment(index_ - 1).candidate(j1).value,
       base_value, segments_.segment(index_ + 1).candidate(j2).value);
 }
 
 // Feature "Left Left"
-std::string FeatureKey::LeftLeft(absl::string_view base_key,
-                                 absl::string_view base_value) const {
+uint64_t FeatureKey::LeftLeft(absl::string_view base_key,
+                              absl::string_view base_value) const {
   if (index_ < 2) {
-    return "";
+    return kNoFeature;
   }
   const int j1 = GetDefaultCandidateIndex(segments_.segment(index_ - 2));
   const int j2 = GetDefaultCandidateIndex(segments_.segment(index_ - 1));
-  return StrJoinWithTabs(
-      "LL", base_key, segments_.segment(index_ - 2).candidate(j1).value,
+  return FingerprintWithTabs(
+      seed_, "LL", base_key, segments_.segment(index_ - 2).candidate(j1).value,
       segments_.segment(index_ - 1).candidate(j2).value, base_value);
 }
 
 // Feature "Right Right"
-std::string FeatureKey::RightRight(absl::string_view base_key,
-                                   absl::string_view base_value) const {
+uint64_t FeatureKey::RightRight(absl::string_view base_key,
+                                absl::string_view base_value) const {
   if (index_ + 2 >= segments_.segments_size()) {
-    return "";
+    return kNoFeature;
   }
   const int j1 = GetDefaultCandidateIndex(segments_.segment(index_ + 1));
   const int j2 = GetDefaultCandidateIndex(segments_.segment(index_ + 2));
-  return StrJoinWithTabs("RR", base_key, base_value,
-                         segments_.segment(index_ + 1).candidate(j1).value,
-                         segments_.segment(index_ + 2).candidate(j2).value);
+  return FingerprintWithTabs(seed_, "RR", base_key, base_value,
+                             segments_.segment(index_ + 1).candidate(j1).value,
+                             segments_.segment(index_ + 2).candidate(j2).value);
 }
 
 // Feature "Left"
-std::string FeatureKey::Left(absl::string_view base_key,
-                             absl::string_view base_value) const {
+uint64_t FeatureKey::Left(absl::string_view base_key,
+                          absl::string_view base_value) const {
   if (index_ < 1) {
-    return "";
+    return kNoFeature;
   }
   const int j = GetDefaultCandidateIndex(segments_.segment(index_ - 1));
-  return StrJoinWithTabs("L", base_key,
-                         segments_.segment(index_ - 1).candidate(j).value,
-                         base_value);
+  return FingerprintWithTabs(seed_, "L", base_key,
+                             segments_.segment(index_ - 1).candidate(j).value,
+                             base_value);
 }
 
 // Feature "Right"
-std::string FeatureKey::Right(absl::string_view base_key,
-                              absl::string_view base_value) const {
+uint64_t FeatureKey::Right(absl::string_view base_key,
+                           absl::string_view base_value) const {
   if (index_ + 1 >= segments_.segments_size()) {
-    return "";
+    return kNoFeature;
   }
   const int j = GetDefaultCandidateIndex(segments_.segment(index_ + 1));
-  return StrJoinWithTabs("R", base_key, base_value,
-                         segments_.segment(index_ + 1).candidate(j).value);
+  return FingerprintWithTabs(seed_, "R", base_key, base_value,
+                             segments_.segment(index_ + 1).candidate(j).value);
 }
 
 // Feature "Current"
-std::string FeatureKey::Current(absl::string_view base_key,
-                                absl::string_view base_value) const {
-  return StrJoinWithTabs("C", base_key, base_value);
+uint64_t FeatureKey::Current(absl::string_view base_key,
+                             absl::string_view base_value) const {
+  return FingerprintWithTabs(seed_, "C", base_key, base_value);
 }
 
 // Feature "Single"
-std::string FeatureKey::Single(absl::string_view base_key,
-                               absl::string_view base_value) const {
+uint64_t FeatureKey::Single(absl::string_view base_key,
+                            absl::string_view base_value) const {
   if (segments_.segments_size() - segments_.history_segments_size() != 1) {
-    return "";
+    return kNoFeature;
   }
-  return StrJoinWithTabs("S", base_key, base_value);
+  return FingerprintWithTabs(seed_, "S", base_key, base_value);
 }
 
 // Feature "Left Number"
-std::string FeatureKey::LeftNumber(absl::string_view base_key,
-                                   absl::string_view base_value) const {
+uint64_t FeatureKey::LeftNumber(absl::string_view base_key,
+                                absl::string_view base_value) const {
   if (index_ < 1) {
-    return "";
+    return kNoFeature;
   }
   const int j = GetDefaultCandidateIndex(segments_.segment(index_ - 1));
   const Segment::Candidate &candidate =
@@ -264,16 +286,16 @@ std::string FeatureKey::LeftNumber(absl::string_view base_key,
   if (pos_matcher_.IsNumber(candidate.rid) ||
       pos_matcher_.IsKanjiNumber(candidate.rid) ||
       Util::GetScriptType(candidate.value) == Util::NUMBER) {
-    return StrJoinWithTabs("LN", base_key, base_value);
+    return FingerprintWithTabs(seed_, "LN", base_key, base_value);
   }
-  return "";
+  return kNoFeature;
 }
 
 // Feature "Right Number"
-std::string FeatureKey::RightNumber(absl::string_view base_key,
-                                    absl::string_view base_value) const {
+uint64_t FeatureKey::RightNumber(absl::string_view base_key,
+                                 absl::string_view base_value) const {
   if (index_ + 1 >= segments_.segments_size()) {
-    return "";
+    return kNoFeature;
   }
   const int j = GetDefaultCandidateIndex(segments_.segment(index_ + 1));
   const Segment::Candidate &candidate =
@@ -281,17 +303,42 @@ std::string FeatureKey::RightNumber(absl::string_view base_key,
   if (pos_matcher_.IsNumber(candidate.lid) ||
       pos_matcher_.IsKanjiNumber(candidate.lid) ||
       Util::GetScriptType(candidate.value) == Util::NUMBER) {
-    return StrJoinWithTabs("RN", base_key, base_value);
+    return FingerprintWithTabs(seed_, "RN", base_key, base_value);
   }
-  return "";
+  return kNoFeature;
 }
 
 // Feature "Number"
 // used for number rewrite
-std::string FeatureKey::Number(uint16_t type) {
-  return StrJoinWithTabs("N", absl::StrCat(type));
+uint64_t FeatureKey::Number(uint16_t type, uint32_t seed) {
+  return FingerprintWithTabs(seed, "N", absl::AlphaNum(type).Piece());
 }
 
+// Collects the feature fingerprints of a candidate with their weights, so
+// that they can be looked up in one LruStorage::LookupMany() call.
+class FeatureBatch {
+ public:
+  static constexpr size_t kMaxSize = 18;
+
+  void Add(uint64_t fp, uint32_t weight) {
+    if (fp == kNoFeature) {
+      return;
+    }
+    DCHECK_LT(size_, kMaxSize);
+    fps_[size_] = fp;
+    weights_[size_] = weight;
+    ++size_;
+  }
+
+  absl::Span<const uint64_t> fps() const { return {fps_, size_}; }
+  absl::Span<const uint32_t> weights() const { return {weights_, size_}; }
+
+ private:
+  uint64_t fps_[kMaxSize];
+  uint32_t weights_[kMaxSize];
+  size_t size_ = 0;
+};
+
 bool IsNumberSegment(const Segment &seg) {
   if (seg.key().empty()) {
     return false;
@@ -509,50 +556,45 @@ UserSegmentHistoryRewriter::Score UserSegmentHistoryRewriter::GetScore(
   const uint32_t unigram_weight = (segments_size == 1) ? 36 : 6;
   const uint32_t single_weight = (segments_size == 1) ? 90 : 15;
 
-  Score score = {0, 0};
-  FeatureKey fkey(segments, *pos_matcher_, segment_index);
-  score.Update(Fetch(fkey.LeftRight(all_key, all_value), trigram_weight));
-  score.Update(Fetch(fkey.LeftLeft(all_key, all_value), trigram_weight));
-  score.Update(Fetch(fkey.RightRight(all_key, all_value), trigram_weight));
-  score.Update(Fetch(fkey.Left(all_key, all_value), bigram_weight));
-  score.Update(Fetch(fkey.Right(all_key, all_value), bigram_weight));
-  score.Update(Fetch(fkey.Single(all_key, all_value), single_weight));
-  score.Update(
-      Fetch(fkey.LeftNumber(content_key, content_value), bigram_number_weight));
-  score.Update(Fetch(fkey.RightNumber(content_key, content_value),
-                     bigram_number_weight));
+  FeatureKey fkey(segments, *pos_matcher_, segment_index, storage_->seed());
+  FeatureBatch features;
+  features.Add(fkey.LeftRight(all_key, all_value), trigram_weight);
+  features.Add(fkey.LeftLeft(all_key, all_value), trigram_weight);
+  features.Add(fkey.RightRight(all_key, all_value), trigram_weight);
+  features.Add(fkey.Left(all_key, all_value), bigram_weight);
+  features.Add(fkey.Right(all_key, all_value), bigram_weight);
+  features.Add(fkey.Single(all_key, all_value), single_weight);
+  features.Add(fkey.LeftNumber(content_key, content_value),
+               bigram_number_weight);
+  features.Add(fkey.RightNumber(content_key, content_value),
+               bigram_number_weight);
 
   const bool is_replaceable = Replaceable(top_candidate, candidate);
   if (!context_sensitive && is_replaceable) {
-    score.Update(Fetch(fkey.Current(all_key, all_value), unigram_weight));
+    features.Add(fkey.Current(all_key, all_value), unigram_weight);
   }
 
   if (!is_replaceable) {
-    return score;
+    return FetchMany(features.fps(), features.weights());
   }
 
-  score.Update(
-      Fetch(fkey.LeftRight(content_key, content_value), trigram_weight / 2));
-  score.Update(
-      Fetch(fkey.LeftLeft(content_key, content_value), trigram_weight / 2));
-  score.Update(
-      Fetch(fkey.RightRight(content_key, content_value), trigram_weight / 2));
-  score.Update(Fetch(fkey.Left(content_key, content_value), bigram_weight / 2));
-  score.Update(
-      Fetch(fkey.Right(content_key, content_value), bigram_weight / 2));
-  score.Update(
-      Fetch(fkey.Single(content_key, content_value), single_weight / 2));
-  score.Update(Fetch(fkey.LeftNumber(content_key, content_value),
-                     bigram_number_weight / 2));
-  score.Update(Fetch(fkey.RightNumber(content_key, content_value),
-                     bigram_number_weight / 2));
+  features.Add(fkey.LeftRight(content_key, content_value), trigram_weight / 2);
+  features.Add(fkey.LeftLeft(content_key, content_value), trigram_weight / 2);
+  features.Add(fkey.RightRight(content_key, content_value),
+               trigram_weight / 2);
+  features.Add(fkey.Left(content_key, content_value), bigram_weight / 2);
+  features.Add(fkey.Right(content_key, content_value), bigram_weight / 2);
+  features.Add(fkey.Single(content_key, content_value), single_weight / 2);
+  features.Add(fkey.LeftNumber(content_key, content_value),
+               bigram_number_weight / 2);
+  features.Add(fkey.RightNumber(content_key, content_value),
+               bigram_number_weight / 2);
 
   if (!context_sensitive) {
-    score.Update(
-        Fetch(fkey.Current(content_key, content_value), unigram_weight / 2));
+    features.Add(fkey.Current(content_key, content_value), unigram_weight / 2);
   }
 
-  return score;
+  return FetchMany(features.fps(), features.weights());
 }
 
 // Returns true if |lhs| candidate can be replaceable with |rhs|.
@@ -584,11 +626,13 @@ void UserSegmentHistoryRewriter::RememberNumberPreference(
     // However, access time is count by second, so
     // separated and default is learned at same time
     // This problem is solved by workaround on lookup.
-    Insert(FeatureKey::Number(NumberUtil::NumberString::DEFAULT_STYLE), true);
+    Insert(FeatureKey::Number(NumberUtil::NumberString::DEFAULT_STYLE,
+                              storage_->seed()),
+           true);
   }
 
   // Always insert for numbers
-  Insert(FeatureKey::Number(candidate.style), true);
+  Insert(FeatureKey::Number(candidate.style, storage_->seed()), true);
 }
 
 void UserSegmentHistoryRewriter::RememberFirstCandidate(
@@ -626,7 +670,7 @@ void UserSegmentHistoryRewriter::RememberFirstCandidate(
   const bool is_replaceable_with_top =
       ((top_index == 0) || Replaceable(seg.candidate(top_index), candidate));
 
-  FeatureKey fkey(segments, *pos_matcher_, segment_index);
+  FeatureKey fkey(segments, *pos_matcher_, segment_index, storage_->seed());
   Insert(fkey.LeftRight(all_key, all_value), force_insert);
   Insert(fkey.LeftLeft(all_key, all_value), force_insert);
   Insert(fkey.RightRight(all_key, all_value), force_insert);
@@ -828,7 +872,8 @@ bool UserSegmentHistoryRewriter::RewriteNumber(Segment *segment) const {
       j -= static_cast<int>(segment->candidates_size() +
                             segment->meta_candidates_size());
     }
-    Score score = Fetch(FeatureKey::Number(segment->candidate(j).style), 10);
+    Score score = Fetch(
+        FeatureKey::Number(segment->candidate(j).style, storage_->seed()), 10);
 
     if (score.score) {
       // Workaround for separated arabic.
@@ -942,6 +987,12 @@ void UserSegmentHistoryRewriter::Clear() {
   }
 }
 
+void UserSegmentHistoryRewriter::GetMemoryStats(MemoryStats *stats) const {
+  if (storage_ != nullptr) {
+    stats->Add("user_segment_history", storage_->mapped_size());
+  }
+}
+
 bool UserSegmentHistoryRewriter::IsPunctuation(
     const Segment &seg, const Segment::Candidate &candidate) const {
   return (pos_matcher_->IsJapanesePunctuations(candidate.lid) &&
@@ -950,11 +1001,11 @@ bool UserSegmentHistoryRewriter::IsPunctuation(
 }
 
 UserSegmentHistoryRewriter::Score UserSegmentHistoryRewriter::Fetch(
-    const absl::string_view key, const uint32_t weight) const {
-  if (!key.empty()) {
+    const uint64_t fp, const uint32_t weight) const {
+  if (fp != kNoFeature) {
     uint32_t atime;
     const FeatureValue *v = std::launder(
-        reinterpret_cast<const FeatureValue *>(storage_->Lookup(key, &atime)));
+        reinterpret_cast<const FeatureValue *>(storage_->Lookup(fp, &atime)));
     if (v && v->IsValid()) {
       return {weight, atime};
     }
@@ -962,14 +1013,35 @@ UserSegmentHistoryRewriter::Score UserSegmentHistoryRewriter::Fetch(
   return {0, 0};
 }
 
-void UserSegmentHistoryRewriter::Insert(absl::string_view key, bool force) {
-  if (!key.empty()) {
+UserSegmentHistoryRewriter::Score UserSegmentHistoryRewriter::FetchMany(
+    absl::Span<const uint64_t> fps, absl::Span<const uint32_t> weights) const {
+  DCHECK_EQ(fps.size(), weights.size());
+  DCHECK_LE(fps.size(), FeatureBatch::kMaxSize);
+  const char *values[FeatureBatch::kMaxSize];
+  uint32_t atimes[FeatureBatch::kMaxSize];
+  Score score = {0, 0};
+  if (storage_->LookupMany(fps, absl::MakeSpan(values, fps.size()),
+                           absl::MakeSpan(atimes, fps.size())) == 0) {
+    return score;
+  }
+  for (size_t i = 0; i < fps.size(); ++i) {
+    const FeatureValue *v =
+        std::launder(reinterpret_cast<const FeatureValue *>(values[i]));
+    if (v && v->IsValid()) {
+      score.Update({weights[i], atimes[i]});
+    }
+  }
+  return score;
+}
+
+void UserSegmentHistoryRewriter::Insert(const uint64_t fp, bool force) {
+  if (fp != kNoFeature) {
     FeatureValue v;
     DCHECK(v.IsValid());
     if (force) {
-      storage_->Insert(key, reinterpret_cast<const char *>(&v));
+      storage_->Insert(fp, reinterpret_cast<const char *>(&v));
     } else {
-      storage_->TryInsert(key, reinterpret_cast<const char *>(&v));
+      storage_->TryInsert(fp, reinterpret_cast<const char *>(&v));
     }
   }
 }
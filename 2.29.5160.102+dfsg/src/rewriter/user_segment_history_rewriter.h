@@ -42,7 +42,7 @@
 #include "request/conversion_request.h"
 #include "rewriter/rewriter_interface.h"
 #include "storage/lru_storage.h"
-#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 
@@ -58,6 +58,7 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
   bool Sync() override;
   bool Reload() override;
   void Clear() override;
+  void GetMemoryStats(MemoryStats *stats) const override;
 
  private:
   struct Score {
@@ -98,8 +99,11 @@ class UserSegmentHistoryRewriter : public RewriterInterface {
                      const Segment::Candidate &candidate) const;
   bool SortCandidates(const std::vector<ScoreCandidate> &sorted_scores,
                       Segment *segment) const;
-  Score Fetch(absl::string_view key, uint32_t weight) const;
-  void Insert(absl::string_view key, bool force);
+  // Feature keys are passed as the fingerprints of LruStorage keys.
+  Score Fetch(uint64_t fp, uint32_t weight) const;
+  Score FetchMany(absl::Span<const uint64_t> fps,
+                  absl::Span<const uint32_t> weights) const;
+  void Insert(uint64_t fp, bool force);
 
   std::unique_ptr<storage::LruStorage> storage_;
   const dictionary::PosMatcher *pos_matcher_;
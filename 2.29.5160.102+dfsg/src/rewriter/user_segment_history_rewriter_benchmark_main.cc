@@ -0,0 +1,148 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Microbenchmark of UserSegmentHistoryRewriter::Rewrite().
+//
+// Usage:
+//   user_segment_history_rewriter_benchmark_main --segments=4 --candidates=200
+//
+// The history is trained on every segment so that Rewrite() scores all the
+// candidates of all the segments, which is the slowest path of the rewriter.
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "base/file/temp_dir.h"
+#include "base/init_mozc.h"
+#include "base/system_util.h"
+#include "config/config_handler.h"
+#include "converter/segments.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "dictionary/pos_group.h"
+#include "dictionary/pos_matcher.h"
+#include "protocol/config.pb.h"
+#include "request/conversion_request.h"
+#include "rewriter/user_segment_history_rewriter.h"
+#include "absl/flags/flag.h"
+#include "absl/log/check.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, segments, 4, "number of conversion segments");
+ABSL_FLAG(int32_t, candidates, 200, "number of candidates per segment");
+ABSL_FLAG(int32_t, iterations, 1000, "number of Rewrite() calls");
+
+namespace mozc {
+namespace {
+
+Segments MakeSegments(int segments_size, int candidates_size) {
+  Segments segments;
+  for (int i = 0; i < segments_size; ++i) {
+    Segment *segment = segments.add_segment();
+    segment->set_key(absl::StrCat("key", i));
+    for (int j = 0; j < candidates_size; ++j) {
+      Segment::Candidate *candidate = segment->add_candidate();
+      candidate->key = segment->key();
+      candidate->content_key = segment->key();
+      candidate->value = absl::StrCat("value", i, "_", j);
+      candidate->content_value = candidate->value;
+      // Non-zero POS ids so that the candidates are not treated as
+      // transliterations.
+      candidate->lid = 1;
+      candidate->rid = 1;
+    }
+  }
+  return segments;
+}
+
+// Commits a non-top candidate of every segment so that all the segments have
+// history to be looked up.
+void Train(const ConversionRequest &request, const Segments &base,
+           UserSegmentHistoryRewriter *rewriter) {
+  Segments segments = base;
+  for (size_t i = 0; i < segments.segments_size(); ++i) {
+    Segment *segment = segments.mutable_segment(i);
+    segment->move_candidate((i * 7 + 3) % segment->candidates_size(), 0);
+    segment->mutable_candidate(0)->attributes |=
+        Segment::Candidate::RERANKED;
+    segment->set_segment_type(Segment::FIXED_VALUE);
+  }
+  rewriter->Finish(request, &segments);
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+  absl::StatusOr<mozc::TempDirectory> temp_dir =
+      mozc::TempDirectory::Default().CreateTempDirectory();
+  CHECK_OK(temp_dir);
+  mozc::SystemUtil::SetUserProfileDirectory(temp_dir->path());
+
+  const mozc::testing::MockDataManager data_manager;
+  const mozc::dictionary::PosMatcher pos_matcher(
+      data_manager.GetPosMatcherData());
+  const mozc::dictionary::PosGroup pos_group(data_manager.GetPosGroupData());
+  mozc::UserSegmentHistoryRewriter rewriter(&pos_matcher, &pos_group);
+
+  mozc::config::Config config;
+  mozc::config::ConfigHandler::GetDefaultConfig(&config);
+  mozc::ConversionRequest request;
+  request.set_config(&config);
+
+  const mozc::Segments base = mozc::MakeSegments(
+      absl::GetFlag(FLAGS_segments), absl::GetFlag(FLAGS_candidates));
+  mozc::Train(request, base, &rewriter);
+
+  const int iterations = absl::GetFlag(FLAGS_iterations);
+  absl::Duration total;
+  int modified = 0;
+  for (int i = 0; i < iterations; ++i) {
+    mozc::Segments segments = base;
+    const absl::Time start = absl::Now();
+    modified += rewriter.Rewrite(request, &segments);
+    total += absl::Now() - start;
+  }
+  const double scored = static_cast<double>(iterations) *
+                        absl::GetFlag(FLAGS_segments) *
+                        absl::GetFlag(FLAGS_candidates);
+  std::cout << "Rewrite: "
+            << absl::ToDoubleMicroseconds(total) / iterations << " us/call, "
+            << absl::ToDoubleNanoseconds(total) / scored << " ns/candidate, "
+            << "modified " << modified << "/" << iterations << std::endl;
+  return 0;
+}
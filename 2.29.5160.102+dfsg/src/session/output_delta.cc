@@ -0,0 +1,232 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/output_delta.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "base/logging.h"
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+namespace {
+
+// Serializes |message| without its focused index, which is sent separately.
+template <typename T>
+void SerializeWithoutFocus(T *message, std::string *output) {
+  if (!message->has_focused_index()) {
+    message->SerializeToString(output);
+    return;
+  }
+  const uint32_t focused_index = message->focused_index();
+  message->clear_focused_index();
+  message->SerializeToString(output);
+  message->set_focused_index(focused_index);
+}
+
+bool SegmentEquals(const commands::Preedit::Segment &a,
+                   const commands::Preedit::Segment &b) {
+  return a.annotation() == b.annotation() && a.value() == b.value() &&
+         a.value_length() == b.value_length() && a.has_key() == b.has_key() &&
+         a.key() == b.key();
+}
+
+}  // namespace
+
+void OutputDeltaEncoder::Encode(uint32_t client_sequence,
+                                commands::Output *output) {
+  const bool has_base = sequence_ != 0 && client_sequence == sequence_;
+  commands::OutputDelta *delta = output->mutable_delta();
+  if (has_base) {
+    delta->set_base_sequence(sequence_);
+  }
+  delta->set_sequence(++sequence_);
+
+  // |buffer_| holds the serialized message of the output before the previous
+  // one, whose capacity is reused.
+  buffer_.clear();
+  candidates_focused_index_.reset();
+  if (output->has_candidates()) {
+    if (output->candidates().has_focused_index()) {
+      candidates_focused_index_ = output->candidates().focused_index();
+    }
+    SerializeWithoutFocus(output->mutable_candidates(), &buffer_);
+    if (has_base && buffer_ == candidates_) {
+      delta->set_reuse_candidates(true);
+      if (output->candidates().has_focused_index()) {
+        delta->set_candidates_focused_index(
+            output->candidates().focused_index());
+      }
+      output->clear_candidates();
+    }
+  }
+  candidates_.swap(buffer_);
+
+  buffer_.clear();
+  all_candidate_words_focused_index_.reset();
+  if (output->has_all_candidate_words()) {
+    if (output->all_candidate_words().has_focused_index()) {
+      all_candidate_words_focused_index_ =
+          output->all_candidate_words().focused_index();
+    }
+    SerializeWithoutFocus(output->mutable_all_candidate_words(), &buffer_);
+    if (has_base && buffer_ == all_candidate_words_) {
+      delta->set_reuse_all_candidate_words(true);
+      if (output->all_candidate_words().has_focused_index()) {
+        delta->set_all_candidate_words_focused_index(
+            output->all_candidate_words().focused_index());
+      }
+      output->clear_all_candidate_words();
+    }
+  }
+  all_candidate_words_.swap(buffer_);
+
+  if (!output->has_preedit()) {
+    preedit_.Clear();
+    return;
+  }
+  commands::Preedit *preedit = output->mutable_preedit();
+  int reused = 0;
+  if (has_base) {
+    const int size =
+        std::min(preedit->segment_size(), preedit_.segment_size());
+    while (reused < size &&
+           SegmentEquals(preedit->segment(reused), preedit_.segment(reused))) {
+      ++reused;
+    }
+  }
+  preedit_ = *preedit;
+  if (reused > 0) {
+    preedit->mutable_segment()->DeleteSubrange(0, reused);
+    delta->set_reused_preedit_segments(reused);
+  }
+}
+
+void OutputDeltaEncoder::GetPreviousOutput(commands::Output *output) const {
+  output->clear_candidates();
+  if (!candidates_.empty()) {
+    output->mutable_candidates()->ParseFromString(candidates_);
+    if (candidates_focused_index_.has_value()) {
+      output->mutable_candidates()->set_focused_index(
+          *candidates_focused_index_);
+    }
+  }
+  output->clear_all_candidate_words();
+  if (!all_candidate_words_.empty()) {
+    output->mutable_all_candidate_words()->ParseFromString(
+        all_candidate_words_);
+    if (all_candidate_words_focused_index_.has_value()) {
+      output->mutable_all_candidate_words()->set_focused_index(
+          *all_candidate_words_focused_index_);
+    }
+  }
+  output->clear_preedit();
+  // Preedit.cursor is a required field.
+  if (preedit_.has_cursor()) {
+    *output->mutable_preedit() = preedit_;
+  }
+}
+
+bool OutputDeltaDecoder::Decode(commands::Output *output) {
+  if (!output->has_delta()) {
+    return true;
+  }
+  const commands::OutputDelta delta = std::move(*output->mutable_delta());
+  output->clear_delta();
+
+  if (delta.has_base_sequence() && delta.base_sequence() != sequence_) {
+    LOG(ERROR) << "The output is based on " << delta.base_sequence()
+               << " but the last output is " << sequence_;
+    Reset();
+    return false;
+  }
+
+  if (delta.reuse_candidates()) {
+    *output->mutable_candidates() = last_output_.candidates();
+    if (delta.has_candidates_focused_index()) {
+      output->mutable_candidates()->set_focused_index(
+          delta.candidates_focused_index());
+    } else {
+      output->mutable_candidates()->clear_focused_index();
+    }
+  }
+  if (delta.reuse_all_candidate_words()) {
+    *output->mutable_all_candidate_words() =
+        last_output_.all_candidate_words();
+    if (delta.has_all_candidate_words_focused_index()) {
+      output->mutable_all_candidate_words()->set_focused_index(
+          delta.all_candidate_words_focused_index());
+    } else {
+      output->mutable_all_candidate_words()->clear_focused_index();
+    }
+  }
+  if (delta.reused_preedit_segments() > 0) {
+    const int reused = delta.reused_preedit_segments();
+    if (reused > last_output_.preedit().segment_size()) {
+      LOG(ERROR) << "The base output has only "
+                 << last_output_.preedit().segment_size() << " segments";
+      Reset();
+      return false;
+    }
+    commands::Preedit *preedit = output->mutable_preedit();
+    auto *segments = preedit->mutable_segment();
+    for (int i = 0; i < reused; ++i) {
+      *segments->Add() = last_output_.preedit().segment(i);
+    }
+    // Move the reused segments, which were appended, to the front.
+    std::rotate(segments->begin(), segments->end() - reused, segments->end());
+  }
+
+  sequence_ = delta.sequence();
+  last_output_.Clear();
+  if (output->has_candidates()) {
+    *last_output_.mutable_candidates() = output->candidates();
+  }
+  if (output->has_all_candidate_words()) {
+    *last_output_.mutable_all_candidate_words() =
+        output->all_candidate_words();
+  }
+  if (output->has_preedit()) {
+    *last_output_.mutable_preedit() = output->preedit();
+  }
+  return true;
+}
+
+void OutputDeltaDecoder::Reset() {
+  sequence_ = 0;
+  last_output_.Clear();
+}
+
+}  // namespace mozc
@@ -0,0 +1,107 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_SESSION_OUTPUT_DELTA_H_
+#define MOZC_SESSION_OUTPUT_DELTA_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+
+namespace mozc {
+
+// Replaces the parts of commands::Output which are unchanged from the
+// previous output of the same session with commands::OutputDelta. Used by the
+// server for clients with Capability.output_delta.
+//
+// While typing, most of the output is the same as the previous one except
+// for the focused candidate or the last preedit segment, and the candidate
+// window makes up most of the bytes sent to the client and the renderer.
+class OutputDeltaEncoder {
+ public:
+  OutputDeltaEncoder() = default;
+  OutputDeltaEncoder(const OutputDeltaEncoder &) = delete;
+  OutputDeltaEncoder &operator=(const OutputDeltaEncoder &) = delete;
+
+  // Encodes |output| against the previous output if |client_sequence|, the
+  // sequence number of the last output received by the client, matches it.
+  // Otherwise |output| is left complete. |output| always gets a new sequence
+  // number.
+  void Encode(uint32_t client_sequence, commands::Output *output);
+
+  // Fills the candidates, all_candidate_words and preedit of |output| with
+  // those of the previous output, i.e., the parts that may be omitted by the
+  // delta. Used for a client which couldn't restore the previous output.
+  void GetPreviousOutput(commands::Output *output) const;
+
+  uint32_t sequence() const { return sequence_; }
+
+ private:
+  uint32_t sequence_ = 0;
+  // Serialized candidates of the previous output without the focused index.
+  // Empty if the previous output had no candidates.
+  std::string candidates_;
+  std::string all_candidate_words_;
+  std::optional<uint32_t> candidates_focused_index_;
+  std::optional<uint32_t> all_candidate_words_focused_index_;
+  std::string buffer_;
+  commands::Preedit preedit_;
+};
+
+// Restores commands::Output encoded by OutputDeltaEncoder. Used by the client.
+class OutputDeltaDecoder {
+ public:
+  OutputDeltaDecoder() = default;
+  OutputDeltaDecoder(const OutputDeltaDecoder &) = delete;
+  OutputDeltaDecoder &operator=(const OutputDeltaDecoder &) = delete;
+
+  // Restores |output| in place and removes its delta. Returns false if
+  // |output| is encoded against an output which is not the last one decoded.
+  // Outputs without delta are left as is.
+  bool Decode(commands::Output *output);
+
+  // Forgets the previous output, e.g. when a new session is created.
+  void Reset();
+
+  // The sequence number of the last decoded output, which should be sent
+  // as Input.output_sequence. Returns 0 if there is none.
+  uint32_t sequence() const { return sequence_; }
+
+ private:
+  uint32_t sequence_ = 0;
+  commands::Output last_output_;
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_SESSION_OUTPUT_DELTA_H_
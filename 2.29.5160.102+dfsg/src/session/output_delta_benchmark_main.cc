@@ -0,0 +1,178 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures the size of commands::Output sent to the client per key, and the
+// time to encode and decode it, with and without OutputDeltaEncoder.
+//
+// Usage:
+//   output_delta_benchmark_main --candidates=90 --iterations=100
+//
+// The key sequence emulates a conversion: the user moves the focus through
+// all the candidates with the down arrow key, which pages the candidate
+// window every page size.
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base/init_mozc.h"
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+#include "session/output_delta.h"
+#include "absl/flags/flag.h"
+#include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, candidates, 90, "number of conversion candidates");
+ABSL_FLAG(int32_t, page_size, 9, "number of candidates per page");
+ABSL_FLAG(int32_t, iterations, 100, "number of repetitions of the sequence");
+
+namespace mozc {
+namespace {
+
+commands::Output MakeOutput(int size, int page_size, int focused_index) {
+  commands::Output output;
+  output.set_id(1);
+  output.set_mode(commands::HIRAGANA);
+  output.set_consumed(true);
+  output.mutable_status()->set_activated(true);
+  output.mutable_status()->set_mode(commands::HIRAGANA);
+
+  commands::Preedit *preedit = output.mutable_preedit();
+  preedit->set_cursor(5);
+  preedit->set_highlighted_position(0);
+  commands::Preedit::Segment *segment = preedit->add_segment();
+  segment->set_annotation(commands::Preedit::Segment::HIGHLIGHT);
+  segment->set_value(absl::StrCat("候補", focused_index));
+  segment->set_value_length(3);
+  segment->set_key("こうほ");
+  segment = preedit->add_segment();
+  segment->set_annotation(commands::Preedit::Segment::UNDERLINE);
+  segment->set_value("を選択する");
+  segment->set_value_length(5);
+  segment->set_key("をせんたくする");
+
+  const int page_begin = focused_index / page_size * page_size;
+  commands::Candidates *candidates = output.mutable_candidates();
+  candidates->set_size(size);
+  candidates->set_position(0);
+  candidates->set_focused_index(focused_index);
+  candidates->set_page_size(page_size);
+  for (int i = page_begin; i < page_begin + page_size && i < size; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_value(absl::StrCat("候補", i));
+    candidate->set_id(i);
+    candidate->mutable_annotation()->set_shortcut(
+        absl::StrCat(i - page_begin + 1));
+    candidate->mutable_annotation()->set_description("[全]ひらがな");
+  }
+  commands::Footer *footer = candidates->mutable_footer();
+  footer->set_index_visible(true);
+  footer->set_logo_visible(true);
+  footer->set_sub_label("build 1234");
+
+  commands::CandidateList *all = output.mutable_all_candidate_words();
+  all->set_focused_index(focused_index);
+  for (int i = 0; i < size; ++i) {
+    commands::CandidateWord *word = all->add_candidates();
+    word->set_id(i);
+    word->set_index(i);
+    word->set_key("こうほ");
+    word->set_value(absl::StrCat("候補", i));
+    word->mutable_annotation()->set_description("[全]ひらがな");
+  }
+  return output;
+}
+
+struct Result {
+  size_t bytes = 0;
+  absl::Duration encode;
+  absl::Duration decode;
+};
+
+Result Run(const std::vector<commands::Output> &outputs, bool use_delta) {
+  Result result;
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  std::string buf;
+  for (const commands::Output &original : outputs) {
+    // Copying the output is not measured as the server builds it anyway.
+    commands::Output output = original;
+    const absl::Time start = absl::Now();
+    if (use_delta) {
+      encoder.Encode(decoder.sequence(), &output);
+    }
+    output.SerializeToString(&buf);
+    const absl::Time encoded = absl::Now();
+    commands::Output received;
+    CHECK(received.ParseFromString(buf));
+    if (use_delta) {
+      CHECK(decoder.Decode(&received));
+    }
+    result.decode += absl::Now() - encoded;
+    result.encode += encoded - start;
+    result.bytes += buf.size();
+  }
+  return result;
+}
+
+void Print(const std::string &name, const Result &result, size_t keys) {
+  std::cout << name << ": " << static_cast<double>(result.bytes) / keys
+            << " bytes/key, encode "
+            << absl::ToDoubleMicroseconds(result.encode) / keys
+            << " us/key, decode "
+            << absl::ToDoubleMicroseconds(result.decode) / keys << " us/key"
+            << std::endl;
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+  const int size = absl::GetFlag(FLAGS_candidates);
+  const int page_size = absl::GetFlag(FLAGS_page_size);
+  std::vector<mozc::commands::Output> outputs;
+  for (int i = 0; i < absl::GetFlag(FLAGS_iterations); ++i) {
+    for (int focused_index = 0; focused_index < size; ++focused_index) {
+      outputs.push_back(mozc::MakeOutput(size, page_size, focused_index));
+    }
+  }
+
+  mozc::Print("Full", mozc::Run(outputs, false), outputs.size());
+  mozc::Print("Delta", mozc::Run(outputs, true), outputs.size());
+  return 0;
+}
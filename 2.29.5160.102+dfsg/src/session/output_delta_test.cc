@@ -0,0 +1,223 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/output_delta.h"
+
+#include <cstdint>
+#include <string>
+
+#include "protocol/candidates.pb.h"
+#include "protocol/commands.pb.h"
+#include "testing/gunit.h"
+#include "absl/strings/str_cat.h"
+
+namespace mozc {
+namespace {
+
+commands::Output MakeOutput(int page, int focused_index,
+                            const std::string &last_segment) {
+  commands::Output output;
+  output.set_consumed(true);
+
+  commands::Preedit *preedit = output.mutable_preedit();
+  preedit->set_cursor(3);
+  commands::Preedit::Segment *segment = preedit->add_segment();
+  segment->set_annotation(commands::Preedit::Segment::UNDERLINE);
+  segment->set_value("今日");
+  segment->set_value_length(2);
+  segment->set_key("きょう");
+  segment = preedit->add_segment();
+  segment->set_annotation(commands::Preedit::Segment::HIGHLIGHT);
+  segment->set_value(last_segment);
+  segment->set_value_length(1);
+
+  commands::Candidates *candidates = output.mutable_candidates();
+  candidates->set_size(90);
+  candidates->set_position(2);
+  candidates->set_focused_index(focused_index);
+  for (int i = 0; i < 9; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(page * 9 + i);
+    candidate->set_value(absl::StrCat("candidate", page * 9 + i));
+    candidate->set_id(page * 9 + i);
+  }
+
+  commands::CandidateList *all = output.mutable_all_candidate_words();
+  all->set_focused_index(focused_index);
+  for (int i = 0; i < 90; ++i) {
+    commands::CandidateWord *word = all->add_candidates();
+    word->set_index(i);
+    word->set_value(absl::StrCat("candidate", i));
+  }
+  return output;
+}
+
+// Encodes |output| and returns the decoded one.
+commands::Output RoundTrip(const commands::Output &output,
+                           OutputDeltaEncoder &encoder,
+                           OutputDeltaDecoder &decoder) {
+  commands::Output encoded = output;
+  encoder.Encode(decoder.sequence(), &encoded);
+  commands::Output decoded;
+  EXPECT_TRUE(decoded.ParseFromString(encoded.SerializeAsString()));
+  EXPECT_TRUE(decoder.Decode(&decoded));
+  return decoded;
+}
+
+TEST(OutputDeltaTest, FirstOutputIsComplete) {
+  OutputDeltaEncoder encoder;
+  commands::Output output = MakeOutput(0, 0, "は");
+  const commands::Output original = output;
+  encoder.Encode(0, &output);
+  EXPECT_EQ(output.delta().sequence(), 1);
+  EXPECT_FALSE(output.delta().has_base_sequence());
+  output.clear_delta();
+  EXPECT_EQ(output.SerializeAsString(), original.SerializeAsString());
+}
+
+TEST(OutputDeltaTest, ReuseUnchangedParts) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  RoundTrip(MakeOutput(0, 0, "は"), encoder, decoder);
+
+  // Only the focus moves.
+  commands::Output output = MakeOutput(0, 1, "は");
+  encoder.Encode(decoder.sequence(), &output);
+  EXPECT_EQ(output.delta().base_sequence(), 1);
+  EXPECT_TRUE(output.delta().reuse_candidates());
+  EXPECT_EQ(output.delta().candidates_focused_index(), 1);
+  EXPECT_TRUE(output.delta().reuse_all_candidate_words());
+  EXPECT_EQ(output.delta().all_candidate_words_focused_index(), 1);
+  EXPECT_EQ(output.delta().reused_preedit_segments(), 2);
+  EXPECT_FALSE(output.has_candidates());
+  EXPECT_FALSE(output.has_all_candidate_words());
+  EXPECT_EQ(output.preedit().segment_size(), 0);
+
+  ASSERT_TRUE(decoder.Decode(&output));
+  EXPECT_EQ(output.SerializeAsString(),
+            MakeOutput(0, 1, "は").SerializeAsString());
+}
+
+TEST(OutputDeltaTest, RoundTrip) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  const commands::Output outputs[] = {
+      MakeOutput(0, 0, "は"), MakeOutput(0, 1, "は"),
+      MakeOutput(0, 1, "が"),  // The last segment changes.
+      MakeOutput(1, 9, "が"),  // The page changes.
+      commands::Output(),       // No candidates.
+      MakeOutput(1, 10, "が"), MakeOutput(1, 10, "が"),
+  };
+  for (const commands::Output &output : outputs) {
+    EXPECT_EQ(RoundTrip(output, encoder, decoder).SerializeAsString(),
+              output.SerializeAsString());
+  }
+  // The output without candidates resets the base.
+  commands::Output output = MakeOutput(1, 10, "が");
+  encoder.Encode(decoder.sequence(), &output);
+  EXPECT_TRUE(output.delta().reuse_candidates());
+}
+
+TEST(OutputDeltaTest, ClearFocusedIndex) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  RoundTrip(MakeOutput(0, 0, "は"), encoder, decoder);
+  commands::Output output = MakeOutput(0, 0, "は");
+  output.mutable_candidates()->clear_focused_index();
+  output.mutable_all_candidate_words()->clear_focused_index();
+  EXPECT_EQ(RoundTrip(output, encoder, decoder).SerializeAsString(),
+            output.SerializeAsString());
+}
+
+TEST(OutputDeltaTest, LostOutput) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  RoundTrip(MakeOutput(0, 0, "は"), encoder, decoder);
+
+  // The client didn't receive this output.
+  commands::Output lost = MakeOutput(0, 1, "は");
+  encoder.Encode(decoder.sequence(), &lost);
+
+  // The client still reports the first output, so the next one is complete.
+  commands::Output output = MakeOutput(0, 2, "は");
+  encoder.Encode(decoder.sequence(), &output);
+  EXPECT_FALSE(output.delta().has_base_sequence());
+  EXPECT_TRUE(output.has_candidates());
+  ASSERT_TRUE(decoder.Decode(&output));
+  EXPECT_EQ(decoder.sequence(), 3);
+
+  // An output based on an unknown output is rejected.
+  commands::Output unknown = MakeOutput(0, 3, "は");
+  unknown.mutable_delta()->set_sequence(5);
+  unknown.mutable_delta()->set_base_sequence(4);
+  EXPECT_FALSE(decoder.Decode(&unknown));
+  EXPECT_EQ(decoder.sequence(), 0);
+}
+
+TEST(OutputDeltaTest, GetPreviousOutput) {
+  OutputDeltaEncoder encoder;
+  OutputDeltaDecoder decoder;
+  RoundTrip(MakeOutput(0, 0, "は"), encoder, decoder);
+
+  // The client fails to restore this output.
+  commands::Output output = MakeOutput(0, 1, "は");
+  output.mutable_candidates()->clear_focused_index();
+  commands::Output expected;
+  *expected.mutable_candidates() = output.candidates();
+  *expected.mutable_all_candidate_words() = output.all_candidate_words();
+  *expected.mutable_preedit() = output.preedit();
+  encoder.Encode(decoder.sequence(), &output);
+  EXPECT_TRUE(output.delta().reuse_candidates());
+
+  // Only the parts which the delta may omit are filled.
+  commands::Output previous;
+  encoder.GetPreviousOutput(&previous);
+  EXPECT_EQ(previous.SerializeAsString(), expected.SerializeAsString());
+
+  // The parts are cleared if the previous output doesn't have them.
+  output.Clear();
+  encoder.Encode(0, &output);
+  encoder.GetPreviousOutput(&previous);
+  EXPECT_FALSE(previous.has_candidates());
+  EXPECT_FALSE(previous.has_all_candidate_words());
+  EXPECT_FALSE(previous.has_preedit());
+}
+
+TEST(OutputDeltaTest, OutputWithoutDelta) {
+  OutputDeltaDecoder decoder;
+  commands::Output output = MakeOutput(0, 0, "は");
+  const std::string original = output.SerializeAsString();
+  EXPECT_TRUE(decoder.Decode(&output));
+  EXPECT_EQ(output.SerializeAsString(), original);
+  EXPECT_EQ(decoder.sequence(), 0);
+}
+
+}  // namespace
+}  // namespace mozc
@@ -40,6 +40,7 @@
 
 #include "base/clock.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/key_event_util.h"
@@ -212,7 +213,12 @@ ImeContext::State GetEffectiveStateForTestSendKey(const commands::KeyEvent &key,
 
 // TODO(komatsu): Remove these argument by using/making singletons.
 Session::Session(EngineInterface *engine)
-    : engine_(engine), context_(new ImeContext) {
+    // Aliases an empty shared_ptr, so that |engine| is never deleted.
+    : Session(std::shared_ptr<EngineInterface>(
+          std::shared_ptr<EngineInterface>(), engine)) {}
+
+Session::Session(std::shared_ptr<EngineInterface> engine)
+    : engine_(std::move(engine)), context_(new ImeContext) {
   InitContext(context_.get());
 }
 
@@ -390,6 +396,9 @@ bool Session::SendCommand(commands::Command *command) {
     case commands::SessionCommand::STOP_KEY_TOGGLING:
       result = StopKeyToggling(command);
       break;
+    case commands::SessionCommand::UPDATE_SUGGESTION:
+      result = UpdateSuggestion(command);
+      break;
     default:
       LOG(WARNING) << "Unknown command" << MOZC_LOG_PROTOBUF(*command);
       result = DoNothing(command);
@@ -960,6 +969,7 @@ void Session::UpdatePreferences(commands::Command *command) {
   if (command->input().has_capability()) {
     *context_->mutable_client_capability() = command->input().capability();
   }
+  context_->mutable_converter()->set_deadline(deadline_);
 
   // Update config values modified temporarily.
   // TODO(team): Stop using config for temporary modification.
@@ -1136,6 +1146,22 @@ void Session::SetTable(const composer::Table *table) {
   context_->mutable_composer()->SetTable(table);
 }
 
+bool Session::SetEngine(const std::shared_ptr<EngineInterface> &engine) {
+  if (engine_ == engine) {
+    return true;
+  }
+  // The segments and the composition may refer to the data of the current
+  // engine, so the switch waits until they are finished.
+  if (context_->converter().IsActive() || !context_->composer().Empty()) {
+    return false;
+  }
+  // The undo contexts are bound to the current engine.
+  ClearUndoContext();
+  engine_ = engine;
+  context_->mutable_converter()->SetConverter(engine_->GetConverter());
+  return true;
+}
+
 void Session::SetConfig(const config::Config *config) {
   ClearUndoContext();
   context_->SetConfig(config);
@@ -1420,6 +1446,18 @@ void Session::set_client_capability(const commands::Capability &capability) {
   *context_->mutable_client_capability() = capability;
 }
 
+void Session::EncodeOutputDelta(commands::Command *command) {
+  if (!context_->client_capability().output_delta()) {
+    return;
+  }
+  output_delta_encoder_.Encode(command->input().output_sequence(),
+                               command->mutable_output());
+}
+
+void Session::GetPreviousOutput(commands::Command *command) {
+  output_delta_encoder_.GetPreviousOutput(command->mutable_output());
+}
+
 void Session::set_application_info(
     const commands::ApplicationInfo &application_info) {
   *context_->mutable_application_info() = application_info;
@@ -1437,6 +1475,16 @@ absl::Time Session::last_command_time() const {
   return context_->last_command_time();
 }
 
+void Session::GetMemoryStats(MemoryStats *stats) const {
+  context_->composer().GetMemoryStats(stats);
+  context_->converter().GetMemoryStats(stats);
+  MemoryStats::Scope scope(stats, "undo");
+  for (const std::unique_ptr<ImeContext> &undo_context : undo_contexts_) {
+    undo_context->composer().GetMemoryStats(stats);
+    undo_context->converter().GetMemoryStats(stats);
+  }
+}
+
 bool Session::InsertCharacter(commands::Command *command) {
   if (!command->input().has_key()) {
     LOG(ERROR) << "No key event: " << MOZC_LOG_PROTOBUF(command->input());
@@ -1522,6 +1570,19 @@ bool Session::InsertCharacter(commands::Command *command) {
     return Convert(command);
   }
 
+  if (ShouldDeferSuggestion()) {
+    // Resets the suggestion shown for the previous composition as it is
+    // stale now.
+    ConversionPreferences conversion_preferences =
+        context_->converter().conversion_preferences();
+    conversion_preferences.request_suggestion = false;
+    context_->mutable_converter()->SuggestWithPreferences(
+        context_->composer(), conversion_preferences);
+    command->mutable_output()->set_suggestion_deferred(true);
+    OutputComposition(command);
+    return true;
+  }
+
   if (Suggest(command->input())) {
     Output(command);
     return true;
@@ -1531,6 +1592,18 @@ bool Session::InsertCharacter(commands::Command *command) {
   return true;
 }
 
+bool Session::ShouldDeferSuggestion() {
+  const uint32_t debounce_msec =
+      context_->client_capability().suggestion_debounce_msec();
+  if (debounce_msec == 0) {
+    return false;
+  }
+  const absl::Time now = Clock::GetAbslTime();
+  const absl::Time last_insert_time = last_insert_time_;
+  last_insert_time_ = now;
+  return now - last_insert_time < absl::Milliseconds(debounce_msec);
+}
+
 bool Session::IsFullWidthInsertSpace(const commands::Input &input) const {
   // If IME is off, any space has to be half-width.
   if (context_->state() == ImeContext::DIRECT) {
@@ -2314,6 +2387,21 @@ bool Session::StopKeyToggling(commands::Command *command) {
   return DoNothing(command);
 }
 
+bool Session::UpdateSuggestion(commands::Command *command) {
+  if (context_->state() != ImeContext::COMPOSITION) {
+    return DoNothing(command);
+  }
+  command->mutable_output()->set_consumed(true);
+  // The next insert should not be deferred as the typing has paused.
+  last_insert_time_ = absl::InfinitePast();
+  if (Suggest(command->input())) {
+    Output(command);
+    return true;
+  }
+  OutputComposition(command);
+  return true;
+}
+
 bool Session::Convert(commands::Command *command) {
   command->mutable_output()->set_consumed(true);
   std::string composition;
@@ -53,6 +53,7 @@
         '../transliteration/transliteration.gyp:transliteration',
         '../usage_stats/usage_stats_base.gyp:usage_stats',
         'session_base.gyp:keymap',
+        'session_base.gyp:output_delta',
         'session_base.gyp:session_usage_stats_util',
         'session_internal',
       ],
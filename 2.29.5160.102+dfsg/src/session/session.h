@@ -44,6 +44,7 @@
 #include "protocol/config.pb.h"
 #include "session/internal/ime_context.h"
 #include "session/internal/keymap.h"
+#include "session/output_delta.h"
 #include "session/session_interface.h"
 // for FRIEND_TEST()
 #include "testing/gunit_prod.h"
@@ -55,7 +56,11 @@ namespace session {
 
 class Session : public SessionInterface {
  public:
+  // Session doesn't own |engine|, which must outlive the session.
   explicit Session(EngineInterface *engine);
+  // Session shares the ownership of |engine| so that a reloaded engine can
+  // replace it while the session is alive.
+  explicit Session(std::shared_ptr<EngineInterface> engine);
   Session(const Session &) = delete;
   Session &operator=(const Session &) = delete;
 
@@ -227,6 +232,9 @@ class Session : public SessionInterface {
   // Stops key toggling in the composer.
   bool StopKeyToggling(mozc::commands::Command *command);
 
+  // Runs the suggestion deferred by Capability::suggestion_debounce_msec.
+  bool UpdateSuggestion(mozc::commands::Command *command);
+
   // Send a command to the composer to append a special string.
   bool SendComposerCommand(
       mozc::composer::Composer::InternalCommand composer_command,
@@ -243,6 +251,8 @@ class Session : public SessionInterface {
 
   void SetTable(const mozc::composer::Table *table) override;
 
+  bool SetEngine(const std::shared_ptr<EngineInterface> &engine) override;
+
   void SetSpellCheckerService(const spelling::SpellCheckerServiceInterface
                                   *spellchecker_service) override;
 
@@ -250,6 +260,11 @@ class Session : public SessionInterface {
   void set_client_capability(
       const mozc::commands::Capability &capability) override;
 
+  void EncodeOutputDelta(mozc::commands::Command *command) override;
+  void GetPreviousOutput(mozc::commands::Command *command) override;
+
+  void set_deadline(absl::Time deadline) override { deadline_ = deadline; }
+
   // Set application information for this session.
   void set_application_info(
       const mozc::commands::ApplicationInfo &application_info) override;
@@ -263,6 +278,10 @@ class Session : public SessionInterface {
   // return 0 (default value) if no command is executed in this session.
   absl::Time last_command_time() const override;
 
+  // Adds "composer" and "segments" of the current context and "undo/..." of
+  // the contexts kept for undo.
+  void GetMemoryStats(MemoryStats *stats) const override;
+
   // TODO(komatsu): delete this function.
   // For unittest only
   mozc::composer::Composer *get_internal_composer_only_for_unittest();
@@ -276,13 +295,24 @@ class Session : public SessionInterface {
   FRIEND_TEST(SessionTest, SetConfig);
 
   // Underlying conversion engine for this session. Please note that:
-  //   i) Session doesn't own the pointer.
+  //   i) Session owns the pointer only if it was given as a shared_ptr.
   //  ii) The state of underlying converter will change because it manages user
   //      history, user dictionary, etc.
-  mozc::EngineInterface *engine_;
+  std::shared_ptr<mozc::EngineInterface> engine_;
 
   std::unique_ptr<ImeContext> context_;
 
+  // Keeps the last output sent to the client. Not a part of ImeContext as it
+  // is not reverted by undo.
+  OutputDeltaEncoder output_delta_encoder_;
+
+  // Time of the last insert, used to debounce the suggestion.
+  absl::Time last_insert_time_ = absl::InfinitePast();
+
+  // Deadline of the conversions, applied to the converter of the current
+  // context for each command.
+  absl::Time deadline_ = absl::InfiniteFuture();
+
   // Undo stack. *begin is the oldest, and *back is the newest.
   std::deque<std::unique_ptr<ImeContext>> undo_contexts_;
 
@@ -337,6 +367,11 @@ class Session : public SessionInterface {
   // SessionConverter::Suggest is not called or no results exist.
   bool Suggest(const mozc::commands::Input &input);
 
+  // Returns true if the suggestion for the current insert should be skipped
+  // because it arrived within Capability::suggestion_debounce_msec of the
+  // previous insert.
+  bool ShouldDeferSuggestion();
+
   // Commands like EditCancel should restore the original string used for
   // the reverse conversion without any modification.
   // Returns true if the |source_text| is committed to cancel reconversion.
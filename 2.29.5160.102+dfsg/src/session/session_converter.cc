@@ -39,6 +39,7 @@
 #include <vector>
 
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/text_normalizer.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -134,6 +135,31 @@ void InitSegmentsFromString(std::string key, std::string preedit,
   c->content_key = std::move(key);
 }
 
+size_t CandidateBytes(const Segment::Candidate &candidate) {
+  return sizeof(Segment::Candidate) + MemoryStats::StringBytes(candidate.key) +
+         MemoryStats::StringBytes(candidate.value) +
+         MemoryStats::StringBytes(candidate.content_key) +
+         MemoryStats::StringBytes(candidate.content_value) +
+         MemoryStats::StringBytes(candidate.prefix) +
+         MemoryStats::StringBytes(candidate.suffix) +
+         MemoryStats::StringBytes(candidate.description);
+}
+
+size_t SegmentsBytes(const Segments &segments) {
+  size_t bytes = sizeof(Segments);
+  for (size_t i = 0; i < segments.segments_size(); ++i) {
+    const Segment &segment = segments.segment(i);
+    bytes += sizeof(Segment) + MemoryStats::StringBytes(segment.key());
+    for (size_t j = 0; j < segment.candidates_size(); ++j) {
+      bytes += CandidateBytes(segment.candidate(j));
+    }
+    for (size_t j = 0; j < segment.meta_candidates_size(); ++j) {
+      bytes += CandidateBytes(segment.meta_candidate(j));
+    }
+  }
+  return bytes;
+}
+
 }  // namespace
 
 SessionConverter::SessionConverter(const ConverterInterface *converter,
@@ -181,6 +207,7 @@ bool SessionConverter::ConvertWithPreferences(
 
   ConversionRequest conversion_request(&composer, request_, config_);
   SetConversionPreferences(preferences, segments_.get(), &conversion_request);
+  conversion_request.set_deadline(deadline_);
   SetRequestType(ConversionRequest::CONVERSION, &conversion_request);
 
   if (!converter_->StartConversionForRequest(conversion_request,
@@ -203,9 +230,10 @@ bool SessionConverter::GetReadingText(absl::string_view source_text,
   DCHECK(reading);
   reading->clear();
   Segments reverse_segments;
-  // TODO(team): Replace with StartReverseConversionForRequest()
-  // once it is implemented.
-  if (!converter_->StartReverseConversion(&reverse_segments, source_text)) {
+  ConversionRequest conversion_request;
+  conversion_request.set_deadline(deadline_);
+  if (!converter_->StartReverseConversionForRequest(
+          conversion_request, &reverse_segments, source_text)) {
     return false;
   }
   if (reverse_segments.segments_size() == 0) {
@@ -372,7 +400,8 @@ bool SessionConverter::SwitchKanaType(const composer::Composer &composer) {
     if (segments_->conversion_segments_size() != 1) {
       std::string composition;
       GetPreedit(0, segments_->conversion_segments_size(), &composition);
-      const ConversionRequest conversion_request(&composer, request_, config_);
+      ConversionRequest conversion_request(&composer, request_, config_);
+      conversion_request.set_deadline(deadline_);
       if (!converter_->ResizeSegment(segments_.get(), conversion_request, 0,
                                      Util::CharsLen(composition))) {
         LOG(WARNING) << "ResizeSegment failed for segments.";
@@ -454,6 +483,7 @@ bool SessionConverter::SuggestWithPreferences(
   ConversionRequest conversion_request(&composer, request_, config_);
   // Initialize the conversion request and segments for suggestion.
   SetConversionPreferences(preferences, segments_.get(), &conversion_request);
+  conversion_request.set_deadline(deadline_);
 
   segments_->clear_conversion_segments();
 
@@ -567,6 +597,7 @@ bool SessionConverter::PredictWithPreferences(
   // Initialize the segments and conversion_request for prediction
   ConversionRequest conversion_request(&composer, request_, config_);
   SetConversionPreferences(preferences, segments_.get(), &conversion_request);
+  conversion_request.set_deadline(deadline_);
   SetRequestType(ConversionRequest::PREDICTION, &conversion_request);
   SetUseActualConverterForRealtimeConversion(*request_, &conversion_request);
 
@@ -928,7 +959,8 @@ void SessionConverter::ResizeSegmentWidth(const composer::Composer &composer,
   }
   ResetResult();
 
-  const ConversionRequest conversion_request(&composer, request_, config_);
+  ConversionRequest conversion_request(&composer, request_, config_);
+  conversion_request.set_deadline(deadline_);
   if (!converter_->ResizeSegment(segments_.get(), conversion_request,
                                  segment_index_, delta)) {
     return;
@@ -1626,6 +1658,16 @@ void SessionConverter::SetConfig(const config::Config *config) {
   use_cascading_window_ = config->use_cascading_window();
 }
 
+void SessionConverter::SetConverter(const ConverterInterface *converter) {
+  DCHECK(!IsActive());
+  converter_ = converter;
+}
+
+void SessionConverter::GetMemoryStats(MemoryStats *stats) const {
+  stats->Add("segments", SegmentsBytes(*segments_) +
+                             SegmentsBytes(*incognito_segments_));
+}
+
 void SessionConverter::OnStartComposition(const commands::Context &context) {
   bool revision_changed = false;
   if (context.has_revision()) {
@@ -48,6 +48,7 @@
 #include "session/session_converter_interface.h"
 #include "transliteration/transliteration.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 namespace session {
@@ -237,6 +238,11 @@ class SessionConverter : public SessionConverterInterface {
   // Sets setting by the config;
   void SetConfig(const config::Config *config) override;
 
+  // Switches the underlying converter.
+  void SetConverter(const ConverterInterface *converter) override;
+
+  void GetMemoryStats(MemoryStats *stats) const override;
+
   // Set setting by the context.
   void OnStartComposition(const commands::Context &context) override;
 
@@ -259,6 +265,8 @@ class SessionConverter : public SessionConverterInterface {
     use_cascading_window_ = use_cascading_window;
   }
 
+  void set_deadline(absl::Time deadline) override { deadline_ = deadline; }
+
   // Meaning that all the composition characters are consumed.
   // c.f. CommitSuggestionInternal
   static constexpr size_t kConsumedAllCharacters =
@@ -404,6 +412,10 @@ class SessionConverter : public SessionConverterInterface {
   // Mutable values of |config_|.  These values may be changed temporaliry per
   // session.
   bool use_cascading_window_;
+
+  // Deadline of the conversions for the current command. Not copied by
+  // Clone() as it is set again for each command.
+  absl::Time deadline_ = absl::InfiniteFuture();
 };
 
 }  // namespace session
@@ -35,6 +35,7 @@
 #include <cstddef>
 #include <string>
 
+#include "base/memory_stats.h"
 #include "composer/composer.h"
 #include "converter/converter_interface.h"
 #include "converter/segments.h"
@@ -42,6 +43,7 @@
 #include "protocol/config.pb.h"
 #include "transliteration/transliteration.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 namespace session {
@@ -228,6 +230,13 @@ class SessionConverterInterface {
   // Currently this is especially for SessionConverter.
   virtual void SetConfig(const config::Config *config) = 0;
 
+  // Switches the underlying converter. The history segments are kept, so it
+  // must not be called while a conversion is in progress.
+  virtual void SetConverter(const ConverterInterface *converter) = 0;
+
+  // Adds the approximate memory held by the segments to |stats|.
+  virtual void GetMemoryStats(MemoryStats *stats) const = 0;
+
   // Update the internal state by the context.
   virtual void OnStartComposition(const commands::Context &context) = 0;
 
@@ -239,6 +248,10 @@ class SessionConverterInterface {
       config::Config::SelectionShortcut selection_shortcut) = 0;
 
   virtual void set_use_cascading_window(bool use_cascading_window) = 0;
+
+  // Sets the deadline of the conversions started by the current command.
+  // Conversions running past it return their partial results.
+  virtual void set_deadline(absl::Time deadline) = 0;
 };
 
 }  // namespace session
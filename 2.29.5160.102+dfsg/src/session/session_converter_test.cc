@@ -3071,8 +3071,9 @@ TEST_F(SessionConverterTest, GetReadingText) {
   candidate->key = kKanjiAiueo;
   candidate->value = kChars_Aiueo;
   EXPECT_CALL(mock_converter,
-              StartReverseConversion(_, absl::string_view(kKanjiAiueo)))
-      .WillOnce(DoAll(SetArgPointee<0>(reverse_segments), Return(true)));
+              StartReverseConversionForRequest(
+                  _, _, absl::string_view(kKanjiAiueo)))
+      .WillOnce(DoAll(SetArgPointee<1>(reverse_segments), Return(true)));
   std::string reading;
   EXPECT_TRUE(converter.GetReadingText(kKanjiAiueo, &reading));
   EXPECT_EQ(reading, kChars_Aiueo);
@@ -37,12 +37,15 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "base/clock.h"
 #include "base/logging.h"
+#include "base/memory_stats.h"
 #include "base/stopwatch.h"
+#include "base/trace.h"
 #include "composer/table.h"
 #include "config/character_form_manager.h"
 #include "config/config_handler.h"
@@ -101,6 +104,11 @@ ABSL_FLAG(int32_t, last_create_session_timeout, 300,
 
 ABSL_FLAG(bool, restricted, false, "Launch server with restricted setting");
 
+ABSL_FLAG(int32_t, command_deadline_msec, 0,
+          "latency budget (msec) of a key or a command. "
+          "conversions running past it return partial results. "
+          "0 means no deadline");
+
 namespace mozc {
 namespace {
 
@@ -128,6 +136,17 @@ bool IsApplicationAlive(const session::SessionInterface *session) {
 #endif  // MOZC_DISABLE_SESSION_WATCHDOG
   return true;
 }
+
+// Sets the deadline of the command which |session| is about to evaluate.
+void SetCommandDeadline(session::SessionInterface *session) {
+  const int32_t deadline_msec = absl::GetFlag(FLAGS_command_deadline_msec);
+  if (deadline_msec <= 0) {
+    session->set_deadline(absl::InfiniteFuture());
+    return;
+  }
+  session->set_deadline(Clock::GetAbslTime() +
+                        absl::Milliseconds(deadline_msec));
+}
 }  // namespace
 
 SessionHandler::SessionHandler(std::unique_ptr<EngineInterface> engine) {
@@ -148,12 +167,11 @@ void SessionHandler::Init(
   last_session_empty_time_ = Clock::GetAbslTime();
   last_cleanup_time_ = absl::InfinitePast();
   last_create_session_time_ = absl::InfinitePast();
-  engine_ = std::move(engine);
+  SetEngine(std::move(engine));
   engine_builder_ = std::move(engine_builder);
   observer_handler_ = std::make_unique<session::SessionObserverHandler>();
   user_dictionary_session_handler_ =
       std::make_unique<user_dictionary::UserDictionarySessionHandler>();
-  table_manager_ = std::make_unique<composer::TableManager>();
   request_ = std::make_unique<commands::Request>();
   config_ = config::ConfigHandler::GetConfig();
   key_map_manager_ = std::make_unique<keymap::KeyMapManager>(*config_);
@@ -190,6 +208,14 @@ void SessionHandler::Init(
   is_available_ = true;
 }
 
+void SessionHandler::SetEngine(std::unique_ptr<EngineInterface> engine) {
+  auto state = std::make_shared<EngineState>();
+  state->engine = std::move(engine);
+  table_manager_ = &state->table_manager;
+  EngineInterface *engine_ptr = state->engine.get();
+  engine_ = std::shared_ptr<EngineInterface>(std::move(state), engine_ptr);
+}
+
 SessionHandler::~SessionHandler() {
   for (SessionElement *element =
            const_cast<SessionElement *>(session_map_->Head());
@@ -341,6 +367,7 @@ bool SessionHandler::SetRequest(commands::Command *command) {
 }
 
 bool SessionHandler::EvalCommand(commands::Command *command) {
+  ScopedTrace trace("SessionHandler::EvalCommand");
   if (!is_available_) {
     LOG(ERROR) << "SessionHandler is not available.";
     return false;
@@ -363,6 +390,9 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::TEST_SEND_KEY:
       eval_succeeded = TestSendKey(command);
       break;
+    case commands::Input::SEND_KEYS:
+      eval_succeeded = SendKeys(command);
+      break;
     case commands::Input::SEND_COMMAND:
       eval_succeeded = SendCommand(command);
       break;
@@ -414,6 +444,12 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::RELOAD_SPELL_CHECKER:
       eval_succeeded = ReloadSpellChecker(command);
       break;
+    case commands::Input::GET_MEMORY_STATS:
+      eval_succeeded = GetMemoryStats(command);
+      break;
+    case commands::Input::GET_PREVIOUS_OUTPUT:
+      eval_succeeded = GetPreviousOutput(command);
+      break;
     default:
       eval_succeeded = false;
   }
@@ -434,6 +470,8 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   if (eval_succeeded) {
     // TODO(komatsu): Make sre if checking eval_succeeded is necessary or not.
     observer_handler_->EvalCommandHandler(*command);
+    // The observers need the complete output.
+    EncodeOutputDelta(command);
   }
 
   stopwatch.Stop();
@@ -445,8 +483,27 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
 }
 
 session::SessionInterface *SessionHandler::NewSession() {
-  // Session doesn't take the ownership of engine.
-  return new session::Session(engine_.get());
+  // Session shares the ownership of engine, which keeps the engine alive
+  // after it is replaced by EngineReloadRequest.
+  return new session::Session(engine_);
+}
+
+void SessionHandler::EncodeOutputDelta(commands::Command *command) {
+  switch (command->input().type()) {
+    case commands::Input::SEND_KEY:
+    case commands::Input::SEND_KEYS:
+    case commands::Input::TEST_SEND_KEY:
+    case commands::Input::SEND_COMMAND:
+    case commands::Input::GET_PREVIOUS_OUTPUT:
+      break;
+    default:
+      return;
+  }
+  session::SessionInterface *const *session =
+      session_map_->Lookup(command->input().id());
+  if (session != nullptr && *session != nullptr) {
+    (*session)->EncodeOutputDelta(command);
+  }
 }
 
 void SessionHandler::AddObserver(session::SessionObserverInterface *observer) {
@@ -469,11 +526,86 @@ bool SessionHandler::SendKey(commands::Command *command) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
+  SetCommandDeadline(*session);
+  // A session still on the previous engine moves to the current one once it
+  // has no composition or conversion.
+  (*session)->SetEngine(engine_);
   (*session)->SendKey(command);
   MaybeUpdateConfig(command);
   return true;
 }
 
+bool SessionHandler::SendKeys(commands::Command *command) {
+  const SessionID id = command->input().id();
+  session::SessionInterface **session = session_map_->MutableLookup(id);
+  if (session == nullptr || *session == nullptr) {
+    LOG(WARNING) << "SessionID " << id << " is not available";
+    return false;
+  }
+  if (command->input().keys().empty()) {
+    LOG(WARNING) << "No keys to send";
+    return false;
+  }
+  // The keys share the budget of the command.
+  SetCommandDeadline(*session);
+  (*session)->SetEngine(engine_);
+
+  // Each key is evaluated as an ordinary SEND_KEY command so that the session
+  // and the observers see exactly what they would for separate calls.
+  commands::Input key_input = command->input();
+  key_input.set_type(commands::Input::SEND_KEY);
+  key_input.clear_keys();
+  const bool request_suggestion = key_input.request_suggestion();
+
+  const int size = command->input().keys_size();
+  commands::Command key_command;
+  std::string result_value;
+  std::string result_key;
+  int count = 0;
+  while (count < size) {
+    key_command.Clear();
+    *key_command.mutable_input() = key_input;
+    *key_command.mutable_input()->mutable_key() = command->input().keys(count);
+    // The touch events belong to the batch, so only the first key carries
+    // them; otherwise the usage stats would count them once per key.
+    if (count > 0) {
+      key_command.mutable_input()->clear_touch_events();
+    }
+    ++count;
+    const bool is_last = (count == size);
+    // The output of an intermediate key is thrown away, so don't bother
+    // computing suggestions for it.
+    key_command.mutable_input()->set_request_suggestion(is_last &&
+                                                        request_suggestion);
+    (*session)->SendKey(&key_command);
+    MaybeUpdateConfig(&key_command);
+    observer_handler_->EvalCommandHandler(key_command);
+
+    const commands::Output &output = key_command.output();
+    if (output.has_result()) {
+      result_value.append(output.result().value());
+      result_key.append(output.result().key());
+    }
+    // The client has to handle an unconsumed key, and the parts of the output
+    // other than the result, before the rest of the keys.
+    if (!output.consumed() || output.has_callback() ||
+        output.has_deletion_range() || output.has_launch_tool_mode()) {
+      break;
+    }
+  }
+
+  commands::Output *output = command->mutable_output();
+  *output = std::move(*key_command.mutable_output());
+  if (!result_value.empty()) {
+    commands::Result *result = output->mutable_result();
+    result->set_type(commands::Result::STRING);
+    result->set_value(result_value);
+    result->set_key(result_key);
+  }
+  output->set_key_count(count);
+  return true;
+}
+
 bool SessionHandler::TestSendKey(commands::Command *command) {
   const SessionID id = command->input().id();
   session::SessionInterface **session = session_map_->MutableLookup(id);
@@ -481,6 +613,7 @@ bool SessionHandler::TestSendKey(commands::Command *command) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
+  SetCommandDeadline(*session);
   (*session)->TestSendKey(command);
   return true;
 }
@@ -493,6 +626,8 @@ bool SessionHandler::SendCommand(commands::Command *command) {
     LOG(WARNING) << "SessionID " << id << " is not available";
     return false;
   }
+  SetCommandDeadline(*session);
+  (*session)->SetEngine(engine_);
   (*session)->SendCommand(command);
   MaybeUpdateConfig(command);
   return true;
@@ -529,19 +664,32 @@ bool SessionHandler::CreateSession(commands::Command *command) {
             << " is removed";
   }
 
-  if (engine_builder_ && session_map_->Size() == 0 &&
-      engine_builder_->HasResponse()) {
+  if (engine_builder_ && engine_builder_->HasResponse()) {
     auto *response =
         command->mutable_output()->mutable_engine_reload_response();
     engine_builder_->GetResponse(response);
     if (response->status() == EngineReloadResponse::RELOAD_READY) {
-      if (engine_->GetUserDataManager()) {
-        engine_->GetUserDataManager()->Wait();
+      if (UserDataManagerInterface *user_data_manager =
+              engine_->GetUserDataManager()) {
+        // Saves the user history learned so far for the new engine to load.
+        // Sync() is skipped while the syncer is running, hence the first
+        // Wait().
+        user_data_manager->Wait();
+        user_data_manager->Sync();
+        user_data_manager->Wait();
+        // The current engine must not overwrite the files owned by the new
+        // one afterwards, even when it's destroyed.  What the live sessions
+        // learn on it until they move is discarded.
+        user_data_manager->StopSaving();
       }
-      engine_.reset();
-      engine_ = engine_builder_->BuildFromPreparedData();
+      // The live sessions keep the current engine until they finish their
+      // compositions. Without them, it is released before the new one is
+      // built to lower the peak memory usage.
+      if (session_map_->Size() == 0) {
+        SetEngine(nullptr);
+      }
+      SetEngine(engine_builder_->BuildFromPreparedData());
       LOG_IF(FATAL, !engine_) << "Critical failure in engine replace";
-      table_manager_->ClearCaches();
       response->set_status(EngineReloadResponse::RELOADED);
     }
     engine_builder_->Clear();
@@ -710,6 +858,45 @@ bool SessionHandler::ReloadSpellChecker(commands::Command *command) {
   return true;
 }
 
+bool SessionHandler::GetMemoryStats(commands::Command *command) {
+  MemoryStats stats;
+  GetMemoryStats(&stats);
+  commands::MemoryStats *output =
+      command->mutable_output()->mutable_memory_stats();
+  for (const auto &[name, bytes] : stats.entries()) {
+    commands::MemoryStats::Entry *entry = output->add_entry();
+    entry->set_name(name);
+    entry->set_bytes(bytes);
+  }
+  output->set_total_bytes(stats.total_bytes());
+  return true;
+}
+
+bool SessionHandler::GetPreviousOutput(commands::Command *command) {
+  const SessionID id = command->input().id();
+  session::SessionInterface **session = session_map_->MutableLookup(id);
+  if (session == nullptr || *session == nullptr) {
+    LOG(WARNING) << "SessionID " << id << " is not available";
+    return false;
+  }
+  (*session)->GetPreviousOutput(command);
+  return true;
+}
+
+void SessionHandler::GetMemoryStats(MemoryStats *stats) const {
+  {
+    MemoryStats::Scope scope(stats, "engine");
+    engine_->GetMemoryStats(stats);
+  }
+  MemoryStats::Scope scope(stats, "sessions");
+  for (const SessionElement *element = session_map_->Head();
+       element != nullptr; element = element->next) {
+    if (element->value != nullptr) {
+      element->value->GetMemoryStats(stats);
+    }
+  }
+}
+
 // Create Random Session ID in order to make the session id unpredicable
 SessionID SessionHandler::CreateNewSessionID() {
   while (true) {
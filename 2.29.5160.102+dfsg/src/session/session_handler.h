@@ -35,6 +35,7 @@
 #include <cstdint>
 #include <memory>
 
+#include "base/memory_stats.h"
 #include "composer/table.h"
 #include "dictionary/user_dictionary_session_handler.h"
 #include "engine/engine_builder_interface.h"
@@ -86,6 +87,10 @@ class SessionHandler : public SessionHandlerInterface {
 
   const EngineInterface &engine() const { return *engine_; }
 
+  // Adds "engine/..." of the current engine and "sessions/..." summed up over
+  // the live sessions.
+  void GetMemoryStats(MemoryStats *stats) const;
+
  private:
   FRIEND_TEST(SessionHandlerTest, StorageTest);
   FRIEND_TEST(SessionHandlerTest, KeyMapTest);
@@ -97,13 +102,23 @@ class SessionHandler : public SessionHandlerInterface {
   void Init(std::unique_ptr<EngineInterface> engine,
             std::unique_ptr<EngineBuilderInterface> engine_builder);
 
+  // Makes |engine| the engine of the new sessions. The sessions created before
+  // keep the previous engine until they get idle; see SendKey().
+  void SetEngine(std::unique_ptr<EngineInterface> engine);
+
   // Updates the config, if the |command| contains the config.
   void MaybeUpdateConfig(commands::Command *command);
 
+  // Encodes the output of the session commands against the previous output
+  // of the session.
+  void EncodeOutputDelta(commands::Command *command);
+
   bool CreateSession(commands::Command *command);
   bool DeleteSession(commands::Command *command);
   bool TestSendKey(commands::Command *command);
   bool SendKey(commands::Command *command);
+  // Evaluates Input::keys with SendKey() of the session one by one.
+  bool SendKeys(commands::Command *command);
   bool SendCommand(commands::Command *command);
   // Syncs internal data to local file system and wait for finish.
   bool SyncData(commands::Command *command);
@@ -133,6 +148,9 @@ class SessionHandler : public SessionHandlerInterface {
   bool NoOperation(commands::Command *command);
   bool CheckSpelling(commands::Command *command);
   bool ReloadSpellChecker(commands::Command *command);
+  // Fills Output::memory_stats by GetMemoryStats() above.
+  bool GetMemoryStats(commands::Command *command);
+  bool GetPreviousOutput(commands::Command *command);
 
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
@@ -147,12 +165,21 @@ class SessionHandler : public SessionHandlerInterface {
   absl::Time last_cleanup_time_ = absl::InfinitePast();
   absl::Time last_create_session_time_ = absl::InfinitePast();
 
-  std::unique_ptr<EngineInterface> engine_;
+  // An engine and the composer tables built from its data.
+  struct EngineState {
+    std::unique_ptr<EngineInterface> engine;
+    composer::TableManager table_manager;
+  };
+
+  // Points to the engine of an EngineState and shares the ownership of it
+  // with the sessions still using the engine. |table_manager_| points to the
+  // tables of the same state.
+  std::shared_ptr<EngineInterface> engine_;
+  composer::TableManager *table_manager_ = nullptr;
   std::unique_ptr<EngineBuilderInterface> engine_builder_;
   std::unique_ptr<session::SessionObserverHandler> observer_handler_;
   std::unique_ptr<user_dictionary::UserDictionarySessionHandler>
       user_dictionary_session_handler_;
-  std::unique_ptr<composer::TableManager> table_manager_;
   std::unique_ptr<const commands::Request> request_;
   std::unique_ptr<const config::Config> config_;
   std::unique_ptr<keymap::KeyMapManager> key_map_manager_;
@@ -33,6 +33,13 @@
 // session_handler_main --logtostderr --input input.txt --profile /tmp/mozc
 //                      --dictionary oss --engine desktop
 //
+// With --trace_output trace.json, the time spent in each stage of the
+// conversion is written in the Chrome trace event format, which can be loaded
+// by chrome://tracing or https://ui.perfetto.dev.
+//
+// SHOW_MEMORY_STATS prints the approximate bytes held by each component of the
+// engine and the session, e.g. "engine/connector/cache", and their total.
+//
 /* Example of input.txt (tsv format)
 # Enable IME
 SEND_KEY        ON
@@ -50,6 +57,7 @@ SEND_KEY        Enter
 SHOW
 SHOW_LOG_BY_VALUE       ございます
 SHOW_LOG_BY_VALUE       ございました
+SHOW_MEMORY_STATS
 */
 
 #include <cstdint>
@@ -63,6 +71,7 @@ SHOW_LOG_BY_VALUE       ございました
 #include "base/file_stream.h"
 #include "base/init_mozc.h"
 #include "base/system_util.h"
+#include "base/trace.h"
 #include "data_manager/oss/oss_data_manager.h"
 #include "engine/engine.h"
 #include "protocol/candidates.pb.h"
@@ -76,6 +85,9 @@ ABSL_FLAG(std::string, profile, "", "User profile directory");
 ABSL_FLAG(std::string, engine, "", "Conversion engine: 'mobile' or 'desktop'");
 ABSL_FLAG(std::string, dictionary, "",
           "Dictionary: 'google', 'android' or 'oss'");
+ABSL_FLAG(std::string, trace_output, "",
+          "If set, writes the traces of the conversion to this file in the "
+          "Chrome trace event format.");
 
 namespace mozc {
 void Show(const commands::Output &output) {
@@ -107,6 +119,13 @@ void ShowLog(const commands::Output &output, const int cand_id) {
   }
 }
 
+void ShowMemoryStats(const commands::MemoryStats &stats) {
+  for (const auto &entry : stats.entry()) {
+    std::cout << entry.name() << "\t" << entry.bytes() << std::endl;
+  }
+  std::cout << "total\t" << stats.total_bytes() << std::endl;
+}
+
 void ParseLine(session::SessionHandlerInterpreter &handler, std::string line) {
   std::vector<std::string> args = handler.Parse(line);
   if (args.empty()) {
@@ -149,6 +168,15 @@ void ParseLine(session::SessionHandlerInterpreter &handler, std::string line) {
     }
     return;
   }
+  if (command == "SHOW_MEMORY_STATS") {
+    const absl::Status status = handler.Eval({"GET_MEMORY_STATS"});
+    if (!status.ok()) {
+      std::cout << "ERROR: " << status.message() << std::endl;
+      return;
+    }
+    ShowMemoryStats(handler.LastOutput().memory_stats());
+    return;
+  }
   if (command == "SHOW_LOG_BY_VALUE") {
     if (args.size() != 2) {
       std::cout << "ERROR: " << line << std::endl;
@@ -207,6 +235,8 @@ int main(int argc, char **argv) {
     return 1;
   }
   mozc::session::SessionHandlerInterpreter handler(*std::move(engine));
+  const std::string trace_output = absl::GetFlag(FLAGS_trace_output);
+  mozc::Trace::Enable(!trace_output.empty());
 
   std::string line;
   if (!absl::GetFlag(FLAGS_input).empty()) {
@@ -219,5 +249,10 @@ int main(int argc, char **argv) {
   while (std::getline(std::cin, line)) {
     mozc::ParseLine(handler, line);
   }
+
+  if (!trace_output.empty()) {
+    mozc::OutputFileStream output(trace_output);
+    output << mozc::Trace::ExportChromeTraceJson();
+  }
   return 0;
 }
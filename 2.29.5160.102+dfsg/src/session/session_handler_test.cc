@@ -52,11 +52,13 @@
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "session/session_handler_test_util.h"
+#include "session/session_observer_interface.h"
 #include "testing/gmock.h"
 #include "testing/googletest.h"
 #include "testing/gunit.h"
 #include "usage_stats/usage_stats.h"
 #include "usage_stats/usage_stats_testing_util.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/flags/declare.h"
 #include "absl/flags/flag.h"
 
@@ -69,6 +71,7 @@ namespace mozc {
 namespace {
 
 using ::mozc::session::testing::SessionHandlerTestBase;
+using ::testing::InSequence;
 using ::testing::Return;
 
 // Used to test interaction between SessionHandler and EngineBuilder in engine
@@ -133,6 +136,23 @@ class MockEngineBuilder : public EngineBuilderInterface {
   int num_clear_called_ = 0;
 };
 
+// Used to test when the engine replaced by a reload is released.
+class DeletionTrackingEngine : public EngineStub {
+ public:
+  explicit DeletionTrackingEngine(
+      bool *deleted, UserDataManagerInterface *user_data_manager = nullptr)
+      : deleted_(deleted), user_data_manager_(user_data_manager) {}
+  ~DeletionTrackingEngine() override { *deleted_ = true; }
+
+  UserDataManagerInterface *GetUserDataManager() override {
+    return user_data_manager_;
+  }
+
+ private:
+  bool *deleted_;
+  UserDataManagerInterface *user_data_manager_;
+};
+
 EngineReloadResponse::Status SendDummyEngineCommand(SessionHandler *handler) {
   commands::Command command;
   command.mutable_input()->set_type(
@@ -170,6 +190,15 @@ bool CleanUp(SessionHandlerInterface *handler, uint64_t id) {
   return handler->EvalCommand(&command);
 }
 
+bool GetStatus(SessionHandlerInterface *handler, uint64_t id) {
+  commands::Command command;
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+  command.mutable_input()->mutable_command()->set_type(
+      commands::SessionCommand::GET_STATUS);
+  return handler->EvalCommand(&command);
+}
+
 bool IsGoodSession(SessionHandlerInterface *handler, uint64_t id) {
   commands::Command command;
   command.mutable_input()->set_id(id);
@@ -559,6 +588,178 @@ TEST_F(SessionHandlerTest, KeyMapTest) {
   }
 }
 
+TEST_F(SessionHandlerTest, SendKeys) {
+  SessionHandler handler(CreateMockDataEngine());
+  uint64_t session_id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &session_id));
+
+  auto add_key = [](commands::Input *input, int key_code) {
+    input->add_keys()->set_key_code(key_code);
+  };
+  {
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(session_id);
+    input->set_type(commands::Input::SEND_KEYS);
+    input->add_keys()->set_special_key(commands::KeyEvent::ON);
+    add_key(input, 'a');
+    add_key(input, 'i');
+    input->add_keys()->set_special_key(commands::KeyEvent::ENTER);
+    add_key(input, 'k');
+    add_key(input, 'a');
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    const commands::Output &output = command.output();
+    EXPECT_TRUE(output.consumed());
+    EXPECT_EQ(output.key_count(), 6);
+    // The result committed by ENTER is kept in the final output.
+    EXPECT_EQ(output.result().value(), "あい");
+    ASSERT_EQ(output.preedit().segment_size(), 1);
+    EXPECT_EQ(output.preedit().segment(0).value(), "か");
+  }
+  {
+    // The keys after the first unconsumed one are left to the client.
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(session_id);
+    input->set_type(commands::Input::SEND_KEYS);
+    input->add_keys()->set_special_key(commands::KeyEvent::ENTER);
+    input->add_keys()->set_special_key(commands::KeyEvent::OFF);
+    add_key(input, 'a');
+    add_key(input, 'b');
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    const commands::Output &output = command.output();
+    EXPECT_FALSE(output.consumed());
+    EXPECT_EQ(output.key_count(), 3);
+    EXPECT_EQ(output.result().value(), "か");
+  }
+  {
+    // The client has to handle the callback before the rest of the keys.
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(session_id);
+    input->set_type(commands::Input::SEND_KEYS);
+    input->add_keys()->set_special_key(commands::KeyEvent::ON);
+    input->add_keys()->set_special_key(commands::KeyEvent::HENKAN);
+    add_key(input, 'a');
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    const commands::Output &output = command.output();
+    EXPECT_TRUE(output.consumed());
+    EXPECT_EQ(output.key_count(), 2);
+    EXPECT_EQ(output.callback().session_command().type(),
+              commands::SessionCommand::CONVERT_REVERSE);
+    EXPECT_FALSE(output.has_preedit());
+  }
+  {
+    commands::Command command;
+    command.mutable_input()->set_id(session_id);
+    command.mutable_input()->set_type(commands::Input::SEND_KEYS);
+    EXPECT_TRUE(handler.EvalCommand(&command));
+    EXPECT_EQ(command.output().error_code(),
+              commands::Output::SESSION_FAILURE);
+  }
+}
+
+TEST_F(SessionHandlerTest, SendKeysReportsTouchEventsOnce) {
+  class TouchEventCounter : public session::SessionObserverInterface {
+   public:
+    void EvalCommandHandler(const commands::Command &command) override {
+      if (command.input().type() == commands::Input::SEND_KEY) {
+        count_ += command.input().touch_events_size();
+      }
+    }
+    int count() const { return count_; }
+
+   private:
+    int count_ = 0;
+  };
+
+  SessionHandler handler(CreateMockDataEngine());
+  TouchEventCounter counter;
+  handler.AddObserver(&counter);
+  uint64_t session_id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &session_id));
+
+  commands::Command command;
+  commands::Input *input = command.mutable_input();
+  input->set_id(session_id);
+  input->set_type(commands::Input::SEND_KEYS);
+  input->add_keys()->set_special_key(commands::KeyEvent::ON);
+  input->add_keys()->set_key_code('k');
+  input->add_keys()->set_key_code('a');
+  input->add_touch_events()->set_source_id(1);
+  input->add_touch_events()->set_source_id(2);
+  ASSERT_TRUE(handler.EvalCommand(&command));
+  EXPECT_EQ(command.output().key_count(), 3);
+  // The touch events of the batch are observed with the first key only.
+  EXPECT_EQ(counter.count(), 2);
+}
+
+TEST_F(SessionHandlerTest, GetMemoryStats) {
+  SessionHandler handler(CreateMockDataEngine());
+  uint64_t session_id = 0;
+  ASSERT_TRUE(CreateSession(&handler, &session_id));
+  {
+    commands::Command command;
+    commands::Input *input = command.mutable_input();
+    input->set_id(session_id);
+    input->set_type(commands::Input::SEND_KEYS);
+    input->add_keys()->set_special_key(commands::KeyEvent::ON);
+    input->add_keys()->set_key_code('k');
+    input->add_keys()->set_key_code('a');
+    ASSERT_TRUE(handler.EvalCommand(&command));
+  }
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_MEMORY_STATS);
+  ASSERT_TRUE(handler.EvalCommand(&command));
+  ASSERT_TRUE(command.output().has_memory_stats());
+  const commands::MemoryStats &stats = command.output().memory_stats();
+
+  absl::flat_hash_map<std::string, uint64_t> bytes;
+  uint64_t total = 0;
+  for (const commands::MemoryStats::Entry &entry : stats.entry()) {
+    bytes[entry.name()] = entry.bytes();
+    total += entry.bytes();
+  }
+  EXPECT_EQ(stats.total_bytes(), total);
+  EXPECT_GT(bytes["engine/data_set/conn"], 0);
+  EXPECT_GT(bytes["engine/connector/cache"], 0);
+  EXPECT_GT(bytes["sessions/composer"], 0);
+  EXPECT_GT(bytes["sessions/segments"], 0);
+}
+
+TEST_F(SessionHandlerTest, GetPreviousOutput) {
+  SessionHandler handler(CreateMockDataEngine());
+  uint64_t session_id = 0;
+  {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::CREATE_SESSION);
+    command.mutable_input()->mutable_capability()->set_output_delta(true);
+    ASSERT_TRUE(handler.EvalCommand(&command));
+    session_id = command.output().id();
+  }
+  commands::Command command;
+  commands::Input *input = command.mutable_input();
+  input->set_id(session_id);
+  input->set_type(commands::Input::SEND_KEYS);
+  input->add_keys()->set_special_key(commands::KeyEvent::ON);
+  input->add_keys()->set_key_code('k');
+  input->add_keys()->set_key_code('a');
+  ASSERT_TRUE(handler.EvalCommand(&command));
+  ASSERT_TRUE(command.output().has_preedit());
+
+  // The previous output is sent again without evaluating the keys.
+  commands::Command previous;
+  previous.mutable_input()->set_id(session_id);
+  previous.mutable_input()->set_type(commands::Input::GET_PREVIOUS_OUTPUT);
+  ASSERT_TRUE(handler.EvalCommand(&previous));
+  EXPECT_EQ(previous.output().preedit().SerializeAsString(),
+            command.output().preedit().SerializeAsString());
+  EXPECT_FALSE(previous.output().delta().has_base_sequence());
+  EXPECT_GT(previous.output().delta().sequence(),
+            command.output().delta().sequence());
+}
+
 TEST_F(SessionHandlerTest, VerifySyncIsCalled) {
   // Tests if sync is called for the following input commands.
   commands::Input::CommandType command_types[] = {
@@ -667,9 +868,13 @@ TEST_F(SessionHandlerTest, EngineReloadInvalidData) {
 // Tests the interaction with EngineBuilderInterface in the situation where
 // sessions exist in create session event.
 TEST_F(SessionHandlerTest, EngineReloadSessionExists) {
+  bool engine_deleted = false;
+  MockUserDataManager user_data_manager;
   MockEngineBuilder *engine_builder = new MockEngineBuilder();
-  SessionHandler handler(std::make_unique<EngineStub>(),
+  SessionHandler handler(std::make_unique<DeletionTrackingEngine>(
+                             &engine_deleted, &user_data_manager),
                          std::unique_ptr<MockEngineBuilder>(engine_builder));
+  const EngineInterface *old_engine = &handler.engine();
 
   // A session is created before data is loaded.
   engine_builder->set_state(MockEngineBuilder::State::STOP);
@@ -681,23 +886,32 @@ TEST_F(SessionHandlerTest, EngineReloadSessionExists) {
   // Emulate the state where async data load is complete.
   engine_builder->set_state(MockEngineBuilder::State::RELOAD_READY);
 
-  // Another session is created.  Since the handler already holds one session
-  // (id1), engine reload should not happen.
+  // The user history is saved for the new engine, then the previous engine,
+  // which the session id1 still uses, stops saving it.
+  {
+    InSequence seq;
+    EXPECT_CALL(user_data_manager, Wait()).WillOnce(Return(true));
+    EXPECT_CALL(user_data_manager, Sync()).WillOnce(Return(true));
+    EXPECT_CALL(user_data_manager, Wait()).WillOnce(Return(true));
+    EXPECT_CALL(user_data_manager, StopSaving());
+  }
+
+  // Another session is created.  The engine is reloaded even though the
+  // handler holds a session (id1), which keeps the previous engine.
   uint64_t id2 = 0;
   ASSERT_TRUE(CreateSession(&handler, &id2));
-  EXPECT_EQ(engine_builder->num_build_from_prepared_data_called(), 0);
-  EXPECT_EQ(engine_builder->num_clear_called(), 0);
+  EXPECT_EQ(engine_builder->num_build_from_prepared_data_called(), 1);
+  EXPECT_EQ(engine_builder->num_clear_called(), 1);
+  EXPECT_NE(&handler.engine(), old_engine);
+  EXPECT_FALSE(engine_deleted);
+
+  // The idle session moves to the new engine on its next command, which
+  // releases the previous one.
+  ASSERT_TRUE(GetStatus(&handler, id1));
+  EXPECT_TRUE(engine_deleted);
 
-  // All the sessions were deleted.
   ASSERT_TRUE(DeleteSession(&handler, id1));
   ASSERT_TRUE(DeleteSession(&handler, id2));
-
-  // A new session is created.  Since the handler holds no session, engine is
-  // reloaded at this timing.
-  uint64_t id3 = 0;
-  ASSERT_TRUE(CreateSession(&handler, &id3));
-  EXPECT_EQ(engine_builder->num_build_from_prepared_data_called(), 1);
-  EXPECT_EQ(engine_builder->num_clear_called(), 1);
 }
 
 }  // namespace mozc
@@ -210,6 +210,12 @@ bool SessionHandlerTool::ResetContext() {
   return EvalCommand(&input, nullptr);
 }
 
+bool SessionHandlerTool::GetMemoryStats(commands::Output *output) {
+  commands::Input input;
+  input.set_type(commands::Input::GET_MEMORY_STATS);
+  return EvalCommand(&input, output);
+}
+
 bool SessionHandlerTool::UndoOrRewind(commands::Output *output) {
   commands::Input input;
   input.set_type(commands::Input::SEND_COMMAND);
@@ -672,6 +678,9 @@ absl::Status SessionHandlerInterpreter::Eval(
   } else if (command == "CLEAR_USAGE_STATS") {
     MOZC_ASSERT_EQ(1, args.size());
     ClearUsageStats();
+  } else if (command == "GET_MEMORY_STATS") {
+    MOZC_ASSERT_EQ(1, args.size());
+    MOZC_ASSERT_TRUE(client_->GetMemoryStats(last_output_.get()));
   } else {
     return absl::Status(absl::StatusCode::kUnimplemented, "");
   }
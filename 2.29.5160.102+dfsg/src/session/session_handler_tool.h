@@ -82,6 +82,7 @@ class SessionHandlerTool {
   bool SetRequest(const commands::Request &request, commands::Output *output);
   bool SetConfig(const config::Config &config, commands::Output *output);
   bool SyncData();
+  bool GetMemoryStats(commands::Output *output);
   void SetCallbackText(const std::string &text);
 
  private:
@@ -32,7 +32,11 @@
 #ifndef MOZC_SESSION_SESSION_INTERFACE_H_
 #define MOZC_SESSION_SESSION_INTERFACE_H_
 
+#include <memory>
+
+#include "base/memory_stats.h"
 #include "composer/table.h"
+#include "engine/engine_interface.h"
 #include "protocol/commands.pb.h"
 #include "protocol/config.pb.h"
 #include "session/internal/keymap.h"
@@ -67,6 +71,13 @@ class SessionInterface {
   // Set composition Table. Currently, this is especial for session::Session.
   virtual void SetTable(const composer::Table *table) {}
 
+  // Switches the session to |engine| unless a composition or a conversion is
+  // in progress, which keeps running on the engine it was started with.
+  // Returns true if the session uses |engine| after the call.
+  virtual bool SetEngine(const std::shared_ptr<EngineInterface> &engine) {
+    return false;
+  }
+
   // Set spellchecker.
   virtual void SetSpellCheckerService(
       const spelling::SpellCheckerServiceInterface *spellchecker_service) {}
@@ -75,6 +86,18 @@ class SessionInterface {
   virtual void set_client_capability(
       const commands::Capability &capability) = 0;
 
+  // Replaces the parts of the output unchanged from the previous one with
+  // commands::OutputDelta if the client supports it.
+  virtual void EncodeOutputDelta(commands::Command *command) {}
+
+  // Fills the output with the parts of the previous output which
+  // EncodeOutputDelta() may omit.
+  virtual void GetPreviousOutput(commands::Command *command) {}
+
+  // Sets the deadline of the conversions run by the next commands. The
+  // conversions past it return their partial results.
+  virtual void set_deadline(absl::Time deadline) {}
+
   // Set application information for this session.
   virtual void set_application_info(
       const commands::ApplicationInfo &application_info) = 0;
@@ -88,6 +111,10 @@ class SessionInterface {
   // return absl::InfinitePast (default value) if no command is executed in this
   // session.
   virtual absl::Time last_command_time() const = 0;
+
+  // Adds the approximate memory held by the session, e.g. the composer and
+  // the segments, to |stats|.
+  virtual void GetMemoryStats(MemoryStats *stats) const {}
 };
 
 }  // namespace session
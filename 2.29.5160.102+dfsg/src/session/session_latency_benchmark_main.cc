@@ -0,0 +1,451 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Measures the latency of the session commands per keystroke with an
+// in-process engine. The test sentences of RandomKeyEventsGenerator are typed
+// in romaji, JIS kana and Tsuki (2-263) layouts, converted, moved to the next
+// candidate and committed, in the same order on every run.
+//
+// Usage:
+//   session_latency_benchmark_main --dictionary=oss --sentences=200
+//       --output=latency.tsv
+//
+// The output is a TSV of the percentiles in microseconds per input method and
+// command:
+//   #input_method  command  count  p50  p90  p99  max
+//   romaji         insert   12345  35   60   120  800
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/file/temp_dir.h"
+#include "base/init_mozc.h"
+#include "base/japanese_util.h"
+#include "base/system_util.h"
+#include "base/util.h"
+#include "composer/table.h"
+#include "data_manager/data_manager_interface.h"
+#include "data_manager/oss/oss_data_manager.h"
+#include "data_manager/testing/mock_data_manager.h"
+#include "engine/engine.h"
+#include "protocol/commands.pb.h"
+#include "protocol/config.pb.h"
+#include "session/internal/keymap.h"
+#include "session/random_keyevents_generator.h"
+#include "session/session.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/flags/flag.h"
+#include "absl/log/check.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+
+ABSL_FLAG(std::string, dictionary, "oss", "Data set: 'oss' or 'mock'");
+ABSL_FLAG(std::string, engine, "desktop",
+          "Conversion engine: 'desktop' or 'mobile'");
+ABSL_FLAG(std::vector<std::string>, input_methods,
+          std::vector<std::string>({"romaji", "kana", "tsuki"}),
+          "Input methods to measure: 'romaji', 'kana' and/or 'tsuki'");
+ABSL_FLAG(int32_t, sentences, 200,
+          "Number of test sentences to type per input method. 0 types all.");
+ABSL_FLAG(int32_t, next_candidates, 2,
+          "Number of next-candidate keys per conversion");
+ABSL_FLAG(std::string, output, "", "Output file. Writes to stdout if empty.");
+
+namespace mozc {
+namespace {
+
+using ::mozc::session::RandomKeyEventsGenerator;
+
+enum CommandType {
+  INSERT,
+  SUGGEST,
+  CONVERT,
+  NEXT_CANDIDATE,
+  COMMIT,
+  NUM_COMMAND_TYPES,
+};
+
+constexpr absl::string_view kCommandNames[] = {
+    "insert", "suggest", "convert", "next_candidate", "commit",
+};
+static_assert(std::size(kCommandNames) == NUM_COMMAND_TYPES);
+
+struct KeyKana {
+  absl::string_view keys;
+  absl::string_view kana;
+};
+
+// JIS kana layout. The key codes of the shifted kana are those of the ASCII
+// layout.
+constexpr KeyKana kJisKanaLayout[] = {
+    {"1", "ぬ"},  {"2", "ふ"},  {"3", "あ"},  {"4", "う"},  {"5", "え"},
+    {"6", "お"},  {"7", "や"},  {"8", "ゆ"},  {"9", "よ"},  {"0", "わ"},
+    {"-", "ほ"},  {"^", "へ"},  {"|", "ー"},  {"q", "た"},  {"w", "て"},
+    {"e", "い"},  {"r", "す"},  {"t", "か"},  {"y", "ん"},  {"u", "な"},
+    {"i", "に"},  {"o", "ら"},  {"p", "せ"},  {"@", "゛"},  {"[", "゜"},
+    {"a", "ち"},  {"s", "と"},  {"d", "し"},  {"f", "は"},  {"g", "き"},
+    {"h", "く"},  {"j", "ま"},  {"k", "の"},  {"l", "り"},  {";", "れ"},
+    {":", "け"},  {"]", "む"},  {"z", "つ"},  {"x", "さ"},  {"c", "そ"},
+    {"v", "ひ"},  {"b", "こ"},  {"n", "み"},  {"m", "も"},  {",", "ね"},
+    {".", "る"},  {"/", "め"},  {"\\", "ろ"}, {"#", "ぁ"},  {"$", "ぅ"},
+    {"%", "ぇ"},  {"&", "ぉ"},  {"'", "ゃ"},  {"(", "ゅ"},  {")", "ょ"},
+    {"~", "を"},  {"E", "ぃ"},  {"Z", "っ"},  {"<", "、"},  {">", "。"},
+    {"?", "・"},  {"{", "「"},  {"}", "」"},
+};
+
+// Tsuki 2-263 layout. "k" prefixes the shifted kana of the left hand and "d"
+// prefixes those of the right hand. "l" and "/" are the voiced and the
+// semi-voiced sound marks typed after the kana.
+constexpr KeyKana kTsukiLayout[] = {
+    {"q", "そ"},  {"w", "こ"},  {"e", "し"},  {"r", "て"},  {"t", "ょ"},
+    {"y", "つ"},  {"u", "ん"},  {"i", "い"},  {"o", "の"},  {"p", "り"},
+    {"[", "ち"},  {"]", "・"},  {"a", "は"},  {"s", "か"},  {"f", "と"},
+    {"g", "た"},  {"h", "く"},  {"j", "う"},  {"l", "゛"},  {";", "き"},
+    {"'", "れ"},  {"z", "す"},  {"x", "け"},  {"c", "に"},  {"v", "な"},
+    {"b", "さ"},  {"n", "っ"},  {"m", "る"},  {",", "、"},  {".", "。"},
+    {"/", "゜"},  {"kq", "ぁ"}, {"kw", "ひ"}, {"ke", "ほ"}, {"kr", "ふ"},
+    {"kt", "め"}, {"ka", "ぃ"}, {"ks", "を"}, {"kd", "ら"}, {"kf", "あ"},
+    {"kg", "よ"}, {"kz", "ぅ"}, {"kx", "へ"}, {"kc", "せ"}, {"kv", "ゅ"},
+    {"kb", "ゃ"}, {"dy", "ぬ"}, {"du", "え"}, {"di", "み"}, {"do", "や"},
+    {"dp", "ぇ"}, {"d[", "「"}, {"dh", "ま"}, {"dj", "お"}, {"dk", "も"},
+    {"dl", "わ"}, {"d;", "ゆ"}, {"d'", "」"}, {"dn", "む"}, {"dm", "ろ"},
+    {"d,", "ね"}, {"d.", "ー"}, {"d/", "ぉ"},
+};
+
+// Voiced and semi-voiced kana and the kana they are composed from.
+constexpr absl::string_view kVoicedKana[][2] = {
+    {"ゔ", "う"}, {"が", "か"}, {"ぎ", "き"}, {"ぐ", "く"}, {"げ", "け"},
+    {"ご", "こ"}, {"ざ", "さ"}, {"じ", "し"}, {"ず", "す"}, {"ぜ", "せ"},
+    {"ぞ", "そ"}, {"だ", "た"}, {"ぢ", "ち"}, {"づ", "つ"}, {"で", "て"},
+    {"ど", "と"}, {"ば", "は"}, {"び", "ひ"}, {"ぶ", "ふ"}, {"べ", "へ"},
+    {"ぼ", "ほ"},
+};
+constexpr absl::string_view kSemiVoicedKana[][2] = {
+    {"ぱ", "は"}, {"ぴ", "ひ"}, {"ぷ", "ふ"}, {"ぺ", "へ"}, {"ぽ", "ほ"},
+};
+
+// Maps a kana to the keys typing it on a layout, and the voiced kana to the
+// keys of their base kana followed by the sound mark.
+class KanaLayout {
+ public:
+  KanaLayout(absl::Span<const KeyKana> layout, absl::string_view voiced_mark,
+             absl::string_view semi_voiced_mark) {
+    for (const KeyKana &key_kana : layout) {
+      keys_.emplace(key_kana.kana, std::vector<KeyKana>({key_kana}));
+    }
+    AddComposed(kVoicedKana, voiced_mark);
+    AddComposed(kSemiVoicedKana, semi_voiced_mark);
+  }
+
+  // Returns the keys typing |sentence|. The characters missing in the layout
+  // are skipped.
+  std::vector<KeyKana> Type(absl::string_view sentence) const {
+    std::vector<std::string> chars;
+    Util::SplitStringToUtf8Chars(sentence, &chars);
+    std::vector<KeyKana> result;
+    for (const std::string &c : chars) {
+      if (const auto it = keys_.find(c); it != keys_.end()) {
+        result.insert(result.end(), it->second.begin(), it->second.end());
+      }
+    }
+    return result;
+  }
+
+ private:
+  void AddComposed(absl::Span<const absl::string_view[2]> composed,
+                   absl::string_view mark) {
+    const auto mark_it = keys_.find(mark);
+    CHECK(mark_it != keys_.end());
+    for (const auto &[kana, base] : composed) {
+      const auto base_it = keys_.find(base);
+      if (base_it == keys_.end()) {
+        continue;
+      }
+      std::vector<KeyKana> keys = base_it->second;
+      keys.insert(keys.end(), mark_it->second.begin(), mark_it->second.end());
+      keys_.emplace(kana, std::move(keys));
+    }
+  }
+
+  absl::flat_hash_map<absl::string_view, std::vector<KeyKana>> keys_;
+};
+
+// Returns the romaji table emulating the Tsuki layout. The kana taking the
+// sound marks stay pending until the next key.
+std::string CreateTsukiRomanTable() {
+  absl::flat_hash_map<absl::string_view, absl::string_view> voiceable;
+  for (const auto &[kana, base] : kVoicedKana) {
+    voiceable.emplace(base, kana);
+  }
+  std::string table;
+  for (const KeyKana &key_kana : kTsukiLayout) {
+    if (voiceable.contains(key_kana.kana)) {
+      absl::StrAppend(&table, key_kana.keys, "\t\t", key_kana.kana, "\n");
+    } else {
+      absl::StrAppend(&table, key_kana.keys, "\t", key_kana.kana, "\n");
+    }
+  }
+  for (const auto &[kana, base] : kVoicedKana) {
+    absl::StrAppend(&table, base, "l\t", kana, "\n");
+  }
+  for (const auto &[kana, base] : kSemiVoicedKana) {
+    absl::StrAppend(&table, base, "/\t", kana, "\n");
+  }
+  return table;
+}
+
+std::vector<commands::KeyEvent> TypeRomaji(absl::string_view sentence) {
+  std::string full_width, romaji;
+  japanese_util::HiraganaToRomanji(sentence, &full_width);
+  japanese_util::FullWidthToHalfWidth(full_width, &romaji);
+  std::vector<commands::KeyEvent> keys;
+  for (const char c : romaji) {
+    if (c < 0x20 || c >= 0x7F) {
+      continue;
+    }
+    commands::KeyEvent &key = keys.emplace_back();
+    key.set_key_code(c);
+  }
+  return keys;
+}
+
+std::vector<commands::KeyEvent> TypeKana(const KanaLayout &layout,
+                                         absl::string_view sentence) {
+  std::vector<commands::KeyEvent> keys;
+  for (const KeyKana &key_kana : layout.Type(sentence)) {
+    commands::KeyEvent &key = keys.emplace_back();
+    key.set_key_code(key_kana.keys[0]);
+    key.set_key_string(std::string(key_kana.kana));
+  }
+  return keys;
+}
+
+std::vector<commands::KeyEvent> TypeTsuki(const KanaLayout &layout,
+                                          absl::string_view sentence) {
+  // The client sends the raw keys and the romaji table composes them.
+  std::vector<commands::KeyEvent> keys;
+  for (const KeyKana &key_kana : layout.Type(sentence)) {
+    for (const char c : key_kana.keys) {
+      commands::KeyEvent &key = keys.emplace_back();
+      key.set_key_code(c);
+    }
+  }
+  return keys;
+}
+
+class LatencyRecorder {
+ public:
+  void Add(CommandType type, absl::Duration latency) {
+    latencies_[type].push_back(latency);
+  }
+
+  // Writes a line per command type.
+  void Write(absl::string_view input_method, std::ostream &out) {
+    for (int type = 0; type < NUM_COMMAND_TYPES; ++type) {
+      std::vector<absl::Duration> &latencies = latencies_[type];
+      if (latencies.empty()) {
+        continue;
+      }
+      std::sort(latencies.begin(), latencies.end());
+      auto percentile = [&latencies](int p) {
+        const size_t index =
+            std::min(latencies.size() - 1, latencies.size() * p / 100);
+        return absl::ToInt64Microseconds(latencies[index]);
+      };
+      out << input_method << "\t" << kCommandNames[type] << "\t"
+          << latencies.size() << "\t" << percentile(50) << "\t"
+          << percentile(90) << "\t" << percentile(99) << "\t"
+          << percentile(100) << "\n";
+    }
+  }
+
+ private:
+  std::vector<absl::Duration> latencies_[NUM_COMMAND_TYPES];
+};
+
+void SendKey(session::Session &session, const commands::KeyEvent &key,
+             bool request_suggestion) {
+  commands::Command command;
+  commands::Input *input = command.mutable_input();
+  input->set_type(commands::Input::SEND_KEY);
+  *input->mutable_key() = key;
+  input->set_request_suggestion(request_suggestion);
+  session.SendKey(&command);
+}
+
+void SendSpecialKey(session::Session &session,
+                    commands::KeyEvent::SpecialKey special_key) {
+  commands::KeyEvent key;
+  key.set_special_key(special_key);
+  SendKey(session, key, true);
+}
+
+void UpdateSuggestion(session::Session &session) {
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+  command.mutable_input()->mutable_command()->set_type(
+      commands::SessionCommand::UPDATE_SUGGESTION);
+  session.SendCommand(&command);
+}
+
+template <class F>
+absl::Duration Measure(F &&f) {
+  const absl::Time start = absl::Now();
+  f();
+  return absl::Now() - start;
+}
+
+// Types |sentences| with the keys given by |type| and records the latency of
+// each command.
+template <class TypeFunc>
+void Run(EngineInterface &engine, const config::Config &config,
+         absl::Span<const char *const> sentences, TypeFunc &&type,
+         LatencyRecorder &recorder) {
+  const commands::Request request;
+  composer::TableManager table_manager;
+  const keymap::KeyMapManager key_map_manager(config);
+  session::Session session(&engine);
+  session.SetConfig(&config);
+  session.SetRequest(&request);
+  session.SetKeyMapManager(&key_map_manager);
+  session.SetTable(
+      table_manager.GetTable(request, config, *engine.GetDataManager()));
+
+  const int next_candidates = absl::GetFlag(FLAGS_next_candidates);
+  for (const absl::string_view sentence : sentences) {
+    const std::vector<commands::KeyEvent> keys = type(sentence);
+    if (keys.empty()) {
+      continue;
+    }
+    // The insertion and the suggestion are measured separately as the
+    // suggestion may be skipped or deferred by the client.
+    for (const commands::KeyEvent &key : keys) {
+      recorder.Add(INSERT, Measure([&] { SendKey(session, key, false); }));
+      recorder.Add(SUGGEST, Measure([&] { UpdateSuggestion(session); }));
+    }
+    recorder.Add(CONVERT, Measure([&] {
+                   SendSpecialKey(session, commands::KeyEvent::SPACE);
+                 }));
+    for (int i = 0; i < next_candidates; ++i) {
+      recorder.Add(NEXT_CANDIDATE, Measure([&] {
+                     SendSpecialKey(session, commands::KeyEvent::SPACE);
+                   }));
+    }
+    recorder.Add(COMMIT, Measure([&] {
+                   SendSpecialKey(session, commands::KeyEvent::ENTER);
+                 }));
+  }
+}
+
+absl::StatusOr<std::unique_ptr<Engine>> CreateEngine() {
+  std::unique_ptr<const DataManagerInterface> data_manager;
+  if (absl::GetFlag(FLAGS_dictionary) == "mock") {
+    data_manager = std::make_unique<const testing::MockDataManager>();
+  } else {
+    data_manager = std::make_unique<const oss::OssDataManager>();
+  }
+  if (absl::GetFlag(FLAGS_engine) == "mobile") {
+    return Engine::CreateMobileEngine(std::move(data_manager));
+  }
+  return Engine::CreateDesktopEngine(std::move(data_manager));
+}
+
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+  // Keeps the user history of the runs away from the user profile.
+  absl::StatusOr<mozc::TempDirectory> temp_dir =
+      mozc::TempDirectory::Default().CreateTempDirectory();
+  CHECK_OK(temp_dir);
+  mozc::SystemUtil::SetUserProfileDirectory(temp_dir->path());
+
+  absl::StatusOr<std::unique_ptr<mozc::Engine>> engine = mozc::CreateEngine();
+  CHECK_OK(engine);
+
+  absl::Span<const char *const> sentences =
+      mozc::session::RandomKeyEventsGenerator::GetTestSentences();
+  const size_t num_sentences =
+      std::max<int32_t>(absl::GetFlag(FLAGS_sentences), 0);
+  if (num_sentences > 0 && num_sentences < sentences.size()) {
+    sentences = sentences.subspan(0, num_sentences);
+  }
+
+  std::ofstream file;
+  if (!absl::GetFlag(FLAGS_output).empty()) {
+    file.open(absl::GetFlag(FLAGS_output));
+  }
+  std::ostream &out = file.is_open() ? file : std::cout;
+  out << "#input_method\tcommand\tcount\tp50\tp90\tp99\tmax\n";
+
+  const mozc::KanaLayout jis_kana_layout(mozc::kJisKanaLayout, "゛", "゜");
+  const mozc::KanaLayout tsuki_layout(mozc::kTsukiLayout, "゛", "゜");
+  for (const std::string &input_method : absl::GetFlag(FLAGS_input_methods)) {
+    mozc::config::Config config;
+    mozc::LatencyRecorder recorder;
+    if (input_method == "romaji") {
+      mozc::Run(**engine, config, sentences, mozc::TypeRomaji, recorder);
+    } else if (input_method == "kana") {
+      config.set_preedit_method(mozc::config::Config::KANA);
+      mozc::Run(
+          **engine, config, sentences,
+          [&](absl::string_view s) {
+            return mozc::TypeKana(jis_kana_layout, s);
+          },
+          recorder);
+    } else if (input_method == "tsuki") {
+      config.set_custom_roman_table(mozc::CreateTsukiRomanTable());
+      mozc::Run(
+          **engine, config, sentences,
+          [&](absl::string_view s) {
+            return mozc::TypeTsuki(tsuki_layout, s);
+          },
+          recorder);
+    } else {
+      LOG(ERROR) << "Unknown input method: " << input_method;
+      continue;
+    }
+    recorder.Write(input_method, out);
+  }
+  return 0;
+}
@@ -36,6 +36,8 @@
 #include <string>
 #include <vector>
 
+#include "base/clock.h"
+#include "base/clock_mock.h"
 #include "base/logging.h"
 #include "base/util.h"
 #include "composer/composer.h"
@@ -66,6 +68,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 namespace mozc {
 
@@ -571,8 +574,8 @@ class SessionTest : public testing::TestWithTempUserProfile {
     // For reverse conversion, key is the original kanji string.
     candidate->key = kanji;
     candidate->value = hiragana;
-    EXPECT_CALL(*converter, StartReverseConversion(_, _))
-        .WillOnce(DoAll(SetArgPointee<0>(reverse_segments), Return(true)));
+    EXPECT_CALL(*converter, StartReverseConversionForRequest(_, _, _))
+        .WillOnce(DoAll(SetArgPointee<1>(reverse_segments), Return(true)));
     // Set up Segments for forward conversion.
     Segments segments;
     segment = segments.add_segment();
@@ -3005,6 +3008,65 @@ TEST_F(SessionTest, StopKeyToggling) {
   EXPECT_PREEDIT("ああ", command);
 }
 
+TEST_F(SessionTest, DebounceSuggestion) {
+  ClockMock clock(absl::FromUnixSeconds(1000));
+  Clock::SetClockForUnitTest(&clock);
+
+  MockConverter converter;
+  MockEngine engine;
+  EXPECT_CALL(engine, GetConverter()).WillRepeatedly(Return(&converter));
+
+  Session session(&engine);
+  InitSessionToPrecomposition(&session);
+  commands::Capability capability;
+  capability.set_suggestion_debounce_msec(100);
+  session.set_client_capability(capability);
+
+  Segments segments;
+  SetAiueo(&segments);
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _))
+      .WillRepeatedly(DoAll(SetArgPointee<1>(segments), Return(true)));
+
+  commands::Command command;
+  InsertCharacterChars("a", &session, &command);
+  EXPECT_FALSE(command.output().suggestion_deferred());
+  Mock::VerifyAndClearExpectations(&converter);
+
+  // The next key comes within the interval.
+  clock.Advance(absl::Milliseconds(50));
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _)).Times(0);
+  InsertCharacterChars("i", &session, &command);
+  EXPECT_TRUE(command.output().consumed());
+  EXPECT_TRUE(command.output().suggestion_deferred());
+  EXPECT_FALSE(command.output().has_candidates());
+  EXPECT_EQ(GetComposition(command), "あい");
+  Mock::VerifyAndClearExpectations(&converter);
+
+  // The client asks for the suggestion as the typing has paused.
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+  command.mutable_input()->mutable_command()->set_type(
+      commands::SessionCommand::UPDATE_SUGGESTION);
+  EXPECT_TRUE(session.SendCommand(&command));
+  EXPECT_TRUE(command.output().consumed());
+  EXPECT_FALSE(command.output().suggestion_deferred());
+  EXPECT_TRUE(command.output().has_candidates());
+  EXPECT_EQ(GetComposition(command), "あい");
+  Mock::VerifyAndClearExpectations(&converter);
+
+  // A key after the interval gets the suggestion immediately.
+  clock.Advance(absl::Milliseconds(500));
+  EXPECT_CALL(converter, StartSuggestionForRequest(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(segments), Return(true)));
+  InsertCharacterChars("u", &session, &command);
+  EXPECT_FALSE(command.output().suggestion_deferred());
+  EXPECT_TRUE(command.output().has_candidates());
+
+  Clock::SetClockForUnitTest(nullptr);
+}
+
 TEST_F(SessionTest, CommitRawText) {
   MockConverter converter;
   MockEngine engine;
@@ -62,6 +62,7 @@
       ],
       'dependencies': [
         '../base/absl.gyp:absl_base',
+        '../base/base_test.gyp:clock_mock',
         '../data_manager/testing/mock_data_manager.gyp:mock_data_manager',
         '../engine/engine.gyp:engine',
         '../engine/engine.gyp:mock_data_engine_factory',
@@ -189,6 +190,22 @@
         'test_size': 'small',
       },
     },
+    {
+      'target_name': 'output_delta_test',
+      'type': 'executable',
+      'sources': [
+        'output_delta_test.cc',
+      ],
+      'dependencies': [
+        '../base/absl.gyp:absl_base',
+        '../protocol/protocol.gyp:commands_proto',
+        '../testing/testing.gyp:gtest_main',
+        'session_base.gyp:output_delta',
+      ],
+      'variables': {
+        'test_size': 'small',
+      },
+    },
     {
       'target_name': 'session_internal_test',
       'type': 'executable',
@@ -315,6 +332,7 @@
         # 'session_converter_stress_test',
         # 'session_handler_scenario_test',
         # 'session_handler_stress_test',
+        'output_delta_test',
         'random_keyevents_generator_test',
         'request_test_util_test',
         'session_converter_test',
@@ -0,0 +1,478 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MOZC_STORAGE_FLAT_LRU_CACHE_H_
+#define MOZC_STORAGE_FLAT_LRU_CACHE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "absl/hash/hash.h"
+
+namespace mozc {
+namespace storage {
+
+// Eviction policy of FlatLruCache.
+enum class LruCachePolicy {
+  // Exact LRU.  Every lookup moves the element to the head of the list.
+  kLru,
+  // CLOCK (second chance) approximation of LRU.  A lookup only marks the
+  // element as referenced, and the list is kept in the insertion order.  When
+  // the cache is full, the referenced elements at the tail are given a second
+  // chance by moving them to the head, and the first unreferenced one is
+  // evicted.  Lookups don't write the links, so they are cheaper than kLru.
+  kClock,
+};
+
+// Alternative implementation of LruCache with the same interface.  The
+// elements are stored in one array, which is linked with 32-bit links instead
+// of pointers, and the keys are indexed by an open addressing hash table of
+// 32-bit element indices instead of absl::flat_hash_map<Key, Element *>.
+// This saves 24 bytes or more per element for small keys, and a lookup
+// touches only the hash table slot and the element.
+//
+// The array for max_elements is allocated on the first Insert() and never
+// moves, so the pointers to the elements and values stay valid until they are
+// evicted or erased, as with LruCache.  The elements are constructed only as
+// they are first used, so the pages of the array beyond them are usually not
+// backed by physical memory.  Only the hash table grows with the size.
+//
+// Note: like LruCache, this class keeps some resources inside of the
+// Key/Value, even if such a entry is erased.
+template <typename Key, typename Value,
+          LruCachePolicy kPolicy = LruCachePolicy::kLru>
+class FlatLruCache final {
+ public:
+  struct Element;
+
+  // Link to another element in the same array.  It is stored as the 32-bit
+  // byte distance from the link itself to the element, so that it can be used
+  // like the Element pointer of LruCache (e.g., elem = elem->next) without
+  // knowing the base address of the array.
+  class Link {
+   public:
+    Link() = default;
+    Link(const Link &) = delete;
+    Link &operator=(const Link &) = delete;
+
+    operator Element *() const {  // NOLINT(google-explicit-constructor)
+      if (offset_ == 0) {
+        return nullptr;
+      }
+      return reinterpret_cast<Element *>(
+          const_cast<char *>(reinterpret_cast<const char *>(this)) + offset_);
+    }
+    Element *operator->() const { return static_cast<Element *>(*this); }
+
+   private:
+    friend class FlatLruCache;
+
+    void Set(const Element *element) {
+      offset_ = element == nullptr
+                    ? 0
+                    : static_cast<int32_t>(
+                          reinterpret_cast<const char *>(element) -
+                          reinterpret_cast<const char *>(this));
+      DCHECK(element == nullptr || offset_ != 0);
+    }
+
+    int32_t offset_ = 0;
+  };
+
+  // Every Element is either on the free list or the lru list.  The
+  // free list is singly-linked and only uses the next link, while
+  // the LRU list is doubly-linked and uses both next and prev.
+  struct Element {
+    Link next;
+    Link prev;
+    Key key;
+    Value value;
+  };
+
+  // Constructs a new FlatLruCache that can hold at most max_elements
+  explicit FlatLruCache(size_t max_elements);
+
+  FlatLruCache(const FlatLruCache &) = delete;
+  FlatLruCache &operator=(const FlatLruCache &) = delete;
+  ~FlatLruCache();
+
+  // Adds the specified key/value pair into the cache, putting it at the head
+  // of the LRU list.
+  void Insert(const Key &key, const Value &value);
+
+  // Adds the specified key and return the Element added to the cache.
+  // Caller needs to set the value.  If the key already exists, its element is
+  // moved to the head and returned as is.
+  Element *Insert(const Key &key);
+
+  // Returns the cached value associated with the key, or NULL if the cache
+  // does not contain an entry for that key.
+  const Value *Lookup(const Key &key) { return MutableLookup(key); }
+
+  // return non-const Value
+  Value *MutableLookup(const Key &key);
+
+  // Lookup/MutableLookup don't change the LRU order.
+  const Value *LookupWithoutInsert(const Key &key) const {
+    return MutableLookupWithoutInsert(key);
+  }
+  Value *MutableLookupWithoutInsert(const Key &key) const;
+
+  // Removes the cache entry specified by key.  Returns true if the entry was
+  // in the cache, otherwise returns false.
+  bool Erase(const Key &key);
+
+  // Removes all entries from the cache.  Note that this does not release the
+  // memory of the elements.
+  void Clear();
+
+  // Returns the number of entries currently in the cache.
+  size_t Size() const { return size_; }
+
+  bool HasKey(const Key &key) const { return FindSlot(key) != kNotFound; }
+
+  // Returns the head of LRU list
+  const Element *Head() const { return GetElement(head_); }
+  Element *MutableHead() const { return GetElement(head_); }
+
+  // Returns the tail of LRU list
+  const Element *Tail() const { return GetElement(tail_); }
+
+ private:
+  static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t kNotFound = std::numeric_limits<size_t>::max();
+
+  Element *GetElement(uint32_t index) const {
+    return index == kNone ? nullptr : &elements_[index];
+  }
+  uint32_t GetIndex(const Element *element) const {
+    return element == nullptr ? kNone
+                              : static_cast<uint32_t>(element - elements_);
+  }
+
+  size_t GetHomeSlot(const Key &key) const {
+    return absl::Hash<Key>()(key) & slot_mask_;
+  }
+
+  // Returns the position of the hash table slot of key, or kNotFound.
+  size_t FindSlot(const Key &key) const;
+
+  // Adds the element to the hash table.
+  void AddSlot(uint32_t index);
+
+  // Removes the slot at pos.  The following slots of the same cluster are
+  // shifted back so that the table doesn't need tombstones.
+  void RemoveSlot(size_t pos);
+
+  // Doubles the hash table.
+  void GrowSlots();
+
+  // Returns a free element, popping from the free list if possible, or
+  // allocating a new element if the free list is empty.  If there are already
+  // max_elements_ in use this will return NULL.
+  Element *NextFreeElement();
+
+  // Returns the element to be evicted when the cache is full.
+  Element *SelectVictim();
+
+  void RemoveFromLRU(Element *element);
+  void PushLRUHead(Element *element);
+
+  // Removes the element from the hash table and the LRU list.
+  void Evict(Element *element);
+
+  // Allocated for max_elements_ on the first use.  Only the elements in
+  // [0, used_) are constructed.
+  Element *elements_ = nullptr;
+  size_t used_ = 0;
+  size_t size_ = 0;
+  std::unique_ptr<uint32_t[]> slots_;  // element index + 1, or 0 if empty
+  size_t slot_mask_ = 0;
+  std::vector<bool> referenced_;  // used only for kClock
+  uint32_t free_list_ = kNone;
+  uint32_t head_ = kNone;
+  uint32_t tail_ = kNone;
+  const size_t max_elements_;
+};
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+FlatLruCache<Key, Value, kPolicy>::FlatLruCache(size_t max_elements)
+    : max_elements_(max_elements) {
+  CHECK_LT(max_elements_, std::numeric_limits<uint32_t>::max() / 2);
+  CHECK_LT(max_elements_ * sizeof(Element),
+           static_cast<size_t>(std::numeric_limits<int32_t>::max()));
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+FlatLruCache<Key, Value, kPolicy>::~FlatLruCache() {
+  if (elements_ == nullptr) {
+    return;
+  }
+  std::destroy_n(elements_, used_);
+  std::allocator<Element>().deallocate(elements_, max_elements_);
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+size_t FlatLruCache<Key, Value, kPolicy>::FindSlot(const Key &key) const {
+  if (slots_ == nullptr) {
+    return kNotFound;
+  }
+  for (size_t pos = GetHomeSlot(key); slots_[pos] != 0;
+       pos = (pos + 1) & slot_mask_) {
+    if (elements_[slots_[pos] - 1].key == key) {
+      return pos;
+    }
+  }
+  return kNotFound;
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+void FlatLruCache<Key, Value, kPolicy>::AddSlot(uint32_t index) {
+  size_t pos = GetHomeSlot(elements_[index].key);
+  while (slots_[pos] != 0) {
+    pos = (pos + 1) & slot_mask_;
+  }
+  slots_[pos] = index + 1;
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+void FlatLruCache<Key, Value, kPolicy>::RemoveSlot(size_t pos) {
+  size_t hole = pos;
+  for (size_t i = (pos + 1) & slot_mask_; slots_[i] != 0;
+       i = (i + 1) & slot_mask_) {
+    // The slot can fill the hole unless its home is in (hole, i].
+    const size_t home = GetHomeSlot(elements_[slots_[i] - 1].key);
+    if (((i - home) & slot_mask_) >= ((i - hole) & slot_mask_)) {
+      slots_[hole] = slots_[i];
+      hole = i;
+    }
+  }
+  slots_[hole] = 0;
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+void FlatLruCache<Key, Value, kPolicy>::GrowSlots() {
+  // Keeps the load factor of the hash table at most 1/2.
+  const size_t num_slots = slots_ == nullptr ? 16 : (slot_mask_ + 1) * 2;
+  slots_ = std::make_unique<uint32_t[]>(num_slots);
+  slot_mask_ = num_slots - 1;
+  for (Element *e = GetElement(head_); e != nullptr; e = e->next) {
+    AddSlot(GetIndex(e));
+  }
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+typename FlatLruCache<Key, Value, kPolicy>::Element *
+FlatLruCache<Key, Value, kPolicy>::NextFreeElement() {
+  if (free_list_ != kNone) {
+    Element *e = GetElement(free_list_);
+    free_list_ = GetIndex(e->next);
+    e->next.Set(nullptr);
+    return e;
+  }
+  if (used_ == max_elements_) {
+    return nullptr;
+  }
+  if (elements_ == nullptr) {
+    elements_ = std::allocator<Element>().allocate(max_elements_);
+    if constexpr (kPolicy == LruCachePolicy::kClock) {
+      referenced_.resize(max_elements_);
+    }
+  }
+  return new (&elements_[used_++]) Element();
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+typename FlatLruCache<Key, Value, kPolicy>::Element *
+FlatLruCache<Key, Value, kPolicy>::SelectVictim() {
+  Element *e = GetElement(tail_);
+  if constexpr (kPolicy == LruCachePolicy::kClock) {
+    // Terminates because every visited element loses its reference bit.
+    while (referenced_[GetIndex(e)]) {
+      referenced_[GetIndex(e)] = false;
+      PushLRUHead(e);
+      e = GetElement(tail_);
+    }
+  }
+  return e;
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+void FlatLruCache<Key, Value, kPolicy>::RemoveFromLRU(Element *element) {
+  Element *prev = element->prev;
+  Element *next = element->next;
+  if (head_ == GetIndex(element)) {
+    head_ = GetIndex(next);
+  }
+  if (tail_ == GetIndex(element)) {
+    tail_ = GetIndex(prev);
+  }
+  if (prev != nullptr) {
+    prev->next.Set(next);
+  }
+  if (next != nullptr) {
+    next->prev.Set(prev);
+  }
+  element->prev.Set(nullptr);
+  element->next.Set(nullptr);
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+void FlatLruCache<Key, Value, kPolicy>::PushLRUHead(Element *element) {
+  const uint32_t index = GetIndex(element);
+  if (head_ == index) {
+    // element is already at head, so do nothing.
+    return;
+  }
+  RemoveFromLRU(element);
+  Element *head = GetElement(head_);
+  element->next.Set(head);
+  if (head != nullptr) {
+    head->prev.Set(element);
+  }
+  head_ = index;
+  if (tail_ == kNone) {
+    tail_ = index;
+  }
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+void FlatLruCache<Key, Value, kPolicy>::Evict(Element *element) {
+  const size_t pos = FindSlot(element->key);
+  CHECK_NE(pos, kNotFound);
+  RemoveSlot(pos);
+  RemoveFromLRU(element);
+  element->next.Set(GetElement(free_list_));
+  free_list_ = GetIndex(element);
+  --size_;
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+void FlatLruCache<Key, Value, kPolicy>::Insert(const Key &key,
+                                               const Value &value) {
+  Element *e = Insert(key);
+  if (e != nullptr) {
+    e->value = value;
+  }
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+typename FlatLruCache<Key, Value, kPolicy>::Element *
+FlatLruCache<Key, Value, kPolicy>::Insert(const Key &key) {
+  if (const size_t pos = FindSlot(key); pos != kNotFound) {
+    Element *e = &elements_[slots_[pos] - 1];
+    PushLRUHead(e);
+    return e;
+  }
+
+  Element *e = NextFreeElement();
+  if (e == nullptr) {
+    // no free elements, I have to replace an existing element
+    Evict(SelectVictim());
+    e = NextFreeElement();
+    CHECK(e != nullptr);
+  }
+  e->key = key;
+  const uint32_t index = GetIndex(e);
+  if (size_ + 1 > (slot_mask_ + 1) / 2) {
+    // The new element is not linked yet, so it's added after the rehash.
+    GrowSlots();
+  }
+  AddSlot(index);
+  if constexpr (kPolicy == LruCachePolicy::kClock) {
+    referenced_[index] = false;
+  }
+  PushLRUHead(e);
+  ++size_;
+  return e;
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+Value *FlatLruCache<Key, Value, kPolicy>::MutableLookup(const Key &key) {
+  const size_t pos = FindSlot(key);
+  if (pos == kNotFound) {
+    return nullptr;
+  }
+  const uint32_t index = slots_[pos] - 1;
+  if constexpr (kPolicy == LruCachePolicy::kClock) {
+    referenced_[index] = true;
+  } else {
+    PushLRUHead(&elements_[index]);
+  }
+  return &elements_[index].value;
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+Value *FlatLruCache<Key, Value, kPolicy>::MutableLookupWithoutInsert(
+    const Key &key) const {
+  const size_t pos = FindSlot(key);
+  if (pos == kNotFound) {
+    return nullptr;
+  }
+  return &elements_[slots_[pos] - 1].value;
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+bool FlatLruCache<Key, Value, kPolicy>::Erase(const Key &key) {
+  const size_t pos = FindSlot(key);
+  if (pos == kNotFound) {
+    return false;
+  }
+  Evict(&elements_[slots_[pos] - 1]);
+  return true;
+}
+
+template <typename Key, typename Value, LruCachePolicy kPolicy>
+void FlatLruCache<Key, Value, kPolicy>::Clear() {
+  if (slots_ != nullptr) {
+    std::fill(slots_.get(), slots_.get() + slot_mask_ + 1, 0);
+  }
+  // All the constructed elements go back to the free list.
+  free_list_ = head_ = tail_ = kNone;
+  for (size_t i = used_; i > 0; --i) {
+    Element &e = elements_[i - 1];
+    e.prev.Set(nullptr);
+    e.next.Set(GetElement(free_list_));
+    free_list_ = static_cast<uint32_t>(i - 1);
+  }
+  size_ = 0;
+}
+
+}  // namespace storage
+}  // namespace mozc
+
+#endif  // MOZC_STORAGE_FLAT_LRU_CACHE_H_
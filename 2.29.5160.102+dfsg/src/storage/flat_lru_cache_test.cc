@@ -0,0 +1,240 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "storage/flat_lru_cache.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "storage/lru_cache.h"
+#include "testing/gmock.h"
+#include "testing/gunit.h"
+
+namespace mozc {
+namespace storage {
+namespace {
+
+using ::testing::ElementsAre;
+
+template <typename Cache>
+std::vector<typename Cache::Element *> GetElements(const Cache &cache) {
+  std::vector<typename Cache::Element *> elements;
+  for (auto *elem = cache.MutableHead(); elem != nullptr; elem = elem->next) {
+    elements.push_back(elem);
+  }
+  return elements;
+}
+
+template <typename Cache>
+std::vector<int> GetOrderedKeys(const Cache &cache) {
+  std::vector<int> keys;
+  keys.reserve(cache.Size());
+  for (auto *elem = cache.Head(); elem != nullptr; elem = elem->next) {
+    keys.push_back(elem->key);
+  }
+  // The list is also linked backward.
+  std::vector<int> reversed;
+  for (auto *elem = cache.Tail(); elem != nullptr; elem = elem->prev) {
+    reversed.insert(reversed.begin(), elem->key);
+  }
+  EXPECT_EQ(keys, reversed);
+  return keys;
+}
+
+TEST(FlatLruCacheTest, Insert) {
+  FlatLruCache<int, int> cache(3);
+  EXPECT_EQ(cache.Size(), 0);
+  EXPECT_EQ(cache.Head(), nullptr);
+
+  cache.Insert(0, 0);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(0));
+  cache.Insert(1, 1);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(1, 0));
+  cache.Insert(2, 2);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(2, 1, 0));
+  cache.Insert(3, 3);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(3, 2, 1));
+  cache.Insert(1, 10);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(1, 3, 2));
+  EXPECT_EQ(*cache.LookupWithoutInsert(1), 10);
+  EXPECT_EQ(cache.Size(), 3);
+}
+
+TEST(FlatLruCacheTest, Lookup) {
+  FlatLruCache<int, int> cache(5);
+  for (int i = 0; i < 3; ++i) {
+    cache.Insert(i, i);
+  }
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(2, 1, 0));
+
+  // Looked up elements are moved to the head.
+  EXPECT_TRUE(cache.Lookup(0) != nullptr);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(0, 2, 1));
+  EXPECT_TRUE(cache.Lookup(1) != nullptr);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(1, 0, 2));
+
+  EXPECT_TRUE(cache.Lookup(-1) == nullptr);
+  EXPECT_TRUE(cache.Lookup(3) == nullptr);
+
+  // Unlike Lookup, LRU order shouldn't change.
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(*cache.LookupWithoutInsert(i), i);
+    EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(1, 0, 2));
+  }
+}
+
+TEST(FlatLruCacheTest, EraseAndClear) {
+  FlatLruCache<int, int> cache(5);
+  for (int i = 0; i < 3; ++i) {
+    cache.Insert(i, i);
+  }
+  EXPECT_FALSE(cache.Erase(-1));
+  EXPECT_TRUE(cache.Erase(1));
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(2, 0));
+  EXPECT_FALSE(cache.HasKey(1));
+  EXPECT_TRUE(cache.Erase(2));
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(0));
+  EXPECT_EQ(cache.Size(), 1);
+
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), 0);
+  EXPECT_FALSE(cache.HasKey(0));
+  EXPECT_EQ(cache.Head(), nullptr);
+  EXPECT_EQ(cache.Tail(), nullptr);
+  cache.Insert(5, 5);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(5));
+}
+
+TEST(FlatLruCacheTest, InsertElement) {
+  FlatLruCache<std::string, std::string> cache(2);
+  cache.Insert("a")->value = "A";
+  cache.Insert("b")->value = "B";
+  EXPECT_EQ(cache.MutableHead()->key, "b");
+  EXPECT_EQ(cache.Head()->next->key, "a");
+  *cache.MutableLookup("a") = "AA";
+  EXPECT_EQ(*cache.LookupWithoutInsert("a"), "AA");
+  EXPECT_EQ(cache.Tail()->value, "B");
+}
+
+TEST(FlatLruCacheTest, Clock) {
+  FlatLruCache<int, int, LruCachePolicy::kClock> cache(3);
+  for (int i = 0; i < 3; ++i) {
+    cache.Insert(i, i);
+  }
+  // Lookup doesn't change the order but gives a second chance.
+  EXPECT_EQ(*cache.Lookup(0), 0);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(2, 1, 0));
+  cache.Insert(3, 3);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(3, 0, 2));
+
+  // The second chance is used only once.
+  cache.Insert(4, 4);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(4, 3, 0));
+  cache.Insert(5, 5);
+  EXPECT_THAT(GetOrderedKeys(cache), ElementsAre(5, 4, 3));
+}
+
+// The behavior should be the same as LruCache, including the growth of the
+// hash table.
+TEST(FlatLruCacheTest, SameAsLruCache) {
+  constexpr int kCapacity = 1000;
+  LruCache<int, int> expected(kCapacity);
+  FlatLruCache<int, int> cache(kCapacity);
+  std::mt19937 random(0);
+  std::uniform_int_distribution<int> key_dist(0, 2 * kCapacity);
+  for (int i = 0; i < 20 * kCapacity; ++i) {
+    const int key = key_dist(random);
+    switch (random() % 4) {
+      case 0:
+      case 1:
+        expected.Insert(key, i);
+        cache.Insert(key, i);
+        break;
+      case 2: {
+        const int *expected_value = expected.Lookup(key);
+        const int *value = cache.Lookup(key);
+        ASSERT_EQ(expected_value == nullptr, value == nullptr);
+        if (value != nullptr) {
+          EXPECT_EQ(*value, *expected_value);
+        }
+        break;
+      }
+      default:
+        EXPECT_EQ(cache.Erase(key), expected.Erase(key));
+        break;
+    }
+    ASSERT_EQ(cache.Size(), expected.Size());
+    if (i % 1000 == 0) {
+      std::vector<int> expected_keys;
+      for (auto *elem = expected.Head(); elem != nullptr; elem = elem->next) {
+        expected_keys.push_back(elem->key);
+      }
+      ASSERT_EQ(GetOrderedKeys(cache), expected_keys);
+    }
+  }
+  EXPECT_EQ(GetElements(cache).size(), cache.Size());
+}
+
+TEST(FlatLruCacheTest, StableElements) {
+  constexpr int kCapacity = 100;
+  FlatLruCache<int, std::string> cache(kCapacity);
+  auto *first = cache.Insert(0);
+  first->value = "zero";
+  const std::string *value = cache.Lookup(0);
+  // The hash table grows several times, but the elements don't move.
+  for (int i = 1; i < kCapacity; ++i) {
+    cache.Insert(i, std::to_string(i));
+    ASSERT_EQ(cache.MutableLookupWithoutInsert(0), value);
+  }
+  EXPECT_EQ(cache.Tail(), first);
+  EXPECT_EQ(first->value, "zero");
+
+  // Erased elements are reused in place.
+  cache.Erase(0);
+  EXPECT_EQ(cache.Insert(kCapacity), first);
+  EXPECT_EQ(cache.Head(), first);
+}
+
+TEST(FlatLruCacheTest, LargeCapacity) {
+  constexpr int kCapacity = 1000000;
+  FlatLruCache<int, int> cache(kCapacity);
+  for (int i = 0; i < 3 * kCapacity; ++i) {
+    cache.Insert(i, i);
+    EXPECT_TRUE(cache.HasKey(i));
+    EXPECT_EQ(cache.Head()->key, i);
+    EXPECT_GE(kCapacity, cache.Size());
+  }
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace mozc
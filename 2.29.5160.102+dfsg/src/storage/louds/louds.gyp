@@ -65,6 +65,7 @@
         'louds_trie_builder.cc',
       ],
       'dependencies': [
+        '../../base/absl.gyp:absl_base',
         '../../base/base.gyp:base',
         'bit_stream',
       ],
@@ -31,12 +31,15 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/logging.h"
 #include "storage/louds/bit_stream.h"
+#include "absl/container/flat_hash_map.h"
 
 namespace mozc {
 namespace storage {
@@ -71,6 +74,60 @@ class EntryLengthLessThan {
   size_t length_;
 };
 
+// Reorders the entries in [begin, end), which are sorted and share the first
+// |depth| bytes, so that the children of the node at |depth| appear in the
+// descending order of their subtree weights.  Children having the same weight
+// keep the label order.  The entries sharing a prefix are kept contiguous and
+// the terminal entry of a node is kept first, so the result still satisfies
+// the pre-condition of the output loop in Build().  Returns the total weight
+// of the subtree.
+uint64_t ReorderByWeight(
+    const absl::flat_hash_map<std::string, uint64_t> &weight_map, size_t depth,
+    std::vector<Entry>::iterator begin, std::vector<Entry>::iterator end) {
+  uint64_t total_weight = 0;
+  if (begin != end && begin->word().length() == depth) {
+    if (const auto iter = weight_map.find(begin->word());
+        iter != weight_map.end()) {
+      total_weight += iter->second;
+    }
+    ++begin;
+  }
+
+  // {weight, [first, last)} for each child.
+  struct Child {
+    uint64_t weight;
+    std::vector<Entry>::iterator first;
+    std::vector<Entry>::iterator last;
+  };
+  std::vector<Child> children;
+  const std::vector<Entry>::iterator children_begin = begin;
+  while (begin != end) {
+    const char label = begin->word()[depth];
+    auto last = begin + 1;
+    while (last != end && last->word()[depth] == label) {
+      ++last;
+    }
+    const uint64_t weight = ReorderByWeight(weight_map, depth + 1, begin, last);
+    children.push_back({weight, begin, last});
+    total_weight += weight;
+    begin = last;
+  }
+  if (children.size() <= 1) {
+    return total_weight;
+  }
+
+  std::stable_sort(children.begin(), children.end(),
+                   [](const Child &lhs, const Child &rhs) {
+                     return lhs.weight > rhs.weight;
+                   });
+  std::vector<Entry> reordered;
+  for (const Child &child : children) {
+    reordered.insert(reordered.end(), child.first, child.last);
+  }
+  std::copy(reordered.begin(), reordered.end(), children_begin);
+  return total_weight;
+}
+
 }  // namespace
 
 void LoudsTrieBuilder::Add(const std::string &word) {
@@ -79,6 +136,13 @@ void LoudsTrieBuilder::Add(const std::string &word) {
   word_list_.push_back(word);
 }
 
+void LoudsTrieBuilder::Add(const std::string &word, uint64_t weight) {
+  Add(word);
+  if (weight > 0) {
+    weight_map_[word] += weight;
+  }
+}
+
 void LoudsTrieBuilder::Build() {
   CHECK(!built_);
 
@@ -92,6 +156,9 @@ void LoudsTrieBuilder::Build() {
     entry_list.push_back(Entry(word_list_[i], i));
   }
   id_list_.resize(word_list_.size(), -1);
+  if (!weight_map_.empty()) {
+    ReorderByWeight(weight_map_, 0, entry_list.begin(), entry_list.end());
+  }
 
   // Output the tree to streams.
   BitStream trie_stream;
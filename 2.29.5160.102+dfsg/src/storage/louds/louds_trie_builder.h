@@ -30,9 +30,12 @@
 #ifndef MOZC_STORAGE_LOUDS_LOUDS_TRIE_BUILDER_H_
 #define MOZC_STORAGE_LOUDS_LOUDS_TRIE_BUILDER_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+
 namespace mozc {
 namespace storage {
 namespace louds {
@@ -53,6 +56,13 @@ class LoudsTrieBuilder {
   // before Build invocation.
   void Add(const std::string &word);
 
+  // Same as above, but also accumulates |weight| (e.g., lookup frequency) for
+  // the word.  If any word has a non-zero weight, Build() orders the children
+  // of each node by the descending total weight of their subtrees instead of
+  // by label, so that frequent keys get small, contiguous ids in each level of
+  // the trie.  The lookup APIs of LoudsTrie don't depend on the child order.
+  void Add(const std::string &word, uint64_t weight);
+
   // Builds the trie image.
   void Build();
 
@@ -69,6 +79,7 @@ class LoudsTrieBuilder {
 
   std::vector<std::string> word_list_;
   std::vector<int> id_list_;
+  absl::flat_hash_map<std::string, uint64_t> weight_map_;
   std::string image_;
 };
 
@@ -30,6 +30,7 @@
 #include "storage/louds/louds_trie.h"
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "base/port.h"
@@ -529,6 +530,56 @@ TEST_P(LoudsTrieTest, RestoreKeyString) {
 }
 INSTANTIATE_TEST_CASE(GenRestoreKeyStringTest);
 
+TEST_P(LoudsTrieTest, WeightedBuild) {
+  // Children are ordered by the total weight of their subtrees (b: 100,
+  // a: 10).  The numbers are the key IDs, and "a" is not a key:
+  //
+  //   (root)
+  //   +-- b (0)
+  //   |   +-- bb (1)
+  //   |   +-- ba (2)
+  //   +-- a
+  //       +-- ab (3)
+  //       |   +-- abc (5)
+  //       +-- aa (4)
+  LoudsTrieBuilder builder;
+  builder.Add("aa");
+  builder.Add("ab", 10);
+  builder.Add("abc");
+  builder.Add("b");
+  builder.Add("ba");
+  builder.Add("bb", 100);
+  builder.Build();
+
+  EXPECT_EQ(builder.GetId("b"), 0);
+  EXPECT_EQ(builder.GetId("bb"), 1);
+  EXPECT_EQ(builder.GetId("ba"), 2);
+  EXPECT_EQ(builder.GetId("ab"), 3);
+  EXPECT_EQ(builder.GetId("aa"), 4);
+  EXPECT_EQ(builder.GetId("abc"), 5);
+
+  const CacheSizeParam &param = GetParam();
+  LoudsTrie trie;
+  trie.Open(reinterpret_cast<const uint8_t *>(builder.image().data()),
+            param.louds_lb0_cache_size, param.louds_lb1_cache_size,
+            param.louds_select0_cache_size, param.louds_select1_cache_size,
+            param.termvec_lb1_cache_size);
+
+  char buffer[LoudsTrie::kMaxDepth + 1];
+  for (const absl::string_view key : {"aa", "ab", "abc", "b", "ba", "bb"}) {
+    const int id = builder.GetId(std::string(key));
+    EXPECT_EQ(trie.ExactSearch(key), id) << key;
+    EXPECT_EQ(trie.RestoreKeyString(id, buffer), key);
+  }
+  EXPECT_EQ(trie.ExactSearch("a"), -1);
+  EXPECT_EQ(trie.ExactSearch("bc"), -1);
+
+  LoudsTrie::Node node = trie.MoveToFirstChild(LoudsTrie::Node());
+  EXPECT_EQ(trie.GetEdgeLabelToParentNode(node), 'b');
+  trie.Close();
+}
+INSTANTIATE_TEST_CASE(GenWeightedBuildTest);
+
 }  // namespace
 }  // namespace louds
 }  // namespace storage
@@ -0,0 +1,184 @@
+// Copyright 2010-2021, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Microbenchmark of LruCache and FlatLruCache.
+//
+// Usage:
+//   lru_cache_benchmark_main --size=10000 --key_range=20000 --iterations=10
+//
+// Each run simulates a cache of user history entries: keys are looked up with
+// a skewed (Zipf-like) distribution and inserted on miss.  The heap memory held
+// by a full cache is also reported.
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/init_mozc.h"
+#include "storage/flat_lru_cache.h"
+#include "storage/lru_cache.h"
+#include "absl/flags/flag.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+ABSL_FLAG(int32_t, size, 10000, "capacity of the cache");
+ABSL_FLAG(int32_t, key_range, 20000, "number of distinct keys");
+ABSL_FLAG(int32_t, operations, 1000000, "number of operations per iteration");
+ABSL_FLAG(int32_t, iterations, 10, "number of iterations");
+
+namespace {
+
+// Bytes currently allocated by operator new.
+std::atomic<size_t> g_allocated_bytes{0};
+
+// Each block is prefixed with its size so that operator delete can subtract it.
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+}  // namespace
+
+void *operator new(size_t size) {
+  void *block = std::malloc(size + kHeaderSize);
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+  *static_cast<size_t *>(block) = size;
+  g_allocated_bytes += size;
+  return static_cast<char *>(block) + kHeaderSize;
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  void *block = static_cast<char *>(ptr) - kHeaderSize;
+  g_allocated_bytes -= *static_cast<size_t *>(block);
+  std::free(block);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+namespace mozc {
+namespace storage {
+namespace {
+
+// Stand-in for the value of the user history, which is about 64 bytes.
+struct Payload {
+  uint64_t data[8];
+};
+
+std::vector<uint32_t> GenerateKeys(int key_range, int operations) {
+  // Inverse transform sampling of a power law so that a small fraction of the
+  // keys gets most of the lookups.
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  std::vector<uint32_t> keys;
+  keys.reserve(operations);
+  for (int i = 0; i < operations; ++i) {
+    const double r = std::pow(dist(random), 3.0);
+    // Scatters the ranks so that hot keys are not adjacent.
+    const uint32_t rank = static_cast<uint32_t>(r * key_range);
+    keys.push_back(rank * 2654435761u);
+  }
+  return keys;
+}
+
+// Returns the heap bytes held by a cache filled with distinct keys.
+template <typename Cache>
+size_t GetMemoryUsage() {
+  const size_t size = absl::GetFlag(FLAGS_size);
+  const size_t before = g_allocated_bytes;
+  Cache cache(size);
+  for (uint32_t i = 0; i < size; ++i) {
+    cache.Insert(i * 2654435761u)->value.data[0] = i;
+  }
+  return g_allocated_bytes - before;
+}
+
+template <typename Cache>
+void Run(absl::string_view name, const std::vector<uint32_t> &keys) {
+  const int iterations = absl::GetFlag(FLAGS_iterations);
+  absl::Duration total;
+  size_t hits = 0;
+  for (int i = 0; i < iterations; ++i) {
+    Cache cache(absl::GetFlag(FLAGS_size));
+    const absl::Time start = absl::Now();
+    for (const uint32_t key : keys) {
+      if (Payload *payload = cache.MutableLookup(key); payload != nullptr) {
+        ++payload->data[0];
+        ++hits;
+      } else {
+        cache.Insert(key)->value.data[0] = 0;
+      }
+    }
+    total += absl::Now() - start;
+  }
+  const double operations = static_cast<double>(keys.size()) * iterations;
+  const double bytes_per_entry = static_cast<double>(GetMemoryUsage<Cache>()) /
+                                 absl::GetFlag(FLAGS_size);
+  std::cout << name << ": "
+            << absl::ToDoubleNanoseconds(total) / operations << " ns/op, "
+            << "hit rate " << hits / operations << ", " << bytes_per_entry
+            << " bytes/entry" << std::endl;
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  mozc::InitMozc(argv[0], &argc, &argv);
+
+  using mozc::storage::FlatLruCache;
+  using mozc::storage::LruCache;
+  using mozc::storage::LruCachePolicy;
+  using mozc::storage::Payload;
+
+  const std::vector<uint32_t> keys = mozc::storage::GenerateKeys(
+      absl::GetFlag(FLAGS_key_range), absl::GetFlag(FLAGS_operations));
+  std::cout << "sizeof(LruCache::Element): "
+            << sizeof(LruCache<uint32_t, Payload>::Element) << std::endl
+            << "sizeof(FlatLruCache::Element): "
+            << sizeof(FlatLruCache<uint32_t, Payload>::Element) << std::endl;
+  mozc::storage::Run<LruCache<uint32_t, Payload>>("LruCache", keys);
+  mozc::storage::Run<FlatLruCache<uint32_t, Payload>>("FlatLruCache", keys);
+  mozc::storage::Run<
+      FlatLruCache<uint32_t, Payload, LruCachePolicy::kClock>>(
+      "FlatLruCache (CLOCK)", keys);
+  return 0;
+}
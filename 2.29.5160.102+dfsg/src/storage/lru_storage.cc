@@ -27,17 +27,18 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+
 #include "storage/lru_storage.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <ios>
-#include <iterator>
-#include <list>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
@@ -51,20 +52,73 @@
 #include "base/mmap.h"
 #include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+
+// File layout
+//
+// The file consists of four regions:
+//
+//   Header:  LruStorage::Header (36 bytes).
+//   Items:   |size| items of (fingerprint, timestamp, value), which is the
+//            same as the old (v1) layout. The used items are always packed at
+//            [0, used).
+//   Links:   |size| pairs of uint32 (prev, next) forming the LRU list.
+//   Buckets: An open addressing hash table from fingerprints to items.
+//            Each bucket holds (item index + 1), or 0 for an empty bucket.
+//
+// All the regions are 4-byte aligned, as the value size is a multiple of 4.
+//
+// The v1 layout had only a 12-byte header of (value size, size, seed)
+// followed by the items, and the LRU list was rebuilt by sorting the items on
+// every Open. As the first field of the v1 header is the value size, which is
+// at most 1024, it never matches the magic number of the current layout.
+//
+// The header has a state which is set while the index is being modified and
+// reset by Close(), which also stores a checksum of the header. If a process
+// dies in the middle of an update, the next Open() finds the state set and
+// rebuilds the index from the items. Otherwise Open() only checks the header,
+// so that opening a file doesn't touch every page. The links and the buckets
+// are checked when they are followed, and an index found broken is rebuilt by
+// the next update.
 
 namespace mozc {
 namespace storage {
+
+struct LruStorage::Header {
+  uint32_t magic;
+  uint32_t value_size;
+  uint32_t size;
+  uint32_t seed;
+  uint32_t head;  // The most recently used item.
+  uint32_t tail;  // The least recently used item.
+  uint32_t used;  // The number of used items.
+  uint32_t state;
+  uint32_t checksum;  // Fingerprint of the fields above, set by Close().
+};
+
 namespace {
 
+constexpr uint32_t kMagic = 0x3255524c;  // "LRU2" in little endian.
+
+// Values of Header::state.
+enum : uint32_t {
+  kIndexValid = 0,
+  kIndexUpdating = 1,  // Reset to kIndexValid by Close().
+  kIndexStale = 2,     // Items were written by Write(). Kept until Open().
+  kIndexBroken = 3,    // Found broken by a lookup. Kept until Open().
+};
+
 constexpr size_t kMaxLruSize = 1000000;  // 1M
 constexpr size_t kMaxValueSize = 1024;   // 1024 byte
 
-// The byte length used to store LRU properties.
+// The byte length used to store LRU properties in the v1 layout.
 // * 4 bytes for user specified value size
 // * 4 bytes for LRU capacity
 // * 4 bytes for fingerprint seed
-constexpr size_t kFileHeaderSize = 12;
+constexpr size_t kV1FileHeaderSize = 12;
 
 constexpr uint64_t k62DaysInSec = 62 * 24 * 60 * 60;
 
@@ -103,6 +157,44 @@ class CompareByTimeStamp {
   }
 };
 
+// The number of buckets is a power of 2 so that the load factor is at most
+// 2/3.
+size_t GetBucketCount(size_t size) {
+  size_t count = 4;
+  while (count * 2 < size * 3) {
+    count *= 2;
+  }
+  return count;
+}
+
+size_t GetFileSize(size_t value_size, size_t size) {
+  return sizeof(uint32_t) * 9 +
+         (LruStorage::kItemHeaderSize + value_size) * size +
+         sizeof(uint32_t) * 2 * size + sizeof(uint32_t) * GetBucketCount(size);
+}
+
+bool IsValidParameter(size_t value_size, size_t size) {
+  if (value_size == 0 || value_size > kMaxValueSize) {
+    LOG(ERROR) << "value_size is out of range: " << value_size;
+    return false;
+  }
+  if (size == 0 || size > kMaxLruSize) {
+    LOG(ERROR) << "size is out of range: " << size;
+    return false;
+  }
+  if (value_size % 4 != 0) {
+    LOG(ERROR) << "value_size_ must be 4 byte alignment";
+    return false;
+  }
+  return true;
+}
+
+inline void Prefetch(const void *ptr) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(ptr);
+#endif  // __GNUC__ || __clang__
+}
+
 }  // namespace
 
 std::unique_ptr<LruStorage> LruStorage::Create(const char *filename) {
@@ -127,18 +219,7 @@ std::unique_ptr<LruStorage> LruStorage::Create(const char *filename,
 
 bool LruStorage::CreateStorageFile(const char *filename, size_t value_size,
                                    size_t size, uint32_t seed) {
-  if (value_size == 0 || value_size > kMaxValueSize) {
-    LOG(ERROR) << "value_size is out of range";
-    return false;
-  }
-
-  if (size == 0 || size > kMaxLruSize) {
-    LOG(ERROR) << "size is out of range";
-    return false;
-  }
-
-  if (value_size % 4 != 0) {
-    LOG(ERROR) << "value_size_ must be 4 byte alignment";
+  if (!IsValidParameter(value_size, size)) {
     return false;
   }
 
@@ -148,42 +229,34 @@ bool LruStorage::CreateStorageFile(const char *filename, size_t value_size,
     return false;
   }
 
-  const uint32_t value_size_uint32 = static_cast<uint32_t>(value_size);
-  const uint32_t size_uint32 = static_cast<uint32_t>(size);
-
-  ofs.write(reinterpret_cast<const char *>(&value_size_uint32),
-            sizeof(value_size_uint32));
-  ofs.write(reinterpret_cast<const char *>(&size_uint32), sizeof(size_uint32));
-  ofs.write(reinterpret_cast<const char *>(&seed), sizeof(seed));
-  std::vector<char> ary(value_size, '\0');
-  const uint32_t last_access_time = 0;
-  const uint64_t fp = 0;
-
-  for (size_t i = 0; i < size; ++i) {
-    ofs.write(reinterpret_cast<const char *>(&fp), sizeof(fp));
-    ofs.write(reinterpret_cast<const char *>(&last_access_time),
-              sizeof(last_access_time));
-    ofs.write(reinterpret_cast<const char *>(&ary[0]),
-              static_cast<std::streamsize>(ary.size() * sizeof(ary[0])));
-  }
-
+  Header header = {
+      kMagic,         static_cast<uint32_t>(value_size),
+      static_cast<uint32_t>(size), seed,
+      kInvalidIndex,  kInvalidIndex,
+      0,              kIndexValid,
+      0,  // checksum
+  };
+  header.checksum = GetChecksum(header);
+  ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  // Items, links, and buckets are all zero-initialized. Links are not used
+  // until the items are linked.
+  const std::vector<char> zeros(GetFileSize(value_size, size) - sizeof(header),
+                                '\0');
+  ofs.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
   return true;
 }
 
 // Reopen file after initializing mapped page.
 bool LruStorage::Clear() {
   // Don't need to clear the page if the lru list is empty
-  if (mmap_.empty() || lru_list_.empty()) {
+  if (mmap_.empty() || header_ == nullptr || header_->used == 0) {
     return true;
   }
-  const size_t offset = sizeof(value_size_) + sizeof(size_) + sizeof(seed_);
-  if (offset >= mmap_.size()) {  // should not happen
-    return false;
-  }
-  std::fill(mmap_.begin() + offset, mmap_.end(), 0);
-  lru_list_.clear();
-  lru_map_.clear();
-  Open(mmap_.begin(), mmap_.size());
+  BeginUpdate();
+  std::fill(begin_, mmap_.end(), 0);
+  header_->head = kInvalidIndex;
+  header_->tail = kInvalidIndex;
+  header_->used = 0;
   return true;
 }
 
@@ -240,15 +313,16 @@ bool LruStorage::Merge(const LruStorage &storage) {
   const size_t old_size = static_cast<size_t>(end_ - begin_);
   const size_t new_size = std::min(buf.size(), old_size);
 
-  // TODO(taku): this part is not atomic.
-  // If the converter process is killed while memcpy or memset is running,
-  // the storage data will be broken.
+  // If the converter process is killed while copying, the index is rebuilt
+  // on the next Open() as the state is still set.
+  BeginUpdate();
   char *new_end = absl::c_copy_n(buf, new_size, begin_);
   if (new_size < old_size) {
     std::fill(new_end, end_, 0);
   }
-
-  return Open(mmap_.begin(), mmap_.size());
+  RebuildIndex();
+  DeleteElementsUntouchedFor62Days();
+  return true;
 }
 
 bool LruStorage::OpenOrCreate(const char *filename, size_t new_value_size,
@@ -317,24 +391,46 @@ bool LruStorage::Open(const char *filename) {
                << " with read+write mode: " << mmap.status();
     return false;
   }
-  mmap_ = *std::move(mmap);
 
-  if (mmap_.size() < 8) {
+  if (mmap->size() < 8) {
     LOG(ERROR) << "file size is too small";
     return false;
   }
 
+  if (LoadUnaligned<uint32_t>(mmap->begin()) != kMagic) {
+    mmap->Close();
+    LOG(INFO) << "Converting " << filename << " to the current layout";
+    if (!MigrateFromV1(filename)) {
+      return false;
+    }
+    mmap = Mmap::Map(filename, Mmap::READ_WRITE);
+    if (!mmap.ok()) {
+      LOG(ERROR) << "Cannot open " << filename
+                 << " with read+write mode: " << mmap.status();
+      return false;
+    }
+  }
+  mmap_ = *std::move(mmap);
+
   filename_ = filename;
   return Open(mmap_.begin(), mmap_.size());
 }
 
 bool LruStorage::Open(char *ptr, size_t ptr_size) {
-  begin_ = ptr;
-  end_ = ptr + ptr_size;
+  static_assert(sizeof(Header) == sizeof(uint32_t) * 9);
+  if (ptr_size < sizeof(Header)) {
+    LOG(ERROR) << "file size is too small";
+    return false;
+  }
+  header_ = reinterpret_cast<Header *>(ptr);
+  if (header_->magic != kMagic) {
+    LOG(ERROR) << "Unknown file format";
+    return false;
+  }
 
-  value_size_ = LoadUnalignedAdvance<uint32_t>(begin_);
-  size_ = LoadUnalignedAdvance<uint32_t>(begin_);
-  seed_ = LoadUnalignedAdvance<uint32_t>(begin_);
+  value_size_ = header_->value_size;
+  size_ = header_->size;
+  seed_ = header_->seed;
 
   if (value_size_ % 4 != 0) {
     LOG(ERROR) << "value_size_ must be 4 byte alignment";
@@ -351,30 +447,21 @@ bool LruStorage::Open(char *ptr, size_t ptr_size) {
     return false;
   }
 
-  if (mmap_.size() != kFileHeaderSize + item_size() * size_) {
+  if (ptr_size != GetFileSize(value_size_, size_)) {
     LOG(ERROR) << "LRU file is broken";
     return false;
   }
 
-  std::vector<char *> ary;
-  for (char *begin = begin_; begin < end_; begin += item_size()) {
-    ary.push_back(begin);
-  }
-  std::stable_sort(ary.begin(), ary.end(), CompareByTimeStamp());
+  begin_ = ptr + sizeof(Header);
+  end_ = begin_ + item_size() * size_;
+  links_ = reinterpret_cast<uint32_t *>(end_);
+  buckets_ = links_ + 2 * size_;
+  bucket_mask_ = static_cast<uint32_t>(GetBucketCount(size_) - 1);
 
-  lru_list_.clear();
-  lru_map_.clear();
-  char *next = nullptr;
-  for (size_t i = 0; i < ary.size(); ++i) {
-    if (GetTimeStamp(ary[i]) != 0) {
-      lru_list_.push_back(ary[i]);
-      lru_map_[GetFP(ary[i])] = std::prev(lru_list_.end());
-    } else if (next == nullptr) {
-      next = ary[i];
-    }
+  if (!IsHeaderValid()) {
+    LOG(WARNING) << "The index was not saved properly. Rebuilding it.";
+    RebuildIndex();
   }
-  next_item_ = (next != nullptr) ? next : end_;
-  DCHECK_LE(next_item_, end_);
 
   // At the time file is opened, perform clean up.
   DeleteElementsUntouchedFor62Days();
@@ -382,175 +469,499 @@ bool LruStorage::Open(char *ptr, size_t ptr_size) {
   return true;
 }
 
+bool LruStorage::MigrateFromV1(const char *filename) {
+  absl::StatusOr<Mmap> v1 = Mmap::Map(filename, Mmap::READ_ONLY);
+  if (!v1.ok()) {
+    LOG(ERROR) << "Cannot open " << filename << ": " << v1.status();
+    return false;
+  }
+  if (v1->size() < kV1FileHeaderSize) {
+    LOG(ERROR) << "file size is too small";
+    return false;
+  }
+  const char *ptr = v1->begin();
+  const uint32_t value_size = LoadUnalignedAdvance<uint32_t>(ptr);
+  const uint32_t size = LoadUnalignedAdvance<uint32_t>(ptr);
+  const uint32_t seed = LoadUnalignedAdvance<uint32_t>(ptr);
+  if (!IsValidParameter(value_size, size)) {
+    return false;
+  }
+  const size_t item_size = kItemHeaderSize + value_size;
+  if (v1->size() != kV1FileHeaderSize + item_size * size) {
+    LOG(ERROR) << "LRU file is broken";
+    return false;
+  }
+
+  const std::string tmp_filename = absl::StrCat(filename, ".tmp");
+  if (!CreateStorageFile(tmp_filename.c_str(), value_size, size, seed)) {
+    return false;
+  }
+  {
+    LruStorage storage;
+    if (!storage.Open(tmp_filename.c_str())) {
+      return false;
+    }
+    // The items are stored in the same format.
+    storage.header_->state = kIndexStale;
+    std::copy_n(ptr, item_size * size, storage.begin_);
+    storage.RebuildIndex();
+  }
+  v1->Close();
+
+  if (absl::Status s = FileUtil::AtomicRename(tmp_filename, filename);
+      !s.ok()) {
+    LOG(ERROR) << "Cannot replace " << filename << ": " << s;
+    return false;
+  }
+  return true;
+}
+
+void LruStorage::RebuildIndex() {
+  DCHECK(header_);
+  header_->state = kIndexUpdating;
+  // Drops the empty items and the older duplicates.
+  std::vector<uint32_t> order;
+  for (uint32_t i = 0; i < size_; ++i) {
+    if (GetTimeStamp(GetItem(i)) != 0) {
+      order.push_back(i);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return GetTimeStamp(GetItem(a)) > GetTimeStamp(GetItem(b));
+  });
+  std::vector<bool> live(size_, false);
+  absl::flat_hash_set<uint64_t> seen;
+  for (const uint32_t i : order) {
+    live[i] = seen.insert(GetFP(GetItem(i))).second;
+  }
+
+  // Packs the live items at the beginning, keeping their order.
+  uint32_t used = 0;
+  for (uint32_t i = 0; i < size_; ++i) {
+    if (!live[i]) {
+      continue;
+    }
+    if (i != used) {
+      std::copy_n(GetItem(i), item_size(), GetItem(used));
+    }
+    ++used;
+  }
+  std::fill(GetItem(used), end_, 0);
+  std::fill(links_, buckets_ + bucket_mask_ + 1, 0);
+  header_->head = kInvalidIndex;
+  header_->tail = kInvalidIndex;
+  header_->used = used;
+
+  // Links the items from the oldest, as PushFront() makes the item the most
+  // recently used one.
+  order.resize(used);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return GetTimeStamp(GetItem(a)) > GetTimeStamp(GetItem(b));
+  });
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    PushFront(*it);
+    AddToIndex(GetFP(GetItem(*it)), *it);
+  }
+}
+
+bool LruStorage::IsHeaderValid() const {
+  if (header_->state != kIndexValid ||
+      header_->checksum != GetChecksum(*header_)) {
+    return false;
+  }
+  const uint32_t used = header_->used;
+  if (used == 0) {
+    return header_->head == kInvalidIndex && header_->tail == kInvalidIndex;
+  }
+  return used <= size_ && header_->head < used && header_->tail < used;
+}
+
+uint32_t LruStorage::GetChecksum(const Header &header) {
+  return Hash::Fingerprint32(absl::string_view(
+      reinterpret_cast<const char *>(&header), offsetof(Header, checksum)));
+}
+
+void LruStorage::MarkIndexBroken() const {
+  if (header_->state != kIndexBroken) {
+    LOG(WARNING) << "The index is broken. It will be rebuilt.";
+    header_->state = kIndexBroken;
+  }
+}
+
+bool LruStorage::RepairIndex() {
+  if (header_->state != kIndexBroken) {
+    return false;
+  }
+  RebuildIndex();
+  return true;
+}
+
+void LruStorage::BeginUpdate() {
+  if (header_->state == kIndexValid) {
+    header_->state = kIndexUpdating;
+  }
+}
+
 void LruStorage::Close() {
-  // Perform clean up before closing the file.
-  DeleteElementsUntouchedFor62Days();
+  if (header_ != nullptr && !mmap_.empty() &&
+      header_->state != kIndexStale && header_->state != kIndexBroken) {
+    // Perform clean up before closing the file.
+    DeleteElementsUntouchedFor62Days();
+    header_->state = kIndexValid;
+    header_->checksum = GetChecksum(*header_);
+  }
 
   filename_.clear();
   mmap_.Close();
-  lru_list_.clear();
-  lru_map_.clear();
+  header_ = nullptr;
+  begin_ = nullptr;
+  end_ = nullptr;
+  links_ = nullptr;
+  buckets_ = nullptr;
+  bucket_mask_ = 0;
+}
+
+size_t LruStorage::used_size() const {
+  return header_ == nullptr ? 0 : header_->used;
+}
+
+uint32_t LruStorage::Find(uint64_t fp) const {
+  if (header_ == nullptr) {
+    return kInvalidIndex;
+  }
+  // The buckets are not verified by Open(). A bucket pointing to an unused
+  // item, or a table without an empty bucket, means the index is broken.
+  uint32_t pos = fp & bucket_mask_;
+  for (uint32_t probes = 0; buckets_[pos] != 0; ++probes) {
+    if (probes > bucket_mask_ || buckets_[pos] > header_->used) {
+      MarkIndexBroken();
+      return kInvalidIndex;
+    }
+    const uint32_t i = buckets_[pos] - 1;
+    if (GetFP(GetItem(i)) == fp) {
+      return i;
+    }
+    pos = (pos + 1) & bucket_mask_;
+  }
+  return kInvalidIndex;
+}
+
+uint32_t LruStorage::FindForUpdate(uint64_t fp) {
+  uint32_t i = Find(fp);
+  if (i != kInvalidIndex && !IsLinked(i)) {
+    i = kInvalidIndex;
+  }
+  if (RepairIndex()) {
+    i = Find(fp);
+  }
+  return i;
+}
+
+bool LruStorage::IsLinked(uint32_t i) const {
+  const uint32_t used = header_->used;
+  if (i < used) {
+    const uint32_t prev = links_[2 * i];
+    const uint32_t next = links_[2 * i + 1];
+    const bool prev_ok = prev == kInvalidIndex
+                             ? header_->head == i
+                             : prev < used && links_[2 * prev + 1] == i;
+    const bool next_ok = next == kInvalidIndex
+                             ? header_->tail == i
+                             : next < used && links_[2 * next] == i;
+    if (prev_ok && next_ok) {
+      return true;
+    }
+  }
+  MarkIndexBroken();
+  return false;
+}
+
+void LruStorage::AddToIndex(uint64_t fp, uint32_t i) {
+  uint32_t pos = fp & bucket_mask_;
+  for (uint32_t probes = 0; buckets_[pos] != 0; ++probes) {
+    if (probes > bucket_mask_) {
+      MarkIndexBroken();
+      return;
+    }
+    pos = (pos + 1) & bucket_mask_;
+  }
+  buckets_[pos] = i + 1;
+}
+
+void LruStorage::RemoveFromIndex(uint64_t fp) {
+  // Find() checks the buckets up to the one of |fp|.
+  const uint32_t i = Find(fp);
+  if (i == kInvalidIndex) {
+    return;
+  }
+  uint32_t hole = fp & bucket_mask_;
+  while (buckets_[hole] != i + 1) {
+    hole = (hole + 1) & bucket_mask_;
+  }
+  // Backward shift deletion: moves the following entries into the hole
+  // unless they are already at or before their home bucket.
+  uint32_t pos = (hole + 1) & bucket_mask_;
+  for (uint32_t probes = 0; buckets_[pos] != 0; ++probes) {
+    if (probes > bucket_mask_ || buckets_[pos] > header_->used) {
+      MarkIndexBroken();
+      return;
+    }
+    const uint32_t home = GetFP(GetItem(buckets_[pos] - 1)) & bucket_mask_;
+    if (((pos - home) & bucket_mask_) >= ((pos - hole) & bucket_mask_)) {
+      buckets_[hole] = buckets_[pos];
+      hole = pos;
+    }
+    pos = (pos + 1) & bucket_mask_;
+  }
+  buckets_[hole] = 0;
+}
+
+void LruStorage::PushFront(uint32_t i) {
+  links_[2 * i] = kInvalidIndex;
+  links_[2 * i + 1] = header_->head;
+  if (header_->head != kInvalidIndex) {
+    links_[2 * header_->head] = i;
+  } else {
+    header_->tail = i;
+  }
+  header_->head = i;
+}
+
+void LruStorage::Unlink(uint32_t i) {
+  const uint32_t prev = links_[2 * i];
+  const uint32_t next = links_[2 * i + 1];
+  if (prev != kInvalidIndex) {
+    links_[2 * prev + 1] = next;
+  } else {
+    header_->head = next;
+  }
+  if (next != kInvalidIndex) {
+    links_[2 * next] = prev;
+  } else {
+    header_->tail = prev;
+  }
+}
+
+void LruStorage::MoveToFront(uint32_t i) {
+  if (header_->head != i) {
+    Unlink(i);
+    PushFront(i);
+  }
 }
 
 const char *LruStorage::Lookup(const absl::string_view key,
                                uint32_t *last_access_time) const {
-  const uint64_t fp = Hash::FingerprintWithSeed(key, seed_);
-  const auto it = lru_map_.find(fp);
-  if (it == lru_map_.end()) {
+  return Lookup(Hash::FingerprintWithSeed(key, seed_), last_access_time);
+}
+
+const char *LruStorage::Lookup(uint64_t fp, uint32_t *last_access_time) const {
+  const uint32_t i = Find(fp);
+  if (i == kInvalidIndex) {
     return nullptr;
   }
-  const uint32_t timestamp = GetTimeStamp(*it->second);
+  const char *item = GetItem(i);
+  const uint32_t timestamp = GetTimeStamp(item);
   if (IsOlderThan62Days(timestamp)) {
     return nullptr;
   }
   *last_access_time = timestamp;
-  return GetValue(*it->second);
+  return GetValue(item);
+}
+
+size_t LruStorage::LookupMany(absl::Span<const uint64_t> fps,
+                              absl::Span<const char *> values,
+                              absl::Span<uint32_t> last_access_times) const {
+  DCHECK_EQ(fps.size(), values.size());
+  DCHECK_EQ(fps.size(), last_access_times.size());
+  if (header_ != nullptr) {
+    for (const uint64_t fp : fps) {
+      Prefetch(&buckets_[fp & bucket_mask_]);
+    }
+  }
+  size_t found = 0;
+  for (size_t i = 0; i < fps.size(); ++i) {
+    values[i] = Lookup(fps[i], &last_access_times[i]);
+    if (values[i] != nullptr) {
+      ++found;
+    }
+  }
+  return found;
 }
 
 void LruStorage::GetAllValues(std::vector<std::string> *values) const {
   DCHECK(values);
   values->clear();
+  if (header_ == nullptr) {
+    return;
+  }
   // Iterate data from the most recently used element to the least recently used
   // element.
-  for (const char *ptr : lru_list_) {
+  const uint32_t used = header_->used;
+  for (uint32_t i = header_->head; i != kInvalidIndex; i = links_[2 * i + 1]) {
+    // The links are not verified by Open(). Stops at a link out of range or a
+    // cycle.
+    if (i >= used || values->size() == used) {
+      MarkIndexBroken();
+      break;
+    }
+    const char *ptr = GetItem(i);
     const uint32_t timestamp = GetTimeStamp(ptr);
     if (IsOlderThan62Days(timestamp)) {
       break;
     }
     // Default constructor of string is not applicable
     // because value's size() must return value_size_.
-    DCHECK(ptr);
     values->emplace_back(GetValue(ptr), value_size_);
   }
 }
 
 bool LruStorage::Touch(const absl::string_view key) {
   const uint64_t fp = Hash::FingerprintWithSeed(key, seed_);
-  auto it = lru_map_.find(fp);
-  if (it == lru_map_.end()) {
+  const uint32_t i = FindForUpdate(fp);
+  if (i == kInvalidIndex) {
     return false;
   }
-  const uint32_t timestamp = GetTimeStamp(*it->second);
+  const uint32_t timestamp = GetTimeStamp(GetItem(i));
   if (IsOlderThan62Days(timestamp)) {
     return false;
   }
-  Update(*it->second);
-  // Move the node pointed to by it->second to the front.
-  lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+  BeginUpdate();
+  Update(GetItem(i));
+  MoveToFront(i);
   return true;
 }
 
 bool LruStorage::Insert(const absl::string_view key, const char *value) {
-  if (value == nullptr) {
+  return Insert(Hash::FingerprintWithSeed(key, seed_), value);
+}
+
+bool LruStorage::Insert(uint64_t fp, const char *value) {
+  if (value == nullptr || header_ == nullptr) {
     return false;
   }
-  const uint64_t fp = Hash::FingerprintWithSeed(key, seed_);
+  BeginUpdate();
 
   // If the data corresponding to |key| already exists in LRU, update it.
-  {
-    auto it = lru_map_.find(fp);
-    if (it != lru_map_.end()) {
-      // Overwrite the data pointed to by it->second and move it to the front.
-      Update(*it->second, fp, value, value_size_);
-      lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
-      return true;
-    }
-  }
-
-  // If the LRU is full or we run out of the mmap region, drop the least
-  // recently used element (actually, the least recently used element is
-  // overwritten with new data).
-  if (lru_map_.size() >= size_ || next_item_ == end_) {
-    auto it = std::prev(lru_list_.end());  // Least recently used data.
-    const uint64_t old_fp = GetFP(*it);
-    lru_map_.erase(old_fp);
-    lru_list_.splice(lru_list_.begin(), lru_list_, it);  // Move to front.
-    Update(*it, fp, value, value_size_);
-    lru_map_[fp] = it;
+  if (const uint32_t i = FindForUpdate(fp); i != kInvalidIndex) {
+    // Overwrite the data and move it to the front.
+    Update(GetItem(i), fp, value, value_size_);
+    MoveToFront(i);
     return true;
   }
 
-  // A new item can be assigned in the mmap region.
-  if (next_item_ < end_) {
-    Update(next_item_, fp, value, value_size_);
-    lru_list_.push_front(next_item_);
-    lru_map_[fp] = lru_list_.begin();
-    // Advance next_item_ for next item.
-    next_item_ += item_size();
-    DCHECK_LE(next_item_, end_);
+  // If the LRU is full, drop the least recently used element (actually, the
+  // least recently used element is overwritten with new data).
+  if (header_->used >= size_ && !IsLinked(header_->tail)) {
+    RebuildIndex();
+  }
+  if (header_->used >= size_) {
+    const uint32_t i = header_->tail;
+    RemoveFromIndex(GetFP(GetItem(i)));
+    Update(GetItem(i), fp, value, value_size_);
+    MoveToFront(i);
+    AddToIndex(fp, i);
+    // The item is already updated, so the rebuilt index has it at the head.
+    RepairIndex();
     return true;
   }
 
-  LOG(ERROR) << "Insertion failed because no more mmap region is available.";
-  return false;
+  // A new item can be assigned in the mmap region.
+  const uint32_t i = header_->used++;
+  Update(GetItem(i), fp, value, value_size_);
+  PushFront(i);
+  AddToIndex(fp, i);
+  RepairIndex();
+  return true;
 }
 
 bool LruStorage::TryInsert(const absl::string_view key, const char *value) {
-  const uint64_t fp = Hash::FingerprintWithSeed(key, seed_);
-  auto it = lru_map_.find(fp);
-  if (it != lru_map_.end()) {
-    Update(*it->second, fp, value, value_size_);
-    lru_list_.splice(lru_list_.begin(), lru_list_, it->second);
+  return TryInsert(Hash::FingerprintWithSeed(key, seed_), value);
+}
+
+bool LruStorage::TryInsert(uint64_t fp, const char *value) {
+  if (const uint32_t i = FindForUpdate(fp); i != kInvalidIndex) {
+    BeginUpdate();
+    Update(GetItem(i), fp, value, value_size_);
+    MoveToFront(i);
   }
   return true;
 }
 
 bool LruStorage::Delete(const absl::string_view key) {
   const uint64_t fp = Hash::FingerprintWithSeed(key, seed_);
-  return Delete(fp);
+  const uint32_t i = FindForUpdate(fp);
+  return i == kInvalidIndex || DeleteItem(i);
 }
 
-bool LruStorage::Delete(uint64_t fp) {
-  auto it = lru_map_.find(fp);
-  return (it == lru_map_.end() || Delete(fp, it->second));
-}
-
-bool LruStorage::Delete(std::list<char *>::iterator it) {
-  return (it == lru_list_.end() || Delete(GetFP(*it), it));
-}
-
-bool LruStorage::Delete(uint64_t fp, std::list<char *>::iterator it) {
-  // Determine the last element in the mmap region.
-  if (next_item_ < begin_ + item_size()) {
-    LOG(ERROR) << "next_item_ points to invalid location (broken?)";
+bool LruStorage::DeleteItem(uint32_t i) {
+  if (i >= header_->used) {
+    LOG(ERROR) << "The item index is out of range (broken?)";
     return false;
   }
-  next_item_ -= item_size();
-
-  // Backup the location of mmap region to which another element will be moved.
-  char *deleted_item_pos = *it;
-
-  // Erase the LRU structure for (fp, it).
-  lru_map_.erase(fp);
-  lru_list_.erase(it);
-
-  if (next_item_ != deleted_item_pos) {
-    // Move the region for the last element to the deleted location.  Then,
-    // update the LRU structure for the moved element (the pointer to mmap
-    // region in the list node is updated.)
-    std::copy_n(next_item_, item_size(), deleted_item_pos);
-    const uint64_t fp = GetFP(next_item_);
-    *lru_map_[fp] = deleted_item_pos;
+  BeginUpdate();
+  if (!IsLinked(i) || !IsLinked(header_->used - 1)) {
+    // Drops the item and lets RebuildIndex() fix the links.
+    std::fill_n(GetItem(i), item_size(), 0);
+    RebuildIndex();
+    return true;
+  }
+  RemoveFromIndex(GetFP(GetItem(i)));
+  Unlink(i);
+
+  const uint32_t last = --header_->used;
+  if (last != i) {
+    // Move the last element to the deleted location, and update the links
+    // and the bucket pointing to it.
+    std::copy_n(GetItem(last), item_size(), GetItem(i));
+    const uint32_t prev = links_[2 * last];
+    const uint32_t next = links_[2 * last + 1];
+    links_[2 * i] = prev;
+    links_[2 * i + 1] = next;
+    if (prev != kInvalidIndex) {
+      links_[2 * prev + 1] = i;
+    } else {
+      header_->head = i;
+    }
+    if (next != kInvalidIndex) {
+      links_[2 * next] = i;
+    } else {
+      header_->tail = i;
+    }
+    uint32_t pos = GetFP(GetItem(i)) & bucket_mask_;
+    for (uint32_t probes = 0; probes <= bucket_mask_ && buckets_[pos] != 0 &&
+                              buckets_[pos] != last + 1;
+         ++probes) {
+      pos = (pos + 1) & bucket_mask_;
+    }
+    if (buckets_[pos] == last + 1) {
+      buckets_[pos] = i + 1;
+    } else {
+      MarkIndexBroken();
+    }
   }
 
-  // Clear the region for the next_item_.
-  std::fill_n(next_item_, item_size(), 0);
+  // Clear the region for the last item.
+  std::fill_n(GetItem(last), item_size(), 0);
+  links_[2 * last] = 0;
+  links_[2 * last + 1] = 0;
 
+  RepairIndex();
   return true;
 }
 
 int LruStorage::DeleteElementsBefore(uint32_t timestamp) {
-  if (mmap_.empty() || begin_ >= end_) {
+  if (mmap_.empty() || header_ == nullptr) {
     return 0;
   }
   int num_deleted = 0;
-  while (!lru_list_.empty()) {
-    auto it = std::prev(lru_list_.end());
-    const uint32_t last_access_time = GetTimeStamp(*it);
+  while (header_->tail != kInvalidIndex) {
+    const uint32_t i = header_->tail;
+    const uint32_t last_access_time = GetTimeStamp(GetItem(i));
     if (last_access_time >= timestamp) {
       break;
     }
-    if (Delete(it)) {
+    if (DeleteItem(i)) {
       ++num_deleted;
       continue;
     }
@@ -570,6 +981,8 @@ int LruStorage::DeleteElementsUntouchedFor62Days() {
 void LruStorage::Write(size_t i, uint64_t fp, const absl::string_view value,
                        uint32_t last_access_time) {
   DCHECK_LT(i, size_);
+  // The index no longer matches the items.
+  header_->state = kIndexStale;
   char *ptr = begin_ + (i * item_size());
   ptr = StoreUnaligned<uint64_t>(fp, ptr);
   ptr = StoreUnaligned<uint32_t>(last_access_time, ptr);
@@ -30,19 +30,26 @@
 #ifndef MOZC_STORAGE_LRU_STORAGE_H_
 #define MOZC_STORAGE_LRU_STORAGE_H_
 
+#include <cstddef>
 #include <cstdint>
-#include <list>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "base/mmap.h"
-#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace storage {
 
+// An LRU map from 64-bit fingerprints to fixed-size values, backed by a
+// memory-mapped file.
+//
+// The file keeps the hash index and the LRU links next to the items (see
+// lru_storage.cc for the layout), so opening a file doesn't rebuild anything
+// and an update touches only the entry, its neighbors and one bucket. Files
+// written in the old layout, which only had the items, are converted on Open.
 class LruStorage {
  public:
   LruStorage() = default;
@@ -66,6 +73,20 @@ class LruStorage {
       return Lookup(key, &last_access_time);
   }
 
+  // Looks up elements by fingerprint, i.e., Hash::FingerprintWithSeed(key,
+  // seed()). Callers composing keys from several pieces can compute it with
+  // FingerprintBuilder without building the key string.
+  const char *Lookup(uint64_t fp, uint32_t *last_access_time) const;
+
+  // Looks up |fps| in one batch. The hash slots of all the fingerprints are
+  // prefetched before probing, so that the cache misses of independent
+  // lookups overlap. |values[i]| is set to nullptr if |fps[i]| is not found;
+  // otherwise |last_access_times[i]| is also set. Returns the number of the
+  // found elements.
+  size_t LookupMany(absl::Span<const uint64_t> fps,
+                    absl::Span<const char *> values,
+                    absl::Span<uint32_t> last_access_times) const;
+
   // A safer lookup for string values (the pointers returned by above Lookup()'s
   // are not null terminated.)
   absl::string_view LookupAsString(const absl::string_view key) const {
@@ -90,10 +111,12 @@ class LruStorage {
 
   // Inserts a key value pair.
   bool Insert(absl::string_view key, const char *value);
+  bool Insert(uint64_t fp, const char *value);
 
   // Inserts a key value pair only if |key| already exists.
   // CAUTION: despite the name, it does nothing if there's no value of |key|.
   bool TryInsert(absl::string_view key, const char *value);
+  bool TryInsert(uint64_t fp, const char *value);
 
   // Deletes the element if exists.  Returns false on failure (it's not failure
   // if the element for |key| doesn't exist.)
@@ -120,16 +143,21 @@ class LruStorage {
   size_t size() const { return size_; }
 
   // Returns the number of items in LRU.
-  size_t used_size() const { return lru_list_.size(); }
+  size_t used_size() const;
 
   // Returns the seed used for fingerprinting.
   uint32_t seed() const { return seed_; }
 
+  // Returns the byte length of the mapped file, which holds the items, the
+  // links and the hash buckets.
+  size_t mapped_size() const { return mmap_.size(); }
+
   const std::string &filename() const { return filename_; }
 
   // Writes one entry at |i| th index.
   // i must be 0 <= i < size.
-  // This data will not update the index of the storage.
+  // This data will not update the index of the storage. The index is rebuilt
+  // when the file is opened next time.
   void Write(size_t i, uint64_t fp, absl::string_view value,
              uint32_t last_access_time);
 
@@ -146,7 +174,7 @@ class LruStorage {
                                             size_t value_size, size_t size,
                                             uint32_t seed);
 
-  // Creates an empty LRU db file
+  // Creates an empty LRU db file.
   static bool CreateStorageFile(const char *filename, size_t value_size,
                                 size_t size, uint32_t seed);
 
@@ -156,25 +184,74 @@ class LruStorage {
   static constexpr size_t kItemHeaderSize = 12;
 
  private:
+  struct Header;
+
+  static constexpr uint32_t kInvalidIndex = 0xffffffff;
+
   // Initializes this LRU from memory buffer.
   bool Open(char *ptr, size_t ptr_size);
 
-  // Deletes the element from |fp| or |it|.
-  bool Delete(uint64_t fp);
-  bool Delete(std::list<char *>::iterator it);
+  // Converts the file in the old layout to the current one.
+  static bool MigrateFromV1(const char *filename);
+
+  // Rebuilds the hash index and the LRU links from the items. Used when the
+  // items have been modified without maintaining them (Merge, Write, or a
+  // process that died in the middle of an update), or when the index is found
+  // broken.
+  void RebuildIndex();
+
+  // Returns true if the header was saved by Close() and its fields are in
+  // range. This doesn't read the links nor the buckets, which are checked
+  // lazily when they are followed.
+  bool IsHeaderValid() const;
+  static uint32_t GetChecksum(const Header &header);
+
+  // Marks the index as broken so that it is rebuilt by the next update or
+  // Open().
+  void MarkIndexBroken() const;
+
+  // Rebuilds the index if it has been marked as broken. Returns true if
+  // rebuilt.
+  bool RepairIndex();
+
+  // Marks the index as being modified until Close().
+  void BeginUpdate();
+
+  char *GetItem(uint32_t i) const { return begin_ + i * item_size(); }
+
+  // Returns the index of the item for |fp|, or kInvalidIndex.
+  uint32_t Find(uint64_t fp) const;
+
+  // Same as Find() but also checks the links of the item, and rebuilds the
+  // index if it's broken, so that the item can be updated.
+  uint32_t FindForUpdate(uint64_t fp);
+
+  // Returns true if the |i|-th item is used and its neighbors link back to it.
+  // Otherwise, marks the index as broken.
+  bool IsLinked(uint32_t i) const;
+  void AddToIndex(uint64_t fp, uint32_t i);
+  void RemoveFromIndex(uint64_t fp);
+
+  // Operations on the doubly linked LRU list. The head is the most recently
+  // used item.
+  void PushFront(uint32_t i);
+  void Unlink(uint32_t i);
+  void MoveToFront(uint32_t i);
 
-  // Actual implementation of Delete() methods.
-  bool Delete(uint64_t fp, std::list<char *>::iterator it);
+  // Deletes the |i|-th item. The last item is moved to fill the hole so that
+  // the used items are always at [0, used_size()).
+  bool DeleteItem(uint32_t i);
 
   size_t value_size_ = 0;
   size_t size_ = 0;
   uint32_t seed_ = 0;
-  char *next_item_ = nullptr;
-  char *begin_ = nullptr;
-  char *end_ = nullptr;
+  Header *header_ = nullptr;
+  char *begin_ = nullptr;  // The beginning of the items.
+  char *end_ = nullptr;    // The end of the items.
+  uint32_t *links_ = nullptr;    // {prev, next} for each item.
+  uint32_t *buckets_ = nullptr;  // 1 + item index, or 0 for empty.
+  uint32_t bucket_mask_ = 0;
   std::string filename_;
-  std::list<char *> lru_list_;  // Front is the most recently used data.
-  absl::flat_hash_map<uint64_t, std::list<char *>::iterator> lru_map_;
   Mmap mmap_;
 };
 
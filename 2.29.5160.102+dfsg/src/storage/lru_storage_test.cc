@@ -30,6 +30,7 @@
 #include "storage/lru_storage.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <iterator>
@@ -39,8 +40,10 @@
 #include <utility>
 #include <vector>
 
+#include "base/bits.h"
 #include "base/clock_mock.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/port.h"
 #include "base/random.h"
@@ -50,6 +53,9 @@
 #include "testing/gunit.h"
 #include "absl/flags/flag.h"
 #include "absl/random/random.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace mozc {
 namespace storage {
@@ -572,5 +578,248 @@ TEST_F(LruStorageTest, OldDataAreNotLookedUp) {
   EXPECT_TRUE(storage.Touch("4444"));
 }
 
+TEST_F(LruStorageTest, LookupByFingerprint) {
+  ScopedClockMock clock(1, 0);
+  clock->SetAutoPutClockForward(1, 0);
+
+  constexpr size_t kValueSize = 4;
+  constexpr size_t kNumElements = 4;
+  LruStorage storage;
+  ASSERT_TRUE(storage.OpenOrCreate(GetTemporaryFilePath().c_str(), kValueSize,
+                                   kNumElements, kSeed));
+
+  const uint64_t fp0 = Hash::FingerprintWithSeed("0000", kSeed);
+  const uint64_t fp1 = Hash::FingerprintWithSeed("1111", kSeed);
+  const uint64_t fp2 = Hash::FingerprintWithSeed("2222", kSeed);
+  EXPECT_TRUE(storage.Insert("0000", "aaaa"));
+  EXPECT_TRUE(storage.Insert(fp1, "bbbb"));
+
+  // Keys and fingerprints address the same elements.
+  uint32_t last_access_time = 0;
+  const char *value = storage.Lookup(fp0, &last_access_time);
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(absl::string_view(value, kValueSize), "aaaa");
+  EXPECT_EQ(storage.LookupAsString("1111"), "bbbb");
+  EXPECT_EQ(storage.Lookup(fp2, &last_access_time), nullptr);
+
+  // TryInsert() only updates existing elements.
+  EXPECT_TRUE(storage.TryInsert(fp1, "BBBB"));
+  EXPECT_TRUE(storage.TryInsert(fp2, "cccc"));
+  EXPECT_EQ(storage.LookupAsString("1111"), "BBBB");
+  EXPECT_EQ(storage.Lookup("2222"), nullptr);
+
+  const uint64_t fps[] = {fp2, fp1, fp0, fp1};
+  const char *values[std::size(fps)];
+  uint32_t last_access_times[std::size(fps)];
+  EXPECT_EQ(storage.LookupMany(fps, absl::MakeSpan(values),
+                               absl::MakeSpan(last_access_times)),
+            3);
+  EXPECT_EQ(values[0], nullptr);
+  for (size_t i = 1; i < std::size(fps); ++i) {
+    uint32_t expected_time = 0;
+    ASSERT_NE(values[i], nullptr);
+    EXPECT_EQ(values[i], storage.Lookup(fps[i], &expected_time));
+    EXPECT_EQ(last_access_times[i], expected_time);
+  }
+  EXPECT_EQ(absl::string_view(values[1], kValueSize), "BBBB");
+  EXPECT_EQ(absl::string_view(values[2], kValueSize), "aaaa");
+  EXPECT_GT(last_access_times[1], last_access_times[2]);
+}
+
+TEST_F(LruStorageTest, ReopenKeepsLruOrder) {
+  ScopedClockMock clock(1, 0);
+  clock->SetAutoPutClockForward(1, 0);
+
+  const std::string file = GetTemporaryFilePath();
+  {
+    LruStorage storage;
+    ASSERT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 3, kSeed));
+    EXPECT_TRUE(storage.Insert("0000", "aaaa"));
+    EXPECT_TRUE(storage.Insert("1111", "bbbb"));
+    EXPECT_TRUE(storage.Insert("2222", "cccc"));
+    EXPECT_TRUE(storage.Touch("0000"));
+  }
+
+  LruStorage storage;
+  ASSERT_TRUE(storage.Open(file.c_str()));
+  std::vector<std::string> values;
+  storage.GetAllValues(&values);
+  EXPECT_THAT(values, ::testing::ElementsAre("aaaa", "cccc", "bbbb"));
+
+  // "1111" is the least recently used one.
+  EXPECT_TRUE(storage.Insert("3333", "dddd"));
+  EXPECT_EQ(storage.Lookup("1111"), nullptr);
+  storage.GetAllValues(&values);
+  EXPECT_THAT(values, ::testing::ElementsAre("dddd", "aaaa", "cccc"));
+}
+
+TEST_F(LruStorageTest, RebuildIndexAfterWrite) {
+  const std::string file = GetTemporaryFilePath();
+  {
+    LruStorage storage;
+    ASSERT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 4, kSeed));
+    storage.Write(0, Hash::FingerprintWithSeed("0000", kSeed), "aaaa", 10);
+    storage.Write(1, Hash::FingerprintWithSeed("1111", kSeed), "bbbb", 30);
+    storage.Write(2, Hash::FingerprintWithSeed("2222", kSeed), "cccc", 20);
+    // Older duplicate of "1111".
+    storage.Write(3, Hash::FingerprintWithSeed("1111", kSeed), "BBBB", 5);
+  }
+
+  ScopedClockMock clock(40, 0);
+  LruStorage storage;
+  ASSERT_TRUE(storage.Open(file.c_str()));
+  EXPECT_EQ(storage.used_size(), 3);
+  EXPECT_EQ(storage.LookupAsString("0000"), "aaaa");
+  EXPECT_EQ(storage.LookupAsString("1111"), "bbbb");
+  EXPECT_EQ(storage.LookupAsString("2222"), "cccc");
+  std::vector<std::string> values;
+  storage.GetAllValues(&values);
+  EXPECT_THAT(values, ::testing::ElementsAre("bbbb", "cccc", "aaaa"));
+}
+
+TEST_F(LruStorageTest, RebuildBrokenIndex) {
+  ScopedClockMock clock(1, 0);
+  clock->SetAutoPutClockForward(1, 0);
+
+  const std::string file = GetTemporaryFilePath();
+  // The file ends with the links (2 per item) and the buckets (8 for 3
+  // items). Makes the links cyclic and fills all the buckets, while the header
+  // says the index is valid.
+  const auto create_broken_file = [&file]() {
+    {
+      LruStorage storage;
+      ASSERT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 3, kSeed));
+      EXPECT_TRUE(storage.Insert("0000", "aaaa"));
+      EXPECT_TRUE(storage.Insert("1111", "bbbb"));
+      EXPECT_TRUE(storage.Insert("2222", "cccc"));
+    }
+    absl::StatusOr<std::string> contents = FileUtil::GetContents(file);
+    ASSERT_OK(contents);
+    constexpr size_t kLinksSize = sizeof(uint32_t) * 2 * 3;
+    constexpr size_t kBucketsSize = sizeof(uint32_t) * 8;
+    ASSERT_GT(contents->size(), kLinksSize + kBucketsSize);
+    char *links =
+        contents->data() + contents->size() - kLinksSize - kBucketsSize;
+    std::fill_n(links, kLinksSize, 0);
+    for (size_t i = 0; i < kBucketsSize / sizeof(uint32_t); ++i) {
+      StoreUnaligned<uint32_t>(1, links + kLinksSize + i * sizeof(uint32_t));
+    }
+    ASSERT_OK(FileUtil::SetContents(file, *contents));
+  };
+
+  // Open() only checks the header. The lookups stop at the broken index, and
+  // the index is rebuilt by the next Open().
+  create_broken_file();
+  {
+    LruStorage storage;
+    ASSERT_TRUE(storage.Open(file.c_str()));
+    EXPECT_EQ(storage.Lookup("3333"), nullptr);
+    std::vector<std::string> values;
+    storage.GetAllValues(&values);
+    EXPECT_LE(values.size(), 3);
+  }
+  {
+    LruStorage storage;
+    ASSERT_TRUE(storage.Open(file.c_str()));
+    EXPECT_EQ(storage.used_size(), 3);
+    EXPECT_EQ(storage.LookupAsString("0000"), "aaaa");
+    EXPECT_EQ(storage.LookupAsString("1111"), "bbbb");
+    EXPECT_EQ(storage.LookupAsString("2222"), "cccc");
+    EXPECT_EQ(storage.Lookup("3333"), nullptr);
+    std::vector<std::string> values;
+    storage.GetAllValues(&values);
+    EXPECT_THAT(values, ::testing::ElementsAre("cccc", "bbbb", "aaaa"));
+  }
+
+  // An update rebuilds the index right away.
+  create_broken_file();
+  LruStorage storage;
+  ASSERT_TRUE(storage.Open(file.c_str()));
+  EXPECT_TRUE(storage.Insert("3333", "dddd"));
+  EXPECT_EQ(storage.used_size(), 3);
+  EXPECT_EQ(storage.Lookup("0000"), nullptr);
+  EXPECT_EQ(storage.LookupAsString("1111"), "bbbb");
+  EXPECT_EQ(storage.LookupAsString("2222"), "cccc");
+  EXPECT_EQ(storage.LookupAsString("3333"), "dddd");
+  std::vector<std::string> values;
+  storage.GetAllValues(&values);
+  EXPECT_THAT(values, ::testing::ElementsAre("dddd", "cccc", "bbbb"));
+}
+
+TEST_F(LruStorageTest, RebuildIndexOnHeaderChecksumMismatch) {
+  ScopedClockMock clock(1, 0);
+  clock->SetAutoPutClockForward(1, 0);
+
+  const std::string file = GetTemporaryFilePath();
+  {
+    LruStorage storage;
+    ASSERT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 4, kSeed));
+    EXPECT_TRUE(storage.Insert("0000", "aaaa"));
+    EXPECT_TRUE(storage.Insert("1111", "bbbb"));
+    EXPECT_TRUE(storage.Insert("2222", "cccc"));
+  }
+
+  // Overwrites the used count (the 7th field of the header) without updating
+  // the checksum.
+  absl::StatusOr<std::string> contents = FileUtil::GetContents(file);
+  ASSERT_OK(contents);
+  StoreUnaligned<uint32_t>(1, contents->data() + sizeof(uint32_t) * 6);
+  ASSERT_OK(FileUtil::SetContents(file, *contents));
+
+  LruStorage storage;
+  ASSERT_TRUE(storage.Open(file.c_str()));
+  EXPECT_EQ(storage.used_size(), 3);
+  std::vector<std::string> values;
+  storage.GetAllValues(&values);
+  EXPECT_THAT(values, ::testing::ElementsAre("cccc", "bbbb", "aaaa"));
+}
+
+TEST_F(LruStorageTest, MigrateFromV1) {
+  // The old layout: (value size, size, seed) followed by the items.
+  constexpr uint32_t kHeader[] = {4, 4, kSeed};
+  std::string contents(reinterpret_cast<const char *>(kHeader),
+                       sizeof(kHeader));
+  const auto append_item = [&contents](absl::string_view key,
+                                       absl::string_view value,
+                                       uint32_t timestamp) {
+    const uint64_t fp = Hash::FingerprintWithSeed(key, kSeed);
+    contents.append(reinterpret_cast<const char *>(&fp), sizeof(fp));
+    contents.append(reinterpret_cast<const char *>(&timestamp),
+                    sizeof(timestamp));
+    contents.append(value.data(), value.size());
+  };
+  append_item("0000", "aaaa", 10);
+  append_item("1111", "bbbb", 30);
+  append_item("2222", "cccc", 20);
+  contents.append(LruStorage::kItemHeaderSize + 4, '\0');  // Unused.
+
+  const std::string file = GetTemporaryFilePath();
+  ASSERT_OK(FileUtil::SetContents(file, contents));
+
+  ScopedClockMock clock(40, 0);
+  clock->SetAutoPutClockForward(1, 0);
+  {
+    LruStorage storage;
+    ASSERT_TRUE(storage.Open(file.c_str()));
+    EXPECT_EQ(storage.value_size(), 4);
+    EXPECT_EQ(storage.size(), 4);
+    EXPECT_EQ(storage.seed(), kSeed);
+    EXPECT_EQ(storage.used_size(), 3);
+    std::vector<std::string> values;
+    storage.GetAllValues(&values);
+    EXPECT_THAT(values, ::testing::ElementsAre("bbbb", "cccc", "aaaa"));
+    EXPECT_TRUE(storage.Insert("3333", "dddd"));
+    EXPECT_TRUE(storage.Insert("4444", "eeee"));
+    EXPECT_EQ(storage.Lookup("0000"), nullptr);
+  }
+
+  // The converted file is opened as is.
+  LruStorage storage;
+  ASSERT_TRUE(storage.OpenOrCreate(file.c_str(), 4, 4, kSeed));
+  std::vector<std::string> values;
+  storage.GetAllValues(&values);
+  EXPECT_THAT(values, ::testing::ElementsAre("eeee", "dddd", "bbbb", "cccc"));
+}
+
 }  // namespace storage
 }  // namespace mozc
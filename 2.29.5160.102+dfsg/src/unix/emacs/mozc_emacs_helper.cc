@@ -108,6 +108,17 @@ void ProcessLoop() {
         }
         break;
       }
+      case mozc::commands::Input::SEND_KEYS: {
+        std::shared_ptr<mozc::client::Client> client =
+            client_pool.GetClient(session_id);
+        CHECK(client.get());
+        const std::vector<mozc::commands::KeyEvent> keys(
+            command.input().keys().begin(), command.input().keys().end());
+        if (!client->SendKeys(keys, command.mutable_output())) {
+          ErrorExit(mozc::emacs::kErrSessionError, "Session failed");
+        }
+        break;
+      }
       default:
         ErrorExit(mozc::emacs::kErrVoidFunction, "Unknown function");
     }
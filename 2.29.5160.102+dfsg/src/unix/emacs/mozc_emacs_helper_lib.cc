@@ -63,6 +63,40 @@ void PrintFieldValue(const protobuf::Message &message,
                      const protobuf::Reflection &reflection,
                      const protobuf::FieldDescriptor &field, int index,
                      std::vector<std::string> *output);
+
+// Parses KEY... in tokens[begin, end) into |key|.
+void ParseKey(const std::vector<std::string> &tokens, size_t begin, size_t end,
+              mozc::commands::KeyEvent *key) {
+  std::vector<std::string> keys;
+  std::string key_string;
+  for (size_t i = begin; i < end; ++i) {
+    if (isdigit(tokens[i][0])) {  // Numeric key code
+      uint32_t key_code;
+      if (!absl::SimpleAtoi(tokens[i], &key_code) || key_code > 255) {
+        ErrorExit(kErrWrongTypeArgument, "Wrong character code");
+      }
+      keys.push_back(std::string(1, static_cast<char>(key_code)));
+    } else if (tokens[i][0] == '\"') {  // String literal
+      if (!key_string.empty()) {
+        ErrorExit(kErrWrongTypeArgument, "Wrong number of key strings");
+      }
+      if (!UnquoteString(tokens[i], &key_string)) {
+        ErrorExit(kErrWrongTypeArgument, "Wrong key string literal");
+      }
+    } else {  // Key symbol
+      keys.push_back(tokens[i]);
+    }
+  }
+  if (!mozc::KeyParser::ParseKeyVector(keys, key) &&
+      // If there are any unsupported key symbols, falls back to
+      // mozc::commands::KeyEvent::UNDEFINED_KEY.
+      !mozc::KeyParser::ParseKey("undefinedkey", key)) {
+    DLOG(FATAL);  // Code must not reach here.
+  }
+  if (!key_string.empty()) {
+    key->set_key_string(key_string);
+  }
+}
 }  // namespace
 
 // Parses a line, which must be a single complete command in form of:
@@ -70,7 +104,8 @@ void PrintFieldValue(const protobuf::Message &message,
 // where EVENT_ID is an arbitrary integer used to identify the response
 // according to the command (see 'emacs-event-id' in a response).
 // Normally it's just a sequence number of transactions.
-// COMMAND is one of 'CreateSession', 'DeleteSession' and 'SendKey'.
+// COMMAND is one of 'CreateSession', 'DeleteSession', 'SendKey' and
+// 'SendKeys'.
 // ARGUMENTs depend on a command.
 // An input line must be surrounded by a pair of parentheses,
 // like a S-expression.
@@ -100,6 +135,8 @@ void ParseInputLine(const std::string &line, uint32_t *event_id,
     input->set_type(mozc::commands::Input::CREATE_SESSION);
   } else if (func == "DeleteSession") {
     input->set_type(mozc::commands::Input::DELETE_SESSION);
+  } else if (func == "SendKeys") {
+    input->set_type(mozc::commands::Input::SEND_KEYS);
   } else {
     // Mozc has SendTestKey and SendCommand commands in addition to the above.
     // But this code doesn't support them because of no need so far.
@@ -135,34 +172,31 @@ void ParseInputLine(const std::string &line, uint32_t *event_id,
         ErrorExit(kErrWrongTypeArgument, "Session ID is not an integer");
       }
       // Parse keys.
-      std::vector<std::string> keys;
-      std::string key_string;
-      for (int i = 4; i < tokens.size() - 1; ++i) {
-        if (isdigit(tokens[i][0])) {  // Numeric key code
-          uint32_t key_code;
-          if (!absl::SimpleAtoi(tokens[i], &key_code) || key_code > 255) {
-            ErrorExit(kErrWrongTypeArgument, "Wrong character code");
-          }
-          keys.push_back(std::string(1, static_cast<char>(key_code)));
-        } else if (tokens[i][0] == '\"') {  // String literal
-          if (!key_string.empty()) {
-            ErrorExit(kErrWrongTypeArgument, "Wrong number of key strings");
-          }
-          if (!UnquoteString(tokens[i], &key_string)) {
-            ErrorExit(kErrWrongTypeArgument, "Wrong key string literal");
-          }
-        } else {  // Key symbol
-          keys.push_back(tokens[i]);
-        }
+      ParseKey(tokens, 4, tokens.size() - 1, input->mutable_key());
+      break;
+    }
+    case mozc::commands::Input::SEND_KEYS: {
+      // Suppose: (EVENT_ID SendKeys SESSION_ID (KEY...) (KEY...)...)
+      if (tokens.size() < 8) {
+        ErrorExit(kErrWrongNumberOfArguments, "Wrong number of arguments");
       }
-      if (!mozc::KeyParser::ParseKeyVector(keys, input->mutable_key()) &&
-          // If there are any unsupported key symbols, falls back to
-          // mozc::commands::KeyEvent::UNDEFINED_KEY.
-          !mozc::KeyParser::ParseKey("undefinedkey", input->mutable_key())) {
-        DLOG(FATAL);  // Code must not reach here.
+      // Parse session ID.
+      if (!absl::SimpleAtoi(tokens[3], session_id)) {
+        ErrorExit(kErrWrongTypeArgument, "Session ID is not an integer");
       }
-      if (!key_string.empty()) {
-        input->mutable_key()->set_key_string(key_string);
+      // Parse a list of keys for each key event.
+      for (size_t i = 4; i < tokens.size() - 1;) {
+        if (tokens[i] != "(") {
+          ErrorExit(kErrWrongTypeArgument, "Key event is not a list");
+        }
+        const size_t end = std::find(tokens.begin() + i, tokens.end() - 1,
+                                     ")") -
+                           tokens.begin();
+        if (end == tokens.size() - 1 || end == i + 1) {
+          ErrorExit(kErrWrongTypeArgument, "Wrong key event");
+        }
+        ParseKey(tokens, i + 1, end, input->add_keys());
+        i = end + 1;
       }
       break;
     }
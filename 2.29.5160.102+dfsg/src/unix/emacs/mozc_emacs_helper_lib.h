@@ -62,7 +62,8 @@ inline constexpr char kErrSessionError[] = "session-error";
 // where EVENT_ID is an arbitrary integer used to identify the response
 // according to the command (see 'emacs-event-id' in a response).
 // Normally it's just a sequence number of transactions.
-// COMMAND is one of 'CreateSession', 'DeleteSession' and 'SendKey'.
+// COMMAND is one of 'CreateSession', 'DeleteSession', 'SendKey' and
+// 'SendKeys'.
 // ARGUMENTs depend on a command.
 // An input line must be surrounded by a pair of parentheses,
 // like a S-expression.
@@ -148,6 +148,17 @@ TEST_F(MozcEmacsHelperLibTest, ParseInputLine) {
                         "type: SEND_KEY "
                         "key { key_code: 72 "
                         "key_string: \"\\007\\010\\t\\n \\177\" }");
+
+  // SendKeys
+  ParseAndTestInputLine("(14 SendKeys 12 (97) (32 shift) (return))", 14, 12,
+                        "type: SEND_KEYS "
+                        "keys { key_code: 97 } "
+                        "keys { key_code: 32 modifier_keys: SHIFT } "
+                        "keys { special_key: ENTER }");
+  ParseAndTestInputLine("(15 SendKeys 13 (97 \"\343\201\241\"))", 15, 13,
+                        "type: SEND_KEYS "
+                        "keys { key_code: 97 "
+                        "key_string: \"\\343\\201\\241\" }");
 }
 
 TEST_F(MozcEmacsHelperLibTest, PrintMessage) {
@@ -46,6 +46,7 @@ std::unique_ptr<mozc::client::ClientInterface> CreateAndConfigureClient() {
   mozc::commands::Capability capability;
   capability.set_text_deletion(
       mozc::commands::Capability::DELETE_PRECEDING_TEXT);
+  capability.set_output_delta(true);
   client->set_client_capability(capability);
   return client;
 }
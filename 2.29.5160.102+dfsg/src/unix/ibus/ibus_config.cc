@@ -29,6 +29,7 @@
 
 #include "unix/ibus/ibus_config.h"
 
+#include <cstdint>
 #include <string>
 #include <utility>
 
@@ -184,4 +185,8 @@ bool IbusConfig::IsActiveOnLaunch() const {
   // https://github.com/google/mozc/issues/201
   return false;
 }
+
+uint32_t IbusConfig::GetSuggestionDebounceMsec() const {
+  return config_.suggestion_debounce_msec();
+}
 }  // namespace mozc
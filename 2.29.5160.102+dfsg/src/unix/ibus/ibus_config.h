@@ -30,6 +30,7 @@
 #ifndef MOZC_UNIX_IBUS_IBUS_CONFIG_H_
 #define MOZC_UNIX_IBUS_IBUS_CONFIG_H_
 
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -57,6 +58,7 @@ class IbusConfig {
   const std::string &GetLayout(absl::string_view name) const;
   const ibus::Config &GetConfig() const;
   bool IsActiveOnLaunch() const;
+  uint32_t GetSuggestionDebounceMsec() const;
 
   ibus::Engine::CompositionMode GetCompositionMode(
       absl::string_view engine_name) const;
@@ -32,6 +32,7 @@
 #include <string>
 
 #include "testing/gunit.h"
+#include "absl/strings/str_cat.h"
 
 namespace mozc {
 namespace ibus {
@@ -91,5 +92,21 @@ active_on_launch: False
   EXPECT_EQ(config_proto.engines(0).layout_option(), "09AZaz______________-");
 }
 
+TEST(IbusConfigTest, SuggestionDebounceMsec) {
+  IbusConfig config;
+  const std::string config_data = R"(engines {
+  name : "mozc-jp"
+  longname : "Mozc"
+  layout : "default"
+}
+)";
+  EXPECT_TRUE(config.LoadConfig(config_data));
+  EXPECT_EQ(config.GetSuggestionDebounceMsec(), 0);
+
+  EXPECT_TRUE(config.LoadConfig(
+      absl::StrCat(config_data, "suggestion_debounce_msec: 40\n")));
+  EXPECT_EQ(config.GetSuggestionDebounceMsec(), 40);
+}
+
 }  // namespace ibus
 }  // namespace mozc
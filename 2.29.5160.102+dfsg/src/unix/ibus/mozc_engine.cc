@@ -171,12 +171,16 @@ bool GetSurroundingText(IbusEngineWrapper *engine,
   return true;
 }
 
-std::unique_ptr<client::ClientInterface> CreateAndConfigureClient() {
+std::unique_ptr<client::ClientInterface> CreateAndConfigureClient(
+    uint32_t suggestion_debounce_msec) {
   std::unique_ptr<client::ClientInterface> client(
       client::ClientFactory::NewClient());
-  // Currently client capability is fixed.
   commands::Capability capability;
   capability.set_text_deletion(commands::Capability::DELETE_PRECEDING_TEXT);
+  capability.set_output_delta(true);
+  if (suggestion_debounce_msec > 0) {
+    capability.set_suggestion_debounce_msec(suggestion_debounce_msec);
+  }
   client->set_client_capability(capability);
   return client;
 }
@@ -217,14 +221,15 @@ bool UseMozcCandidateWindow() {
 MozcEngine::MozcEngine()
     : last_sync_time_(Clock::GetTime()),
       key_event_handler_(new KeyEventHandler),
-      client_(CreateAndConfigureClient()),
 #ifdef MOZC_ENABLE_X11_SELECTION_MONITOR
       selection_monitor_(SelectionMonitorFactory::Create(1024)),
 #endif  // MOZC_ENABLE_X11_SELECTION_MONITOR
       preedit_handler_(new PreeditHandler()),
       use_mozc_candidate_window_(UseMozcCandidateWindow()),
-      mozc_candidate_window_handler_(new renderer::RendererClient()),
-      preedit_method_(config::Config::ROMAN) {
+      mozc_candidate_window_handler_(new renderer::AsyncRendererClient()),
+      preedit_method_(config::Config::ROMAN),
+      suggestion_timer_id_(0),
+      suggestion_engine_(nullptr) {
   if (selection_monitor_ != nullptr) {
     selection_monitor_->StartMonitoring();
   }
@@ -233,6 +238,7 @@ MozcEngine::MozcEngine()
   }
 
   ibus_config_.Initialize();
+  client_ = CreateAndConfigureClient(ibus_config_.GetSuggestionDebounceMsec());
   property_handler_ = std::make_unique<PropertyHandler>(
       std::make_unique<LocaleBasedMessageTranslator>(GetMessageLocale()),
       ibus_config_.IsActiveOnLaunch(), client_.get());
@@ -241,10 +247,14 @@ MozcEngine::MozcEngine()
   // as expected.
 }
 
-MozcEngine::~MozcEngine() { SyncData(true); }
+MozcEngine::~MozcEngine() {
+  CancelSuggestion();
+  SyncData(true);
+}
 
 void MozcEngine::CandidateClicked(IbusEngineWrapper *engine, uint index,
                                   uint button, uint state) {
+  CancelSuggestion();
   if (index >= unique_candidate_ids_.size()) {
     return;
   }
@@ -364,6 +374,7 @@ bool MozcEngine::ProcessKeyEvent(IbusEngineWrapper *engine, uint keyval,
                                  uint keycode, uint modifiers) {
   VLOG(2) << "keyval: " << keyval << ", keycode: " << keycode
           << ", modifiers: " << modifiers;
+  CancelSuggestion();
   if (property_handler_->IsDisabled()) {
     return false;
   }
@@ -403,6 +414,7 @@ bool MozcEngine::ProcessKeyEvent(IbusEngineWrapper *engine, uint keyval,
   VLOG(2) << output.DebugString();
 
   UpdateAll(engine, output);
+  ScheduleSuggestion(engine, output);
 
   return output.consumed();
 }
@@ -535,7 +547,50 @@ bool MozcEngine::LaunchTool(const commands::Output &output) const {
   return true;
 }
 
+void MozcEngine::ScheduleSuggestion(IbusEngineWrapper *engine,
+                                    const commands::Output &output) {
+  CancelSuggestion();
+  if (!output.suggestion_deferred()) {
+    return;
+  }
+  suggestion_engine_ = engine->GetEngine();
+  g_object_ref(suggestion_engine_);
+  suggestion_timer_id_ =
+      g_timeout_add(ibus_config_.GetSuggestionDebounceMsec(),
+                    &MozcEngine::OnSuggestionTimeout, this);
+}
+
+void MozcEngine::CancelSuggestion() {
+  if (suggestion_timer_id_ != 0) {
+    g_source_remove(suggestion_timer_id_);
+    suggestion_timer_id_ = 0;
+  }
+  if (suggestion_engine_ != nullptr) {
+    g_object_unref(suggestion_engine_);
+    suggestion_engine_ = nullptr;
+  }
+}
+
+// static
+gboolean MozcEngine::OnSuggestionTimeout(gpointer user_data) {
+  MozcEngine *self = static_cast<MozcEngine *>(user_data);
+  // Returning G_SOURCE_REMOVE destroys the source.
+  self->suggestion_timer_id_ = 0;
+  IbusEngineWrapper engine(self->suggestion_engine_);
+  commands::SessionCommand command;
+  command.set_type(commands::SessionCommand::UPDATE_SUGGESTION);
+  commands::Output output;
+  if (self->client_->SendCommand(command, &output)) {
+    self->UpdateAll(&engine, output);
+  } else {
+    LOG(ERROR) << "UpdateSuggestion failed";
+  }
+  self->CancelSuggestion();
+  return G_SOURCE_REMOVE;
+}
+
 void MozcEngine::RevertSession(IbusEngineWrapper *engine) {
+  CancelSuggestion();
   // TODO(team): We should skip following actions when there is no on-going
   // omposition.
   commands::SessionCommand command;
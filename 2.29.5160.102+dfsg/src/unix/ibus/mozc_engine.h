@@ -127,6 +127,13 @@ class MozcEngine : public EngineInterface {
   // always calls SyncData.
   void SyncData(bool force);
 
+  // Schedules SessionCommand::UPDATE_SUGGESTION when |output| says that the
+  // suggestion was deferred, and cancels the pending one otherwise.
+  void ScheduleSuggestion(IbusEngineWrapper *engine,
+                          const commands::Output &output);
+  void CancelSuggestion();
+  static gboolean OnSuggestionTimeout(gpointer user_data);
+
   // Reverts internal state of mozc_server by sending SessionCommand::REVERT IPC
   // message, then hides a preedit string and the candidate window.
   void RevertSession(IbusEngineWrapper *engine);
@@ -153,6 +160,11 @@ class MozcEngine : public EngineInterface {
   std::vector<int32_t> unique_candidate_ids_;
   IbusConfig ibus_config_;
 
+  // GLib source id of the pending UPDATE_SUGGESTION, or 0 if none.
+  uint suggestion_timer_id_;
+  // The engine to update when the timer fires. Referenced while pending.
+  IBusEngine *suggestion_engine_;
+
   friend class LaunchToolTest;
   FRIEND_TEST(LaunchToolTest, LaunchToolTest);
 };